@@ -3,6 +3,7 @@
 #include "IControl.h"
 #include "resource.h"
 #include <math.h>
+#include <limits.h>
 
 // The number of presets/programs
 const int kNumPrograms = 8;
@@ -101,20 +102,20 @@ public:
       {
         case 0: //Save Program
           fileName.Set(mPlug->GetPresetName(mPlug->GetCurrentPresetIdx()));
-          GetGUI()->PromptForFile(&fileName, kFileSave, &mPreviousPath, "fxp");
+          mPlug->GetGUI()->PromptForFile(&fileName, kFileSave, &mPreviousPath, "fxp");
           mPlug->SaveProgramAsFXP(&fileName);
           break;
         case 1: //Save Bank
           fileName.Set("IPlugChunksBank");
-          GetGUI()->PromptForFile(&fileName, kFileSave, &mPreviousPath, "fxb");
+          mPlug->GetGUI()->PromptForFile(&fileName, kFileSave, &mPreviousPath, "fxb");
           mPlug->SaveBankAsFXB(&fileName);
           break;
         case 3: //Load Preset
-          GetGUI()->PromptForFile(&fileName, kFileOpen, &mPreviousPath, "fxp");
+          mPlug->GetGUI()->PromptForFile(&fileName, kFileOpen, &mPreviousPath, "fxp");
           mPlug->LoadProgramFromFXP(&fileName);
           break;
         case 4: // Load Bank
-          GetGUI()->PromptForFile(&fileName, kFileOpen, &mPreviousPath, "fxb");
+          mPlug->GetGUI()->PromptForFile(&fileName, kFileOpen, &mPreviousPath, "fxb");
           mPlug->LoadBankFromFXB(&fileName);
           break;
         default:
@@ -171,11 +171,11 @@ void IPlugConvoEngine::Reset()
 {
 	TRACE; IMutexLock lock(this);
 
-	// Detect a change in sample rate.
+	// Detect a change in sample rate. If the impulse for a previous change
+	// hasn't been picked up by the audio thread yet, it is replaced by this
+	// one.
 	if (GetSampleRate() != mSampleRate)
 	{
-		mSampleRate = GetSampleRate();
-
 		const int irLength = sizeof(mIR) / sizeof(mIR[0]);
 		const double irSampleRate = 44100.;
 		mImpulse.SetNumChannels(1);
@@ -189,11 +189,14 @@ void IPlugConvoEngine::Reset()
 		#endif
 
 		// Resample the impulse response.
-		int len = mImpulse.SetLength(ResampleLength(irLength, irSampleRate, mSampleRate));
-		if (len) Resample(mIR, irLength, irSampleRate, mImpulse.impulses[0].Get(), len, mSampleRate);
-
-		// Tie the impulse response to the convolution engine.
-		mEngine.SetImpulse(&mImpulse);
+		const double sampleRate = GetSampleRate();
+		int len = mImpulse.SetLength(ResampleLength(irLength, irSampleRate, sampleRate));
+		if (len) Resample(mIR, irLength, irSampleRate, mImpulse.impulses[0].Get(), len, sampleRate);
+
+		// Tie the impulse response to the convolution engine. The FFTs are
+		// done here, the audio thread crossfades to the new impulse on its
+		// next block, once it has been fed an impulse length of input.
+		if (mEngine.PrepareImpulse(&mImpulse, 1, 0, 0, 0, 0, 0, GetBlockSize())) mSampleRate = sampleRate;
 	}
 }
 
@@ -64,7 +64,7 @@ private:
 	static const float mIR[512];
 
 	WDL_ImpulseBuffer mImpulse;
-	WDL_ConvolutionEngine_Div mEngine;
+	WDL_ConvolutionEngine_Crossfade mEngine;
 
 	#if defined(_USE_WDL_RESAMPLER) || defined(_USE_R8BRAIN)
 	static const int mBlockLength = 64;
@@ -36,14 +36,14 @@ IPlugEEL::IPlugEEL(IPlugInstanceInfo instanceInfo)
 {
   TRACE;
   
-  vm = NSEEL_VM_alloc(); // create virtual machine
+  vm = NSEEL_VM_alloc_ex(NSEEL_VM_FLAG_CODECACHE); // create virtual machine, instances after the second reuse the compiled script
+  NSEEL_VM_reserveRAM(vm, NSEEL_RAM_ITEMSPERBLOCK); // preallocate one megabuf block (64k items), so the first block a script touches isn't allocated on the audio thread
   
-  mVmOutput = NSEEL_VM_regvar(vm, "x"); // register a variable into vm to get a value out
-
   memset(codetext, 0, 65536);
-  strcpy(codetext, "x=rand(2)-1.;");
+  strcpy(codetext, "spl0=rand(2)-1.;\nspl1=spl0;");
   
-  codehandle = NSEEL_code_compile(vm, codetext, 0); // compile code
+  // compile code in block mode: spl0/spl1 are bound to the channel buffers and the script runs once per block
+  codehandle = NSEEL_code_compile_ex(vm, codetext, 0, NSEEL_CODE_COMPILE_FLAG_BLOCK);
 
   //arguments are: name, defaultVal, minVal, maxVal, step, label
   GetParam(kGain)->InitDouble("Gain", 50., 0., 100.0, 0.01, "%");
@@ -78,16 +78,15 @@ void IPlugEEL::ProcessDoubleReplacing(double** inputs, double** outputs, int nFr
 {
   // Mutex is already locked for us.
 
-  double* in1 = inputs[0];
-  double* in2 = inputs[1];
+  NSEEL_code_execute_block(codehandle, nFrames, inputs, 2, outputs, 2);
+
   double* out1 = outputs[0];
   double* out2 = outputs[1];
 
-  for (int s = 0; s < nFrames; ++s, ++in1, ++in2, ++out1, ++out2)
+  for (int s = 0; s < nFrames; ++s, ++out1, ++out2)
   {
-    NSEEL_code_execute(codehandle);
-    *out1 = *mVmOutput * mGain;
-    *out2 = *out1;
+    *out1 *= mGain;
+    *out2 *= mGain;
   }
 }
 
@@ -55,7 +55,6 @@ public:
 
 private:
   double mGain;
-  double* mVmOutput;
   
   NSEEL_VMCTX vm;
   NSEEL_CODEHANDLE codehandle;
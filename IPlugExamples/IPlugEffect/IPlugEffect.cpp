@@ -30,6 +30,9 @@ IPlugEffect::IPlugEffect(IPlugInstanceInfo instanceInfo)
   GetParam(kGain)->InitDouble("Gain", 50., 0., 100.0, 0.01, "%");
   GetParam(kGain)->SetShape(2.);
 
+  // Single precision hosts call ProcessSingleReplacing() directly, see below.
+  SetNativeFloatProcessing(true);
+
   IGraphics* pGraphics = MakeGraphics(this, kWidth, kHeight);
   pGraphics->AttachPanelBackground(&COLOR_RED);
 
@@ -46,18 +49,30 @@ IPlugEffect::IPlugEffect(IPlugInstanceInfo instanceInfo)
 IPlugEffect::~IPlugEffect() {}
 
 void IPlugEffect::ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames)
+{
+  ProcessReplacing(inputs, outputs, nFrames);
+}
+
+void IPlugEffect::ProcessSingleReplacing(float** inputs, float** outputs, int nFrames)
+{
+  ProcessReplacing(inputs, outputs, nFrames);
+}
+
+template <class SAMPLETYPE>
+void IPlugEffect::ProcessReplacing(SAMPLETYPE** inputs, SAMPLETYPE** outputs, int nFrames)
 {
   // Mutex is already locked for us.
 
-  double* in1 = inputs[0];
-  double* in2 = inputs[1];
-  double* out1 = outputs[0];
-  double* out2 = outputs[1];
+  SAMPLETYPE* in1 = inputs[0];
+  SAMPLETYPE* in2 = inputs[1];
+  SAMPLETYPE* out1 = outputs[0];
+  SAMPLETYPE* out2 = outputs[1];
+  SAMPLETYPE gain = (SAMPLETYPE) mGain;
 
   for (int s = 0; s < nFrames; ++s, ++in1, ++in2, ++out1, ++out2)
   {
-    *out1 = *in1 * mGain;
-    *out2 = *in2 * mGain;
+    *out1 = *in1 * gain;
+    *out2 = *in2 * gain;
   }
 }
 
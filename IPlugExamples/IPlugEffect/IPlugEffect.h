@@ -1,4 +1,4 @@
-b#ifndef __IPLUGEFFECT__
+#ifndef __IPLUGEFFECT__
 #define __IPLUGEFFECT__
 
 #include "IPlug_include_in_plug_hdr.h"
@@ -12,8 +12,11 @@ public:
   void Reset();
   void OnParamChange(int paramIdx);
   void ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames);
+  void ProcessSingleReplacing(float** inputs, float** outputs, int nFrames);
 
 private:
+  template <class SAMPLETYPE> void ProcessReplacing(SAMPLETYPE** inputs, SAMPLETYPE** outputs, int nFrames);
+
   double mGain;
 };
 
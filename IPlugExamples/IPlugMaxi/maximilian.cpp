@@ -33,6 +33,7 @@
 
 #include "maximilian.h"
 #include "math.h"
+#include <string.h>
 
 
 //int channels=2;
@@ -361,7 +362,7 @@ bool maxiSample::read()
 {
 	bool result;
 	ifstream inFile( myPath.c_str(), ios::in | ios::binary);
-	result = inFile;
+	result = inFile.is_open();
 	if (inFile) {
 		bool datafound = false;
 		inFile.seekg(4, ios::beg);
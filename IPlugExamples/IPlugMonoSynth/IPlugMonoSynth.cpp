@@ -5,15 +5,16 @@
 #include "IControl.h"
 #include "IKeyboardControl.h"
 
+#ifdef OS_OSX
+// WavetableBank builds its tables with the real FFT, the Xcode project doesn't list fft.c
+#include "../../WDL/fft.c"
+#endif
+
 
 const int kNumPrograms = 8;
 
 #define PITCH 440.
 
-#ifndef M_PI
-#define M_PI  (3.14159265)
-#endif
-
 enum EParams
 {
   kGainL = 0,
@@ -24,10 +25,11 @@ enum EParams
 
 IPlugMonoSynth::IPlugMonoSynth(IPlugInstanceInfo instanceInfo)
   : IPLUG_CTOR(kNumParams, kNumPrograms, instanceInfo),
-    mGainL(1.),
-    mGainR(1.),
     mNoteGain(0.),
-    mPhase(0),
+    mNoteGainSmoothed(0.),
+    mPhaseL(0.),
+    mPhaseR(0.),
+    mPhaseIncr(440. / 44100.),
     mSampleRate(44100.),
     mFreq(440.),
     mNumKeys(0),
@@ -40,6 +42,8 @@ IPlugMonoSynth::IPlugMonoSynth(IPlugInstanceInfo instanceInfo)
 
   memset(mKeyStatus, 0, 128 * sizeof(bool));
 
+  mBank = WavetableCache::Acquire(WavetableBank::kWaveSine);
+
   //arguments are: name, defaultVal, minVal, maxVal, step, label
   GetParam(kGainL)->InitDouble("GainL", -12.0, -70.0, 12.0, 0.1, "dB");
   GetParam(kGainR)->InitDouble("GainR", -12.0, -70.0, 12.0, 0.1, "dB");
@@ -51,6 +55,10 @@ IPlugMonoSynth::IPlugMonoSynth(IPlugInstanceInfo instanceInfo)
   GetParam(kMode)->SetDisplayText(4, "e");
   GetParam(kMode)->SetDisplayText(5, "f");
 
+  // the gains are smoothed in dB, GetSmoothedParam() hands ProcessDoubleReplacing() a value per sample
+  SetParamSmoothing(kGainL, 20.);
+  SetParamSmoothing(kGainR, 20.);
+
   IGraphics* pGraphics = MakeGraphics(this, kWidth, kHeight);
   pGraphics->AttachBackground(BG_ID, BG_FN);
 
@@ -74,7 +82,10 @@ IPlugMonoSynth::IPlugMonoSynth(IPlugInstanceInfo instanceInfo)
   MakeDefaultPreset((char *) "-", kNumPrograms);
 }
 
-IPlugMonoSynth::~IPlugMonoSynth() {}
+IPlugMonoSynth::~IPlugMonoSynth()
+{
+  WavetableCache::Release(mBank);
+}
 
 void IPlugMonoSynth::ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames)
 {
@@ -83,7 +94,12 @@ void IPlugMonoSynth::ProcessDoubleReplacing(double** inputs, double** outputs, i
 //  double* in2 = inputs[1];
   double* out1 = outputs[0];
   double* out2 = outputs[1];
+  const double* pGainL = GetSmoothedParam(kGainL);
+  const double* pGainR = GetSmoothedParam(kGainR);
   double peakL = 0.0, peakR = 0.0;
+  // a sine has no harmonics to cut, so it only has the one level
+  const float* pTable = mBank->GetTable(0);
+  const double size = mBank->GetSize();
 
   GetTime(&mTimeInfo);
 
@@ -133,6 +149,7 @@ void IPlugMonoSynth::ProcessDoubleReplacing(double** inputs, double** outputs, i
           {
             mNote = pMsg->NoteNumber();
             mFreq = 440. * pow(2., (mNote - 69.) / 12.);
+            mPhaseIncr = mFreq / mSampleRate;
             mNoteGain = velocity / 127.;
           }
           // Note Off
@@ -150,8 +167,16 @@ void IPlugMonoSynth::ProcessDoubleReplacing(double** inputs, double** outputs, i
       mMidiQueue.Remove();
     }
 
-    *out1 = sin( 2. * M_PI * mFreq * mPhase / mSampleRate ) * mGainLSmoother.Process(mGainL * mNoteGain);
-    *out2 = sin( 2. * M_PI * mFreq * 1.01 * (mPhase++) / mSampleRate ) * mGainRSmoother.Process(mGainR * mNoteGain);
+    // the note gain isn't a parameter, so it keeps its own one-pole declicker
+    mNoteGainSmoothed += (mNoteGain - mNoteGainSmoothed) * 0.01;
+
+    *out1 = WavetableBank::Read(pTable, (float) (mPhaseL * size), WavetableBank::kInterpLinear) * DBToAmp(pGainL[offset]) * mNoteGainSmoothed;
+    *out2 = WavetableBank::Read(pTable, (float) (mPhaseR * size), WavetableBank::kInterpLinear) * DBToAmp(pGainR[offset]) * mNoteGainSmoothed;
+
+    mPhaseL += mPhaseIncr;
+    if (mPhaseL >= 1.) mPhaseL -= 1.;
+    mPhaseR += mPhaseIncr * 1.01;
+    if (mPhaseR >= 1.) mPhaseR -= 1.;
 
     peakL = IPMAX(peakL, fabs(*out1));
     peakR = IPMAX(peakR, fabs(*out2));
@@ -181,9 +206,10 @@ void IPlugMonoSynth::Reset()
   TRACE;
   IMutexLock lock(this);
 
-  mPhase = 0;
-  mNoteGain = 0.;
+  mPhaseL = mPhaseR = 0.;
+  mNoteGain = mNoteGainSmoothed = 0.;
   mSampleRate = GetSampleRate();
+  mPhaseIncr = mFreq / mSampleRate;
   mMidiQueue.Resize(GetBlockSize());
 }
 
@@ -191,17 +217,7 @@ void IPlugMonoSynth::OnParamChange(int paramIdx)
 {
   IMutexLock lock(this);
 
-  switch (paramIdx)
-  {
-    case kGainL:
-      mGainL = GetParam(kGainL)->DBToAmp();
-      break;
-    case kGainR:
-      mGainR = GetParam(kGainR)->DBToAmp();
-      break;
-    default:
-      break;
-  }
+  // nothing to do, ProcessDoubleReplacing() reads the gains with GetSmoothedParam()
 }
 
 void IPlugMonoSynth::ProcessMidiMsg(IMidiMsg* pMsg)
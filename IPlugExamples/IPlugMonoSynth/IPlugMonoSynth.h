@@ -3,18 +3,7 @@
 
 #include "IPlug_include_in_plug_hdr.h"
 #include "IMidiQueue.h"
-
-// http://www.musicdsp.org/archive.php?classid=3#257
-
-class CParamSmooth
-{
-public:
-  CParamSmooth() { a = 0.99; b = 1. - a; z = 0.; };
-  ~CParamSmooth() {};
-  inline double Process(double in) { z = (in * b) + (z * a); return z; }
-private:
-  double a, b, z;
-};
+#include "WavetableBank.h"
 
 class IPlugMonoSynth : public IPlug
 {
@@ -43,19 +32,18 @@ private:
   int mNumKeys; // how many keys are being played (via midi)
   bool mKeyStatus[128]; // array of on/off for each key
 
-  int mPhase;
+  const WavetableBank* mBank;
+  double mPhaseL, mPhaseR; // 0 to 1
+  double mPhaseIncr;
   int mNote;
   int mKey;
 
-  double mGainL, mGainR;
   double mSampleRate;
   double mFreq;
-  double mNoteGain;
+  double mNoteGain, mNoteGainSmoothed;
   double mPrevL, mPrevR;
 
   ITimeInfo mTimeInfo;
-
-  CParamSmooth mGainLSmoother, mGainRSmoother;
 };
 
 enum ELayout
@@ -26,9 +26,8 @@ enum EParams
 
 IPlugMultiTargets::IPlugMultiTargets(IPlugInstanceInfo instanceInfo)
   : IPLUG_CTOR(kNumParams, kNumPrograms, instanceInfo),
-    mGainL(1.),
-    mGainR(1.),
     mNoteGain(0.),
+    mNoteGainSmoothed(0.),
     mPhase(0),
     mSampleRate(44100.),
     mFreq(440.),
@@ -53,6 +52,10 @@ IPlugMultiTargets::IPlugMultiTargets(IPlugInstanceInfo instanceInfo)
   GetParam(kMode)->SetDisplayText(4, "e");
   GetParam(kMode)->SetDisplayText(5, "f");
 
+  // the gains are smoothed in dB, GetSmoothedParam() hands ProcessDoubleReplacing() a value per sample
+  SetParamSmoothing(kGainL, 20.);
+  SetParamSmoothing(kGainR, 20.);
+
 #ifndef OS_IOS
   IGraphics* pGraphics = MakeGraphics(this, kWidth, kHeight);
   pGraphics->AttachBackground(BG_ID, BG_FN);
@@ -60,8 +63,8 @@ IPlugMultiTargets::IPlugMultiTargets(IPlugInstanceInfo instanceInfo)
   IBitmap knob = pGraphics->LoadIBitmap(KNOB_ID, KNOB_FN, kKnobFrames);
   IText text = IText(14);
 
-  pGraphics->AttachControl(new IKnobMultiControlText(this, IRECT(kGainX, kGainY, kGainX + 48, kGainY + 48 + 20), kGainL, &knob, &text));
-  pGraphics->AttachControl(new IKnobMultiControlText(this, IRECT(kGainX + 75, kGainY, kGainX + 48 + 75, kGainY + 48 + 20), kGainR, &knob, &text));
+  pGraphics->AttachControl(new IKnobMultiControlText(this, kGainX, kGainY, kGainL, &knob, &text, false, 10));
+  pGraphics->AttachControl(new IKnobMultiControlText(this, kGainX + 75, kGainY, kGainR, &knob, &text, false, 10));
   pGraphics->AttachControl(new ITempoDisplay(this, IRECT(300, 10, kWidth, 20), &text, &mTimeInfo));
 
   pGraphics->AttachControl(new ITestPopupMenu(this, IRECT(410, 100, 460, 115)));
@@ -102,11 +105,15 @@ void IPlugMultiTargets::ProcessSingleReplacing(float** inputs, float** outputs,
   float* in2 = inputs[1];
   float* out1 = outputs[0];
   float* out2 = outputs[1];
+  const double* pGainL = GetSmoothedParam(kGainL);
+  const double* pGainR = GetSmoothedParam(kGainR);
 
   for (int s = 0; s < nFrames; ++s, ++in1, ++in2, ++out1, ++out2)
   {
-    *out1 = sinf( 2.f * M_PI * mFreq * mPhase / mSampleRate ) * mGainLSmoother.Process(mGainL * mNoteGain);
-    *out2 = sinf( 2.f * M_PI * mFreq * 1.01f * (mPhase++) / mSampleRate ) * mGainRSmoother.Process(mGainR * mNoteGain);
+    mNoteGainSmoothed += (mNoteGain - mNoteGainSmoothed) * 0.01;
+
+    *out1 = sinf( 2.f * M_PI * mFreq * mPhase / mSampleRate ) * DBToAmp(pGainL[s]) * mNoteGainSmoothed;
+    *out2 = sinf( 2.f * M_PI * mFreq * 1.01f * (mPhase++) / mSampleRate ) * DBToAmp(pGainR[s]) * mNoteGainSmoothed;
   }
 }
 #else
@@ -117,6 +124,8 @@ void IPlugMultiTargets::ProcessDoubleReplacing(double** inputs, double** outputs
   double* in2 = inputs[1];
   double* out1 = outputs[0];
   double* out2 = outputs[1];
+  const double* pGainL = GetSmoothedParam(kGainL);
+  const double* pGainR = GetSmoothedParam(kGainR);
   double peakL = 0.0, peakR = 0.0;
 
   GetTime(&mTimeInfo);
@@ -184,8 +193,11 @@ void IPlugMultiTargets::ProcessDoubleReplacing(double** inputs, double** outputs
       mMidiQueue.Remove();
     }
 
-    *out1 = sin( 2. * M_PI * mFreq * mPhase / mSampleRate ) * mGainLSmoother.Process(mGainL * mNoteGain);
-    *out2 = sin( 2. * M_PI * mFreq * 1.01 * (mPhase++) / mSampleRate ) * mGainRSmoother.Process(mGainR * mNoteGain);
+    // the note gain isn't a parameter, so it keeps its own one-pole declicker
+    mNoteGainSmoothed += (mNoteGain - mNoteGainSmoothed) * 0.01;
+
+    *out1 = sin( 2. * M_PI * mFreq * mPhase / mSampleRate ) * DBToAmp(pGainL[offset]) * mNoteGainSmoothed;
+    *out2 = sin( 2. * M_PI * mFreq * 1.01 * (mPhase++) / mSampleRate ) * DBToAmp(pGainR[offset]) * mNoteGainSmoothed;
 
     peakL = IPMAX(peakL, fabs(*out1));
     peakR = IPMAX(peakR, fabs(*out2));
@@ -217,7 +229,7 @@ void IPlugMultiTargets::Reset()
   IMutexLock lock(this);
 
   mPhase = 0;
-  mNoteGain = 0.;
+  mNoteGain = mNoteGainSmoothed = 0.;
   mSampleRate = GetSampleRate();
   mMidiQueue.Resize(GetBlockSize());
 }
@@ -226,17 +238,7 @@ void IPlugMultiTargets::OnParamChange(int paramIdx)
 {
   IMutexLock lock(this);
 
-  switch (paramIdx)
-  {
-    case kGainL:
-      mGainL = GetParam(kGainL)->DBToAmp();
-      break;
-    case kGainR:
-      mGainR = GetParam(kGainR)->DBToAmp();
-      break;
-    default:
-      break;
-  }
+  // nothing to do, ProcessDoubleReplacing() reads the gains with GetSmoothedParam()
 }
 
 void IPlugMultiTargets::ProcessMidiMsg(IMidiMsg* pMsg)
@@ -8,18 +8,6 @@
 #include "IControl.h"
 #endif
 
-// http://www.musicdsp.org/archive.php?classid=3#257
-
-class CParamSmooth
-{
-public:
-  CParamSmooth() { a = 0.99; b = 1. - a; z = 0.; };
-  ~CParamSmooth() {};
-  inline double Process(double in) { z = (in * b) + (z * a); return z; }
-private:
-  double a, b, z;
-};
-
 class IPlugMultiTargets : public IPlug
 {
 public:
@@ -57,15 +45,12 @@ private:
   int mNote;
   int mKey;
 
-  double mGainL, mGainR;
   double mSampleRate;
   double mFreq;
-  double mNoteGain;
+  double mNoteGain, mNoteGainSmoothed;
   double mPrevL, mPrevR;
 
   ITimeInfo mTimeInfo;
-
-  CParamSmooth mGainLSmoother, mGainRSmoother;
 };
 
 #ifndef OS_IOS
@@ -5,6 +5,11 @@
 #include "IControl.h"
 #include "IKeyboardControl.h"
 
+#ifdef OS_OSX
+// WavetableBank builds its tables with the real FFT, the Xcode project doesn't list fft.c
+#include "../../WDL/fft.c"
+#endif
+
 
 const int kNumPrograms = 8;
 
@@ -30,22 +35,16 @@ IPlugPolySynth::IPlugPolySynth(IPlugInstanceInfo instanceInfo)
   : IPLUG_CTOR(kNumParams, kNumPrograms, instanceInfo),
     mSampleRate(44100.),
     mNumHeldKeys(0),
-    mKey(-1),
-    mActiveVoices(0)
+    mKey(-1)
 
 {
   TRACE;
 
-  mTable = new double[TABLE_SIZE];
-
-  for (int i = 0; i < TABLE_SIZE; i++)
-  {
-    mTable[i] = sin( i/double(TABLE_SIZE) * 2. * M_PI);
-    //printf("mTable[%i] %f\n", i, mTable[i]);
-  }
+  // Shared with every other instance
+  mBank = WavetableCache::Acquire(WavetableBank::kWaveSine, TABLE_SIZE);
 
-  mOsc = new CWTOsc(mTable, TABLE_SIZE);
-  mEnv = new CADSREnvL();
+  mVoices.setBank(mBank);
+  mVoices.setPolyphony(MAX_VOICES);
 
   memset(mKeyStatus, 0, 128 * sizeof(bool));
 
@@ -80,76 +79,23 @@ IPlugPolySynth::IPlugPolySynth(IPlugInstanceInfo instanceInfo)
 
 IPlugPolySynth::~IPlugPolySynth()
 {
-  delete mOsc;
-  delete mEnv;
-  delete [] mTable;
-}
-
-int IPlugPolySynth::FindFreeVoice()
-{
-  int v;
-
-  for(v = 0; v < MAX_VOICES; v++)
-  {
-    if(!mVS[v].GetBusy())
-      return v;
-  }
-
-  int quietestVoice = 0;
-  double level = 2.;
-
-  for(v = 0; v < MAX_VOICES; v++)
-  {
-    double summed = mVS[v].mEnv_ctx.mPrev;
-
-    if (summed < level)
-    {
-      level = summed;
-      quietestVoice = v;
-    }
-
-  }
-
-  DBGMSG("stealing voice %i\n", quietestVoice);
-  return quietestVoice;
+  WavetableCache::Release(mBank);
 }
 
 void IPlugPolySynth::NoteOnOff(IMidiMsg* pMsg)
 {
-  int v;
-
   int status = pMsg->StatusMsg();
   int velocity = pMsg->Velocity();
   int note = pMsg->NoteNumber();
 
   if (status == IMidiMsg::kNoteOn && velocity) // Note on
   {
-    v = FindFreeVoice(); // or quietest
-    mVS[v].mKey = note;
-    mVS[v].mOsc_ctx.mPhaseIncr = (1./mSampleRate) * midi2CPS(note);
-    mVS[v].mEnv_ctx.mLevel = (double) velocity / 127.;
-    mVS[v].mEnv_ctx.mStage = kStageAttack;
-
-    mActiveVoices++;
+    mVoices.noteOn(note, velocity);
   }
   else  // Note off
   {
-    for (v = 0; v < MAX_VOICES; v++)
-    {
-      if (mVS[v].mKey == note)
-      {
-        if (mVS[v].GetBusy())
-        {
-          mVS[v].mKey = -1;
-          mVS[v].mEnv_ctx.mStage = kStageRelease;
-          mVS[v].mEnv_ctx.mReleaseLevel = mVS[v].mEnv_ctx.mPrev;
-
-          return;
-        }
-      }
-    }
+    mVoices.noteOff(note);
   }
-
 }
 
 void IPlugPolySynth::ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames)
@@ -176,15 +122,14 @@ void IPlugPolySynth::ProcessDoubleReplacing(double** inputs, double** outputs, i
     }
   }
 
-  if (mActiveVoices > 0 || !mMidiQueue.Empty()) // block not empty
-  {
-    double* out1 = outputs[0];
-    double* out2 = outputs[1];
+  double* out1 = outputs[0];
+  double* out2 = outputs[1];
 
-    double output;
-    CVoiceState* vs;
-
-    for (int s = 0; s < nFrames; ++s)
+  if (mVoices.getNumActive() > 0 || !mMidiQueue.Empty()) // block not empty
+  {
+    // Render the voices up to the next MIDI event, apply it, repeat: sample accurate without a per sample loop.
+    int s = 0;
+    while (s < nFrames)
     {
       while (!mMidiQueue.Empty())
       {
@@ -212,29 +157,26 @@ void IPlugPolySynth::ProcessDoubleReplacing(double** inputs, double** outputs, i
         mMidiQueue.Remove();
       }
 
-      output = 0.;
+      int end = nFrames;
+      if (!mMidiQueue.Empty() && mMidiQueue.Peek()->mOffset < end) end = mMidiQueue.Peek()->mOffset;
 
-      for(int v = 0; v < MAX_VOICES; v++) // for each vs
-      {
-        vs = &mVS[v];
-
-        if (vs->GetBusy())
-        {
-          output += mOsc->process(&vs->mOsc_ctx) * mEnv->process(&vs->mEnv_ctx);
-        }
-      }
-
-      output *= GAIN_FACTOR;
+      mVoices.process(out1 + s, end - s);
+      s = end;
+    }
 
-      *out1++ = output;
-      *out2++ = output;
+    for (s = 0; s < nFrames; ++s)
+    {
+      out1[s] *= GAIN_FACTOR;
+      out2[s] = out1[s];
     }
 
     mMidiQueue.Flush(nFrames);
   }
-//  else // empty block
-//  {
-//  }
+  else // empty block
+  {
+    memset(out1, 0, nFrames * sizeof(double));
+    memset(out2, 0, nFrames * sizeof(double));
+  }
 }
 
 void IPlugPolySynth::Reset()
@@ -244,7 +186,7 @@ void IPlugPolySynth::Reset()
 
   mSampleRate = GetSampleRate();
   mMidiQueue.Resize(GetBlockSize());
-  mEnv->setSampleRate(mSampleRate);
+  mVoices.setSampleRate(mSampleRate);
 }
 
 void IPlugPolySynth::OnParamChange(int paramIdx)
@@ -254,16 +196,16 @@ void IPlugPolySynth::OnParamChange(int paramIdx)
   switch (paramIdx)
   {
     case kAttack:
-      mEnv->setStageTime(kStageAttack, GetParam(kAttack)->Value());
+      mVoices.setStageTime(kStageAttack, GetParam(kAttack)->Value());
       break;
     case kDecay:
-      mEnv->setStageTime(kStageDecay, GetParam(kDecay)->Value());
+      mVoices.setStageTime(kStageDecay, GetParam(kDecay)->Value());
       break;
     case kSustain:
-      mEnv->setSustainLevel( GetParam(kSustain)->Value() );
+      mVoices.setSustainLevel( GetParam(kSustain)->Value() );
       break;
     case kRelease:
-      mEnv->setStageTime(kStageRelease, GetParam(kRelease)->Value());
+      mVoices.setStageTime(kStageRelease, GetParam(kRelease)->Value());
       break;
     default:
       break;
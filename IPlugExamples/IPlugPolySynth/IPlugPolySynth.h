@@ -5,7 +5,7 @@
 #include "IMidiQueue.h"
 #include "IPlugPolySynthDSP.h"
 
-#define MAX_VOICES 16
+#define MAX_VOICES 128
 #define ATTACK_DEFAULT 5.
 #define DECAY_DEFAULT 20.
 #define RELEASE_DEFAULT 500.
@@ -33,24 +33,20 @@ public:
 private:
 
   void NoteOnOffPoly(IMidiMsg* pMsg);
-  int FindFreeVoice();
 
   IBitmapOverlayControl* mAboutBox;
   IControl* mKeyboard;
 
   IMidiQueue mMidiQueue;
 
-  int mActiveVoices;
   int mKey;
   int mNumHeldKeys;
   bool mKeyStatus[128]; // array of on/off for each key
 
   double mSampleRate;
 
-  CVoiceState mVS[MAX_VOICES];
-  CWTOsc* mOsc;
-  CADSREnvL* mEnv;
-  double* mTable;
+  CVoicePool mVoices;
+  const WavetableBank* mBank;
 };
 
 enum ELayout
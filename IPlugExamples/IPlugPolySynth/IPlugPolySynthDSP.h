@@ -2,6 +2,8 @@
 #ifndef __IPLUGPOLYSYNTHDSP__
 #define __IPLUGPOLYSYNTHDSP__
 
+#include "WavetableBank.h"
+
 const double ENV_VALUE_LOW = 0.000001; // -120dB
 const double ENV_VALUE_HIGH = 0.999;
 const double MIN_ENV_TIME_MS = 0.5;
@@ -46,220 +48,426 @@ inline double calcIncrFromTimeLinear(double timeMS, double sr)
   else return (1./sr) / (timeMS/1000.);
 }
 
-struct CWTOscState
+enum EADSREnvStage
 {
-  double mPhase;        // float phase (goes between 0. and 1.)
-  double mPhaseIncr;    // freq * mPhaseStep
-
-  CWTOscState()
-  {
-    mPhase = 0.;
-    mPhaseIncr = 0.;
-  }
-
-} WDL_FIXALIGN;
+  kIdle = 0,
+  kStageAttack,
+  kStageDecay,
+  kStageSustain,
+  kStageRelease,
+};
 
-class CWTOsc
+enum EVoiceSteal
 {
-protected:
-  const double* mLUT;           // pointer to waveform lookup table, const because the oscilator doesn't change the table data
-  unsigned long int mLUTSize;   // wavetable size
-  unsigned long int mLUTSizeM;  // wavetable Mask (size -1)
-  double mLUTSizeF;             // float version
+  kStealQuietest = 0,   // the voice with the lowest envelope output, scans the voices
+  kStealOldest,         // the longest sounding voice, O(1)
+  kStealNone            // ignore notes when all voices are busy
+};
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define POLYSYNTH_SSE2
+#endif
+
+// Every voice's wavetable oscillator and linear ADSR, kept as structure of arrays. The sounding voices are packed in
+// slots [0, mNumActive) and rendered kLanes at a time. Starting a voice takes the next free slot, a voice that
+// finishes is replaced by the last one, and a list in note-on order finds the oldest voice, so none of it scans.
+//
+// Each envelope stage is value += incr, out = value * mul + add, with incr/mul/add set per voice when its stage
+// changes, so the render loop has no branches until a voice crosses a stage threshold.
+//
+// The oscillators read a shared WavetableBank, each voice from the band-limited level for its pitch and with its own
+// interpolation order, picked when the note starts.
+class CVoicePool
+{
 public:
+  enum { kLanes = 4, kMaxVoices = 128, kChunk = 64 };
 
-  CWTOsc(const double* LUT, unsigned long int LUTSize)
+  CVoicePool()
+    : mNumActive(0), mPolyphony(kMaxVoices), mSteal(kStealQuietest), mOldest(-1), mNewest(-1), mNumRetire(0),
+      mSampleRate(44100.), mSustainLevel(1.f), mBank(0), mTableSize(0.f), mInterp(WavetableBank::kInterpLinear)
   {
-    setLUT(LUT, LUTSize);
+    memset(mPhase, 0, sizeof(mPhase));
+    memset(mPhaseIncr, 0, sizeof(mPhaseIncr));
+    memset(mEnvValue, 0, sizeof(mEnvValue));
+    memset(mEnvIncr, 0, sizeof(mEnvIncr));
+    memset(mEnvMul, 0, sizeof(mEnvMul));
+    memset(mEnvAdd, 0, sizeof(mEnvAdd));
+    memset(mLevel, 0, sizeof(mLevel));
+    memset(mPrev, 0, sizeof(mPrev));
+    memset(mReleaseLevel, 0, sizeof(mReleaseLevel));
+    memset(mStage, 0, sizeof(mStage));
+    memset(mTab, 0, sizeof(mTab));
+    memset(mCubic, 0, sizeof(mCubic));
+    for (int v = 0; v < kMaxVoices; v++) mKey[v] = -1;
+    for (int k = 0; k < 128; k++) mKeyVoice[k] = -1;
+
+    mStageTime[kStageAttack] = 1.;
+    mStageTime[kStageDecay] = 100.;
+    mStageTime[kStageRelease] = 20.;
+    updateIncrs();
   }
 
-  ~CWTOsc() {}
+  ~CVoicePool() {}
 
-  void setLUT(const double* LUT, unsigned long int LUTSize)
+  // Not owned, see WavetableCache. Must be set before process().
+  void setBank(const WavetableBank* pBank)
   {
-    mLUTSize = LUTSize;
-    mLUTSizeM = LUTSize-1;
-    mLUTSizeF = (double) LUTSize;
-    mLUT = LUT;
+    mBank = pBank;
+    mTableSize = pBank->GetSizeF();
+    for (int v = 0; v < kMaxVoices; v++)
+    {
+      mTab[v] = pBank->GetTable(v < mNumActive ? pBank->GetLevel(mPhaseIncr[v]) : 0);
+    }
   }
 
-  inline double process(CWTOscState* pState)
+  // For the voices started from now on, voices already sounding keep theirs.
+  void setInterpolation(WavetableBank::EInterp interp) { mInterp = interp; }
+
+  void setPolyphony(int n) { mPolyphony = n < 1 ? 1 : n > kMaxVoices ? kMaxVoices : n; }
+  void setStealMode(EVoiceSteal mode) { mSteal = mode; }
+
+  void setSampleRate(double sr)
   {
-    pState->mPhase = wrap(pState->mPhase, 0., 1.);
-    const double output = lerp(pState->mPhase * mLUTSizeF, mLUT, mLUTSizeM);
-    pState->mPhase += pState->mPhaseIncr;
+    mSampleRate = sr;
+    updateIncrs();
+  }
 
-    return output;
+  void setStageTime(int stage, double timeMS)
+  {
+    if (stage == kStageAttack || stage == kStageDecay || stage == kStageRelease)
+    {
+      mStageTime[stage] = timeMS;
+      updateIncrs();
+    }
   }
 
-} WDL_FIXALIGN;
+  void setSustainLevel(double sustainLevel)
+  {
+    mSustainLevel = (float) sustainLevel;
+    refreshStages();
+  }
 
-enum EADSREnvStage
-{
-  kIdle = 0,
-  kStageAttack,
-  kStageDecay,
-  kStageSustain,
-  kStageRelease,
-};
+  int getNumActive() const { return mNumActive; }
 
-struct CADSREnvLState
-{
-  double mEnvValue;          // current value of the envelope
-  int mStage;                // idle, attack, decay, sustain, release
-  double mLevel;             // envelope depth
-  double mPrev;
-  double mReleaseLevel;
+  // interp < 0 for the one set with setInterpolation().
+  void noteOn(int key, int velocity, int interp = -1)
+  {
+    // A retriggered key releases its previous voice, so every held key maps to one voice.
+    if (mKeyVoice[key] >= 0) noteOff(key);
+
+    int v;
+    if (mNumActive < mPolyphony)
+    {
+      v = mNumActive++;
+      mPhase[v] = 0.f;
+      mEnvValue[v] = 0.f;
+      linkNewest(v);
+    }
+    else
+    {
+      v = findVoiceToSteal();
+      if (v < 0) return;
+      DBGMSG("stealing voice %i\n", v);
+      if (mKey[v] >= 0) mKeyVoice[mKey[v]] = -1;
+      unlink(v);
+      linkNewest(v);
+      // Attack starts from the stolen voice's current envelope value, as it always has.
+    }
 
-  CADSREnvLState()
+    mKey[v] = key;
+    mKeyVoice[key] = v;
+    mPhaseIncr[v] = (float) ((1./mSampleRate) * midi2CPS(key));
+    if (mBank) mTab[v] = mBank->GetTable(mBank->GetLevel(mPhaseIncr[v]));
+    mCubic[v] = (interp < 0 ? mInterp : interp) == WavetableBank::kInterpCubic ? -1 : 0;
+    mLevel[v] = (float) velocity / 127.f;
+    setStage(v, kStageAttack);
+  }
+
+  void noteOff(int key)
   {
-    mEnvValue = 0.;
-    mStage = kIdle;
-    mLevel = 0.;
-    mReleaseLevel = 0.;
-    mPrev = 0.;
+    int v = mKeyVoice[key];
+    if (v < 0) return;
+    mKeyVoice[key] = -1;
+    mKey[v] = -1;
+    mReleaseLevel[v] = mPrev[v];
+    setStage(v, kStageRelease);
   }
 
-} WDL_FIXALIGN;
+  // Writes nFrames of the summed voices to pOut.
+  void process(double* pOut, int nFrames)
+  {
+    if (!mBank)
+    {
+      memset(pOut, 0, nFrames * sizeof(double));
+      return;
+    }
+
+    while (nFrames > 0)
+    {
+      int n = nFrames < kChunk ? nFrames : kChunk;
+      memset(mMix, 0, n * kLanes * sizeof(float));
+      for (int g = 0; g < mNumActive; g += kLanes) processLanes(g, n);
+
+      const float* pMix = mMix;
+      for (int s = 0; s < n; s++, pMix += kLanes)
+      {
+        *pOut++ = (double) pMix[0] + pMix[1] + pMix[2] + pMix[3];
+      }
+      nFrames -= n;
+      retireIdle();
+    }
+  }
+
+private:
+  float mPhase[kMaxVoices];         // goes between 0. and 1.
+  float mPhaseIncr[kMaxVoices];     // freq / sample rate
+  float mEnvValue[kMaxVoices];
+  float mEnvIncr[kMaxVoices];
+  float mEnvMul[kMaxVoices];
+  float mEnvAdd[kMaxVoices];
+  float mLevel[kMaxVoices];         // envelope depth, velocity
+  float mPrev[kMaxVoices];          // last envelope output, before mLevel
+  float mReleaseLevel[kMaxVoices];
+  int mStage[kMaxVoices];
+  const float* mTab[kMaxVoices];   // the bank level for the voice's pitch
+  int mCubic[kMaxVoices];           // all bits set for kInterpCubic, a lane mask as is
+  int mKey[kMaxVoices];             // -1 once released
+  int mOlder[kMaxVoices], mNewer[kMaxVoices];
+  int mKeyVoice[128];
+  float mMix[kChunk * kLanes];      // per lane sums, added up once per sample
+
+  int mNumActive, mPolyphony;
+  EVoiceSteal mSteal;
+  int mOldest, mNewest;
+  int mRetire[kMaxVoices];         // voices that finished their release this chunk, retired by retireIdle()
+  int mNumRetire;
 
-class CADSREnvL
-{
-protected:
-  double mAttackIncr, mDecayIncr, mReleaseIncr;
-  double mSustainLevel, mReleaseLevel;
-  double mPrev;
   double mSampleRate;
+  double mStageTime[kStageRelease + 1];
+  float mAttackIncr, mDecayIncr, mReleaseIncr, mSustainLevel;
+  const WavetableBank* mBank;
+  float mTableSize;
+  WavetableBank::EInterp mInterp;
 
-public:
-  CADSREnvL()
+  void updateIncrs()
   {
-    mSustainLevel = 1.;
-    mReleaseLevel = 0.;
-    mPrev = 0.;
-    mSampleRate = 44100.;
-
-    setStageTime(kStageAttack, 1.);
-    setStageTime(kStageDecay, 100.);
-    setStageTime(kStageRelease, 20.);
+    mAttackIncr = (float) calcIncrFromTimeLinear(fastClip(mStageTime[kStageAttack], MIN_ENV_TIME_MS, MAX_ENV_TIME_MS), mSampleRate);
+    mDecayIncr = (float) calcIncrFromTimeLinear(fastClip(mStageTime[kStageDecay], MIN_ENV_TIME_MS, MAX_ENV_TIME_MS), mSampleRate);
+    mReleaseIncr = (float) calcIncrFromTimeLinear(fastClip(mStageTime[kStageRelease], MIN_ENV_TIME_MS, MAX_ENV_TIME_MS), mSampleRate);
+    refreshStages();
   }
 
-  void setStageTime(int stage, double timeMS)
+  void refreshStages()
   {
-    const double incr = calcIncrFromTimeLinear(fastClip(timeMS, MIN_ENV_TIME_MS, MAX_ENV_TIME_MS), mSampleRate);
+    for (int v = 0; v < mNumActive; v++) setStage(v, mStage[v]);
+  }
 
-    switch(stage)
+  void setStage(int v, int stage)
+  {
+    mStage[v] = stage;
+    switch (stage)
     {
       case kStageAttack:
-        mAttackIncr = incr;
+        mEnvIncr[v] = mAttackIncr; mEnvMul[v] = 1.f; mEnvAdd[v] = 0.f;
         break;
       case kStageDecay:
-        mDecayIncr = incr;
+        mEnvIncr[v] = -mDecayIncr; mEnvMul[v] = 1.f - mSustainLevel; mEnvAdd[v] = mSustainLevel;
+        break;
+      case kStageSustain:
+        mEnvIncr[v] = 0.f; mEnvMul[v] = 0.f; mEnvAdd[v] = mSustainLevel;
         break;
       case kStageRelease:
-        mReleaseIncr = incr;
+        mEnvIncr[v] = -mReleaseIncr; mEnvMul[v] = mReleaseLevel[v]; mEnvAdd[v] = 0.f;
         break;
       default:
-        //error
+        mEnvIncr[v] = 0.f; mEnvMul[v] = 0.f; mEnvAdd[v] = 0.f;
         break;
     }
   }
 
-  void setSustainLevel(double sustainLevel)
-  {
-    mSustainLevel = sustainLevel;
-  }
-
-  virtual void setSampleRate(double sr)
-  {
-    mSampleRate = sr;
-  }
-
-  inline double process(CADSREnvLState* pS)
+  // A voice's envelope crossed its stage threshold this sample.
+  void nextStage(int v)
   {
-    double result = 0.;
-
-    switch(pS->mStage)
+    switch (mStage[v])
     {
-      case kIdle:
-        result = pS->mEnvValue;
-        break;
       case kStageAttack:
-        pS->mEnvValue += mAttackIncr;
-        if (pS->mEnvValue > ENV_VALUE_HIGH || mAttackIncr == 0.)
-        {
-          pS->mStage = kStageDecay;
-          pS->mEnvValue = 1.0;
-        }
-        result = pS->mEnvValue;
+        mEnvValue[v] = 1.f;
+        setStage(v, kStageDecay);
         break;
       case kStageDecay:
-        pS->mEnvValue -= mDecayIncr;
-        result = (pS->mEnvValue * (1.-mSustainLevel)) + mSustainLevel;
-        if (pS->mEnvValue < ENV_VALUE_LOW)
-        {
-          pS->mStage = kStageSustain;
-          pS->mEnvValue = 1.;
-          result = mSustainLevel;
-        }
-        break;
-      case kStageSustain:
-        result = mSustainLevel;
+        mEnvValue[v] = 1.f;
+        setStage(v, kStageSustain);
         break;
       case kStageRelease:
-        pS->mEnvValue -= mReleaseIncr;
-        if(pS->mEnvValue < ENV_VALUE_LOW || mReleaseIncr == 0.)
-        {
-          pS->mStage = kIdle;
-          pS->mEnvValue = 0.0;
-        }
-        result = pS->mEnvValue * pS->mReleaseLevel;
-        break;
-      default:
-        result = pS->mEnvValue;
+        mEnvValue[v] = 0.f;
+        setStage(v, kIdle);
+        mRetire[mNumRetire++] = v; // a voice only finishes once, so this never holds more than kMaxVoices
         break;
     }
+  }
+
+  void processLanes(int g, int n)
+  {
+    float* pMix = mMix;
+    int nLanes = mNumActive - g < kLanes ? mNumActive - g : kLanes;
+
+#ifdef POLYSYNTH_SSE2
+    // Slots past mNumActive are kept at zero level and increment, so the last group renders them as silence.
+    __m128 phase = _mm_loadu_ps(mPhase + g), phaseIncr = _mm_loadu_ps(mPhaseIncr + g);
+    __m128 env = _mm_loadu_ps(mEnvValue + g), envIncr = _mm_loadu_ps(mEnvIncr + g);
+    __m128 envMul = _mm_loadu_ps(mEnvMul + g), envAdd = _mm_loadu_ps(mEnvAdd + g);
+    __m128 level = _mm_loadu_ps(mLevel + g), out = _mm_setzero_ps();
+    const __m128 cubic = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*) (mCubic + g)));
+    const __m128 one = _mm_set1_ps(1.f), size = _mm_set1_ps(mTableSize), zero = _mm_setzero_ps();
+    const __m128 high = _mm_set1_ps((float) ENV_VALUE_HIGH), low = _mm_set1_ps((float) ENV_VALUE_LOW);
+
+    for (int s = 0; s < n; s++, pMix += kLanes)
+    {
+      phase = _mm_sub_ps(phase, _mm_and_ps(_mm_cmpge_ps(phase, one), one));
+      __m128 osc = WavetableBank::Read4(mTab + g, _mm_mul_ps(phase, size), cubic);
+      phase = _mm_add_ps(phase, phaseIncr);
+
+      env = _mm_add_ps(env, envIncr);
+      __m128 cross = _mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(envIncr, zero), _mm_cmpgt_ps(env, high)),
+                               _mm_and_ps(_mm_cmplt_ps(envIncr, zero), _mm_cmplt_ps(env, low)));
+      int crossed = _mm_movemask_ps(cross);
+      if (crossed)
+      {
+        _mm_storeu_ps(mEnvValue + g, env);
+        for (int l = 0; l < nLanes; l++) if (crossed & (1 << l)) nextStage(g + l);
+        env = _mm_loadu_ps(mEnvValue + g);
+        envIncr = _mm_loadu_ps(mEnvIncr + g);
+        envMul = _mm_loadu_ps(mEnvMul + g);
+        envAdd = _mm_loadu_ps(mEnvAdd + g);
+      }
+
+      out = _mm_add_ps(_mm_mul_ps(env, envMul), envAdd);
+      _mm_storeu_ps(pMix, _mm_add_ps(_mm_loadu_ps(pMix), _mm_mul_ps(osc, _mm_mul_ps(out, level))));
+    }
+
+    _mm_storeu_ps(mPhase + g, phase);
+    _mm_storeu_ps(mEnvValue + g, env);
+    _mm_storeu_ps(mPrev + g, out);
+#else
+    for (int l = 0; l < nLanes; l++)
+    {
+      const int v = g + l;
+      float phase = mPhase[v], env = mEnvValue[v], out = mPrev[v];
+      for (int s = 0; s < n; s++)
+      {
+        if (phase >= 1.f) phase -= 1.f;
+        const float osc = WavetableBank::Read(mTab[v], phase * mTableSize,
+                                              mCubic[v] ? WavetableBank::kInterpCubic : WavetableBank::kInterpLinear);
+        phase += mPhaseIncr[v];
+
+        env += mEnvIncr[v];
+        if ((mEnvIncr[v] > 0.f && env > (float) ENV_VALUE_HIGH) || (mEnvIncr[v] < 0.f && env < (float) ENV_VALUE_LOW))
+        {
+          mEnvValue[v] = env;
+          nextStage(v);
+          env = mEnvValue[v];
+        }
 
-    pS->mPrev = result;
+        out = env * mEnvMul[v] + mEnvAdd[v];
+        pMix[s * kLanes + l] += osc * out * mLevel[v];
+      }
+      mPhase[v] = phase;
+      mEnvValue[v] = env;
+      mPrev[v] = out;
+    }
+#endif
+  }
 
-    return result * pS->mLevel;
+  // Swaps finished voices out for the last active ones, highest slot first so no moved voice is one to retire.
+  void retireIdle()
+  {
+    const int n = mNumRetire;
+    if (!n) return;
+    int* pRetire = mRetire;
+    for (int i = 1; i < n; i++)
+    {
+      for (int j = i; j > 0 && pRetire[j] > pRetire[j - 1]; j--)
+      {
+        int t = pRetire[j]; pRetire[j] = pRetire[j - 1]; pRetire[j - 1] = t;
+      }
+    }
+    for (int i = 0; i < n; i++) removeVoice(pRetire[i]);
+    mNumRetire = 0;
   }
 
-} WDL_FIXALIGN ;
+  void removeVoice(int v)
+  {
+    const int last = --mNumActive;
+    unlink(v);
+    if (mKey[v] >= 0) mKeyVoice[mKey[v]] = -1;
 
-// http://www.musicdsp.org/archive.php?classid=3#257
+    if (v != last)
+    {
+      mPhase[v] = mPhase[last];
+      mPhaseIncr[v] = mPhaseIncr[last];
+      mEnvValue[v] = mEnvValue[last];
+      mEnvIncr[v] = mEnvIncr[last];
+      mEnvMul[v] = mEnvMul[last];
+      mEnvAdd[v] = mEnvAdd[last];
+      mLevel[v] = mLevel[last];
+      mPrev[v] = mPrev[last];
+      mReleaseLevel[v] = mReleaseLevel[last];
+      mStage[v] = mStage[last];
+      mTab[v] = mTab[last];
+      mCubic[v] = mCubic[last];
+      mKey[v] = mKey[last];
+      if (mKey[v] >= 0) mKeyVoice[mKey[v]] = v;
+
+      mOlder[v] = mOlder[last];
+      mNewer[v] = mNewer[last];
+      if (mOlder[v] >= 0) mNewer[mOlder[v]] = v; else mOldest = v;
+      if (mNewer[v] >= 0) mOlder[mNewer[v]] = v; else mNewest = v;
+    }
 
-//class CParamSmooth
-//{
-//public:
-//  CParamSmooth() { a = 0.99; b = 1. - a; z = 0.; };
-//  ~CParamSmooth() {};
-//  inline double Process(double in) { z = (in * b) + (z * a); return z; }
-//private:
-//  double a, b, z;
-//};
+    // Free slots render as silence.
+    mPhase[last] = mPhaseIncr[last] = mEnvValue[last] = mEnvIncr[last] = 0.f;
+    mEnvMul[last] = mEnvAdd[last] = mLevel[last] = mPrev[last] = 0.f;
+    mStage[last] = kIdle;
+    mTab[last] = mBank->GetTable(0);
+    mCubic[last] = 0;
+    mKey[last] = -1;
+  }
 
-struct CVoiceState
-{
-  CWTOscState mOsc_ctx;
-  CADSREnvLState mEnv_ctx;
-  //bool mLastBusy;
-  int mKey;
+  void linkNewest(int v)
+  {
+    mOlder[v] = mNewest;
+    mNewer[v] = -1;
+    if (mNewest >= 0) mNewer[mNewest] = v; else mOldest = v;
+    mNewest = v;
+  }
 
-  CVoiceState()
+  void unlink(int v)
   {
-    mKey = -1;
-    //mLastBusy = false;
+    if (mOlder[v] >= 0) mNewer[mOlder[v]] = mNewer[v]; else mOldest = mNewer[v];
+    if (mNewer[v] >= 0) mOlder[mNewer[v]] = mOlder[v]; else mNewest = mOlder[v];
   }
 
-  bool GetBusy()
+  int findVoiceToSteal()
   {
-    if (mEnv_ctx.mStage == kIdle)
-      return false;
-    else
-      return true;
+    switch (mSteal)
+    {
+      case kStealOldest:
+        return mOldest;
+      case kStealQuietest:
+      {
+        int quietest = 0;
+        for (int v = 1; v < mNumActive; v++)
+        {
+          if (mPrev[v] < mPrev[quietest]) quietest = v;
+        }
+        return quietest;
+      }
+      default:
+        return -1;
+    }
   }
-};
 
+} WDL_FIXALIGN;
 
-#endif //__IPLUGPOLYSYNTHDSP__
\ No newline at end of file
+#endif //__IPLUGPOLYSYNTHDSP__
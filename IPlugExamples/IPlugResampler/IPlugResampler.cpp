@@ -65,6 +65,9 @@ void IPlugResampler::Reset()
   mResampler.Reset();
   // set input and output samplerates
   mResampler.SetRates(44100., GetSampleRate());
+  // ResamplePrepare() grows its input buffer to what a block needs, let that happen here and not on the audio thread
+  WDL_ResampleSample* pUnused;
+  mResampler.ResamplePrepare(GetBlockSize(), 1, &pUnused);
 }
 
 void IPlugResampler::ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames)
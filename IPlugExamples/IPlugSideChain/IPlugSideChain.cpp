@@ -61,7 +61,7 @@ IPlugSideChain::IPlugSideChain(IPlugInstanceInfo instanceInfo)
   pGraphics->AttachPanelBackground(&COLOR_RED);
   IBitmap knob = pGraphics->LoadIBitmap(KNOB_ID, KNOB_FN, kKnobFrames);
   IText text = IText(14);
-  pGraphics->AttachControl(new IKnobMultiControlText(this, IRECT(kGainX, kGainY, kGainX + 48, kGainY + 48 + 20), kGain, &knob, &text));
+  pGraphics->AttachControl(new IKnobMultiControlText(this, kGainX, kGainY, kGain, &knob, &text, false, 10));
 
   mMeterIdx_L = pGraphics->AttachControl(new IPeakMeterVert(this, MakeIRect(kMeterL)));
   mMeterIdx_R = pGraphics->AttachControl(new IPeakMeterVert(this, MakeIRect(kMeterR)));
@@ -95,13 +95,6 @@ void IPlugSideChain::ProcessDoubleReplacing(double** inputs, double** outputs, i
 {
   // Mutex is already locked for us.
 
-  bool in1ic = IsInChannelConnected(0);
-  bool in2ic = IsInChannelConnected(1);
-  bool in3ic = IsInChannelConnected(2);
-  bool in4ic = IsInChannelConnected(3);
-
-  printf("%i %i %i %i, ------------------------- \n", in1ic, in2ic, in3ic, in4ic);
-
 #ifdef RTAS_API
   double* in1 = inputs[0];
   double* in2 = inputs[1];
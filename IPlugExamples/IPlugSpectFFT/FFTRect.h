@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstring>
 #include <vector>
 #include <algorithm>
 #include <sstream>
@@ -48,7 +49,9 @@ To Do:
 */
 
 
-//static const double pi = 3.141592653589793238462643383279502884197169399375105820974944;
+#ifndef OS_OSX // CarbonCore's fp.h declares pi
+static const double pi = 3.141592653589793238462643383279502884197169399375105820974944;
+#endif
 static const double pi2 = 2. * pi;
 static const double pi4 = 4. * pi;
 
@@ -238,6 +241,9 @@ class gFFTAnalyzer : public IControl
             sampleRate = 44100.;
             width = static_cast<int>(mRECT.W());
             value.resize(sz / 2 + 1 );
+            pending.resize(sz / 2 + 1);
+            frame.resize(sz / 2 + 1);
+            meter.Resize(sz / 2 + 1, 1, 4);
             iVal.resize(width);
             iPeak.resize(width);
             OctaveGain = 1.;
@@ -271,14 +277,19 @@ class gFFTAnalyzer : public IControl
             else OctaveGain = g;
         }
 
+        // audio thread, the spectrum reaches Draw() through the meter buffer once the last bin is in
         void SendFFT(double v, int c, double sr)
             {
-            value[c] = v;
+            pending[c] = v;
             sampleRate = sr;
+            if (c == (int)pending.size() - 1) meter.PushValues(&pending[0]);
             }
 
         bool Draw(IGraphics* pGraphics)
             {
+            if (meter.PopLatest(&frame[0])) {
+                for (size_t b = 0; b < value.size(); b++) value[b] = frame[b].mMean;
+            }
             double x, y, yPeak;
             double xPrev = mRECT.L;
             double yPrev = mRECT.B;
@@ -351,6 +362,9 @@ class gFFTAnalyzer : public IControl
     private:
         int fftWidth, sCount, mParam, mScaleP;
         std::vector <double> value;
+        std::vector<double>pending;
+        std::vector<IMeterFrame>frame;
+        IMeterBuffer meter;
         std::vector<double>iVal;
         std::vector<double>iPeak;
         double val, fftBins, sampleRate;
@@ -71,8 +71,12 @@ Saturator::Saturator(IPlugInstanceInfo instanceInfo)
 
   
   
-  highShelf.setBiquad(bq_type_highshelf, 6000.0 / GetSampleRate(), 1.0, 0.0);
-  lowPeak.setBiquad(bq_type_peak, 90.0 /GetSampleRate(), 1.0, 0.0);
+  // The shapers alias badly at the host rate, run them at 4x.
+  EnableOversampling(4);
+  SetOversampling(4);
+  
+  highShelf.setBiquad(bq_type_highshelf, 6000.0 / (GetSampleRate() * GetOversampling()), 1.0, 0.0);
+  lowPeak.setBiquad(bq_type_peak, 90.0 / (GetSampleRate() * GetOversampling()), 1.0, 0.0);
 
   
   //MakePreset("preset 1", ... );
@@ -187,6 +191,11 @@ void Saturator::Reset()
 {
   TRACE;
   IMutexLock lock(this);
+  
+  // ProcessDoubleReplacing() runs at the oversampled rate.
+  double sampleRate = GetSampleRate() * GetOversampling();
+  highShelf.setFc(6000.0 / sampleRate);
+  lowPeak.setFc(90.0 / sampleRate);
 }
 
 void Saturator::OnParamChange(int paramIdx)
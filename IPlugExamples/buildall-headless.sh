@@ -0,0 +1,94 @@
+#! /bin/sh
+
+#shell script to build all the plugin projects in this directory as headless command line programs and run
+#each one once, for CI. needs cairo, libpng and zlib. keeps going past failures and prints a summary at the end,
+#exits non-zero if any example failed to build, or allocated memory on the audio thread. then builds and runs
+#headless-checks.cpp, which checks the WDL code the examples share.
+#usage: ./buildall-headless.sh [extra arguments for the headless program, e.g. -bs 64 -float]
+
+BASEDIR=$(dirname $0)
+
+cd $BASEDIR
+
+# examples that can't be built headless, with the reason
+skip_reason()
+{
+  case "$1" in
+    IPlugGamma)
+      echo "needs the external Gamma library";;
+    IPlugRetina)
+      echo "uses IGraphics::GetScalingFactor(), which this IGraphics doesn't have";;
+    TapeDelay)
+      echo "unfinished, doesn't compile for any target";;
+  esac
+}
+
+echo "building all example plugins headless..."
+
+PASSED=""
+FAILED=""
+SKIPPED=""
+
+for file in *
+do
+  if [ -f "$file/$file.cpp" ] && [ -f "$file/resource.h" ]
+  then
+    reason=$(skip_reason "$file")
+
+    if [ -n "$reason" ]
+    then
+      echo "skipping $file: $reason"
+      SKIPPED="$SKIPPED $file"
+      continue
+    fi
+
+    echo "building $file"
+    make -s -f Makefile.headless PLUG="$file" 2> ./build_errors.log
+
+    if [ $? -ne 0 ]
+    then
+      echo "build failed due to following errors in $file"
+      echo ""
+      cat build_errors.log
+      FAILED="$FAILED $file(build)"
+      continue
+    fi
+
+    make -s -f Makefile.headless PLUG="$file" bench BENCH_ARGS="-len 5 -notes $*"
+
+    if [ $? -ne 0 ]
+    then
+      echo "$file failed the headless run"
+      FAILED="$FAILED $file(run)"
+      continue
+    fi
+
+    PASSED="$PASSED $file"
+  fi
+done
+
+echo "building headless-checks"
+make -s -f Makefile.headless checks 2> ./build_errors.log
+
+if [ $? -ne 0 ]
+then
+  cat build_errors.log
+  FAILED="$FAILED headless-checks"
+else
+  PASSED="$PASSED headless-checks"
+fi
+
+if [ -f build_errors.log ]
+then
+  rm build_errors.log
+fi
+
+echo ""
+echo "passed: $(echo $PASSED | wc -w)  failed: $(echo $FAILED | wc -w)  skipped: $(echo $SKIPPED | wc -w)"
+if [ -n "$FAILED" ]
+then
+  echo "failed:$FAILED"
+  exit 1
+fi
+
+echo "done"
@@ -9,6 +9,10 @@
 #ifndef LinkwitzRiley_h
 #define LinkwitzRiley_h
 
+#include <math.h>
+
+static const double pi = 3.141592653589793238462643383279502884197169399375105820974944;
+
 enum FilterType {
     Lowpass = 0,
     Highpass,
@@ -0,0 +1,347 @@
+// Checks for the WDL code the examples share, built and run by buildall-headless.sh:
+//
+// make -f Makefile.headless checks
+//
+// Each check prints one "ok"/"FAIL" line, the program exits non-zero if any failed.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../WDL/eel2/ns-eel.h"
+#include "../WDL/IPlug/Oversampler.h"
+#include "../WDL/convoengine.h"
+#include "../WDL/resample.h"
+
+static int sFailed = 0;
+
+static void Report(bool ok, const char* name, const char* detail)
+{
+  printf("%s  %s%s%s\n", ok ? "ok  " : "FAIL", name, detail[0] ? ": " : "", detail);
+  if (!ok) sFailed++;
+}
+
+// EEL2: NSEEL_code_execute_block() has to give what running the code once per sample does, for any block size.
+
+void NSEEL_HOSTSTUB_EnterMutex() {}
+void NSEEL_HOSTSTUB_LeaveMutex() {}
+
+static void CheckEELBlock(const char* code, int nch, int nFrames, int blockSize)
+{
+  static EEL_F in[2][4096], outA[2][4096], outB[2][4096];
+  char detail[256] = "";
+  bool ok = true;
+
+  NSEEL_VMCTX vmA = NSEEL_VM_alloc(), vmB = NSEEL_VM_alloc();
+  NSEEL_CODEHANDLE codeA = NSEEL_code_compile_ex(vmA, code, 0, 0);
+  NSEEL_CODEHANDLE codeB = NSEEL_code_compile_ex(vmB, code, 0, NSEEL_CODE_COMPILE_FLAG_BLOCK);
+
+  if (!codeA || !codeB)
+  {
+    snprintf(detail, sizeof(detail), "doesn't compile: %s", NSEEL_code_getcodeerror(codeA ? vmB : vmA));
+    ok = false;
+  }
+  else
+  {
+    EEL_F* spl[2];
+    for (int ch = 0; ch < nch; ++ch)
+    {
+      char name[8];
+      snprintf(name, sizeof(name), "spl%d", ch);
+      spl[ch] = NSEEL_VM_regvar(vmA, name);
+      for (int s = 0; s < nFrames; ++s) in[ch][s] = sin(s * 0.01 * (ch + 1)) + 0.001 * ch;
+    }
+
+    for (int s = 0; s < nFrames; ++s)
+    {
+      for (int ch = 0; ch < nch; ++ch) *spl[ch] = in[ch][s];
+      NSEEL_code_execute(codeA);
+      for (int ch = 0; ch < nch; ++ch) outA[ch][s] = *spl[ch];
+    }
+
+    for (int pos = 0; pos < nFrames && ok; pos += blockSize)
+    {
+      const int n = nFrames - pos < blockSize ? nFrames - pos : blockSize;
+      EEL_F* ins[2];
+      EEL_F* outs[2];
+      for (int ch = 0; ch < nch; ++ch)
+      {
+        ins[ch] = in[ch] + pos;
+        outs[ch] = outB[ch] + pos;
+      }
+      if (NSEEL_code_execute_block(codeB, n, ins, nch, outs, nch) != n)
+      {
+        snprintf(detail, sizeof(detail), "block at %d didn't run every frame", pos);
+        ok = false;
+      }
+    }
+
+    for (int ch = 0; ch < nch && ok; ++ch)
+    {
+      for (int s = 0; s < nFrames && ok; ++s)
+      {
+        if (outA[ch][s] != outB[ch][s])
+        {
+          snprintf(detail, sizeof(detail), "spl%d frame %d is %g, per sample gives %g", ch, s, outB[ch][s], outA[ch][s]);
+          ok = false;
+        }
+      }
+    }
+  }
+
+  char name[256];
+  snprintf(name, sizeof(name), "eel block %d frames/block, '%s'", blockSize, code);
+  Report(ok, name, detail);
+
+  NSEEL_code_free(codeA);
+  NSEEL_code_free(codeB);
+  NSEEL_VM_free(vmA);
+  NSEEL_VM_free(vmB);
+}
+
+// EEL2 code cache: from the third VM on, a cached source gets a relocated copy of the code compiled in the first two,
+// which has to run (and reserve RAM for its //#eel-ram: line) like code compiled for that VM.
+
+static EEL_F RunCacheProbe(const char* code, int flags, EEL_F z, int* pReserved)
+{
+  NSEEL_VMCTX vm = NSEEL_VM_alloc_ex(flags);
+  NSEEL_VM_reserveRAM(vm, 0);
+  NSEEL_CODEHANDLE h = NSEEL_code_compile_ex(vm, code, 0, 0);
+  EEL_F out = -1.;
+  if (h)
+  {
+    *NSEEL_VM_regvar(vm, "z") = z;
+    for (int i = 0; i < 3; ++i) NSEEL_code_execute(h);
+    out = *NSEEL_VM_regvar(vm, "out");
+  }
+  *pReserved = NSEEL_VM_reserveRAM(vm, 0);
+  NSEEL_code_free(h);
+  NSEEL_VM_free(vm);
+  return out;
+}
+
+static void CheckEELCodeCache()
+{
+  const char* code = "//#eel-ram:100000\n"
+                     "function f(x) ( x * k + 1 ); k += 0.5; i = 0; loop(10, megabuf[i * 5000] += f(i) + z; i += 1); out = megabuf[45000] + k;";
+  char detail[256] = "";
+  bool ok = true;
+
+  for (int n = 0; n < 4 && ok; ++n)
+  {
+    int reserved, refReserved;
+    const EEL_F out = RunCacheProbe(code, NSEEL_VM_FLAG_CODECACHE, n * 10., &reserved);
+    const EEL_F ref = RunCacheProbe(code, 0, n * 10., &refReserved);
+    if (out != ref || reserved != refReserved)
+    {
+      snprintf(detail, sizeof(detail), "VM %d gives %g with %d items reserved, uncached %g with %d", n, out, reserved, ref, refReserved);
+      ok = false;
+    }
+  }
+  NSEEL_code_cache_flush();
+
+  Report(ok, "eel code cache, 4 VMs", detail);
+}
+
+// Oversampler: GetLatency() is what a band limited signal is delayed by going up and down again, to the sample.
+
+static double OversamplerError(const double* in, const double* out, int nFrames, int delay)
+{
+  double maxErr = 0.;
+  for (int s = 100 + delay; s < nFrames; ++s)
+  {
+    double err = fabs(out[s] - in[s - delay]);
+    if (err > maxErr) maxErr = err;
+  }
+  return maxErr;
+}
+
+static void CheckOversamplerLatency(int factor)
+{
+  const int nFrames = 4096, blockSize = 256;
+  static double in[nFrames], out[nFrames];
+
+  Oversampler os;
+  os.Resize(1, 1, blockSize, factor);
+  os.SetFactor(factor);
+
+  for (int s = 0; s < nFrames; ++s) in[s] = 0.5 * sin(s * 0.02 * 2. * M_PI) + 0.3 * sin(s * 0.11 * 2. * M_PI);
+
+  for (int pos = 0; pos < nFrames; pos += blockSize)
+  {
+    double* pIn = in + pos;
+    double* pOut = out + pos;
+    double** ppOsIn = os.Upsample(&pIn, blockSize);
+    memcpy(os.GetOutputs()[0], ppOsIn[0], blockSize * factor * sizeof(double));
+    os.Downsample(&pOut, blockSize);
+  }
+
+  const int latency = os.GetLatency();
+  const double err = OversamplerError(in, out, nFrames, latency);
+  const double errBefore = OversamplerError(in, out, nFrames, latency - 1);
+  const double errAfter = OversamplerError(in, out, nFrames, latency + 1);
+
+  char name[64], detail[128];
+  snprintf(name, sizeof(name), "oversampler %dx latency %d", factor, latency);
+  snprintf(detail, sizeof(detail), "max error %.2g (%.2g one sample early, %.2g late)", err, errBefore, errAfter);
+  Report(err < 1e-3 && err < errBefore && err < errAfter, name, detail);
+}
+
+// Resampler: sinc mode turns a sine into the same sine at the new rate, interpolating (SIMD kernels) or through the
+// polyphase table, mono or stereo (one kernel each). Checked against the best fitting sine, so the delay doesn't matter.
+
+static void CheckResampler(double rateIn, double rateOut, int nch, bool polyphase)
+{
+  const int nIn = 8192, blockSize = 256, maxOut = 16384;
+  const double freq = 1000., amp = 0.5;
+  static WDL_ResampleSample out[2 * maxOut];
+
+  WDL_Resampler rs;
+  rs.SetMode(false, 0, true);
+  rs.SetFeedMode(true);
+  rs.SetPolyphase(polyphase);
+  rs.SetRates(rateIn, rateOut);
+
+  int nOut = 0;
+  for (int pos = 0; pos < nIn; pos += blockSize)
+  {
+    WDL_ResampleSample* p;
+    const int n = rs.ResamplePrepare(blockSize, nch, &p);
+    for (int i = 0; i < n; ++i)
+    {
+      for (int ch = 0; ch < nch; ++ch) p[i * nch + ch] = (WDL_ResampleSample)((ch ? -amp : amp) * sin(2. * M_PI * freq * (pos + i) / rateIn));
+    }
+    nOut += rs.ResampleOut(out + nOut * nch, n, maxOut - nOut, nch);
+  }
+
+  // Least squares a*sin + b*cos at the output rate, away from the edges.
+  const double w = 2. * M_PI * freq / rateOut;
+  const int from = 500, to = nOut - 500;
+  double maxErr = 0., gainErr = 0.;
+  for (int ch = 0; ch < nch; ++ch)
+  {
+    double ss = 0., sc = 0., cc = 0., ys = 0., yc = 0.;
+    for (int k = from; k < to; ++k)
+    {
+      const double sk = sin(w * k), ck = cos(w * k), y = out[k * nch + ch];
+      ss += sk * sk; sc += sk * ck; cc += ck * ck; ys += y * sk; yc += y * ck;
+    }
+    const double det = ss * cc - sc * sc, a = (ys * cc - yc * sc) / det, b = (yc * ss - ys * sc) / det;
+    for (int k = from; k < to; ++k) maxErr = wdl_max(maxErr, fabs(out[k * nch + ch] - a * sin(w * k) - b * cos(w * k)));
+    gainErr = wdl_max(gainErr, fabs(sqrt(a * a + b * b) - amp));
+  }
+
+  char name[96], detail[128];
+  snprintf(name, sizeof(name), "resampler %g -> %g, %d ch, %s", rateIn, rateOut, nch, polyphase ? "polyphase" : "interpolated");
+  snprintf(detail, sizeof(detail), "max error %.2g, gain off by %.2g (%d out)", maxErr, gainErr, nOut);
+  Report(maxErr < 1e-5 && gainErr < 1e-5 && nOut > nIn * rateOut / rateIn - 200, name, detail);
+}
+
+// Convolution: the FFT engine gives what convolving directly does, and switching impulses holds the old one until the
+// new engine has had an impulse length of input, then fades over SetCrossfade() samples.
+
+static void Convolve(const WDL_FFT_REAL* in, int nFrames, WDL_ImpulseBuffer* imp, double* out)
+{
+  const WDL_FFT_REAL* h = imp->impulses[0].Get();
+  const int len = imp->GetLength();
+  for (int s = 0; s < nFrames; ++s)
+  {
+    double sum = 0.;
+    for (int k = 0; k < len && k <= s; ++k) sum += h[k] * in[s - k];
+    out[s] = sum;
+  }
+}
+
+static void MakeImpulse(WDL_ImpulseBuffer* imp, int len, double decay, double freq)
+{
+  imp->SetNumChannels(1);
+  imp->SetLength(len);
+  WDL_FFT_REAL* h = imp->impulses[0].Get();
+  for (int k = 0; k < len; ++k) h[k] = (WDL_FFT_REAL)(exp(-k * decay) * cos(k * freq));
+}
+
+static void CheckConvolution(int blockSize, int switchAt)
+{
+  const int nFrames = 16384, lenA = 1500, lenB = 700, fadeLen = 256;
+  static WDL_FFT_REAL in[nFrames];
+  static double out[nFrames], convA[nFrames], convB[nFrames];
+
+  WDL_ImpulseBuffer impA, impB;
+  MakeImpulse(&impA, lenA, 0.003, 0.05);
+  MakeImpulse(&impB, lenB, 0.006, 0.31);
+
+  unsigned int seed = 1;
+  for (int s = 0; s < nFrames; ++s)
+  {
+    seed = seed * 1664525 + 1013904223;
+    in[s] = (WDL_FFT_REAL)((seed >> 8) / 16777216. - 0.5);
+  }
+  Convolve(in, nFrames, &impA, convA);
+  Convolve(in, nFrames, &impB, convB);
+
+  WDL_ConvolutionEngine_Crossfade eng;
+  eng.SetCrossfade(fadeLen);
+  eng.PrepareImpulse(&impA, 1, 0, 0, 0, 0, 0, blockSize);
+
+  int nOut = 0, latency = 0, swapped = -1;
+  for (int pos = 0; pos < nFrames; pos += blockSize)
+  {
+    if (pos >= switchAt && swapped < 0)
+    {
+      // The first one is replaced before the audio thread picks it up.
+      eng.PrepareImpulse(&impA, 1, 0, 0, 0, 0, 0, blockSize);
+      eng.PrepareImpulse(&impB, 1, 0, 0, 0, 0, 0, blockSize);
+      swapped = pos;
+    }
+    WDL_FFT_REAL* p = in + pos;
+    eng.Add(&p, blockSize, 1);
+    if (!pos) latency = eng.GetLatency();
+    const int n = eng.Avail(blockSize);
+    WDL_FFT_REAL* o = eng.Get()[0];
+    for (int i = 0; i < n; ++i) out[nOut++] = o[i];
+    eng.Advance(n);
+  }
+
+  // Output sample s is input sample s - latency convolved.
+  double errA = 0., errB = 0., ref = 0.;
+  for (int s = latency; s < nOut; ++s)
+  {
+    const int t = s - latency;
+    if (t < swapped + lenB) errA = wdl_max(errA, fabs(out[s] - convA[t]));
+    else if (t >= swapped + lenB + fadeLen) errB = wdl_max(errB, fabs(out[s] - convB[t]));
+    ref = wdl_max(ref, fabs(convA[t]));
+  }
+
+  char name[64], detail[128];
+  snprintf(name, sizeof(name), "convolution %d frames/block, switching at %d", blockSize, swapped);
+  snprintf(detail, sizeof(detail), "max error %.2g before the fade, %.2g after (peak %.2g, latency %d, %d out)", errA, errB, ref, latency, nOut);
+  Report(errA < 1e-4 * ref && errB < 1e-4 * ref && nOut > nFrames / 2, name, detail);
+}
+
+int main()
+{
+  NSEEL_init();
+  CheckEELBlock("x+=1; spl0=x*0.001+spl0; spl1=spl0-spl1;", 2, 1000, 37);
+  CheckEELBlock("spl0=sin(spl0); spl1=spl1*0.5;", 2, 1000, 1);
+  CheckEELBlock("function f(a) ( a*0.5+1 ); y = 0.99*y + 0.01*spl0; spl0 = f(y); spl1 = spl1 > 0 ? spl1 : -spl1;", 2, 4000, 512);
+  CheckEELBlock("i=0; s=0; loop(4, s+=spl0*i; i+=1); spl0=s; buf[pos]=spl1; pos=(pos+1)%100; spl1=buf[(pos+50)%100];", 2, 3000, 256);
+  CheckEELBlock("while(k<3 ? (k+=1; 1) : 0); k=0; spl0 = spl0 == spl1 ? 1 : spl0 < spl1;", 2, 1000, 64);
+  CheckEELCodeCache();
+  NSEEL_quit();
+
+  CheckOversamplerLatency(2);
+  CheckOversamplerLatency(4);
+  CheckOversamplerLatency(8);
+
+  CheckResampler(44100., 48000., 1, false);
+  CheckResampler(44100., 48000., 2, false);
+  CheckResampler(44100., 48000., 1, true);
+  CheckResampler(48000., 44100., 2, true);
+  CheckResampler(44100., 88200., 2, true);
+
+  CheckConvolution(64, 5000);
+  CheckConvolution(512, 3000);
+
+  printf(sFailed ? "%d checks failed\n" : "all checks passed\n", sFailed);
+  return sFailed ? 1 : 0;
+}
@@ -634,6 +634,7 @@ ICaptionControl::ICaptionControl(IPlugBase* pPlug, IRECT pR, int paramIdx, IText
   :   ITextControl(pPlug, pR, pText), mShowParamLabel(showParamLabel)
 {
   mParamIdx = paramIdx;
+  mDrawThreadSafe = false;  // Draw() formats into mStr.
 }
 
 void ICaptionControl::OnMouseDown(int x, int y, IMouseMod* pMod)
@@ -930,12 +931,13 @@ void IFaderControlText::setCaptionOffset(int offset){
 
 
 
-ICairoPlotControl::ICairoPlotControl(IPlugBase* pPlug, IRECT pR, int paramIdx, IColor* fillColor, IColor* lineColor, bool fillEnable) : IControl(pPlug, pR), mColorFill(fillColor), mColorLine(lineColor), mFill(fillEnable), mRange(1), mLineWeight(2.), mRetina(false)
+ICairoPlotControl::ICairoPlotControl(IPlugBase* pPlug, IRECT pR, int paramIdx, IColor* fillColor, IColor* lineColor, bool fillEnable) : IControl(pPlug, pR), mColorFill(fillColor), mColorLine(lineColor), mFill(fillEnable), mRange(1), mLineWeight(2.), mRetina(false), mIncremental(false), mSurfaceValid(false), mScrollCols(0), mGradient(NULL), mGradientStop(0.), mGradientHeight(0)
 {
     mWidth = mRECT.W();
     mHeight = mRECT.H();
     
     mVals = new valarray<double>(0., mWidth);
+    mDrawThreadSafe = false;    //Draw() renders into the shared cairo surface
     
     surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, mWidth, mHeight);
     cr = cairo_create(surface);
@@ -943,20 +945,28 @@ ICairoPlotControl::ICairoPlotControl(IPlugBase* pPlug, IRECT pR, int paramIdx, I
 
 ICairoPlotControl::~ICairoPlotControl(){
     delete mVals;
+    if(mGradient) cairo_pattern_destroy(mGradient);
     cairo_destroy(cr);
     cairo_surface_destroy(surface);
 }
 
 void ICairoPlotControl::setFillEnable(bool b){
     mFill = b;
+    mSurfaceValid = false;
 }
 
 void ICairoPlotControl::setLineColor(IColor* color){
     mColorLine.setFromIColor(color);
+    mSurfaceValid = false;
 }
 
 void ICairoPlotControl::setFillColor(IColor* color){
     mColorFill.setFromIColor(color);
+    if(mGradient){
+        cairo_pattern_destroy(mGradient);
+        mGradient = NULL;
+    }
+    mSurfaceValid = false;
 }
 
 void ICairoPlotControl::setAAquality(int quality){
@@ -974,16 +984,23 @@ void ICairoPlotControl::setAAquality(int quality){
             cairo_set_antialias(cr, CAIRO_ANTIALIAS_BEST);
             break;
     }
+    mSurfaceValid = false;
 }
 
 void ICairoPlotControl::setLineWeight(double w){
     mLineWeight = w;
+    mSurfaceValid = false;
 }
 
 void ICairoPlotControl::setRange(double range){
     mRange = range;
 }
 
+void ICairoPlotControl::setIncrementalDraw(bool incremental){
+    mIncremental = incremental;
+    mSurfaceValid = false;
+}
+
 void ICairoPlotControl::plotVals(valarray<double>* vals, bool normalize){
     double scalar;
     
@@ -1105,6 +1122,93 @@ bool ICairoPlotControl::Draw(IGraphics* pGraphics){
 }
 
 
+cairo_pattern_t* ICairoPlotControl::getGradient(double stop){
+    if(!mGradient || stop != mGradientStop || mHeight != mGradientHeight){
+        if(mGradient) cairo_pattern_destroy(mGradient);
+        
+        mGradient = cairo_pattern_create_linear(0, 0, 0, mHeight);
+        cairo_pattern_add_color_stop_rgba(mGradient, stop, mColorFill.R, mColorFill.G, mColorFill.B, mColorFill.A);
+        cairo_pattern_add_color_stop_rgba(mGradient, 1, mColorFill.R, mColorFill.G, mColorFill.B, .3);
+        
+        mGradientStop = stop;
+        mGradientHeight = mHeight;
+    }
+    return mGradient;
+}
+
+void ICairoPlotControl::scrollSurface(int px){
+    cairo_surface_flush(surface);
+    
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    
+    for (int y = 0; y < mHeight; y++) {
+        unsigned char* row = data + y * stride;
+        memmove(row, row + px * 4, (mWidth - px) * 4);
+    }
+    
+    cairo_surface_mark_dirty(surface);
+}
+
+int ICairoPlotControl::beginPlotDraw(int nPoints, int spacing){
+    int newCols = mScrollCols;
+    int first = 0;
+    double clipL = 0;
+    
+    mScrollCols = 0;
+    
+    cairo_save(cr);
+    
+    if(mIncremental && mSurfaceValid && newCols < nPoints && spacing > 0){
+        if(!newCols) return -1;
+        
+        scrollSurface(newCols * spacing);
+        
+        //Everything right of the previous last point changes, plus a line width to its left where
+        //the old flat end of the line was stroked. The path starts far enough left that its own
+        //left edge falls outside the clip.
+        int oldLast = nPoints - 1 - newCols;
+        int margin = (int)(mLineWeight * (mRetina ? 2 : 1)) + 2;
+        
+        clipL = oldLast * spacing - margin;
+        if(clipL < 0) clipL = 0;
+        
+        first = oldLast - (2 * margin) / spacing - 2;
+        if(first < 0) first = 0;
+        if(!first) clipL = 0;
+        
+        cairo_rectangle(cr, clipL, 0, mWidth - clipL, mHeight);
+        cairo_clip(cr);
+    }
+    mSurfaceValid = true;
+    
+    cairo_set_source_rgba(cr, 0, 0, 0, 0);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_paint(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    
+    return first;
+}
+
+bool ICairoPlotControl::endPlotDraw(IGraphics* pGraphics){
+    cairo_new_path(cr);
+    cairo_restore(cr);
+    cairo_surface_flush(surface);
+    
+    unsigned int *data = (unsigned int*)cairo_image_surface_get_data(surface);
+    //Bind to LICE
+    LICE_WrapperBitmap WrapperBitmap = LICE_WrapperBitmap(data, mWidth, mHeight, mWidth, false);
+    
+    IBitmap result;
+#ifndef IPLUG_RETINA_SUPPORT
+    result = IBitmap(&WrapperBitmap, WrapperBitmap.getWidth(), WrapperBitmap.getHeight());
+#else
+    result = IBitmap(&WrapperBitmap, &WrapperBitmap, WrapperBitmap.getWidth(), WrapperBitmap.getHeight());
+#endif
+    return pGraphics->DrawBitmap(&result, &this->mRECT);
+}
+
+
 //Accessors//
 CColor ICairoPlotControl::getColorFill(){ return mColorFill; }
 CColor ICairoPlotControl::getColorLine(){ return mColorLine; }
@@ -1128,24 +1232,21 @@ inline double ICairoPlotControl::percentToCoordinates(double value) {
 
 
 
-ILevelPlotControl::ILevelPlotControl(IPlugBase* pPlug, IRECT pR, IColor* fillColor, IColor* lineColor, double timeScale, bool fillEnable, int paramIdx) : ICairoPlotControl(pPlug, pR, paramIdx, fillColor, lineColor, fillEnable), mTimeScale(timeScale), mBufferLength(0.), mYRange(-32), mStroke(true), mHeadroom(2), mReverseFill(false), mGradientFill(false)
+ILevelPlotControl::ILevelPlotControl(IPlugBase* pPlug, IRECT pR, IColor* fillColor, IColor* lineColor, double timeScale, bool fillEnable, int paramIdx) : ICairoPlotControl(pPlug, pR, paramIdx, fillColor, lineColor, fillEnable), mTimeScale(timeScale), mYRange(-32), mHeadroom(2), mDrawPos(0), mStroke(true), mReverseFill(false), mGradientFill(false)
 {
     mRes = kHighRes;
     mXRes = mWidth/2.;
-    mDrawVals = new valarray<double>(mHeight, mXRes);
-    mBuffer = new valarray<double>(0., mTimeScale * mPlug->GetSampleRate() / (double)mXRes);
     setResolution(kHighRes);
     setLineWeight(2.);
 }
 
 ILevelPlotControl::~ILevelPlotControl(){
-    delete mDrawVals;
-    delete mBuffer;
 }
 
 
 void ILevelPlotControl::setReverseFill(bool rev){
     mReverseFill = rev;
+    mSurfaceValid = false;
 }
 
 void ILevelPlotControl::setResolution(int res){
@@ -1173,15 +1274,17 @@ void ILevelPlotControl::setResolution(int res){
             break;
     }
     
-    mBuffer->resize(mTimeScale * mPlug->GetSampleRate() / (double)mXRes, -48.);
-    mBufferLength = 0;
-    if(mReverseFill){
-        mDrawVals->resize(mXRes, -2);
-    }
-    else{
-        mDrawVals->resize(mXRes, mHeight);
+    if(mXRes < 1) mXRes = 1;
+    
+    mMeter.SetDecimation(mTimeScale * mPlug->GetSampleRate() / (double)mXRes);
+    
+    double* pVals = mDrawVals.Resize(mXRes);
+    for (int i = 0; i < mXRes; i++) {
+        pVals[i] = mReverseFill ? -2 : mHeight;
     }
+    mDrawPos = 0;
     mSpacing = mWidth / mXRes;
+    mSurfaceValid = false;
     
 }
 
@@ -1206,26 +1309,31 @@ void ILevelPlotControl::setYRange(int yRangeDB){
 
 void ILevelPlotControl::setStroke(bool stroke){
     mStroke = stroke;
+    mSurfaceValid = false;
 }
 
 void ILevelPlotControl::setGradientFill(bool grad){
     mGradientFill = grad;
+    mSurfaceValid = false;
 }
 void ILevelPlotControl::process(double sample){
-    mBuffer->operator[](mBufferLength) = sample;
-    mBufferLength++;
+    mMeter.Process(&sample);
+}
+
+bool ILevelPlotControl::IsDirty(){
+    IMeterFrame frame;
+    bool newVals = false;
     
-    if(mBufferLength >= mBuffer->size()){
-        double average;
-        
-        *mDrawVals = mDrawVals->shift(1);
-        
-        average = mBuffer->sum() / (double)mBuffer->size();
-        average = scaleValue(average, mYRange, 2, 0, 1);
-        mDrawVals->operator[](mDrawVals->size() - 1) = percentToCoordinates(average);
-        
-        mBufferLength = 0;
+    while (mMeter.Pop(&frame)) {
+        double average = scaleValue(frame.mMean, mYRange, 2, 0, 1);
+        mDrawVals.Get()[mDrawPos] = percentToCoordinates(average);
+        if(++mDrawPos >= mDrawVals.GetSize()) mDrawPos = 0;
+        mScrollCols++;
+        newVals = true;
     }
+    
+    if(newVals) SetDirty(false);
+    return mDirty;
 }
 
 void ILevelPlotControl::checkChangeDPI(IGraphics* pGraphics){
@@ -1256,14 +1364,10 @@ bool ILevelPlotControl::Draw(IGraphics* pGraphics){
 #ifdef IPLUG_RETINA_SUPPORT
     checkChangeDPI(pGraphics);
 #endif
-    cairo_save(cr);
-    cairo_set_source_rgba(cr, 0, 0, 0, 0);
-    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-    cairo_paint(cr);
-    cairo_restore(cr);
+    int nPoints = mDrawVals.GetSize();
+    int first = beginPlotDraw(nPoints, mSpacing);
     
-    //surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, mWidth, mHeight);
-    //cr = cairo_create(surface);
+    if(first < 0) return endPlotDraw(pGraphics);
     
     if(mRetina){
         cairo_set_line_width(cr, mLineWeight * 2);
@@ -1276,21 +1380,21 @@ bool ILevelPlotControl::Draw(IGraphics* pGraphics){
     //            drawDBLines(cr);
     //        }
     
-    //Starting point in bottom left corner.
+    //Starting point in bottom left corner, or below the first point that changed.
     if(mReverseFill){
-        cairo_move_to(cr, -8, -8);
+        cairo_move_to(cr, first ? first * mSpacing : -8, -8);
     }
     else{
-        cairo_move_to(cr, -4, mHeight+4);
+        cairo_move_to(cr, first ? first * mSpacing : -4, mHeight+4);
     }
     
     //Draw data points
-    for (int i = 0, x = 0; x < mWidth && i < mDrawVals->size(); i++) {
-        cairo_line_to(cr, x, mDrawVals->operator[](i));
+    for (int i = first, x = first * mSpacing; x < mWidth && i < nPoints; i++) {
+        cairo_line_to(cr, x, drawVal(i));
         x += mSpacing;
     }
     
-    cairo_line_to(cr, mWidth+8, mDrawVals->operator[](mDrawVals->size()-1));
+    cairo_line_to(cr, mWidth+8, drawVal(nPoints-1));
     //Endpoint in bottom right corner
     if(mReverseFill){
         cairo_line_to(cr, mWidth+8, -8);
@@ -1305,19 +1409,12 @@ bool ILevelPlotControl::Draw(IGraphics* pGraphics){
         cairo_path_t* path = cairo_copy_path(cr);
         
         if(mGradientFill){
-            cairo_pattern_t* grad = cairo_pattern_create_linear(0, 0, 0, mHeight);
-            
-            cairo_pattern_add_color_stop_rgba(grad, .5, mColorFill.R, mColorFill.G, mColorFill.B, mColorFill.A);
-            cairo_pattern_add_color_stop_rgba(grad, 1, mColorFill.R, mColorFill.G, mColorFill.B, .3);
-            
-            cairo_set_source(cr, grad);
-            cairo_fill(cr);
-            cairo_pattern_destroy(grad);
+            cairo_set_source(cr, getGradient(.5));
         }
         else{
             cairo_set_source_rgba(cr, mColorFill.R, mColorFill.G, mColorFill.B, mColorFill.A);
-            cairo_fill(cr);
         }
+        cairo_fill(cr);
         
         cairo_append_path(cr, path);
         
@@ -1334,61 +1431,27 @@ bool ILevelPlotControl::Draw(IGraphics* pGraphics){
     }
     else if(mFill){
         if(mGradientFill){
-            cairo_pattern_t* grad = cairo_pattern_create_linear(0, 0, 0, mHeight);
-            
-            cairo_pattern_add_color_stop_rgba(grad, .75, mColorFill.R, mColorFill.G, mColorFill.B, mColorFill.A);
-            cairo_pattern_add_color_stop_rgba(grad, 1, mColorFill.R, mColorFill.G, mColorFill.B, .3);
-            
-            cairo_set_source(cr, grad);
-            cairo_fill(cr);
-            
-            cairo_pattern_destroy(grad);
+            cairo_set_source(cr, getGradient(.75));
         }
         else{
             cairo_set_source_rgba(cr, mColorFill.R, mColorFill.G, mColorFill.B, mColorFill.A);
-            cairo_fill(cr);
         }
+        cairo_fill(cr);
     }
-    cairo_surface_flush(surface);
     
-    unsigned int *data = (unsigned int*)cairo_image_surface_get_data(surface);
-    //Bind to LICE
-    LICE_WrapperBitmap WrapperBitmap = LICE_WrapperBitmap(data, mWidth, mHeight, mWidth, false);
-    
-    //Render
-    //}
-    IBitmap result;
-#ifndef IPLUG_RETINA_SUPPORT
-    result = IBitmap(&WrapperBitmap, WrapperBitmap.getWidth(), WrapperBitmap.getHeight());
-#else
-    result = IBitmap(&WrapperBitmap, &WrapperBitmap, WrapperBitmap.getWidth(), WrapperBitmap.getHeight());
-#endif
-    return pGraphics->DrawBitmap(&result, &this->mRECT);
+    return endPlotDraw(pGraphics);
 }
 
 
 
-IGRPlotControl::IGRPlotControl(IPlugBase* pPlug, IRECT pR, int paramIdx, IColor* preFillColor, IColor* postFillColor, IColor* postLineColor, IColor* GRFillColor, IColor* GRLineColor, double timeScale) : ICairoPlotControl(pPlug, pR, paramIdx, postFillColor, postLineColor, true), mTimeScale(timeScale), mBufferLength(0.), mYRange(-32), mHeadroom(2), sr(mPlug->GetSampleRate()), mPreFillColor(preFillColor), mGRFillColor(GRFillColor), mGRLineColor(GRLineColor), mRes(2.), mGradientFill(true)
+IGRPlotControl::IGRPlotControl(IPlugBase* pPlug, IRECT pR, int paramIdx, IColor* preFillColor, IColor* postFillColor, IColor* postLineColor, IColor* GRFillColor, IColor* GRLineColor, double timeScale) : ICairoPlotControl(pPlug, pR, paramIdx, postFillColor, postLineColor, true), mTimeScale(timeScale), sr(mPlug->GetSampleRate()), mYRange(-32), mHeadroom(2), mRes(2.), mMeter(kNumPlots), mDrawPos(0), mGradientFill(true), mPreFillColor(preFillColor), mGRLineColor(GRLineColor), mGRFillColor(GRFillColor)
 {
     mXRes = mWidth/2.;
-    mDrawValsPre = new valarray<double>(mHeight, mXRes);
-    mDrawValsPost = new valarray<double>(mHeight, mXRes);
-    mDrawValsGR = new valarray<double>(mHeight, mXRes);
-    
-    mBufferPre = new valarray<double>(0., mTimeScale * sr / (double)mXRes);
-    mBufferPost = new valarray<double>(0., mTimeScale * sr / (double)mXRes);
-    mBufferGR = new valarray<double>(-2, mTimeScale * sr / (double)mXRes);
-
     setResolution(kHighRes);
     setLineWeight(2.);
 }
 
 IGRPlotControl::~IGRPlotControl(){
-    delete mDrawValsPre;
-    delete mDrawValsPost;
-    delete mDrawValsGR;
-    delete mBufferPre;
-    delete mBufferPost;
 }
 
 
@@ -1419,17 +1482,20 @@ void IGRPlotControl::setResolution(int res){
     if(mRetina)
         mXRes /= 2;
     
-    mBufferPre->resize(mTimeScale * sr / (double)mXRes, -48.);
-    mBufferPost->resize(mTimeScale * sr / (double)mXRes, -48.);
-    mBufferGR->resize(mTimeScale * sr / (double)mXRes, 0);
-
-    mDrawValsPre->resize(mXRes, mHeight);
-    mDrawValsPost->resize(mXRes, mHeight);
-    mDrawValsGR->resize(mXRes, -2);
+    if(mXRes < 1) mXRes = 1;
     
-    mBufferLength = 0;
+    mMeter.SetDecimation(mTimeScale * sr / (double)mXRes);
+    
+    for (int plot = 0; plot < kNumPlots; plot++) {
+        double* pVals = mDrawVals[plot].Resize(mXRes);
+        for (int i = 0; i < mXRes; i++) {
+            pVals[i] = plot == kGR ? -2 : mHeight;
+        }
+    }
+    mDrawPos = 0;
     
     mSpacing = mWidth / mXRes;
+    mSurfaceValid = false;
 }
 
 void IGRPlotControl::setYRange(int yRangeDB){
@@ -1453,38 +1519,30 @@ void IGRPlotControl::setYRange(int yRangeDB){
 
 void IGRPlotControl::setGradientFill(bool enabled){
     mGradientFill = enabled;
+    mSurfaceValid = false;
 }
 
 void IGRPlotControl::process(double sampleIn, double sampleOut, double sampleGR){
-    mBufferPre->operator[](mBufferLength) = sampleIn;
-    mBufferPost->operator[](mBufferLength) = sampleOut;
-    mBufferGR->operator[](mBufferLength) = sampleGR;
+    double samples[kNumPlots] = { sampleIn, sampleOut, sampleGR };
+    mMeter.Process(samples);
+}
 
-    mBufferLength++;
+bool IGRPlotControl::IsDirty(){
+    IMeterFrame frame[kNumPlots];
+    bool newVals = false;
     
-    if(mBufferLength >= mBufferPre->size()){
-        double averagePre, averagePost, averageGR;
-        
-        *mDrawValsPre = mDrawValsPre->shift(1);
-        *mDrawValsPost = mDrawValsPost->shift(1);
-        *mDrawValsGR = mDrawValsGR->shift(1);
-        
-        averagePre = mBufferPre->sum() / (double)mBufferPre->size();
-        averagePost = mBufferPost->sum() / (double)mBufferPost->size();
-        averageGR = mBufferGR->sum() / (double)mBufferGR->size();
-        
-        averagePre = scaleValue(averagePre, mYRange, mHeadroom, 0, 1);
-        mDrawValsPre->operator[](mDrawValsPre->size() - 1) = percentToCoordinates(averagePre);
-        
-        averagePost = scaleValue(averagePost, mYRange, mHeadroom, 0, 1);
-        mDrawValsPost->operator[](mDrawValsPost->size() - 1) = percentToCoordinates(averagePost);
-        
-        averageGR = scaleValue(averageGR, mYRange, mHeadroom, 0, 1);
-        mDrawValsGR->operator[](mDrawValsGR->size() - 1) = percentToCoordinates(averageGR);
-        
-        
-        mBufferLength = 0;
+    while (mMeter.Pop(frame)) {
+        for (int plot = 0; plot < kNumPlots; plot++) {
+            double average = scaleValue(frame[plot].mMean, mYRange, mHeadroom, 0, 1);
+            mDrawVals[plot].Get()[mDrawPos] = percentToCoordinates(average);
+        }
+        if(++mDrawPos >= mDrawVals[kPre].GetSize()) mDrawPos = 0;
+        mScrollCols++;
+        newVals = true;
     }
+    
+    if(newVals) SetDirty(false);
+    return mDirty;
 }
 
 
@@ -1517,14 +1575,13 @@ bool IGRPlotControl::Draw(IGraphics* pGraphics){
 #ifdef IPLUG_RETINA_SUPPORT
     checkChangeDPI(pGraphics);
 #endif
-    cairo_save(cr);
-    cairo_set_source_rgba(cr, 0, 0, 0, 0);
-    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-    cairo_paint(cr);
-    cairo_restore(cr);
+    int nPoints = mDrawVals[kPre].GetSize();
+    int first = beginPlotDraw(nPoints, mSpacing);
     
-    //surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, mWidth, mHeight);
-    //cr = cairo_create(surface);
+    if(first < 0) return endPlotDraw(pGraphics);
+    
+    //Left edge of the paths: off the surface, or below the first point that changed.
+    double xStart = first * mSpacing;
     
     if(mRetina){
         cairo_set_line_width(cr, mLineWeight * 2);
@@ -1535,15 +1592,15 @@ bool IGRPlotControl::Draw(IGraphics* pGraphics){
     ////////////////////////////////////////////////////////////////////////////////PRE
     
     //Starting point in bottom left corner.
-    cairo_move_to(cr, -4, mHeight+4);
+    cairo_move_to(cr, first ? xStart : -4, mHeight+4);
     
     //Draw data points
-    for (int i = 0, x = 0; x < mWidth && i < mDrawValsPre->size(); i++) {
-        cairo_line_to(cr, x, mDrawValsPre->operator[](i));
+    for (int i = first, x = xStart; x < mWidth && i < nPoints; i++) {
+        cairo_line_to(cr, x, drawVal(kPre, i));
         x += mSpacing;
     }
     
-    cairo_line_to(cr, mWidth+4, mDrawValsPre->operator[](mDrawValsPre->size()-1));
+    cairo_line_to(cr, mWidth+4, drawVal(kPre, nPoints-1));
     //Endpoint in bottom right corner
     cairo_line_to(cr, mWidth+4, mHeight+4);
     
@@ -1558,15 +1615,15 @@ bool IGRPlotControl::Draw(IGraphics* pGraphics){
 
     
     //Starting point in bottom left corner.
-    cairo_move_to(cr, -4, mHeight+4);
+    cairo_move_to(cr, first ? xStart : -4, mHeight+4);
     
     //Draw data points
-    for (int i = 0, x = 0; x < mWidth && i < mDrawValsPost->size(); i++) {
-        cairo_line_to(cr, x, mDrawValsPost->operator[](i));
+    for (int i = first, x = xStart; x < mWidth && i < nPoints; i++) {
+        cairo_line_to(cr, x, drawVal(kPost, i));
         x += mSpacing;
     }
     
-    cairo_line_to(cr, mWidth+4, mDrawValsPre->operator[](mDrawValsPre->size()-1));
+    cairo_line_to(cr, mWidth+4, drawVal(kPre, nPoints-1));
     //Endpoint in bottom right corner
     cairo_line_to(cr, mWidth+4, mHeight+4);
     
@@ -1581,15 +1638,15 @@ bool IGRPlotControl::Draw(IGraphics* pGraphics){
 
     
     //Starting point in top left corner.
-    cairo_move_to(cr, -8, -8);
+    cairo_move_to(cr, first ? xStart : -8, -8);
     
     //Draw data points
-    for (int i = 0, x = 0; x < mWidth && i < mDrawValsGR->size(); i++) {
-        cairo_line_to(cr, x, mDrawValsGR->operator[](i));
+    for (int i = first, x = xStart; x < mWidth && i < nPoints; i++) {
+        cairo_line_to(cr, x, drawVal(kGR, i));
         x += mSpacing;
     }
     
-    cairo_line_to(cr, mWidth+8, mDrawValsGR->operator[](mDrawValsGR->size()-1));
+    cairo_line_to(cr, mWidth+8, drawVal(kGR, nPoints-1));
     
     //Endpoint in top right corner
     cairo_line_to(cr, mWidth+8, -8);
@@ -1610,19 +1667,12 @@ bool IGRPlotControl::Draw(IGraphics* pGraphics){
     cairo_append_path(cr, pathPost);
     
     if(mGradientFill){
-        cairo_pattern_t* grad = cairo_pattern_create_linear(0, 0, 0, mHeight);
-        
-        cairo_pattern_add_color_stop_rgba(grad, .5, mColorFill.R, mColorFill.G, mColorFill.B, mColorFill.A);
-        cairo_pattern_add_color_stop_rgba(grad, 1, mColorFill.R, mColorFill.G, mColorFill.B, 0.3);
-        
-        cairo_set_source(cr, grad);
-        cairo_fill(cr);
-        cairo_pattern_destroy(grad);
+        cairo_set_source(cr, getGradient(.5));
     }
     else{
         cairo_set_source_rgba(cr, mColorFill.R, mColorFill.G, mColorFill.B, mColorFill.A);
-        cairo_fill(cr);
     }
+    cairo_fill(cr);
     
     cairo_new_path(cr);
 
@@ -1651,22 +1701,7 @@ bool IGRPlotControl::Draw(IGraphics* pGraphics){
     cairo_path_destroy(pathPost);
     cairo_path_destroy(pathGR);
     
-    cairo_surface_flush(surface);
-    
-    unsigned int *data = (unsigned int*)cairo_image_surface_get_data(surface);
-    //Bind to LICE
-    LICE_WrapperBitmap WrapperBitmap = LICE_WrapperBitmap(data, mWidth, mHeight, mWidth, false);
-    
-    //Render
-    //}
-    IBitmap result;
-#ifndef IPLUG_RETINA_SUPPORT
-    result = IBitmap(&WrapperBitmap, WrapperBitmap.getWidth(), WrapperBitmap.getHeight());
-    
-#else
-    result = IBitmap(&WrapperBitmap, &WrapperBitmap, WrapperBitmap.getWidth(), WrapperBitmap.getHeight());
-#endif
-    return pGraphics->DrawBitmap(&result, &this->mRECT);
+    return endPlotDraw(pGraphics);
 }
 
 
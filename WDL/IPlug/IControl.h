@@ -4,6 +4,7 @@
 #include "IPlugBase.h"
 #include "IGraphics.h"
 #include <valarray>
+#include "IMeterBuffer.h"
 #include "../IPlug/DSP/DSP.h"
 #include "../Cairo/include/cairo.h"
 
@@ -22,9 +23,9 @@ class IControl
 public:
   // If paramIdx is > -1, this control will be associated with a plugin parameter.
   IControl(IPlugBase* pPlug, IRECT pR, int paramIdx = -1, IChannelBlend blendMethod = IChannelBlend::kBlendNone)
-    : mPlug(pPlug), mRECT(pR), mTargetRECT(pR), mParamIdx(paramIdx), mValue(0.0), mDefaultValue(-1.0),
-      mBlend(blendMethod), mDirty(true), mHide(false), mGrayed(false), mDisablePrompt(true), mDblAsSingleClick(false),
-      mClampLo(0.0), mClampHi(1.0), mMOWhenGreyed(false), mTextEntryLength(DEFAULT_TEXT_ENTRY_LEN), 
+    : mTextEntryLength(DEFAULT_TEXT_ENTRY_LEN), mPlug(pPlug), mRECT(pR), mTargetRECT(pR), mParamIdx(paramIdx),
+      mValue(0.0), mDefaultValue(-1.0), mClampLo(0.0), mClampHi(1.0), mDirty(true), mHide(false), mGrayed(false),
+      mDisablePrompt(true), mDblAsSingleClick(false), mMOWhenGreyed(false), mDrawThreadSafe(true), mBlend(blendMethod),
       mValDisplayControl(0), mNameDisplayControl(0), mTooltip(NULL) {}
 
   virtual ~IControl() {}
@@ -77,6 +78,7 @@ public:
   bool GetMOWhenGrayed() { return mMOWhenGreyed; }
 
   // Override if you want the control to be hit only if a visible part of it is hit, or whatever.
+  // IGraphics only asks about points inside the draw area or the target area.
   virtual bool IsHit(int x, int y) { return mTargetRECT.Contains(x, y); }
 
   void SetBlendMethod(IChannelBlend::EBlendMethod blendMethod) { mBlend = IChannelBlend(blendMethod); }
@@ -94,6 +96,11 @@ public:
   // Redraw() prevents the control from being cleaned immediately after drawing.
   void Redraw() { mRedraw = true; }
 
+  // With IGraphics::SetTiledDrawing, Draw() may be called for different tiles of the control from several threads
+  // at once. Controls that change their own state in Draw() opt out, and the regions they are in are drawn serially.
+  void SetDrawThreadSafe(bool threadSafe) { mDrawThreadSafe = threadSafe; }
+  bool IsDrawThreadSafe() const { return mDrawThreadSafe; }
+
   // This is an idle call from the GUI thread, as opposed to
   // IPlugBase::OnIdle which is called from the audio processing thread.
   // Only active if USE_IDLE_CALLS is defined.
@@ -130,7 +137,7 @@ protected:
   
   WDL_TypedBuf<AuxParam> mAuxParams;
   double mValue, mDefaultValue, mClampLo, mClampHi;
-  bool mDirty, mHide, mGrayed, mRedraw, mDisablePrompt, mClamped, mDblAsSingleClick, mMOWhenGreyed;
+  bool mDirty, mHide, mGrayed, mRedraw, mDisablePrompt, mClamped, mDblAsSingleClick, mMOWhenGreyed, mDrawThreadSafe;
   IChannelBlend mBlend;
   IControl* mValDisplayControl;
   IControl* mNameDisplayControl;
@@ -383,10 +390,10 @@ class IBitmapOverlayControl : public ISwitchControl
 {
 public:
   IBitmapOverlayControl(IPlugBase* pPlug, int x, int y, int paramIdx, IBitmap* pBitmap, IRECT pTargetArea)
-    : ISwitchControl(pPlug, x, y, paramIdx, pBitmap), mTargetArea(pTargetArea) {}
+    : ISwitchControl(pPlug, x, y, paramIdx, pBitmap), mTargetArea(pTargetArea) { mDrawThreadSafe = false; }
 
   IBitmapOverlayControl(IPlugBase* pPlug, int x, int y, IBitmap* pBitmap, IRECT pTargetArea)
-    : ISwitchControl(pPlug, x, y, -1, pBitmap), mTargetArea(pTargetArea) {}
+    : ISwitchControl(pPlug, x, y, -1, pBitmap), mTargetArea(pTargetArea) { mDrawThreadSafe = false; }
 
   ~IBitmapOverlayControl() {}
 
@@ -462,7 +469,7 @@ public:
   enum EFileSelectorState { kFSNone, kFSSelecting, kFSDone };
 
   IFileSelectorControl(IPlugBase* pPlug, IRECT pR, int paramIdx, IBitmap* pBitmap,
-                       EFileAction action, char* dir = "", char* extensions = "")     // extensions = "txt wav" for example.
+                       EFileAction action, const char* dir = "", const char* extensions = "")     // extensions = "txt wav" for example.
     : IControl(pPlug, pR, paramIdx), mBitmap(*pBitmap),
       mFileAction(action), mDir(dir), mExtensions(extensions), mState(kFSNone) {}
   ~IFileSelectorControl() {}
@@ -652,6 +659,15 @@ public:
      */
     void setRange(double range);
     
+    /**
+     *  Enable incremental drawing for scrolling plots (ILevelPlotControl, IGRPlotControl)
+     *  Instead of rebuilding the whole path every frame, the previous image is shifted left by the
+     *  points added since the last draw and only the strip they occupy is rasterized. Default = false
+     *
+     *  @param incremental True = enabled
+     */
+    void setIncrementalDraw(bool incremental);
+    
     /*
      *  Plot a set of values
      *  Points will be evenly spaced along the horizontal axis
@@ -688,6 +704,11 @@ protected:
     cairo_surface_t *surface;
     cairo_t *cr;
     bool mRetina;
+    bool mIncremental, mSurfaceValid;   //mSurfaceValid: surface holds a complete plot that can be scrolled
+    int mScrollCols;                    //Points added since the last draw
+    cairo_pattern_t* mGradient;         //Fill gradient, rebuilt by getGradient() only when it changes
+    double mGradientStop;
+    int mGradientHeight;
     
     
     
@@ -698,7 +719,35 @@ protected:
      */
     virtual void checkChangeDPI(IGraphics* pGraphics);
 
+    /**
+     *  Vertical gradient from mColorFill (at stop) to mColorFill at 0.3 alpha (at the bottom)
+     *
+     *  @param stop Position of the opaque stop in range [0,1]
+     *
+     *  @return The cached pattern, owned by the control
+     */
+    cairo_pattern_t* getGradient(double stop);
+    
+    /**
+     *  Prepares the surface for a scrolling plot of nPoints points, spacing pixels apart
+     *  In incremental mode the previous image is scrolled and only the strip that changed is cleared
+     *  and clipped to, otherwise the whole surface is cleared. Must be paired with endPlotDraw()
+     *
+     *  @return Index of the first point that has to go on the path (0 = full redraw), -1 if nothing changed
+     */
+    int beginPlotDraw(int nPoints, int spacing);
+    
+    /**
+     *  Finishes a beginPlotDraw() and blits the surface to IGraphics
+     *
+     *  @return True if drawn
+     */
+    bool endPlotDraw(IGraphics* pGraphics);
     
+    /**
+     *  Shifts the surface contents left by px pixels
+     */
+    void scrollSurface(int px);
     
     /**
      *  Scale a value from range [inMin, inMax] to [outMin, outMax]
@@ -804,10 +853,18 @@ public:
     /**
      *  Takes a sample of audio to be added to the plot
      *  For a smooth plot, sample should be processed by an envelope follower
+     *  Audio thread, does not allocate or lock
      *  @param sample A sample of audio
      */
     void process(double sample);
     
+    /**
+     *  Takes the plot points the audio thread has finished since the last call
+     *
+     *  @return True if there are new points to draw
+     */
+    bool IsDirty();
+    
     /**
      *  Draws the plot
      *
@@ -819,10 +876,14 @@ public:
     
 protected:
     double mTimeScale;
-    int mBufferLength, mXRes, mRes, mSpacing, mYRange, mHeadroom;
-    valarray<double> *mBuffer, *mDrawVals;
+    int mXRes, mRes, mSpacing, mYRange, mHeadroom;
+    IMeterBuffer mMeter;                //Audio thread -> GUI, one point per mXRes'th of mTimeScale
+    WDL_TypedBuf<double> mDrawVals;     //GUI thread only, circular: oldest point at mDrawPos
+    int mDrawPos;
     bool mStroke, mReverseFill, mGradientFill;
     
+    inline double drawVal(int i) { int n = mDrawVals.GetSize(); i += mDrawPos; return mDrawVals.Get()[i < n ? i : i - n]; }
+    
     /**
      *  Checks for changes in DPI state of display, updates cairo graphics context accordingly
      *
@@ -858,16 +919,26 @@ public:
     
     void setGradientFill(bool enabled);
     
+    //Audio thread, does not allocate or lock
     void process(double sampleIn, double sampleOut, double sampleGR);
     
+    //Takes the plot points the audio thread has finished since the last call
+    bool IsDirty();
+    
     void checkChangeDPI(IGraphics* pGraphics);
     
     bool Draw(IGraphics* pGraphics);
     
 protected:
+    enum { kPre, kPost, kGR, kNumPlots };
+    
     double mTimeScale, sr;
-    int mBufferLength, mXRes, mSpacing, mYRange, mHeadroom, mRes;
-    valarray<double> *mBufferPre, *mBufferPost, *mBufferGR, *mDrawValsPre, *mDrawValsPost, *mDrawValsGR;
+    int mXRes, mSpacing, mYRange, mHeadroom, mRes;
+    IMeterBuffer mMeter;                        //Audio thread -> GUI, channels kPre, kPost, kGR
+    WDL_TypedBuf<double> mDrawVals[kNumPlots];  //GUI thread only, circular: oldest point at mDrawPos
+    int mDrawPos;
+    
+    inline double drawVal(int plot, int i) { int n = mDrawVals[plot].GetSize(); i += mDrawPos; return mDrawVals[plot].Get()[i < n ? i : i - n]; }
 
     bool mGradientFill;
     
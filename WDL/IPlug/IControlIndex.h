@@ -0,0 +1,139 @@
+#ifndef _ICONTROLINDEX_
+#define _ICONTROLINDEX_
+
+/*
+
+IControlIndex is a uniform grid over the GUI that lists, for every cell, the
+controls whose bounds overlap it, in attach (back to front) order. IGraphics
+builds it from the control rects when controls are attached or move, and uses
+it to find the controls under a dirty region or the mouse without walking
+every control.
+
+The cell size is picked so the grid has at most kMaxCells cells. Bounds
+outside the GUI are clamped to the edge cells.
+
+*/
+
+#include "IPlugStructs.h"
+#include "../heapbuf.h"
+#include <stdlib.h>
+
+class IControlIndex
+{
+public:
+  IControlIndex() : mCellSize(32), mCols(0), mRows(0), mStampVal(0) {}
+  ~IControlIndex() {}
+
+  enum { kMaxCells = 4096, kMinCellSize = 16 };
+
+  // pBounds[i] is control i's draw area unioned with its mouse target area.
+  void Build(const IRECT* pBounds, int nControls, int w, int h)
+  {
+    mCellSize = kMinCellSize;
+    while ((w / mCellSize + 1) * (h / mCellSize + 1) > kMaxCells) mCellSize *= 2;
+    mCols = w / mCellSize + 1;
+    mRows = h / mCellSize + 1;
+
+    int nCells = mCols * mRows;
+    int* pStart = mCellStart.Resize(nCells + 1);
+    memset(pStart, 0, (nCells + 1) * sizeof(int));
+
+    // Counting pass, then fill: each cell's list ends up in control order.
+    int i, x, y;
+    for (i = 0; i < nControls; ++i)
+    {
+      int c0, c1, r0, r1;
+      if (!GetCellRange(pBounds + i, &c0, &r0, &c1, &r1)) continue;
+      for (y = r0; y <= r1; ++y)
+      {
+        for (x = c0; x <= c1; ++x) ++pStart[y * mCols + x + 1];
+      }
+    }
+    for (i = 0; i < nCells; ++i) pStart[i + 1] += pStart[i];
+
+    int* pItems = mItems.Resize(pStart[nCells]);
+    int* pFill = mFill.Resize(nCells);
+    memcpy(pFill, pStart, nCells * sizeof(int));
+    for (i = 0; i < nControls; ++i)
+    {
+      int c0, c1, r0, r1;
+      if (!GetCellRange(pBounds + i, &c0, &r0, &c1, &r1)) continue;
+      for (y = r0; y <= r1; ++y)
+      {
+        for (x = c0; x <= c1; ++x) pItems[pFill[y * mCols + x]++] = i;
+      }
+    }
+
+    mStamps.Resize(nControls);
+    memset(mStamps.Get(), 0, nControls * sizeof(int));
+    mStampVal = 0;
+  }
+
+  // The controls overlapping the cell under (x, y), back to front.
+  const int* GetCell(int x, int y, int* pN)
+  {
+    *pN = 0;
+    if (!mCols || x < 0 || y < 0) return 0;
+    int c = x / mCellSize, r = y / mCellSize;
+    if (c >= mCols || r >= mRows) return 0;
+    const int* pStart = mCellStart.Get() + r * mCols + c;
+    *pN = pStart[1] - pStart[0];
+    return mItems.Get() + pStart[0];
+  }
+
+  // Every control whose cells overlap pR, each once and back to front. A superset of the controls
+  // whose bounds intersect pR, the caller checks the rects.
+  void Query(IRECT* pR, WDL_TypedBuf<int>* pResult)
+  {
+    pResult->Resize(0, false);
+    int c0, c1, r0, r1;
+    if (!GetCellRange(pR, &c0, &r0, &c1, &r1)) return;
+
+    if (++mStampVal < 0) // Wrapped, start over.
+    {
+      memset(mStamps.Get(), 0, mStamps.GetSize() * sizeof(int));
+      mStampVal = 1;
+    }
+
+    const int* pStart = mCellStart.Get();
+    const int* pItems = mItems.Get();
+    int* pStamps = mStamps.Get();
+    bool sorted = true;
+    for (int y = r0; y <= r1; ++y)
+    {
+      for (int x = c0; x <= c1; ++x)
+      {
+        int cell = y * mCols + x;
+        for (int k = pStart[cell]; k < pStart[cell + 1]; ++k)
+        {
+          int i = pItems[k];
+          if (pStamps[i] == mStampVal) continue;
+          pStamps[i] = mStampVal;
+          int n = pResult->GetSize();
+          if (n && pResult->Get()[n - 1] > i) sorted = false;
+          pResult->Add(i);
+        }
+      }
+    }
+
+    if (!sorted) qsort(pResult->Get(), pResult->GetSize(), sizeof(int), CompareInts);
+  }
+
+private:
+  bool GetCellRange(const IRECT* pR, int* pC0, int* pR0, int* pC1, int* pR1) const
+  {
+    if (!mCols || pR->Empty() || pR->R <= pR->L || pR->B <= pR->T) return false;
+    *pC0 = BOUNDED(pR->L / mCellSize, 0, mCols - 1);
+    *pC1 = BOUNDED((pR->R - 1) / mCellSize, 0, mCols - 1);
+    *pR0 = BOUNDED(pR->T / mCellSize, 0, mRows - 1);
+    *pR1 = BOUNDED((pR->B - 1) / mCellSize, 0, mRows - 1);
+    return true;
+  }
+
+  static int CompareInts(const void* a, const void* b) { return *(const int*) a - *(const int*) b; }
+
+  int mCellSize, mCols, mRows, mStampVal;
+  WDL_TypedBuf<int> mCellStart, mItems, mFill, mStamps;
+};
+
+#endif // _ICONTROLINDEX_
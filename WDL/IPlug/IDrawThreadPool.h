@@ -0,0 +1,206 @@
+#ifndef _IDRAWTHREADPOOL_
+#define _IDRAWTHREADPOOL_
+
+/*
+
+IDrawThreadPool runs a batch of independent jobs (the tiles of a frame, for
+IGraphics::SetTiledDrawing) on a few worker threads. The calling thread takes
+jobs too, and Run() returns only once every job of the batch is done, so the
+caller can treat it like a plain loop over the jobs.
+
+Jobs are handed out one at a time under a lock, there are only ever a few
+dozen per frame.
+
+*/
+
+#include "../mutex.h"
+#include "../heapbuf.h"
+
+#ifndef _WIN32
+  #include <pthread.h>
+  #include <unistd.h>
+#endif
+
+class IDrawThreadPool
+{
+public:
+  typedef void (*JobFunc)(void* pCtx, int job);
+
+  // nThreads = 0 for one less than the number of CPUs (the calling thread works too), at least 1.
+  IDrawThreadPool(int nThreads = 0) : mFunc(0), mCtx(0), mNJobs(0), mNext(0), mDone(0), mQuit(false)
+  {
+    if (nThreads < 1)
+    {
+#ifdef _WIN32
+      SYSTEM_INFO si;
+      GetSystemInfo(&si);
+      nThreads = (int) si.dwNumberOfProcessors - 1;
+#else
+      nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN) - 1;
+#endif
+      if (nThreads < 1) nThreads = 1;
+    }
+
+#ifdef _WIN32
+    mWake = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+    mDoneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    for (int i = 0; i < nThreads; ++i)
+    {
+      DWORD tid;
+      HANDLE h = CreateThread(NULL, 0, ThreadProc, this, 0, &tid);
+      if (!h) break;
+      SetThreadPriority(h, THREAD_PRIORITY_ABOVE_NORMAL);
+      mThreads.Add(h);
+    }
+#else
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mWake, NULL);
+    pthread_cond_init(&mDoneCond, NULL);
+    for (int i = 0; i < nThreads; ++i)
+    {
+      pthread_t t;
+      if (pthread_create(&t, NULL, ThreadProc, this)) break;
+      mThreads.Add(t);
+    }
+#endif
+  }
+
+  ~IDrawThreadPool()
+  {
+    int i, n = mThreads.GetSize();
+#ifdef _WIN32
+    mMutex.Enter();
+    mQuit = true;
+    mMutex.Leave();
+    ReleaseSemaphore(mWake, n, NULL);
+    for (i = 0; i < n; ++i)
+    {
+      WaitForSingleObject(mThreads.Get()[i], INFINITE);
+      CloseHandle(mThreads.Get()[i]);
+    }
+    CloseHandle(mDoneEvent);
+    CloseHandle(mWake);
+#else
+    pthread_mutex_lock(&mLock);
+    mQuit = true;
+    pthread_cond_broadcast(&mWake);
+    pthread_mutex_unlock(&mLock);
+    for (i = 0; i < n; ++i) pthread_join(mThreads.Get()[i], NULL);
+    pthread_cond_destroy(&mDoneCond);
+    pthread_cond_destroy(&mWake);
+    pthread_mutex_destroy(&mLock);
+#endif
+  }
+
+  int NThreads() { return mThreads.GetSize(); }
+
+  // Calls func(pCtx, 0 .. nJobs-1), in any order and on any of the threads, and waits for all of them.
+  // Not reentrant: call from one thread at a time, and not from inside a job.
+  void Run(JobFunc func, void* pCtx, int nJobs)
+  {
+    if (nJobs < 1) return;
+    if (nJobs == 1 || !mThreads.GetSize())
+    {
+      for (int i = 0; i < nJobs; ++i) func(pCtx, i);
+      return;
+    }
+
+    Lock();
+    mFunc = func;
+    mCtx = pCtx;
+    mNJobs = nJobs;
+    mNext = mDone = 0;
+#ifdef _WIN32
+    Unlock();
+    int nWake = nJobs - 1;
+    if (nWake > mThreads.GetSize()) nWake = mThreads.GetSize();
+    ReleaseSemaphore(mWake, nWake, NULL);
+    DoJobs();
+    WaitForSingleObject(mDoneEvent, INFINITE);
+#else
+    pthread_cond_broadcast(&mWake);
+    Unlock();
+    DoJobs();
+    Lock();
+    while (mDone < mNJobs) pthread_cond_wait(&mDoneCond, &mLock);
+    Unlock();
+#endif
+  }
+
+private:
+  JobFunc mFunc;
+  void* mCtx;
+  int mNJobs, mNext, mDone;
+  bool mQuit;
+
+#ifdef _WIN32
+  WDL_Mutex mMutex;
+  HANDLE mWake, mDoneEvent;
+  WDL_TypedBuf<HANDLE> mThreads;
+  void Lock() { mMutex.Enter(); }
+  void Unlock() { mMutex.Leave(); }
+#else
+  pthread_mutex_t mLock;
+  pthread_cond_t mWake, mDoneCond;
+  WDL_TypedBuf<pthread_t> mThreads;
+  void Lock() { pthread_mutex_lock(&mLock); }
+  void Unlock() { pthread_mutex_unlock(&mLock); }
+#endif
+
+  // Takes jobs until none are left. Whoever finishes the last one wakes Run().
+  void DoJobs()
+  {
+    Lock();
+    while (mNext < mNJobs)
+    {
+      int job = mNext++;
+      JobFunc func = mFunc;
+      void* pCtx = mCtx;
+      Unlock();
+      func(pCtx, job);
+      Lock();
+      if (++mDone == mNJobs)
+      {
+#ifdef _WIN32
+        SetEvent(mDoneEvent);
+#else
+        pthread_cond_signal(&mDoneCond);
+#endif
+      }
+    }
+    Unlock();
+  }
+
+  void WorkerLoop()
+  {
+    for (;;)
+    {
+#ifdef _WIN32
+      WaitForSingleObject(mWake, INFINITE);
+      Lock();
+      bool quit = mQuit;
+      Unlock();
+      if (quit) break;
+#else
+      Lock();
+      while (mNext >= mNJobs && !mQuit) pthread_cond_wait(&mWake, &mLock);
+      bool quit = mQuit;
+      Unlock();
+      if (quit) break;
+#endif
+      DoJobs();
+    }
+  }
+
+#ifdef _WIN32
+  static DWORD WINAPI ThreadProc(LPVOID p)
+#else
+  static void* ThreadProc(void* p)
+#endif
+  {
+    ((IDrawThreadPool*) p)->WorkerLoop();
+    return 0;
+  }
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "IGraphics.h"
+#include "../wdlatomic.h"
 
 #define DEFAULT_FPS 25
 
@@ -10,67 +11,267 @@
   #define CONTROL_BOUNDS_COLOR COLOR_GREEN
 #endif
 
-class BitmapStorage
+#ifndef DEFAULT_BITMAP_CACHE_BUDGET
+  #define DEFAULT_BITMAP_CACHE_BUDGET (128 << 20)
+#endif
+
+// A bitmap shared by all IGraphics instances, IBitmap::mData points at one of these. The pixels are
+// decoded (or scaled from mSrc) on the UI thread the first time they are needed, and BitmapStorage::Trim()
+// drops them again, least recently drawn first, while the cache is over budget.
+class CachedBitmap : public LICE_IBitmap
 {
 public:
+  CachedBitmap(int id, const char* name, CachedBitmap* pSrc, int w, int h)
+    : mID(id), mSrc(pSrc), mW(w), mH(h), mBitmap(0), mReady(0), mLastUse(0)
+  {
+    mName.Set(name ? name : "");
+  }
+  ~CachedBitmap() { delete(mBitmap); }
+
+  LICE_pixel* getBits() { return Pixels()->getBits(); }
+  int getWidth() { return mW; }
+  int getHeight() { return mH; }
+  int getRowSpan() { return Pixels()->getRowSpan(); }
+  bool isFlipped() { return Pixels()->isFlipped(); }
+  bool resize(int w, int h) { return false; }
+  INT_PTR Extended(int id, void* data) { return Pixels()->Extended(id, data); }
+
+  inline LICE_IBitmap* Pixels();
+
+  int mID;                        // Resource ID, negated for @2x, 0 for scaled variants.
+  WDL_String mName;
+  CachedBitmap* mSrc;             // What a scaled variant is scaled from.
+  int mW, mH;
+  LICE_IBitmap* mBitmap;          // The decoded pixels, or 0.
+  int mReady;                     // Set (atomically) once mBitmap can be read without BitmapStorage::m_mutex.
+  int mLastUse;                   // BitmapStorage::m_tick when last drawn.
+  WDL_PtrList<IGraphics> mOwners; // Instances that loaded it, any of them can decode it.
+};
 
-  struct BitmapKey
-  {
-    int id;
-    LICE_IBitmap* bitmap;
-  };
+class BitmapStorage
+{
+public:
 
-  WDL_PtrList<BitmapKey> m_bitmaps;
+  WDL_PtrList<CachedBitmap> m_bitmaps;
+  WDL_PtrList<LICE_IBitmap> m_retained; // RetainBitmap(), owned but not managed.
   WDL_Mutex m_mutex;
+  int m_tick;                           // Advanced as each frame starts and ends.
+  WDL_PtrList<IGraphics> m_drawing;     // Instances between BeginFrame() and Trim().
+  size_t m_budget, m_bytes;
+  int m_hits, m_misses, m_decodes, m_evictions;
+
+  BitmapStorage()
+    : m_tick(1), m_budget(DEFAULT_BITMAP_CACHE_BUDGET), m_bytes(0), m_hits(0), m_misses(0), m_decodes(0), m_evictions(0) {}
 
-  LICE_IBitmap* Find(int id)
+  static size_t Bytes(LICE_IBitmap* bitmap) { return (size_t) bitmap->getRowSpan() * bitmap->getHeight() * sizeof(LICE_pixel); }
+
+  // Finds or adds the entry and makes pGraphics one of its owners. Counts a hit if the pixels are ready.
+  CachedBitmap* Get(IGraphics* pGraphics, int id, const char* name, CachedBitmap* pSrc, int w, int h)
   {
     WDL_MutexLock lock(&m_mutex);
+    CachedBitmap* pCB = 0;
+    int i, n = m_bitmaps.GetSize();
+    for (i = 0; i < n && !pCB; ++i)
+    {
+      CachedBitmap* p = m_bitmaps.Get(i);
+      if (id ? p->mID == id : (p->mSrc == pSrc && p->mW == w && p->mH == h)) pCB = p;
+    }
+    if (!pCB) pCB = m_bitmaps.Add(new CachedBitmap(id, name, pSrc, w, h));
+    if (pCB->mOwners.Find(pGraphics) < 0) pCB->mOwners.Add(pGraphics);
+
+    if (pCB->mBitmap) ++m_hits;
+    else ++m_misses;
+    return pCB;
+  }
+
+  // An instance that can load pCB: one of its owners or, for a source nobody owns any more, whoever owns a
+  // variant scaled from it.
+  IGraphics* Loader(CachedBitmap* pCB)
+  {
+    if (pCB->mOwners.GetSize()) return pCB->mOwners.Get(0);
     int i, n = m_bitmaps.GetSize();
     for (i = 0; i < n; ++i)
     {
-      BitmapKey* key = m_bitmaps.Get(i);
-      if (key->id == id) return key->bitmap;
+      CachedBitmap* p = m_bitmaps.Get(i);
+      IGraphics* pLoader = p->mSrc == pCB ? Loader(p) : 0;
+      if (pLoader) return pLoader;
     }
     return 0;
   }
 
-  void Add(LICE_IBitmap* bitmap, int id = -1)
+  // Called with m_mutex held, on the UI thread.
+  LICE_IBitmap* Decode(CachedBitmap* pCB)
+  {
+    LICE_IBitmap* bitmap = 0;
+    if (pCB->mSrc)
+    {
+      LICE_IBitmap* pSrc = pCB->mSrc->Pixels();
+      bitmap = new LICE_MemBitmap(pCB->mW, pCB->mH);
+      _LICE::LICE_ScaledBlit(bitmap, pSrc, 0, 0, pCB->mW, pCB->mH, 0.0f, 0.0f, (float) pCB->mSrc->mW, (float) pCB->mSrc->mH, 1.0f,
+                             LICE_BLIT_MODE_COPY | LICE_BLIT_FILTER_BILINEAR);
+    }
+    else
+    {
+      IGraphics* pLoader = Loader(pCB);
+      if (pLoader) bitmap = pLoader->OSLoadBitmap(pCB->mID, pCB->mName.Get());
+    }
+    #ifndef NDEBUG
+    bool imgResourceFound = bitmap;
+    #endif
+    assert(imgResourceFound); // Protect against typos in resource.h and .rc files, and missing @2x files.
+    if (!bitmap)
+    {
+      // Draw nothing rather than read past a smaller bitmap.
+      bitmap = new LICE_MemBitmap(pCB->mW, pCB->mH);
+      _LICE::LICE_Clear(bitmap, 0);
+    }
+    ++m_decodes;
+    m_bytes += Bytes(bitmap);
+    return bitmap;
+  }
+
+  // CachedBitmap::Pixels() when they aren't ready. A tile job doesn't decode, it gets blank pixels and the
+  // bitmap is decoded by DecodeDeferred() once the tiles are done.
+  LICE_IBitmap* Fetch(CachedBitmap* pCB)
   {
     WDL_MutexLock lock(&m_mutex);
-    BitmapKey* key = m_bitmaps.Add(new BitmapKey);
-    key->id = id;
-    key->bitmap = bitmap;
+    if (!pCB->mBitmap)
+    {
+      IGraphics* pTileGraphics = IGraphics::sTileGraphics;
+      if (pTileGraphics)
+      {
+        int i = pTileGraphics->mDeferredBitmaps.Find(pCB);
+        if (i < 0)
+        {
+          pTileGraphics->mDeferredBitmaps.Add(pCB);
+          LICE_IBitmap* blank = pTileGraphics->mDeferredBlanks.Add(new LICE_MemBitmap(pCB->mW, pCB->mH));
+          _LICE::LICE_Clear(blank, 0);
+          return blank;
+        }
+        return pTileGraphics->mDeferredBlanks.Get(i);
+      }
+      pCB->mBitmap = Decode(pCB);
+      wdl_atomic_set(&pCB->mReady, 1);
+    }
+    return pCB->mBitmap;
   }
 
-  void Remove(LICE_IBitmap* bitmap)
+  // Decodes what pGraphics' tile jobs asked for, returns false if there was nothing.
+  bool DecodeDeferred(IGraphics* pGraphics)
   {
     WDL_MutexLock lock(&m_mutex);
-    int i, n = m_bitmaps.GetSize();
+    int i, n = pGraphics->mDeferredBitmaps.GetSize();
     for (i = 0; i < n; ++i)
     {
-      if (m_bitmaps.Get(i)->bitmap == bitmap)
+      Fetch(pGraphics->mDeferredBitmaps.Get(i));
+    }
+    pGraphics->mDeferredBitmaps.Empty();
+    pGraphics->mDeferredBlanks.Empty(true);
+    return n > 0;
+  }
+
+  void Drop(CachedBitmap* pCB)
+  {
+    if (pCB->mBitmap)
+    {
+      wdl_atomic_set(&pCB->mReady, 0);
+      m_bytes -= Bytes(pCB->mBitmap);
+      DELETE_NULL(pCB->mBitmap);
+      ++m_evictions;
+    }
+  }
+
+  void BeginFrame(IGraphics* pGraphics)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    pGraphics->mBitmapFrame = wdl_atomic_incr(&m_tick);
+    if (m_drawing.Find(pGraphics) < 0) m_drawing.Add(pGraphics);
+  }
+
+  // Called by IGraphics::Draw() once its frame is finished. Nothing drawn since the start of that frame, or
+  // of any other instance's frame still in progress, is dropped.
+  void Trim(IGraphics* pGraphics)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    int i, n, keepFrom = pGraphics->mBitmapFrame;
+    for (i = 0; i < m_drawing.GetSize(); ++i)
+    {
+      keepFrom = IPMIN(keepFrom, m_drawing.Get(i)->mBitmapFrame);
+    }
+    while (m_budget && m_bytes > m_budget)
+    {
+      CachedBitmap* pLRU = 0;
+      for (i = 0, n = m_bitmaps.GetSize(); i < n; ++i)
       {
-        m_bitmaps.Delete(i, true);
-        delete(bitmap);
-        break;
+        CachedBitmap* p = m_bitmaps.Get(i);
+        if (p->mBitmap && p->mLastUse < keepFrom && (!pLRU || p->mLastUse < pLRU->mLastUse)) pLRU = p;
       }
+      if (!pLRU) break; // Everything left is in use.
+      Drop(pLRU);
     }
+    m_drawing.Delete(m_drawing.Find(pGraphics));
+    wdl_atomic_incr(&m_tick);
   }
 
-  ~BitmapStorage()
+  bool IsCached(LICE_IBitmap* bitmap)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    return m_bitmaps.Find((CachedBitmap*) bitmap) >= 0;
+  }
+
+  void Retain(LICE_IBitmap* bitmap)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    m_retained.Add(bitmap);
+  }
+
+  void Release(IGraphics* pGraphics, LICE_IBitmap* bitmap)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    int i = m_retained.Find(bitmap);
+    if (i >= 0)
+    {
+      m_retained.Delete(i, true);
+      return;
+    }
+    i = m_bitmaps.Find((CachedBitmap*) bitmap);
+    if (i >= 0) ReleaseOwner(pGraphics, m_bitmaps.Get(i));
+  }
+
+  // Pixels nobody owns any more are dropped straight away, the entries stay for whoever loads them next.
+  void ReleaseOwner(IGraphics* pGraphics, CachedBitmap* pCB = 0)
   {
+    WDL_MutexLock lock(&m_mutex);
+    if (!pCB) m_drawing.Delete(m_drawing.Find(pGraphics));
     int i, n = m_bitmaps.GetSize();
     for (i = 0; i < n; ++i)
     {
-      delete(m_bitmaps.Get(i)->bitmap);
+      CachedBitmap* p = m_bitmaps.Get(i);
+      if (pCB && p != pCB) continue;
+      int j = p->mOwners.Find(pGraphics);
+      if (j >= 0)
+      {
+        p->mOwners.Delete(j);
+        if (!p->mOwners.GetSize()) Drop(p);
+      }
     }
+  }
+
+  ~BitmapStorage()
+  {
     m_bitmaps.Empty(true);
+    m_retained.Empty(true);
   }
 };
 
 static BitmapStorage s_bitmapCache;
 
+inline LICE_IBitmap* CachedBitmap::Pixels()
+{
+  wdl_atomic_set(&mLastUse, wdl_atomic_get(&s_bitmapCache.m_tick));
+  return wdl_atomic_get(&mReady) ? mBitmap : s_bitmapCache.Fetch(this);
+}
+
 class FontStorage
 {
 public:
@@ -121,6 +322,8 @@ public:
 };
 
 static FontStorage s_fontCache;
+// LICE fonts render through static scratch bitmaps, so text is drawn by one thread at a time.
+static WDL_Mutex s_textMutex;
 
 inline LICE_pixel LiceColor(const IColor* pColor)
 {
@@ -165,6 +368,7 @@ IGraphics::IGraphics(IPlugBase* pPlug, int w, int h, int refreshFPS)
   , mWidth(w)
   , mHeight(h)
   , mIdleTicks(0)
+  , mControlIndexValid(false)
   , mMouseCapture(-1)
   , mMouseOver(-1)
   , mMouseX(0)
@@ -176,7 +380,9 @@ IGraphics::IGraphics(IPlugBase* pPlug, int w, int h, int refreshFPS)
   , mDrawBitmap_2x(0)
   , mRetina(false)
 #endif
-  , mTmpBitmap(0)
+  , mDrawPool(0)
+  , mNTiles(0)
+  , mBitmapFrame(0)
   , mLastClickedParam(-1)
   , mKeyCatcher(0)
   , mCursorHidden(false)
@@ -186,6 +392,7 @@ IGraphics::IGraphics(IPlugBase* pPlug, int w, int h, int refreshFPS)
   , mShowControlBounds(false)
 {
   mFPS = (refreshFPS > 0 ? refreshFPS : DEFAULT_FPS);
+  memset(&mTarget, 0, sizeof(mTarget));
 }
 
 IGraphics::~IGraphics()
@@ -193,12 +400,16 @@ IGraphics::~IGraphics()
   if (mKeyCatcher)
     DELETE_NULL(mKeyCatcher);
 
+  DELETE_NULL(mDrawPool);
+  mTiles.Empty(true);
+  mDeferredBlanks.Empty(true);
   mControls.Empty(true);
+  s_bitmapCache.ReleaseOwner(this);
   DELETE_NULL(mDrawBitmap);
 #ifdef IPLUG_RETINA_SUPPORT
   DELETE_NULL(mDrawBitmap_2x);
 #endif
-  DELETE_NULL(mTmpBitmap);
+  DELETE_NULL(mTarget.mTmpBitmap);
 }
 
 void IGraphics::Resize(int w, int h)
@@ -207,11 +418,12 @@ void IGraphics::Resize(int w, int h)
   mHeight = h;
   ReleaseMouseCapture();
   mControls.Empty(true);
+  mControlIndexValid = false;
   DELETE_NULL(mDrawBitmap);
 #ifdef IPLUG_RETINA_SUPPORT
   DELETE_NULL(mDrawBitmap_2x);
 #endif
-  DELETE_NULL(mTmpBitmap);
+  DELETE_NULL(mTarget.mTmpBitmap);
   PrepDraw();
   mPlug->ResizeGraphics(w, h);
 }
@@ -245,17 +457,20 @@ void IGraphics::AttachBackground(int ID, const char* name)
   IBitmap bg = LoadIBitmap(ID, name);
   IControl* pBG = new IBitmapControl(mPlug, 0, 0, -1, &bg, IChannelBlend::kBlendClobber);
   mControls.Insert(0, pBG);
+  mControlIndexValid = false;
 }
 
 void IGraphics::AttachPanelBackground(const IColor *pColor)
 {
   IControl* pBG = new IPanelControl(mPlug, IRECT(0, 0, mWidth, mHeight), pColor);
   mControls.Insert(0, pBG);
+  mControlIndexValid = false;
 }
 
 int IGraphics::AttachControl(IControl* pControl)
 {
   mControls.Add(pControl);
+  mControlIndexValid = false;
   return mControls.GetSize() - 1;
 }
 
@@ -429,51 +644,68 @@ void IGraphics::PromptUserInput(IControl* pControl, IParam* pParam, IRECT* pText
 
 }
 
+// The 1x image is decoded here for its size, its pixels may still be dropped and decoded again later.
+// The @2x image is only decoded when first drawn.
 IBitmap IGraphics::LoadIBitmap(int ID, const char* name, int nStates, bool framesAreHoriztonal)
 {
-  LICE_IBitmap* lb = s_bitmapCache.Find(ID);
-  if (!lb)
+  CachedBitmap* lb = s_bitmapCache.Get(this, ID, name, 0, 0, 0);
+  if (!lb->mW)
   {
-    lb = OSLoadBitmap(ID, name);
-    #ifndef NDEBUG
-    bool imgResourceFound = lb;
-    #endif
-    assert(imgResourceFound); // Protect against typos in resource.h and .rc files.
-    s_bitmapCache.Add(lb, ID);
+    WDL_MutexLock lock(&s_bitmapCache.m_mutex);
+    if (!lb->mW)
+    {
+      LICE_IBitmap* pDecoded = lb->Pixels();
+      lb->mW = pDecoded->getWidth();
+      lb->mH = pDecoded->getHeight();
+    }
   }
 #ifndef IPLUG_RETINA_SUPPORT
   return IBitmap(lb, lb->getWidth(), lb->getHeight(), nStates, framesAreHoriztonal);
 #else
   int ID_2x = -ID;
-  LICE_IBitmap* lb_2x = s_bitmapCache.Find(ID_2x);
-  if (!lb_2x)
-  {
-    char name_2x[strlen(name)+3];
-    char *ext = strrchr(name, '.');
-    int extpos = int(ext - name);
-    strncpy(name_2x, name, extpos);
-    strcpy(&name_2x[extpos], "@2x");
-    strcpy(&name_2x[extpos+3], ext);
-    
-    lb_2x = OSLoadBitmap(ID_2x, name_2x);
-    #ifndef NDEBUG
-    bool imgResourceFound = lb_2x;
-    #endif
-    assert(imgResourceFound); // Retina bitmap not found: use "bitmap@2x.png" naming convention
-    s_bitmapCache.Add(lb_2x, ID_2x);
-  }
+  char name_2x[strlen(name)+4];
+  const char *ext = strrchr(name, '.');
+  int extpos = int(ext - name);
+  strncpy(name_2x, name, extpos);
+  strcpy(&name_2x[extpos], "@2x");
+  strcpy(&name_2x[extpos+3], ext);
+  // Retina bitmaps use the "bitmap@2x.png" naming convention.
+  CachedBitmap* lb_2x = s_bitmapCache.Get(this, ID_2x, name_2x, 0, 2 * lb->mW, 2 * lb->mH);
   return IBitmap(lb, lb_2x, lb->getWidth(), lb->getHeight(), nStates, framesAreHoriztonal);
 #endif
 }
 
 void IGraphics::RetainBitmap(IBitmap* pBitmap)
 {
-  s_bitmapCache.Add((LICE_IBitmap*)pBitmap->mData);
+  s_bitmapCache.Retain((LICE_IBitmap*)pBitmap->mData);
 }
 
 void IGraphics::ReleaseBitmap(IBitmap* pBitmap)
 {
-  s_bitmapCache.Remove((LICE_IBitmap*)pBitmap->mData);
+  s_bitmapCache.Release(this, (LICE_IBitmap*)pBitmap->mData);
+}
+
+void IGraphics::SetBitmapCacheBudget(size_t bytes)
+{
+  WDL_MutexLock lock(&s_bitmapCache.m_mutex);
+  s_bitmapCache.m_budget = bytes;
+}
+
+void IGraphics::GetBitmapCacheStats(IBitmapCacheStats* pStats)
+{
+  WDL_MutexLock lock(&s_bitmapCache.m_mutex);
+  pStats->mHits = s_bitmapCache.m_hits;
+  pStats->mMisses = s_bitmapCache.m_misses;
+  pStats->mDecodes = s_bitmapCache.m_decodes;
+  pStats->mEvictions = s_bitmapCache.m_evictions;
+  pStats->mBitmaps = s_bitmapCache.m_bitmaps.GetSize();
+  pStats->mDecoded = 0;
+  for (int i = 0; i < pStats->mBitmaps; ++i)
+  {
+    if (s_bitmapCache.m_bitmaps.Get(i)->mBitmap) ++pStats->mDecoded;
+  }
+  pStats->mBytes = s_bitmapCache.m_bytes;
+  pStats->mBudget = s_bitmapCache.m_budget;
 }
 
 void IGraphics::PrepDraw()
@@ -481,13 +713,20 @@ void IGraphics::PrepDraw()
   mDrawBitmap = new LICE_SysBitmap(Width(), Height());
 #ifdef IPLUG_RETINA_SUPPORT
   mDrawBitmap_2x = new LICE_SysBitmap(2 * Width(), 2 * Height());
+  mTarget.mBitmap_2x = mDrawBitmap_2x;
 #endif
-  mTmpBitmap = new LICE_MemBitmap();
+  mTarget.mBitmap = mDrawBitmap;
+  mTarget.mX = mTarget.mY = 0;
+  mTarget.mClip = &mDrawRECT;
+  mTarget.mTmpBitmap = new LICE_MemBitmap();
 }
 
+// The drawing methods take GUI coordinates, pT->mX and pT->mY translate them to the target bitmaps.
+
 bool IGraphics::DrawBitmap(IBitmap* pIBitmap, IRECT* pDest, int srcX, int srcY, const IChannelBlend* pBlend)
 {
-  IRECT r = pDest->Intersect(&mDrawRECT);
+  IDrawTarget* pT = GetDrawTarget();
+  IRECT r = pDest->Intersect(pT->mClip);
   srcX += r.L - pDest->L;
   srcY += r.T - pDest->T;
 
@@ -495,30 +734,31 @@ bool IGraphics::DrawBitmap(IBitmap* pIBitmap, IRECT* pDest, int srcX, int srcY,
   if (IsRetina())
   {
     LICE_IBitmap* pLB_2x = (LICE_IBitmap*) pIBitmap->mData_2x;
-    _LICE::LICE_Blit(mDrawBitmap_2x, pLB_2x, r.L * 2, r.T * 2, srcX * 2, srcY * 2, r.W() * 2, r.H() * 2, LiceWeight(pBlend), LiceBlendMode(pBlend));
+    _LICE::LICE_Blit(pT->mBitmap_2x, pLB_2x, (r.L - pT->mX) * 2, (r.T - pT->mY) * 2, srcX * 2, srcY * 2, r.W() * 2, r.H() * 2, LiceWeight(pBlend), LiceBlendMode(pBlend));
     return true;
   }
 #endif
   
   LICE_IBitmap* pLB = (LICE_IBitmap*) pIBitmap->mData;
-  _LICE::LICE_Blit(mDrawBitmap, pLB, r.L, r.T, srcX, srcY, r.W(), r.H(), LiceWeight(pBlend), LiceBlendMode(pBlend));
+  _LICE::LICE_Blit(pT->mBitmap, pLB, r.L - pT->mX, r.T - pT->mY, srcX, srcY, r.W(), r.H(), LiceWeight(pBlend), LiceBlendMode(pBlend));
   return true;
 }
 
 bool IGraphics::DrawRotatedBitmap(IBitmap* pIBitmap, int destCtrX, int destCtrY, double angle, int yOffsetZeroDeg,
                                   const IChannelBlend* pBlend)
 {
+  IDrawTarget* pT = GetDrawTarget();
   int W = pIBitmap->W;
   int H = pIBitmap->H;
-  int destX = destCtrX - W / 2;
-  int destY = destCtrY - H / 2;
+  int destX = destCtrX - W / 2 - pT->mX;
+  int destY = destCtrY - H / 2 - pT->mY;
   
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
     LICE_IBitmap* pLB = (LICE_IBitmap*) pIBitmap->mData_2x;
   
-    _LICE::LICE_RotatedBlit(mDrawBitmap_2x, pLB, destX * 2, destY * 2, W * 2, H * 2, 0.0f, 0.0f, float(W * 2), float(H * 2), (float) angle,
+    _LICE::LICE_RotatedBlit(pT->mBitmap_2x, pLB, destX * 2, destY * 2, W * 2, H * 2, 0.0f, 0.0f, float(W * 2), float(H * 2), (float) angle,
                           false, LiceWeight(pBlend), LiceBlendMode(pBlend) | LICE_BLIT_FILTER_BILINEAR, 0.0f, float(yOffsetZeroDeg * 2));
     
     return true;
@@ -536,7 +776,7 @@ bool IGraphics::DrawRotatedBitmap(IBitmap* pIBitmap, int destCtrX, int destCtrY,
   //int W = int(h * sinA + w * cosA);
   //int H = int(h * cosA + w * sinA);
 
-  _LICE::LICE_RotatedBlit(mDrawBitmap, pLB, destX, destY, W, H, 0.0f, 0.0f, (float) W, (float) H, (float) angle,
+  _LICE::LICE_RotatedBlit(pT->mBitmap, pLB, destX, destY, W, H, 0.0f, 0.0f, (float) W, (float) H, (float) angle,
                           false, LiceWeight(pBlend), LiceBlendMode(pBlend) | LICE_BLIT_FILTER_BILINEAR, 0.0f, (float) yOffsetZeroDeg);
 
   return true;
@@ -545,17 +785,18 @@ bool IGraphics::DrawRotatedBitmap(IBitmap* pIBitmap, int destCtrX, int destCtrY,
 bool IGraphics::DrawRotatedMask(IBitmap* pIBase, IBitmap* pIMask, IBitmap* pITop, int x, int y, double angle,
                                 const IChannelBlend* pBlend)
 {
-  
+  IDrawTarget* pT = GetDrawTarget();
   double dA = angle * PI / 180.0;
   int W = pIBase->W;
   int H = pIBase->H;
   //	RECT srcR = { 0, 0, W, H };
   float xOffs = (W % 2 ? -0.5f : 0.0f);
   
-  if (!mTmpBitmap)
+  if (!pT->mTmpBitmap)
   {
-    mTmpBitmap = new LICE_MemBitmap();
+    pT->mTmpBitmap = new LICE_MemBitmap();
   }
+  LICE_MemBitmap* pTmp = pT->mTmpBitmap;
   
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
@@ -564,15 +805,15 @@ bool IGraphics::DrawRotatedMask(IBitmap* pIBase, IBitmap* pIMask, IBitmap* pITop
     LICE_IBitmap* pMask = (LICE_IBitmap*) pIMask->mData_2x;
     LICE_IBitmap* pTop = (LICE_IBitmap*) pITop->mData_2x;
 
-    _LICE::LICE_Copy(mTmpBitmap, pBase);
+    _LICE::LICE_Copy(pTmp, pBase);
     
-    _LICE::LICE_RotatedBlit(mTmpBitmap, pMask, 0, 0, W * 2, H * 2, 0.0f, 0.0f, float(W * 2), float(H * 2), (float) dA,
+    _LICE::LICE_RotatedBlit(pTmp, pMask, 0, 0, W * 2, H * 2, 0.0f, 0.0f, float(W * 2), float(H * 2), (float) dA,
                             true, 1.0f, LICE_BLIT_MODE_ADD | LICE_BLIT_FILTER_BILINEAR | LICE_BLIT_USE_ALPHA, xOffs, 0.0f);
-    _LICE::LICE_RotatedBlit(mTmpBitmap, pTop, 0, 0, W * 2, H * 2, 0.0f, 0.0f, float(W * 2), float(H * 2), (float) dA,
+    _LICE::LICE_RotatedBlit(pTmp, pTop, 0, 0, W * 2, H * 2, 0.0f, 0.0f, float(W * 2), float(H * 2), (float) dA,
                             true, 1.0f, LICE_BLIT_MODE_COPY | LICE_BLIT_FILTER_BILINEAR | LICE_BLIT_USE_ALPHA, xOffs, 0.0f);
 
-    IRECT r = IRECT(x, y, x + W, y + H).Intersect(&mDrawRECT);
-    _LICE::LICE_Blit(mDrawBitmap_2x, mTmpBitmap, r.L * 2, r.T * 2, (r.L - x) * 2, (r.T - y) * 2, (r.R - r.L) * 2, (r.B - r.T) * 2,
+    IRECT r = IRECT(x, y, x + W, y + H).Intersect(pT->mClip);
+    _LICE::LICE_Blit(pT->mBitmap_2x, pTmp, (r.L - pT->mX) * 2, (r.T - pT->mY) * 2, (r.L - x) * 2, (r.T - y) * 2, (r.R - r.L) * 2, (r.B - r.T) * 2,
                      LiceWeight(pBlend), LiceBlendMode(pBlend));
     return true;
   }
@@ -582,16 +823,16 @@ bool IGraphics::DrawRotatedMask(IBitmap* pIBase, IBitmap* pIMask, IBitmap* pITop
   LICE_IBitmap* pMask = (LICE_IBitmap*) pIMask->mData;
   LICE_IBitmap* pTop = (LICE_IBitmap*) pITop->mData;
 
-  _LICE::LICE_Copy(mTmpBitmap, pBase);
-  //  _LICE::LICE_ClearRect(mTmpBitmap, 0, 0, W, H, LICE_RGBA(255, 255, 255, 0));
+  _LICE::LICE_Copy(pTmp, pBase);
+  //  _LICE::LICE_ClearRect(pTmp, 0, 0, W, H, LICE_RGBA(255, 255, 255, 0));
 
-  _LICE::LICE_RotatedBlit(mTmpBitmap, pMask, 0, 0, W, H, 0.0f, 0.0f, (float) W, (float) H, (float) dA,
+  _LICE::LICE_RotatedBlit(pTmp, pMask, 0, 0, W, H, 0.0f, 0.0f, (float) W, (float) H, (float) dA,
                           true, 1.0f, LICE_BLIT_MODE_ADD | LICE_BLIT_FILTER_BILINEAR | LICE_BLIT_USE_ALPHA, xOffs, 0.0f);
-  _LICE::LICE_RotatedBlit(mTmpBitmap, pTop, 0, 0, W, H, 0.0f, 0.0f, (float) W, (float) H, (float) dA,
+  _LICE::LICE_RotatedBlit(pTmp, pTop, 0, 0, W, H, 0.0f, 0.0f, (float) W, (float) H, (float) dA,
                           true, 1.0f, LICE_BLIT_MODE_COPY | LICE_BLIT_FILTER_BILINEAR | LICE_BLIT_USE_ALPHA, xOffs, 0.0f);
 
-  IRECT r = IRECT(x, y, x + W, y + H).Intersect(&mDrawRECT);
-  _LICE::LICE_Blit(mDrawBitmap, mTmpBitmap, r.L, r.T, r.L - x, r.T - y, r.R - r.L, r.B - r.T,
+  IRECT r = IRECT(x, y, x + W, y + H).Intersect(pT->mClip);
+  _LICE::LICE_Blit(pT->mBitmap, pTmp, r.L - pT->mX, r.T - pT->mY, r.L - x, r.T - y, r.R - r.L, r.B - r.T,
                    LiceWeight(pBlend), LiceBlendMode(pBlend));
   //	ReaperExt::LICE_Blit(mDrawBitmap, mTmpBitmap, x, y, &srcR, LiceWeight(pBlend), LiceBlendMode(pBlend));
   return true;
@@ -600,6 +841,7 @@ bool IGraphics::DrawRotatedMask(IBitmap* pIBase, IBitmap* pIMask, IBitmap* pITop
 bool IGraphics::DrawPoint(const IColor* pColor, float x, float y,
                           const IChannelBlend* pBlend, bool antiAlias)
 {
+  IDrawTarget* pT = GetDrawTarget();
   float weight = LiceWeight(pBlend);
   LICE_pixel color = LiceColor(pColor);
   int mode = LiceBlendMode(pBlend);
@@ -607,35 +849,40 @@ bool IGraphics::DrawPoint(const IColor* pColor, float x, float y,
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
-    int X = int(x + 0.5f) * 2, Y = int(y + 0.5f) * 2;
-    _LICE::LICE_PutPixel(mDrawBitmap_2x, X  , Y  , color, weight, mode);
-    _LICE::LICE_PutPixel(mDrawBitmap_2x, X+1, Y  , color, weight, mode);
-    _LICE::LICE_PutPixel(mDrawBitmap_2x, X  , Y+1, color, weight, mode);
-    _LICE::LICE_PutPixel(mDrawBitmap_2x, X+1, Y+1, color, weight, mode);
+    int X = (int(x + 0.5f) - pT->mX) * 2, Y = (int(y + 0.5f) - pT->mY) * 2;
+    _LICE::LICE_PutPixel(pT->mBitmap_2x, X  , Y  , color, weight, mode);
+    _LICE::LICE_PutPixel(pT->mBitmap_2x, X+1, Y  , color, weight, mode);
+    _LICE::LICE_PutPixel(pT->mBitmap_2x, X  , Y+1, color, weight, mode);
+    _LICE::LICE_PutPixel(pT->mBitmap_2x, X+1, Y+1, color, weight, mode);
     return true;
   }
 #endif
   
-  _LICE::LICE_PutPixel(mDrawBitmap, int(x + 0.5f), int(y + 0.5f), color, weight, mode);
+  _LICE::LICE_PutPixel(pT->mBitmap, int(x + 0.5f) - pT->mX, int(y + 0.5f) - pT->mY, color, weight, mode);
   return true;
 }
 
 bool IGraphics::ForcePixel(const IColor* pColor, int x, int y)
 {
+  IDrawTarget* pT = GetDrawTarget();
+  x -= pT->mX;
+  y -= pT->mY;
+  // Out of a tile is out of bounds too, but a tile is still inside the backbuffer, so just skip it.
+  if (pT != &mTarget && (x < 0 || y < 0 || x >= pT->mBitmap->getWidth() || y >= pT->mBitmap->getHeight())) return true;
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
     LICE_pixel* pxTL, *pxTR, *pxBL, *pxBR;
-    pxTL = mDrawBitmap_2x->getBits() + 2 * x + 2 * y * mDrawBitmap_2x->getRowSpan();
+    pxTL = pT->mBitmap_2x->getBits() + 2 * x + 2 * y * pT->mBitmap_2x->getRowSpan();
     pxTR = pxTL + 1;
-    pxBL = pxTL + mDrawBitmap_2x->getRowSpan();
+    pxBL = pxTL + pT->mBitmap_2x->getRowSpan();
     pxBR = pxBL + 1;
     *pxTL = *pxTR = *pxBL = *pxBR = LiceColor(pColor);
     return true;
   }
 #endif
-  LICE_pixel* px = mDrawBitmap->getBits();
-  px += x + y * mDrawBitmap->getRowSpan();
+  LICE_pixel* px = pT->mBitmap->getBits();
+  px += x + y * pT->mBitmap->getRowSpan();
   *px = LiceColor(pColor);
   return true;
 }
@@ -643,6 +890,7 @@ bool IGraphics::ForcePixel(const IColor* pColor, int x, int y)
 bool IGraphics::DrawLine(const IColor* pColor, float x1, float y1, float x2, float y2,
                          const IChannelBlend* pBlend, bool antiAlias)
 {
+  IDrawTarget* pT = GetDrawTarget();
   float weight = LiceWeight(pBlend);
   LICE_pixel color = LiceColor(pColor);
   int mode = LiceBlendMode(pBlend);
@@ -650,25 +898,28 @@ bool IGraphics::DrawLine(const IColor* pColor, float x1, float y1, float x2, flo
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
-    int X1 = int(x1) * 2, X2 = int(x2) * 2, Y1 = int(y1) * 2, Y2 = int(y2) * 2;
-    _LICE::LICE_Line(mDrawBitmap_2x, X1  , Y1  , X2  , Y2  , color, weight, mode, antiAlias);
-    _LICE::LICE_Line(mDrawBitmap_2x, X1+1, Y1  , X2+1, Y2  , color, weight, mode, antiAlias);
-    _LICE::LICE_Line(mDrawBitmap_2x, X1  , Y1+1, X2  , Y2+1, color, weight, mode, antiAlias);
-    _LICE::LICE_Line(mDrawBitmap_2x, X1+1, Y1+1, X2+1, Y2+1, color, weight, mode, antiAlias);
+    int X1 = (int(x1) - pT->mX) * 2, X2 = (int(x2) - pT->mX) * 2, Y1 = (int(y1) - pT->mY) * 2, Y2 = (int(y2) - pT->mY) * 2;
+    _LICE::LICE_Line(pT->mBitmap_2x, X1  , Y1  , X2  , Y2  , color, weight, mode, antiAlias);
+    _LICE::LICE_Line(pT->mBitmap_2x, X1+1, Y1  , X2+1, Y2  , color, weight, mode, antiAlias);
+    _LICE::LICE_Line(pT->mBitmap_2x, X1  , Y1+1, X2  , Y2+1, color, weight, mode, antiAlias);
+    _LICE::LICE_Line(pT->mBitmap_2x, X1+1, Y1+1, X2+1, Y2+1, color, weight, mode, antiAlias);
     return true;
   }
 #endif
   
-  _LICE::LICE_Line(mDrawBitmap, (int) x1, (int) y1, (int) x2, (int) y2, color, weight, mode, antiAlias);
+  _LICE::LICE_Line(pT->mBitmap, (int) x1 - pT->mX, (int) y1 - pT->mY, (int) x2 - pT->mX, (int) y2 - pT->mY, color, weight, mode, antiAlias);
   return true;
 }
 
 bool IGraphics::DrawArc(const IColor* pColor, float cx, float cy, float r, float minAngle, float maxAngle,
                         const IChannelBlend* pBlend, bool antiAlias)
 {
+  IDrawTarget* pT = GetDrawTarget();
   int mode = LiceBlendMode(pBlend);
   float weight = LiceWeight(pBlend);
   LICE_pixel color = LiceColor(pColor);
+  cx -= (float) pT->mX;
+  cy -= (float) pT->mY;
   
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
@@ -676,22 +927,25 @@ bool IGraphics::DrawArc(const IColor* pColor, float cx, float cy, float r, float
     float cX = cx * 2.f;
     float cY = cy * 2.f;
     float R = r * 2.f;
-    _LICE::LICE_Arc(mDrawBitmap_2x, cX, cY, R, minAngle, maxAngle, color, weight, mode, antiAlias);
-    _LICE::LICE_Arc(mDrawBitmap_2x, cX, cY, R - 1.f, minAngle, maxAngle, color, weight, mode, antiAlias);
+    _LICE::LICE_Arc(pT->mBitmap_2x, cX, cY, R, minAngle, maxAngle, color, weight, mode, antiAlias);
+    _LICE::LICE_Arc(pT->mBitmap_2x, cX, cY, R - 1.f, minAngle, maxAngle, color, weight, mode, antiAlias);
     return true;
   }
 #endif
   
-  _LICE::LICE_Arc(mDrawBitmap, cx, cy, r, minAngle, maxAngle, color, weight, mode, antiAlias);
+  _LICE::LICE_Arc(pT->mBitmap, cx, cy, r, minAngle, maxAngle, color, weight, mode, antiAlias);
   return true;
 }
 
 bool IGraphics::DrawCircle(const IColor* pColor, float cx, float cy, float r,
                            const IChannelBlend* pBlend, bool antiAlias)
 {
+  IDrawTarget* pT = GetDrawTarget();
   int mode = LiceBlendMode(pBlend);
   float weight = LiceWeight(pBlend);
   LICE_pixel color = LiceColor(pColor);
+  cx -= (float) pT->mX;
+  cy -= (float) pT->mY;
   
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
@@ -699,18 +953,19 @@ bool IGraphics::DrawCircle(const IColor* pColor, float cx, float cy, float r,
     float cX = cx * 2.f;
     float cY = cy * 2.f;
     float R = r * 2.f;
-    _LICE::LICE_Circle(mDrawBitmap_2x, cX, cY, R, color, weight, mode, antiAlias);
-    _LICE::LICE_Circle(mDrawBitmap_2x, cX, cY, R - 1.f, color, weight, mode, antiAlias);
+    _LICE::LICE_Circle(pT->mBitmap_2x, cX, cY, R, color, weight, mode, antiAlias);
+    _LICE::LICE_Circle(pT->mBitmap_2x, cX, cY, R - 1.f, color, weight, mode, antiAlias);
     return true;
   }
 #endif
 
-  _LICE::LICE_Circle(mDrawBitmap, cx, cy, r, color, weight, mode, antiAlias);
+  _LICE::LICE_Circle(pT->mBitmap, cx, cy, r, color, weight, mode, antiAlias);
   return true;
 }
 
 bool IGraphics::RoundRect(const IColor* pColor, IRECT* pR, const IChannelBlend* pBlend, int cornerradius, bool aa)
 {
+  IDrawTarget* pT = GetDrawTarget();
   int mode = LiceBlendMode(pBlend);
   float weight = LiceWeight(pBlend);
   LICE_pixel color = LiceColor(pColor);
@@ -718,24 +973,25 @@ bool IGraphics::RoundRect(const IColor* pColor, IRECT* pR, const IChannelBlend*
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
-    int x1 = pR->L * 2;
-    int y1 = pR->T * 2;
+    int x1 = (pR->L - pT->mX) * 2;
+    int y1 = (pR->T - pT->mY) * 2;
     int h = pR->H() * 2;
     int w = pR->W() * 2;
     int r = cornerradius * 2;
-    _LICE::LICE_RoundRect(mDrawBitmap_2x, (float) x1, (float) y1, (float) w, (float) h, r, color, weight, mode, aa);
-    _LICE::LICE_RoundRect(mDrawBitmap_2x, float(x1 + 1), float(y1 + 1), float(w - 2), float(h - 2), r - 1, color, weight, mode, aa);
+    _LICE::LICE_RoundRect(pT->mBitmap_2x, (float) x1, (float) y1, (float) w, (float) h, r, color, weight, mode, aa);
+    _LICE::LICE_RoundRect(pT->mBitmap_2x, float(x1 + 1), float(y1 + 1), float(w - 2), float(h - 2), r - 1, color, weight, mode, aa);
     return true;
   }
 #endif
   
-  _LICE::LICE_RoundRect(mDrawBitmap, (float) pR->L, (float) pR->T, (float) pR->W(), (float) pR->H(), cornerradius,
+  _LICE::LICE_RoundRect(pT->mBitmap, (float) (pR->L - pT->mX), (float) (pR->T - pT->mY), (float) pR->W(), (float) pR->H(), cornerradius,
                         color, weight, mode, aa);
   return true;
 }
 
 bool IGraphics::FillRoundRect(const IColor* pColor, IRECT* pR, const IChannelBlend* pBlend, int cornerradius, bool aa)
 {
+  IDrawTarget* pT = GetDrawTarget();
   int mode = LiceBlendMode(pBlend);
   float weight = LiceWeight(pBlend);
   LICE_pixel color = LiceColor(pColor);
@@ -743,121 +999,156 @@ bool IGraphics::FillRoundRect(const IColor* pColor, IRECT* pR, const IChannelBle
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
-    int x1 = pR->L * 2;
-    int y1 = pR->T * 2;
+    int x1 = (pR->L - pT->mX) * 2;
+    int y1 = (pR->T - pT->mY) * 2;
     int h = pR->H() * 2;
     int w = pR->W() * 2;
     int r = cornerradius * 2;
     
-    _LICE::LICE_FillRect(mDrawBitmap_2x, x1+r, y1, w-2*r, h, color, weight, mode);
-    _LICE::LICE_FillRect(mDrawBitmap_2x, x1, y1+r, r, h-2*r,color, weight, mode);
-    _LICE::LICE_FillRect(mDrawBitmap_2x, x1+w-r, y1+r, r, h-2*r, color, weight, mode);
+    _LICE::LICE_FillRect(pT->mBitmap_2x, x1+r, y1, w-2*r, h, color, weight, mode);
+    _LICE::LICE_FillRect(pT->mBitmap_2x, x1, y1+r, r, h-2*r,color, weight, mode);
+    _LICE::LICE_FillRect(pT->mBitmap_2x, x1+w-r, y1+r, r, h-2*r, color, weight, mode);
     
     //void LICE_FillCircle(LICE_IBitmap* dest, float cx, float cy, float r, LICE_pixel color, float alpha, int mode, bool aa)
-    _LICE::LICE_FillCircle(mDrawBitmap_2x, float(x1+r), float(y1+r), (float) r, color, weight, mode, aa);
-    _LICE::LICE_FillCircle(mDrawBitmap_2x, float(x1+w-r-1), float(y1+h-r-1), (float) r, color, weight, mode, aa);
-    _LICE::LICE_FillCircle(mDrawBitmap_2x, float(x1+w-r-1), float(y1+r), (float) r, color, weight, mode, aa);
-    _LICE::LICE_FillCircle(mDrawBitmap_2x, float(x1+r), float(y1+h-r-1), (float) r, color, weight, mode, aa);
+    _LICE::LICE_FillCircle(pT->mBitmap_2x, float(x1+r), float(y1+r), (float) r, color, weight, mode, aa);
+    _LICE::LICE_FillCircle(pT->mBitmap_2x, float(x1+w-r-1), float(y1+h-r-1), (float) r, color, weight, mode, aa);
+    _LICE::LICE_FillCircle(pT->mBitmap_2x, float(x1+w-r-1), float(y1+r), (float) r, color, weight, mode, aa);
+    _LICE::LICE_FillCircle(pT->mBitmap_2x, float(x1+r), float(y1+h-r-1), (float) r, color, weight, mode, aa);
     
     return true;
   }
 #endif
   
-  int x1 = pR->L;
-  int y1 = pR->T;
+  int x1 = pR->L - pT->mX;
+  int y1 = pR->T - pT->mY;
   int h = pR->H();
   int w = pR->W();
   int r = cornerradius;
   
-  _LICE::LICE_FillRect(mDrawBitmap, x1+r, y1, w-2*r, h, color, weight, mode);
-  _LICE::LICE_FillRect(mDrawBitmap, x1, y1+r, r, h-2*r,color, weight, mode);
-  _LICE::LICE_FillRect(mDrawBitmap, x1+w-r, y1+r, r, h-2*r, color, weight, mode);
+  _LICE::LICE_FillRect(pT->mBitmap, x1+r, y1, w-2*r, h, color, weight, mode);
+  _LICE::LICE_FillRect(pT->mBitmap, x1, y1+r, r, h-2*r,color, weight, mode);
+  _LICE::LICE_FillRect(pT->mBitmap, x1+w-r, y1+r, r, h-2*r, color, weight, mode);
 
   //void LICE_FillCircle(LICE_IBitmap* dest, float cx, float cy, float r, LICE_pixel color, float alpha, int mode, bool aa)
-  _LICE::LICE_FillCircle(mDrawBitmap, (float) x1+r, (float) y1+r, (float) r, color, weight, mode, aa);
-  _LICE::LICE_FillCircle(mDrawBitmap, (float) x1+w-r-1, (float) y1+h-r-1, (float) r, color, weight, mode, aa);
-  _LICE::LICE_FillCircle(mDrawBitmap, (float) x1+w-r-1, (float) y1+r, (float) r, color, weight, mode, aa);
-  _LICE::LICE_FillCircle(mDrawBitmap, (float) x1+r, (float) y1+h-r-1, (float) r, color, weight, mode, aa);
+  _LICE::LICE_FillCircle(pT->mBitmap, (float) x1+r, (float) y1+r, (float) r, color, weight, mode, aa);
+  _LICE::LICE_FillCircle(pT->mBitmap, (float) x1+w-r-1, (float) y1+h-r-1, (float) r, color, weight, mode, aa);
+  _LICE::LICE_FillCircle(pT->mBitmap, (float) x1+w-r-1, (float) y1+r, (float) r, color, weight, mode, aa);
+  _LICE::LICE_FillCircle(pT->mBitmap, (float) x1+r, (float) y1+h-r-1, (float) r, color, weight, mode, aa);
   
   return true;
 }
 
 bool IGraphics::FillIRect(const IColor* pColor, IRECT* pR, const IChannelBlend* pBlend)
 {
+  IDrawTarget* pT = GetDrawTarget();
+  // Clipped like DrawBitmap(), so a panel background only repaints the region being drawn.
+  IRECT r = pR->Intersect(pT->mClip);
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
-    _LICE::LICE_FillRect(mDrawBitmap_2x, pR->L * 2, pR->T * 2, pR->W() * 2, pR->H() * 2, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
+    _LICE::LICE_FillRect(pT->mBitmap_2x, (r.L - pT->mX) * 2, (r.T - pT->mY) * 2, r.W() * 2, r.H() * 2, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
     return true;
   }
 #endif
-  _LICE::LICE_FillRect(mDrawBitmap, pR->L, pR->T, pR->W(), pR->H(), LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
+  _LICE::LICE_FillRect(pT->mBitmap, r.L - pT->mX, r.T - pT->mY, r.W(), r.H(), LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
   return true;
 }
 
 bool IGraphics::FillCircle(const IColor* pColor, int cx, int cy, float r, const IChannelBlend* pBlend, bool antiAlias)
 {
+  IDrawTarget* pT = GetDrawTarget();
+  cx -= pT->mX;
+  cy -= pT->mY;
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
-    _LICE::LICE_FillCircle(mDrawBitmap_2x, float(cx * 2), float(cy * 2), r * 2.f, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend), antiAlias);
+    _LICE::LICE_FillCircle(pT->mBitmap_2x, float(cx * 2), float(cy * 2), r * 2.f, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend), antiAlias);
     return true;
   }
 #endif
-  _LICE::LICE_FillCircle(mDrawBitmap, (float) cx, (float) cy, r, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend), antiAlias);
+  _LICE::LICE_FillCircle(pT->mBitmap, (float) cx, (float) cy, r, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend), antiAlias);
   return true;
 }
 
 bool IGraphics::FillTriangle(const IColor* pColor, int x1, int y1, int x2, int y2, int x3, int y3, IChannelBlend* pBlend)
 {
+  IDrawTarget* pT = GetDrawTarget();
+  x1 -= pT->mX, x2 -= pT->mX, x3 -= pT->mX;
+  y1 -= pT->mY, y2 -= pT->mY, y3 -= pT->mY;
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
-    _LICE::LICE_FillTriangle(mDrawBitmap_2x, x1 * 2, y1 * 2, x2 * 2, y2 * 2, x3 * 2, y3 * 2, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
+    _LICE::LICE_FillTriangle(pT->mBitmap_2x, x1 * 2, y1 * 2, x2 * 2, y2 * 2, x3 * 2, y3 * 2, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
     return true;
   }
 #endif
-  _LICE::LICE_FillTriangle(mDrawBitmap, x1, y1, x2, y2, x3, y3, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
+  _LICE::LICE_FillTriangle(pT->mBitmap, x1, y1, x2, y2, x3, y3, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
   return true;
 }
 
 bool IGraphics::FillIConvexPolygon(const IColor* pColor, int* x, int* y, int npoints, const IChannelBlend* pBlend)
 {
+  IDrawTarget* pT = GetDrawTarget();
 #ifdef IPLUG_RETINA_SUPPORT
   if (IsRetina())
   {
     int X[npoints], Y[npoints];
     for (int i = 0; i < npoints; ++i)
-      X[i] = x[i] * 2, Y[i] = y[i] * 2;
-    _LICE::LICE_FillConvexPolygon(mDrawBitmap_2x, X, Y, npoints, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
+      X[i] = (x[i] - pT->mX) * 2, Y[i] = (y[i] - pT->mY) * 2;
+    _LICE::LICE_FillConvexPolygon(pT->mBitmap_2x, X, Y, npoints, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
     return true;
   }
 #endif
-  _LICE::LICE_FillConvexPolygon(mDrawBitmap, x, y, npoints, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
+  if (pT->mX || pT->mY)
+  {
+    int X[npoints], Y[npoints];
+    for (int i = 0; i < npoints; ++i)
+      X[i] = x[i] - pT->mX, Y[i] = y[i] - pT->mY;
+    _LICE::LICE_FillConvexPolygon(pT->mBitmap, X, Y, npoints, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
+    return true;
+  }
+  _LICE::LICE_FillConvexPolygon(pT->mBitmap, x, y, npoints, LiceColor(pColor), LiceWeight(pBlend), LiceBlendMode(pBlend));
   return true;
 }
 
 IColor IGraphics::GetPoint(int x, int y)
 {
-  LICE_pixel pix = _LICE::LICE_GetPixel(mDrawBitmap, x, y);
+  IDrawTarget* pT = GetDrawTarget();
+  LICE_pixel pix = _LICE::LICE_GetPixel(pT->mBitmap, x - pT->mX, y - pT->mY);
   return IColor(LICE_GETA(pix), LICE_GETR(pix), LICE_GETG(pix), LICE_GETB(pix));
 }
 
 bool IGraphics::DrawVerticalLine(const IColor* pColor, int xi, int yLo, int yHi)
 {
-  _LICE::LICE_Line(mDrawBitmap, xi, yLo, xi, yHi, LiceColor(pColor), 1.0f, LICE_BLIT_MODE_COPY, false);
+  IDrawTarget* pT = GetDrawTarget();
+  xi -= pT->mX;
+  _LICE::LICE_Line(pT->mBitmap, xi, yLo - pT->mY, xi, yHi - pT->mY, LiceColor(pColor), 1.0f, LICE_BLIT_MODE_COPY, false);
   return true;
 }
 
 bool IGraphics::DrawHorizontalLine(const IColor* pColor, int yi, int xLo, int xHi)
 {
-  _LICE::LICE_Line(mDrawBitmap, xLo, yi, xHi, yi, LiceColor(pColor), 1.0f, LICE_BLIT_MODE_COPY, false);
+  IDrawTarget* pT = GetDrawTarget();
+  yi -= pT->mY;
+  _LICE::LICE_Line(pT->mBitmap, xLo - pT->mX, yi, xHi - pT->mX, yi, LiceColor(pColor), 1.0f, LICE_BLIT_MODE_COPY, false);
   return true;
 }
 
+// Scaled variants of loaded bitmaps are cached per size and scaled when first drawn, like LoadIBitmap().
 IBitmap IGraphics::ScaleBitmap(IBitmap* pIBitmap, int destW, int destH)
 {
   LICE_IBitmap* pSrc = (LICE_IBitmap*) pIBitmap->mData;
+  if (s_bitmapCache.IsCached(pSrc))
+  {
+    CachedBitmap* pDest = s_bitmapCache.Get(this, 0, 0, (CachedBitmap*) pSrc, destW, destH);
+#ifndef IPLUG_RETINA_SUPPORT
+    return IBitmap(pDest, destW, destH, pIBitmap->N);
+#else
+    CachedBitmap* pDest_2x = s_bitmapCache.Get(this, 0, 0, (CachedBitmap*) pIBitmap->mData_2x, destW * 2, destH * 2);
+    return IBitmap(pDest, pDest_2x, destW, destH, pIBitmap->N);
+#endif
+  }
+
   LICE_MemBitmap* pDest = new LICE_MemBitmap(destW, destH);
   _LICE::LICE_ScaledBlit(pDest, pSrc, 0, 0, destW, destH, 0.0f, 0.0f, (float) pIBitmap->W, (float) pIBitmap->H, 1.0f,
                          LICE_BLIT_MODE_COPY | LICE_BLIT_FILTER_BILINEAR);
@@ -967,6 +1258,9 @@ bool IGraphics::DrawRadialLine(const IColor* pColor, float cx, float cy, float a
 
 bool IGraphics::IsDirty(IRECT* pR)
 {
+  // Called from the GUI timer, a convenient main thread tick.
+  mPlug->ReportLatencyChange();
+
 #ifndef NDEBUG
   if (mShowControlBounds)
   {
@@ -978,6 +1272,8 @@ bool IGraphics::IsDirty(IRECT* pR)
   bool dirty = false;
   int i, n = mControls.GetSize();
   IControl** ppControl = mControls.GetList();
+  IRECT* pBounds = mControlBounds.Get();
+  if (mControlBounds.GetSize() != n) mControlIndexValid = false;
   for (i = 0; i < n; ++i, ++ppControl)
   {
     IControl* pControl = *ppControl;
@@ -986,6 +1282,11 @@ bool IGraphics::IsDirty(IRECT* pR)
       *pR = pR->Union(pControl->GetRECT());
       dirty = true;
     }
+    // A control that moved or resized since the index was built.
+    if (mControlIndexValid && GetControlBounds(pControl) != pBounds[i])
+    {
+      mControlIndexValid = false;
+    }
   }
 
 #ifdef USE_IDLE_CALLS
@@ -1020,19 +1321,17 @@ bool IGraphics::Draw(IRECT* pR)
   CheckIfRetina();
 #endif
 
+  s_bitmapCache.BeginFrame(this);
+
+  UpdateControlIndex();
+
   if (mStrict)
   {
-    mDrawRECT = *pR;
-    int n = mControls.GetSize();
+    DrawRegion(pR);
     IControl** ppControl = mControls.GetList();
-    for (int i = 0; i < n; ++i, ++ppControl)
+    for (i = 0; i < n; ++i, ++ppControl)
     {
-      IControl* pControl = *ppControl;
-      if (!(pControl->IsHidden()) && pR->Intersects(pControl->GetRECT()))
-      {
-        pControl->Draw(this);
-      }
-      pControl->SetClean();
+      (*ppControl)->SetClean();
     }
   }
   else
@@ -1040,43 +1339,42 @@ bool IGraphics::Draw(IRECT* pR)
     IControl* pBG = mControls.Get(0);
     if (pBG->IsDirty())   // Special case when everything needs to be drawn.
     {
-      mDrawRECT = *(pBG->GetRECT());
-      for (int j = 0; j < n; ++j)
+      DrawRegion(pBG->GetRECT());
+      for (j = 0; j < n; ++j)
       {
         IControl* pControl2 = mControls.Get(j);
         if (!j || !(pControl2->IsHidden()))
         {
-          pControl2->Draw(this);
           pControl2->SetClean();
         }
       }
     }
     else
     {
-      for (i = 1; i < n; ++i)   // loop through all controls starting from one (not bg)
+      mDirtyRegions.Resize(0, false);
+      mDirtyControls.Resize(0, false);
+      for (i = 1; i < n; ++i)
       {
-        IControl* pControl = mControls.Get(i); // assign control i to pControl
-        if (pControl->IsDirty())   // if pControl is dirty
+        IControl* pControl = mControls.Get(i);
+        if (pControl->IsDirty())
         {
+          mDirtyControls.Add(i);
+          if (!pControl->GetRECT()->Empty()) mDirtyRegions.Add(*(pControl->GetRECT()));
+        }
+      }
 
-          // printf("control %i is Dirty\n", i);
-
-          mDrawRECT = *(pControl->GetRECT()); // put the rect in the mDrawRect member variable
-          for (j = 0; j < n; ++j)   // loop through all controls
-          {
-            IControl* pControl2 = mControls.Get(j); // assign control j to pControl2
+      MergeDirtyRegions();
 
-            // if control1 == control2 OR control2 is not hidden AND control2's rect intersects mDrawRect
-            if (!pControl2->IsHidden() && (i == j || pControl2->GetRECT()->Intersects(&mDrawRECT)))
-            {
-              //if ((i == j) && (!pControl2->IsHidden())|| (!(pControl2->IsHidden()) && pControl2->GetRECT()->Intersects(&mDrawRECT))) {
-              //printf("control %i and %i \n", i, j);
+      // The regions are disjoint and every control they touch lies inside one of them,
+      // so each control is drawn at most once and the background once per pixel.
+      for (int r = 0; r < mDirtyRegions.GetSize(); ++r)
+      {
+        DrawRegion(mDirtyRegions.Get() + r);
+      }
 
-              pControl2->Draw(this);
-            }
-          }
-          pControl->SetClean();
-        }
+      for (i = 0; i < mDirtyControls.GetSize(); ++i)
+      {
+        mControls.Get(mDirtyControls.Get()[i])->SetClean();
       }
     }
   }
@@ -1098,9 +1396,205 @@ bool IGraphics::Draw(IRECT* pR)
   }
 #endif
 
+  s_bitmapCache.Trim(this);
   return DrawScreen(pR);
 }
 
+// Draws the controls that intersect pR, back to front, clipped to pR.
+void IGraphics::DrawRegion(IRECT* pR)
+{
+  mDrawRECT = *pR;
+  mControlIndex.Query(pR, &mRegionControls);
+
+  // Keep only the controls that will draw, and find out if they all can be drawn tiled.
+  int j, nDraw = 0, nQuery = mRegionControls.GetSize();
+  int* pIdx = mRegionControls.Get();
+  bool tiled = mDrawPool && (long) pR->W() * pR->H() >= kMinTiledArea;
+  for (j = 0; j < nQuery; ++j)
+  {
+    IControl* pControl = mControls.Get(pIdx[j]);
+    if ((!pIdx[j] || !pControl->IsHidden()) && pR->Intersects(pControl->GetRECT()))
+    {
+      pIdx[nDraw++] = pIdx[j];
+      if (!pControl->IsDrawThreadSafe()) tiled = false;
+    }
+  }
+  mRegionControls.Resize(nDraw, false);
+
+  if (tiled)
+  {
+    DrawTiles(pR);
+    return;
+  }
+
+  for (j = 0; j < nDraw; ++j)
+  {
+    mControls.Get(pIdx[j])->Draw(this);
+  }
+}
+
+// Cuts pR into tiles, each a view of the backbuffers, and draws mRegionControls into them on the pool threads.
+void IGraphics::DrawTiles(IRECT* pR)
+{
+  int cols = (pR->W() + kTileSize - 1) / kTileSize;
+  int rows = (pR->H() + kTileSize - 1) / kTileSize;
+  mNTiles = cols * rows;
+  while (mTiles.GetSize() < mNTiles) mTiles.Add(new ITile);
+
+  for (int t = 0; t < mNTiles; ++t)
+  {
+    ITile* pTile = mTiles.Get(t);
+    int x = pR->L + (t % cols) * kTileSize, y = pR->T + (t / cols) * kTileSize;
+    pTile->mRECT = IRECT(x, y, IPMIN(x + kTileSize, pR->R), IPMIN(y + kTileSize, pR->B));
+
+    LICE_SubBitmap* pB = &pTile->mBitmap;
+    pB->m_parent = mDrawBitmap;
+    pB->m_x = x;
+    pB->m_y = y;
+    pB->resize(pTile->mRECT.W(), pTile->mRECT.H());
+    pTile->mTarget.mBitmap = pB;
+#ifdef IPLUG_RETINA_SUPPORT
+    pB = &pTile->mBitmap_2x;
+    pB->m_parent = mDrawBitmap_2x;
+    pB->m_x = 2 * x;
+    pB->m_y = 2 * y;
+    pB->resize(2 * pTile->mRECT.W(), 2 * pTile->mRECT.H());
+    pTile->mTarget.mBitmap_2x = pB;
+#endif
+    pTile->mTarget.mX = x;
+    pTile->mTarget.mY = y;
+    pTile->mTarget.mClip = &pTile->mRECT;
+  }
+
+  mDrawPool->Run(DrawTileJob, this, mNTiles);
+
+  // Bitmaps first drawn by a tile job were left blank, decode them here and draw the tiles again.
+  while (s_bitmapCache.DecodeDeferred(this))
+  {
+    mDrawPool->Run(DrawTileJob, this, mNTiles);
+  }
+}
+
+IPLUG_THREAD_LOCAL IGraphics::IDrawTarget* IGraphics::sTileTarget = 0;
+IPLUG_THREAD_LOCAL IGraphics* IGraphics::sTileGraphics = 0;
+
+void IGraphics::DrawTileJob(void* pGraphics, int tile)
+{
+  IGraphics* pThis = (IGraphics*) pGraphics;
+  ITile* pTile = pThis->mTiles.Get(tile);
+  sTileTarget = &pTile->mTarget;
+  sTileGraphics = pThis;
+
+  int j, nDraw = pThis->mRegionControls.GetSize();
+  const int* pIdx = pThis->mRegionControls.Get();
+  for (j = 0; j < nDraw; ++j)
+  {
+    IControl* pControl = pThis->mControls.Get(pIdx[j]);
+    if (pTile->mRECT.Intersects(pControl->GetRECT()))
+    {
+      pControl->Draw(pThis);
+    }
+  }
+
+  sTileTarget = 0;
+  sTileGraphics = 0;
+}
+
+void IGraphics::SetTiledDrawing(bool enable, int nThreads)
+{
+  DELETE_NULL(mDrawPool);
+  if (enable)
+  {
+    mDrawPool = new IDrawThreadPool(nThreads);
+  }
+}
+
+IRECT IGraphics::GetControlBounds(IControl* pControl)
+{
+  return pControl->GetRECT()->Union(pControl->GetTargetRECT());
+}
+
+void IGraphics::UpdateControlIndex()
+{
+  int i, n = mControls.GetSize();
+  if (mControlIndexValid && mControlBounds.GetSize() == n) return;
+
+  IRECT* pBounds = mControlBounds.Resize(n);
+  for (i = 0; i < n; ++i)
+  {
+    pBounds[i] = GetControlBounds(mControls.Get(i));
+  }
+  mControlIndex.Build(pBounds, n, mWidth, mHeight);
+  mControlIndexValid = true;
+}
+
+// Turns the dirty control rects into disjoint regions that each contain every (non background) control
+// they touch. Controls that don't draw through DrawBitmap() are not clipped, so a control partly inside a
+// region is redrawn whole, and whatever it overlaps must be redrawn on top of it.
+// Regions that nearly touch are merged too, fewer regions means fewer passes over the index.
+void IGraphics::MergeDirtyRegions()
+{
+  const int kMaxRegions = 16;
+  const int kMergeSlack = 64 * 64; // px^2 of extra repainting worth saving a region
+
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    int nRegions = mDirtyRegions.GetSize();
+    IRECT* pRegions = mDirtyRegions.Get();
+
+    if (nRegions > kMaxRegions)
+    {
+      for (int r = 1; r < nRegions; ++r) pRegions[0] = pRegions[0].Union(pRegions + r);
+      mDirtyRegions.Resize(1, false);
+      nRegions = 1;
+    }
+
+    for (int r = 0; r < nRegions; ++r)
+    {
+      IRECT* pR = pRegions + r;
+      bool grown = true;
+      while (grown)
+      {
+        grown = false;
+        mControlIndex.Query(pR, &mRegionControls);
+        int nHits = mRegionControls.GetSize();
+        const int* pIdx = mRegionControls.Get();
+        for (int k = 0; k < nHits; ++k)
+        {
+          IControl* pControl = mControls.Get(pIdx[k]);
+          IRECT* pCR = pControl->GetRECT();
+          if (pIdx[k] && !pControl->IsHidden() && pCR->Intersects(pR) && !pR->Contains(pCR))
+          {
+            *pR = pR->Union(pCR);
+            grown = true;
+          }
+        }
+      }
+    }
+
+    for (int a = 0; a < nRegions; ++a)
+    {
+      for (int b = a + 1; b < nRegions; ++b)
+      {
+        IRECT* pA = pRegions + a;
+        IRECT* pB = pRegions + b;
+        IRECT u = pA->Union(pB);
+        long areaA = (long) pA->W() * pA->H(), areaB = (long) pB->W() * pB->H();
+        if (pA->Intersects(pB) || (long) u.W() * u.H() <= areaA + areaB + kMergeSlack)
+        {
+          *pA = u;
+          pRegions[b] = pRegions[--nRegions];
+          --b;
+          changed = true;
+        }
+      }
+    }
+    mDirtyRegions.Resize(nRegions, false);
+  }
+}
+
 void IGraphics::SetStrictDrawing(bool strict)
 {
   mStrict = strict;
@@ -1286,11 +1780,14 @@ int IGraphics::GetMouseControlIdx(int x, int y, bool mo)
 
   // The BG is a control and will catch everything, so assume the programmer
   // attached the controls from back to front, and return the frontmost match.
-  int i = mControls.GetSize() - 1;
-  IControl** ppControl = mControls.GetList() + i;
-  for (/* */; i >= 0; --i, --ppControl)
+  // Only the controls whose bounds overlap the point's index cell are candidates.
+  UpdateControlIndex();
+  int nCell;
+  const int* pCell = mControlIndex.GetCell(x, y, &nCell);
+  for (int k = nCell - 1; k >= 0; --k)
   {
-    IControl* pControl = *ppControl;
+    int i = pCell[k];
+    IControl* pControl = mControls.Get(i);
 
     if (mo)
     {
@@ -1352,6 +1849,7 @@ bool IGraphics::DrawIText(IText* pTxt, char* str, IRECT* pR, bool measure)
     return true;
   }
 
+  WDL_MutexLock lock(&s_textMutex);
   LICE_IFont* font = pTxt->mCached;
   
   if (!font)
@@ -1408,14 +1906,16 @@ bool IGraphics::DrawIText(IText* pTxt, char* str, IRECT* pR, bool measure)
 #ifdef IPLUG_RETINA_SUPPORT
   else if (IsRetina())
   {
-    RECT R = { pR->L * 2, pR->T * 2, pR->R * 2, pR->B * 2 };
-    font->DrawText(mDrawBitmap_2x, str, -1, &R, fmt);
+    IDrawTarget* pT = GetDrawTarget();
+    RECT R = { (pR->L - pT->mX) * 2, (pR->T - pT->mY) * 2, (pR->R - pT->mX) * 2, (pR->B - pT->mY) * 2 };
+    font->DrawText(pT->mBitmap_2x, str, -1, &R, fmt);
   }
 #endif
   else
   {
-  	RECT R = { pR->L, pR->T, pR->R, pR->B };
-    font->DrawText(mDrawBitmap, str, -1, &R, fmt);
+    IDrawTarget* pT = GetDrawTarget();
+  	RECT R = { pR->L - pT->mX, pR->T - pT->mY, pR->R - pT->mX, pR->B - pT->mY };
+    font->DrawText(pT->mBitmap, str, -1, &R, fmt);
   }
 
   return true;
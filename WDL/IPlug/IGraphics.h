@@ -4,6 +4,8 @@
 #include "IPlugStructs.h"
 #include "IPopupMenu.h"
 #include "IControl.h"
+#include "IControlIndex.h"
+#include "IDrawThreadPool.h"
 #include "../lice/lice.h"
 #include "../Cairo/include/cairo.h"
 
@@ -39,9 +41,24 @@
 
 #define MAX_PARAM_LEN 32
 
+#ifdef _MSC_VER
+  #define IPLUG_THREAD_LOCAL __declspec(thread)
+#else
+  #define IPLUG_THREAD_LOCAL __thread
+#endif
+
 class IPlugBase;
 class IControl;
 class IParam;
+class CachedBitmap;
+
+struct IBitmapCacheStats
+{
+  int mHits, mMisses;         // LoadIBitmap()/ScaleBitmap() calls that found the pixels decoded, or not.
+  int mDecodes, mEvictions;   // Pixels decoded (or scaled) and dropped again.
+  int mBitmaps, mDecoded;     // Cached bitmaps, and how many of them have their pixels in memory.
+  size_t mBytes, mBudget;
+};
 
 class IGraphics
 {
@@ -49,7 +66,12 @@ public:
   void PrepDraw();    // Called once, when the IGraphics class is attached to the IPlug class.
 
   bool IsDirty(IRECT* pR);        // Ask the plugin what needs to be redrawn.
-  bool Draw(IRECT* pR);           // The system announces what needs to be redrawn.  Ordering and drawing logic.
+  // The system announces what needs to be redrawn.  Ordering and drawing logic.
+  // Without strict drawing the dirty controls are gathered into a few disjoint regions, each grown until it
+  // contains every control it touches, and each region is painted once, back to front, clipped to the region.
+  // The background (control 0) must therefore only draw with DrawBitmap() or FillIRect(), which clip.
+  // With tiled drawing on, large regions are split into tiles that are drawn in parallel, see SetTiledDrawing().
+  bool Draw(IRECT* pR);
   virtual bool DrawScreen(IRECT* pR) = 0;  // Tells the OS class to put the final bitmap on the screen.
 
 #ifdef IPLUG_RETINA_SUPPORT
@@ -114,7 +136,7 @@ public:
   virtual void SandboxSafeAppSupportPath(WDL_String* pPath) = 0;
 
   // Run the "open file" or "save file" dialog.  Default to host executable path.
-  virtual void PromptForFile(WDL_String* pFilename, EFileAction action = kFileOpen, WDL_String* pDir = 0, char* extensions = 0) = 0;  // extensions = "txt wav" for example.
+  virtual void PromptForFile(WDL_String* pFilename, EFileAction action = kFileOpen, WDL_String* pDir = 0, const char* extensions = 0) = 0;  // extensions = "txt wav" for example.
   virtual bool PromptForColor(IColor* pColor, char* prompt = 0) = 0;
 
   virtual bool OpenURL(const char* url, const char* msgWindowTitle = 0, const char* confirmMsg = 0, const char* errMsgOnFailure = 0) = 0;
@@ -126,6 +148,15 @@ public:
   // (a control may be asked to draw multiple parts of itself, if it intersects with something dirty.)
   void SetStrictDrawing(bool strict);
 
+  // Tiled: regions of at least kMinTiledArea pixels are cut into kTileSize tiles, each drawn on a pool thread
+  // into a view of the backbuffer, with every control that touches the tile drawn in attach order. A control
+  // that straddles tiles gets one Draw() call per tile, possibly at the same time, clipped to the tile.
+  // Regions that contain a control that is not IsDrawThreadSafe() are drawn on the calling thread as usual.
+  // All tiles are finished before DrawScreen(). nThreads = 0 for one less than the number of CPUs.
+  void SetTiledDrawing(bool enable, int nThreads = 0);
+  bool GetTiledDrawing() const { return mDrawPool != 0; }
+  enum { kTileSize = 128, kMinTiledArea = 256 * 256 };
+
   virtual void* OpenWindow(void* pParentWnd) = 0;
   virtual void* OpenWindow(void* pParentWnd, void* pParentControl, short leftOffset = 0, short topOffset = 0) { return 0; } // For Carbon / RTAS... mega ugh!
 
@@ -237,6 +268,12 @@ public:
 
   void RetainBitmap(IBitmap* pBitmap);
   void ReleaseBitmap(IBitmap* pBitmap);
+
+  // Loaded and scaled bitmaps are shared by every instance in the process. Their pixels are decoded when first
+  // needed, and at the end of each frame, while the decoded total is over budget, the pixels least recently drawn
+  // (but not drawn in that frame) are dropped, to be decoded again if drawn later. 0 for no limit.
+  static void SetBitmapCacheBudget(size_t bytes);
+  static void GetBitmapCacheStats(IBitmapCacheStats* pStats);
   LICE_pixel* GetBits();
 #ifdef IPLUG_RETINA_SUPPORT
   LICE_pixel* GetBits_2x();
@@ -249,6 +286,20 @@ public:
 
   WDL_Mutex mMutex;
 
+  // Where the drawing methods render to: the backbuffers, or one tile of them while drawing tiled.
+  struct IDrawTarget
+  {
+    LICE_IBitmap* mBitmap;
+#ifdef IPLUG_RETINA_SUPPORT
+    LICE_IBitmap* mBitmap_2x;
+#endif
+    int mX, mY;               // GUI position of the bitmaps' top left pixel.
+    IRECT* mClip;             // DrawBitmap() and FillIRect() clip to this.
+    LICE_MemBitmap* mTmpBitmap;
+  };
+  // The target of the calling thread, only differs from the backbuffers inside a tile's Draw() calls.
+  inline IDrawTarget* GetDrawTarget() { return sTileTarget ? sTileTarget : &mTarget; }
+
   struct IMutexLock
   {
     WDL_Mutex* mpMutex;
@@ -270,6 +321,7 @@ protected:
   inline bool TooltipsEnabled() const { return mEnableTooltips; }
   
   virtual LICE_IBitmap* OSLoadBitmap(int ID, const char* name) = 0;
+  friend class BitmapStorage;
   
   LICE_SysBitmap* mDrawBitmap;
 #ifdef IPLUG_RETINA_SUPPORT
@@ -284,9 +336,53 @@ protected:
 #endif
 
 private:
-  LICE_MemBitmap* mTmpBitmap;
+  struct ITile
+  {
+    IRECT mRECT;
+    IDrawTarget mTarget;
+    LICE_SubBitmap mBitmap;
+#ifdef IPLUG_RETINA_SUPPORT
+    LICE_SubBitmap mBitmap_2x;
+#endif
+    ITile() : mBitmap(0, 0, 0, 0, 0)
+#ifdef IPLUG_RETINA_SUPPORT
+      , mBitmap_2x(0, 0, 0, 0, 0)
+#endif
+    {
+      memset(&mTarget, 0, sizeof(mTarget));
+    }
+    ~ITile() { DELETE_NULL(mTarget.mTmpBitmap); }
+  };
+
+  IDrawTarget mTarget;
+  static IPLUG_THREAD_LOCAL IDrawTarget* sTileTarget;
+  static IPLUG_THREAD_LOCAL IGraphics* sTileGraphics; // Whose tile the calling thread is drawing.
+  IDrawThreadPool* mDrawPool;
+  WDL_PtrList<ITile> mTiles;
+  int mNTiles;
+
+  // Bitmaps tile jobs found not decoded, and the blank pixels they drew instead (see BitmapStorage::Fetch()).
+  WDL_PtrList<CachedBitmap> mDeferredBitmaps;
+  WDL_PtrList<LICE_IBitmap> mDeferredBlanks;
+  int mBitmapFrame; // When this instance's current frame started, in BitmapStorage ticks.
+
+  void DrawRegion(IRECT* pR);
+  void DrawTiles(IRECT* pR);
+  static void DrawTileJob(void* pGraphics, int tile);
+
   int mWidth, mHeight, mFPS, mIdleTicks;
   int GetMouseControlIdx(int x, int y, bool mo = false);
+
+  // Spatial index of the control bounds, rebuilt when controls are attached or move.
+  IControlIndex mControlIndex;
+  WDL_TypedBuf<IRECT> mControlBounds;
+  bool mControlIndexValid;
+  WDL_TypedBuf<IRECT> mDirtyRegions;
+  WDL_TypedBuf<int> mDirtyControls, mRegionControls;
+
+  static IRECT GetControlBounds(IControl* pControl);
+  void UpdateControlIndex();
+  void MergeDirtyRegions();
   int mMouseCapture, mMouseOver, mMouseX, mMouseY, mLastClickedParam;
   bool mHandleMouseOver, mStrict, mEnableTooltips, mShowControlBounds;
   IControl* mKeyCatcher;
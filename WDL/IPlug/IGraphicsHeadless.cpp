@@ -0,0 +1,42 @@
+#include "IGraphicsHeadless.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+int IGraphicsHeadless::ShowMessageBox(const char* pText, const char* pCaption, int type)
+{
+  DBGMSG("%s: %s\n", pCaption ? pCaption : "", pText ? pText : "");
+  return 0;
+}
+
+void IGraphicsHeadless::HostPath(WDL_String* pPath)
+{
+  char buf[4096];
+  pPath->Set(getcwd(buf, sizeof(buf)) ? buf : ".");
+}
+
+void IGraphicsHeadless::PluginPath(WDL_String* pPath)
+{
+  HostPath(pPath);
+}
+
+void IGraphicsHeadless::DesktopPath(WDL_String* pPath)
+{
+  const char* home = getenv("HOME");
+  pPath->Set(home ? home : ".");
+}
+
+void IGraphicsHeadless::AppSupportPath(WDL_String* pPath, bool isSystem)
+{
+  HostPath(pPath);
+}
+
+LICE_IBitmap* IGraphicsHeadless::OSLoadBitmap(int ID, const char* name)
+{
+  LICE_IBitmap* pBitmap = LICE_LoadPNG(name);
+  if (!pBitmap)
+  {
+    // Not next to the binary: stand in with something the size of nothing, controls only read its dimensions.
+    pBitmap = new LICE_MemBitmap(1, 1);
+  }
+  return pBitmap;
+}
@@ -0,0 +1,46 @@
+#ifndef _IGRAPHICSHEADLESS_
+#define _IGRAPHICSHEADLESS_
+
+#include "IGraphics.h"
+
+// What MakeGraphics() returns in headless builds: plugins can build their GUI as usual, but there is
+// never a window, so nothing is drawn. Bitmaps are loaded from their file names (relative to the working
+// directory) when possible, so controls get their real sizes.
+class IGraphicsHeadless : public IGraphics
+{
+public:
+  IGraphicsHeadless(IPlugBase* pPlug, int w, int h, int refreshFPS) : IGraphics(pPlug, w, h, refreshFPS) {}
+  virtual ~IGraphicsHeadless() {}
+
+  bool DrawScreen(IRECT* pR) { return true; }
+
+  void ForceEndUserEdit() {}
+  int ShowMessageBox(const char* pText, const char* pCaption, int type);
+
+  IPopupMenu* CreateIPopupMenu(IPopupMenu* pMenu, IRECT* pTextRect) { return 0; }
+  void CreateTextEntry(IControl* pControl, IText* pText, IRECT* pTextRect, const char* pString, IParam* pParam) {}
+
+  void HostPath(WDL_String* pPath);
+  void PluginPath(WDL_String* pPath);
+  void DesktopPath(WDL_String* pPath);
+  void AppSupportPath(WDL_String* pPath, bool isSystem = false);
+  void SandboxSafeAppSupportPath(WDL_String* pPath) { AppSupportPath(pPath, false); }
+
+  void PromptForFile(WDL_String* pFilename, EFileAction action = kFileOpen, WDL_String* pDir = 0, const char* extensions = 0) { pFilename->Set(""); }
+  bool PromptForColor(IColor* pColor, char* prompt = 0) { return false; }
+  bool OpenURL(const char* url, const char* msgWindowTitle = 0, const char* confirmMsg = 0, const char* errMsgOnFailure = 0) { return false; }
+
+  void* OpenWindow(void* pParentWnd) { return 0; }
+  void CloseWindow() {}
+  void* GetWindow() { return 0; }
+
+  bool GetTextFromClipboard(WDL_String* pStr) { pStr->Set(""); return false; }
+  void UpdateTooltips() {}
+
+  const char* GetGUIAPI() { return "Headless"; }
+
+protected:
+  LICE_IBitmap* OSLoadBitmap(int ID, const char* name);
+};
+
+#endif
@@ -100,7 +100,7 @@ public:
   void AppSupportPath(WDL_String* pPath, bool isSystem = false);
   void SandboxSafeAppSupportPath(WDL_String* pPath);
 
-  void PromptForFile(WDL_String* pFilename, EFileAction action = kFileOpen, WDL_String* pDir = 0, char* extensions = "");   // extensions = "txt wav" for example.
+  void PromptForFile(WDL_String* pFilename, EFileAction action = kFileOpen, WDL_String* pDir = 0, const char* extensions = "");   // extensions = "txt wav" for example.
   bool PromptForColor(IColor* pColor, char* prompt = "");
 
   IPopupMenu* CreateIPopupMenu(IPopupMenu* pMenu, IRECT* pTextRect);
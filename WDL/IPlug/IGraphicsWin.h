@@ -38,7 +38,7 @@ public:
   void AppSupportPath(WDL_String* pPath, bool isSystem = false);
   void SandboxSafeAppSupportPath(WDL_String* pPath) { AppSupportPath(pPath, false); }
 
-  void PromptForFile(WDL_String* pFilename, EFileAction action = kFileOpen, WDL_String* pDir = 0, char* extensions = "");   // extensions = "txt wav" for example.
+  void PromptForFile(WDL_String* pFilename, EFileAction action = kFileOpen, WDL_String* pDir = 0, const char* extensions = "");   // extensions = "txt wav" for example.
   bool PromptForColor(IColor* pColor, char* prompt = "");
 
   IPopupMenu* GetItemMenu(long idx, long &idxInMenu, long &offsetIdx, IPopupMenu* pMenu);
@@ -0,0 +1,209 @@
+#ifndef _IMETERBUFFER_
+#define _IMETERBUFFER_
+
+/*
+
+IMeterBuffer carries metering data from the audio thread to the GUI. The
+audio thread feeds it samples (one value per channel per sample), every
+GetDecimation() samples it reduces them to an IMeterFrame per channel (min,
+max, mean and RMS) and queues that, in O(1) and without allocating. The GUI
+drains the frames whenever it redraws, e.g. from IControl::IsDirty().
+
+Like IPlugQueue it is wait-free for exactly one producer and one consumer.
+If the GUI is not draining (editor closed) new frames are dropped until
+there is room again.
+
+Producers that already have one value per frame (a spectrum, a gain
+reduction figure per block) can PushValues() instead of Process().
+
+// audio thread
+mMeter.Process(outputs, nFrames);
+
+// GUI thread
+IMeterFrame frame[2];
+while (mMeter.Pop(frame)) ... frame[0].mMax ...
+
+*/
+
+#include "../heapbuf.h"
+#include "../wdlatomic.h"
+#include <math.h>
+#include <string.h>
+
+struct IMeterFrame
+{
+  float mMin, mMax, mMean, mRMS;
+};
+
+class IMeterBuffer
+{
+public:
+  IMeterBuffer(int nChans = 1, int decimation = 1024, int maxFrames = 64)
+    : mNChans(0), mDecimation(1), mCount(0), mFrameDecimation(1), mReadPos(0), mWritePos(0)
+  {
+    Resize(nChans, decimation, maxFrames);
+  }
+
+  ~IMeterBuffer() {}
+
+  // Not thread safe, only call this when neither side is using the buffer.
+  void Resize(int nChans, int decimation, int maxFrames)
+  {
+    mNChans = nChans > 0 ? nChans : 1;
+    mFrames.Resize((maxFrames + 1) * mNChans); // One frame is always kept free to tell full from empty.
+    mAcc.Resize(mNChans);
+    SetDecimation(decimation);
+    mReadPos = mWritePos = 0;
+    ResetAccumulators();
+  }
+
+  // Safe from either side, takes effect from the next frame.
+  void SetDecimation(int decimation) { wdl_atomic_set(&mDecimation, decimation > 0 ? decimation : 1); }
+  int GetDecimation() const { return wdl_atomic_get(&mDecimation); }
+  int NChans() const { return mNChans; }
+  int GetMaxFrames() const { return mFrames.GetSize() / mNChans - 1; }
+
+  // Producer side: one sample, values[c] for each channel.
+  void Process(const double* values)
+  {
+    Accumulate* pAcc = mAcc.Get();
+    for (int c = 0; c < mNChans; ++c) pAcc[c].Add(values[c]);
+    if (++mCount >= mFrameDecimation) FlushFrame();
+  }
+
+  // Producer side: nFrames samples of each of channels[0..NChans()-1].
+  void Process(double** channels, int nFrames)
+  {
+    Accumulate* pAcc = mAcc.Get();
+
+    for (int s = 0; s < nFrames; )
+    {
+      int n = mFrameDecimation - mCount;
+      if (n > nFrames - s) n = nFrames - s;
+
+      for (int c = 0; c < mNChans; ++c)
+      {
+        const double* pIn = channels[c] + s;
+        Accumulate* a = pAcc + c;
+        for (int i = 0; i < n; ++i) a->Add(pIn[i]);
+      }
+
+      s += n;
+      mCount += n;
+      if (mCount >= mFrameDecimation) FlushFrame();
+    }
+  }
+
+  // Producer side: queues values[c] as a finished frame (min = max = mean = RMS), bypassing the decimation.
+  // Returns false if the frame was dropped.
+  bool PushValues(const double* values)
+  {
+    IMeterFrame* pFrame = GetWriteFrame();
+    if (!pFrame) return false;
+    for (int c = 0; c < mNChans; ++c)
+    {
+      float v = (float) values[c];
+      pFrame[c].mMin = pFrame[c].mMax = pFrame[c].mMean = v;
+      pFrame[c].mRMS = (float) fabs(values[c]);
+    }
+    Publish();
+    return true;
+  }
+
+  // Consumer side: copies the oldest frame (NChans() IMeterFrames) to pFrame. Returns false if there is none.
+  bool Pop(IMeterFrame* pFrame)
+  {
+    int readPos = mReadPos;
+    if (readPos == wdl_atomic_get(&mWritePos)) return false;
+
+    memcpy(pFrame, mFrames.Get() + readPos * mNChans, mNChans * sizeof(IMeterFrame));
+    if (++readPos >= mFrames.GetSize() / mNChans) readPos = 0;
+    wdl_atomic_set(&mReadPos, readPos);
+    return true;
+  }
+
+  // Consumer side: drops everything but the newest frame, for displays that only show the current state.
+  bool PopLatest(IMeterFrame* pFrame)
+  {
+    bool got = false;
+    while (Pop(pFrame)) got = true;
+    return got;
+  }
+
+  // Safe from either side, but only a snapshot.
+  int ToDo() const
+  {
+    int n = wdl_atomic_get(&mWritePos) - wdl_atomic_get(&mReadPos);
+    return n < 0 ? n + mFrames.GetSize() / mNChans : n;
+  }
+
+private:
+  struct Accumulate
+  {
+    double mMin, mMax, mSum, mSumSq;
+
+    inline void Add(double v)
+    {
+      if (v < mMin) mMin = v;
+      if (v > mMax) mMax = v;
+      mSum += v;
+      mSumSq += v * v;
+    }
+  };
+
+  void ResetAccumulators()
+  {
+    Accumulate* pAcc = mAcc.Get();
+    for (int c = 0; c < mNChans; ++c)
+    {
+      pAcc[c].mMin = 1e300;
+      pAcc[c].mMax = -1e300;
+      pAcc[c].mSum = pAcc[c].mSumSq = 0.;
+    }
+    mCount = 0;
+    mFrameDecimation = wdl_atomic_get(&mDecimation);
+  }
+
+  // Producer side: the slot after the last published frame, or 0 if the consumer hasn't caught up.
+  IMeterFrame* GetWriteFrame()
+  {
+    int next = mWritePos + 1;
+    if (next >= mFrames.GetSize() / mNChans) next = 0;
+    if (next == wdl_atomic_get(&mReadPos)) return 0;
+    return mFrames.Get() + mWritePos * mNChans;
+  }
+
+  void Publish()
+  {
+    int next = mWritePos + 1;
+    if (next >= mFrames.GetSize() / mNChans) next = 0;
+    wdl_atomic_set(&mWritePos, next);
+  }
+
+  void FlushFrame()
+  {
+    IMeterFrame* pFrame = GetWriteFrame();
+    if (pFrame && mCount)
+    {
+      Accumulate* pAcc = mAcc.Get();
+      double scale = 1. / (double) mCount;
+      for (int c = 0; c < mNChans; ++c)
+      {
+        pFrame[c].mMin = (float) pAcc[c].mMin;
+        pFrame[c].mMax = (float) pAcc[c].mMax;
+        pFrame[c].mMean = (float) (pAcc[c].mSum * scale);
+        pFrame[c].mRMS = (float) sqrt(pAcc[c].mSumSq * scale);
+      }
+      Publish();
+    }
+    ResetAccumulators();
+  }
+
+  WDL_TypedBuf<IMeterFrame> mFrames;
+  WDL_TypedBuf<Accumulate> mAcc;
+  int mNChans, mDecimation, mCount;
+  int mFrameDecimation; // Producer side: mDecimation as of the start of the current frame.
+  int mReadPos, mWritePos;
+} WDL_FIXALIGN;
+
+#endif // _IMETERBUFFER_
@@ -86,24 +86,24 @@ void IParam::SetDisplayText(int value, const char* text)
 
 double IParam::DBToAmp()
 {
-  return ::DBToAmp(mValue);
+  return ::DBToAmp(Value());
 }
 
 void IParam::SetNormalized(double normalizedValue)
 {
-  mValue = FromNormalizedParam(normalizedValue, mMin, mMax, mShape);
+  double value = FromNormalizedParam(normalizedValue, mMin, mMax, mShape);
   
   if (mType != kTypeDouble)
   {
-    mValue = floor(0.5 + mValue / mStep) * mStep;
+    value = floor(0.5 + value / mStep) * mStep;
   }
   
-  mValue = IPMIN(mValue, mMax);
+  wdl_atomic_set_double(&mValue, IPMIN(value, mMax));
 }
 
 double IParam::GetNormalized()
 {
-  return GetNormalized(mValue);
+  return GetNormalized(Value());
 }
 
 double IParam::GetNormalized(double nonNormalizedValue)
@@ -154,7 +154,7 @@ const char* IParam::GetNameForHost()
 
 const char* IParam::GetLabelForHost()
 {
-  const char* displayText = GetDisplayText((int) mValue);
+  const char* displayText = GetDisplayText((int) Value());
   return (CSTR_NOT_EMPTY(displayText)) ? "" : mLabel;
 }
 
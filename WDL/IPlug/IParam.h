@@ -2,6 +2,7 @@
 #define _IPARAM_
 
 #include "Containers.h"
+#include "../wdlatomic.h"
 #include <math.h>
 
 #define MAX_PARAM_NAME_LEN 32 // e.g. "Gain"
@@ -34,13 +35,13 @@ public:
   void InitInt(const char* name, int defaultVal, int minVal, int maxVal, const char* label = "", const char* group = "");
   void InitDouble(const char* name, double defaultVal, double minVal, double maxVal, double step, const char* label = "", const char* group = "", double shape = 1.);
 
-  void Set(double value) { mValue = BOUNDED(value, mMin, mMax); }
+  void Set(double value) { wdl_atomic_set_double(&mValue, BOUNDED(value, mMin, mMax)); }
   void SetDisplayText(int value, const char* text);
   void SetCanAutomate(bool canAutomate) { mCanAutomate = canAutomate; }
   // The higher the shape, the more resolution around host value zero.
   void SetShape(double shape);
   void SetIsMeta(bool meta) { mIsMeta = meta; }
-  void SetToDefault() { mValue = mDefault; }
+  void SetToDefault() { wdl_atomic_set_double(&mValue, mDefault); }
 
   // Call this if your param is (x, y) but you want to always display (-x, -y).
   void NegateDisplay() { mNegateDisplay = true; }
@@ -51,16 +52,16 @@ public:
 
   // Accessors / converters.
   // These all return the readable value, not the VST (0,1).
-  double Value() const { return mValue; }
-  bool Bool() const { return (mValue >= 0.5); }
-  int Int() const { return int(mValue); }
+  double Value() const { return wdl_atomic_get_double(&mValue); }
+  bool Bool() const { return (Value() >= 0.5); }
+  int Int() const { return int(Value()); }
   double DBToAmp();
 
   void SetNormalized(double normalizedValue);
   double GetNormalized();
   double GetNormalized(double nonNormalizedValue);
-  void GetDisplayForHost(char* rDisplay) { GetDisplayForHost(mValue, false, rDisplay); }
-  void GetDisplayForHostNoDisplayText(char* rDisplay) { GetDisplayForHost(mValue, false, rDisplay, false); }
+  void GetDisplayForHost(char* rDisplay) { GetDisplayForHost(Value(), false, rDisplay); }
+  void GetDisplayForHostNoDisplayText(char* rDisplay) { GetDisplayForHost(Value(), false, rDisplay, false); }
   void GetDisplayForHost(double value, bool normalized, char* rDisplay, bool withDisplayText = true);
   const char* GetNameForHost();
   const char* GetLabelForHost();
@@ -86,6 +87,8 @@ private:
   // All we store is the readable values.
   // SetFromHost() and GetForHost() handle conversion from/to (0,1).
   EParamType mType;
+  // mValue is set from the GUI, host and state restore threads while the audio thread reads it,
+  // so outside of Init*() it's only accessed through wdl_atomic_get_double()/wdl_atomic_set_double().
   double mValue, mMin, mMax, mStep, mShape, mDefault;
   int mDisplayPrecision;
   char mName[MAX_PARAM_NAME_LEN];
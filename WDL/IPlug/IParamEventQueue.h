@@ -0,0 +1,104 @@
+#ifndef _IPARAMEVENTQUEUE_
+#define _IPARAMEVENTQUEUE_
+
+/*
+
+IParamEventQueue holds sample accurate parameter changes for the current
+block, sorted by sample offset. The API classes fill it from the host's
+timestamped automation (VST3 IParamValueQueue points, AU scheduled
+parameters), it is only ever touched from the audio thread.
+
+Plugins opt in with SetSampleAccurateParams(true). By default IPlugBase then
+splits each block at the event offsets, applies the events in between and
+calls ProcessDoubleReplacing() once per sub-block, so existing plugins get
+sample accurate automation without any changes. A plugin that would rather
+read the events itself can override ProcessParamEvents(), e.g.
+
+void MyPlug::ProcessParamEvents(IParamEventQueue* pEvents, double** inputs, double** outputs, int nFrames)
+{
+  for (int offset = 0; offset < nFrames; ++offset)
+  {
+    while (!pEvents->Empty())
+    {
+      IParamEvent* pEvent = pEvents->Peek();
+      if (pEvent->mOffset > offset) break;
+
+      // To-do: Handle the parameter change
+
+      pEvents->Remove();
+    }
+
+    // To-do: Process audio
+
+  }
+}
+
+*/
+
+struct IParamEvent
+{
+  int mOffset, mIdx;
+  double mNormalizedValue;
+
+  IParamEvent(int offset = 0, int idx = 0, double normalizedValue = 0.) : mOffset(offset), mIdx(idx), mNormalizedValue(normalizedValue) {}
+};
+
+class IParamEventQueue
+{
+public:
+  IParamEventQueue(int size = DEFAULT_BLOCK_SIZE) : mFront(0) { mBuf.Resize(size); mBuf.Resize(0, false); }
+  ~IParamEventQueue() {}
+
+  // Adds an event, keeping the queue sorted by offset. Events with the same
+  // offset stay in the order they were added. Only grows (allocates) if
+  // more events arrive than the queue was sized for in Resize().
+  void Add(const IParamEvent& event)
+  {
+    int back = mBuf.GetSize();
+    if (!mBuf.ResizeOK(back + 1, false)) return;
+
+    IParamEvent* pBuf = mBuf.Get();
+    int i = back;
+    while (i > mFront && event.mOffset < pBuf[i - 1].mOffset) --i;
+    if (i < back) memmove(&pBuf[i + 1], &pBuf[i], (back - i) * sizeof(IParamEvent));
+    pBuf[i] = event;
+  }
+
+  // Removes the event at the front of the queue.
+  inline void Remove() { ++mFront; }
+
+  inline bool Empty() const { return mFront >= mBuf.GetSize(); }
+  inline int ToDo() const { return mBuf.GetSize() - mFront; }
+
+  // Returns the front event, but does *not* remove it from the queue.
+  inline IParamEvent* Peek() { return mBuf.Get() + mFront; }
+
+  // Drops the events that have been handled and updates the offsets of the
+  // remaining ones by substracting nFrames.
+  void Flush(int nFrames)
+  {
+    int n = ToDo();
+    IParamEvent* pBuf = mBuf.Get();
+    if (mFront > 0 && n > 0) memmove(pBuf, pBuf + mFront, n * sizeof(IParamEvent));
+    mBuf.Resize(n, false);
+    mFront = 0;
+
+    for (int i = 0; i < n; ++i) pBuf[i].mOffset -= nFrames;
+  }
+
+  inline void Clear() { mBuf.Resize(0, false); mFront = 0; }
+
+  // Preallocates room for size events, call from Reset() or SetBlockSize().
+  void Resize(int size)
+  {
+    int n = mBuf.GetSize();
+    if (size > n) mBuf.Resize(size);
+    mBuf.Resize(n, false);
+  }
+
+private:
+  WDL_TypedBuf<IParamEvent> mBuf;
+  int mFront;
+} WDL_FIXALIGN;
+
+#endif // _IPARAMEVENTQUEUE_
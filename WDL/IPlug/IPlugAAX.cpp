@@ -267,7 +267,7 @@ AAX_Result IPlugAAX::UpdateParameterNormalizedValue(AAX_CParamID iParameterID, d
       GetGUI()->SetParameterFromPlug(paramIdx, iValue, true);
     }
     
-    OnParamChange(paramIdx);      
+    HandleParamChange(paramIdx);
   }
   
   // Now the control has changed
@@ -523,9 +523,18 @@ void IPlugAAX::ResizeGraphics(int w, int h)
   }
 }
 
+AAX_Result IPlugAAX::TimerWakeup()
+{
+  ReportLatencyChange();
+  return AAX_CIPlugParameters::TimerWakeup();
+}
+
 void IPlugAAX::SetLatency(int latency)
 {
-  Controller()->SetSignalLatency(latency);
+  if (Controller()) // not connected yet when called from the plugin constructor
+  {
+    Controller()->SetSignalLatency(latency);
+  }
   
   IPlugBase::SetLatency(latency); // will update delay time
 }
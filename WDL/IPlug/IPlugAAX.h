@@ -71,6 +71,7 @@ public:
   AAX_Result GetChunk(AAX_CTypeID chunkID, AAX_SPlugInChunk * oChunk ) const ;   
   AAX_Result SetChunk(AAX_CTypeID chunkID, const AAX_SPlugInChunk * iChunk );
   AAX_Result CompareActiveChunk(const AAX_SPlugInChunk * iChunk, AAX_CBoolean * oIsEqual )  const ;
+  AAX_Result TimerWakeup(); // main thread tick for ReportLatencyChange()
   
   // IPlugBase Overrides
   void BeginInformHostOfParamChange(int idx);
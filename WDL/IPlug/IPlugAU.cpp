@@ -102,12 +102,19 @@ ComponentResult IPlugAU::IPlugAUEntry(ComponentParameters *params, void* pPlug)
       _this->mActive = true;
       _this->OnParamReset();
       _this->OnActivate(true);
+      if (!_this->mLatencyTimer)
+      {
+        CFRunLoopTimerContext context = { 0, _this, 0, 0, 0 };
+        _this->mLatencyTimer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent(), 0.05, 0, 0, LatencyTimerProc, &context);
+        CFRunLoopAddTimer(CFRunLoopGetMain(), _this->mLatencyTimer, kCFRunLoopCommonModes);
+      }
       return noErr;
     }
     case kAudioUnitUninitializeSelect:
     {
       _this->mActive = false;
       _this->OnActivate(false);
+      _this->StopLatencyTimer();
       return noErr;
     }
     case kAudioUnitGetPropertyInfoSelect:
@@ -258,7 +265,25 @@ ComponentResult IPlugAU::IPlugAUEntry(ComponentParameters *params, void* pPlug)
       UInt32 nEvents = GET_COMP_PARAM(UInt32, 0, 2);
       for (int i = 0; i < nEvents; ++i, ++pEvent)
       {
-        if (pEvent->eventType == kParameterEvent_Immediate)
+        // Called on the render thread just before rendering, so the offsets are relative to the coming block.
+        if (_this->GetSampleAccurateParams() && pEvent->scope == kAudioUnitScope_Global && pEvent->parameter < _this->NParams())
+        {
+          IParam* pParam = _this->GetParam(pEvent->parameter);
+
+          if (pEvent->eventType == kParameterEvent_Immediate)
+          {
+            _this->AddParamEvent(pEvent->eventValues.immediate.bufferOffset, pEvent->parameter,
+                                 pParam->GetNormalized(pEvent->eventValues.immediate.value));
+          }
+          else // kParameterEvent_Ramped, approximated by its start and end points.
+          {
+            int startOffset = pEvent->eventValues.ramp.startBufferOffset;
+            _this->AddParamEvent(startOffset, pEvent->parameter, pParam->GetNormalized(pEvent->eventValues.ramp.startValue));
+            _this->AddParamEvent(startOffset + pEvent->eventValues.ramp.durationInFrames, pEvent->parameter,
+                                 pParam->GetNormalized(pEvent->eventValues.ramp.endValue));
+          }
+        }
+        else if (pEvent->eventType == kParameterEvent_Immediate)
         {
           ComponentResult r = SetParamProc(pPlug, pEvent->parameter, pEvent->scope, pEvent->element,
                                            pEvent->eventValues.immediate.value, pEvent->eventValues.immediate.bufferOffset);
@@ -1599,7 +1624,7 @@ ComponentResult IPlugAU::SetParamProc(void* pPlug, AudioUnitParameterID paramID,
   {
     _this->GetGUI()->SetParameterFromPlug(paramID, value, false);
   }
-  _this->OnParamChange(paramID);
+  _this->HandleParamChange(paramID);
   return noErr;
 }
 
@@ -1857,6 +1882,7 @@ IPlugAU::IPlugAU(IPlugInstanceInfo instanceInfo,
   , mRenderTimestamp(-1.0)
   , mTempo(DEFAULT_TEMPO)
   , mActive(false)
+  , mLatencyTimer(0)
 {
   Trace(TRACELOC, "%s", effectName);
 
@@ -1945,6 +1971,7 @@ IPlugAU::IPlugAU(IPlugInstanceInfo instanceInfo,
 
 IPlugAU::~IPlugAU()
 {
+  StopLatencyTimer();
   mRenderNotify.Empty(true);
   mInBuses.Empty(true);
   mOutBuses.Empty(true);
@@ -2147,9 +2174,27 @@ void IPlugAU::InformListeners(AudioUnitPropertyID propID, AudioUnitScope scope)
   }
 }
 
+void IPlugAU::LatencyTimerProc(CFRunLoopTimerRef timer, void* pPlug)
+{
+  ((IPlugAU*) pPlug)->ReportLatencyChange();
+}
+
+void IPlugAU::StopLatencyTimer()
+{
+  if (mLatencyTimer)
+  {
+    CFRunLoopTimerInvalidate(mLatencyTimer);
+    CFRelease(mLatencyTimer);
+    mLatencyTimer = 0;
+  }
+}
+
 void IPlugAU::SetLatency(int samples)
 {
   TRACE;
+  // before telling the listeners, they ask GetLatency() for the new value
+  IPlugBase::SetLatency(samples);
+
   int i, n = mPropertyListeners.GetSize();
   
   for (i = 0; i < n; ++i)
@@ -2160,8 +2205,6 @@ void IPlugAU::SetLatency(int samples)
       pListener->mListenerProc(pListener->mProcArgs, mCI, kAudioUnitProperty_Latency, kAudioUnitScope_Global, 0);
     }
   }
-  
-  IPlugBase::SetLatency(samples);
 }
 
 // TODO: SendMidiMsg
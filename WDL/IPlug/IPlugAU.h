@@ -87,6 +87,9 @@ private:
   char mParamValueString[MAX_PARAM_DISPLAY_LEN];
   ComponentInstance mCI;
   bool mActive, mIsOffline;
+  CFRunLoopTimerRef mLatencyTimer; // main thread tick for ReportLatencyChange() while initialized
+  static void LatencyTimerProc(CFRunLoopTimerRef timer, void* pPlug);
+  void StopLatencyTimer();
   double mRenderTimestamp, mTempo;
   HostCallbackInfo mHostCallbacks;
 
@@ -85,6 +85,18 @@ IPlugBase::IPlugBase(int nParams,
   , mIsBypassed(false)
   , mDelay(0)
   , mTailSize(0)
+  , mMutexCompatibility(false)
+  , mParamChangesFromGUI(DEFAULT_PARAM_QUEUE_SIZE)
+  , mParamChangesFromHost(DEFAULT_PARAM_QUEUE_SIZE)
+  , mParamGeneration(0)
+  , mAppliedParamGeneration(0)
+  , mParamResyncPending(0)
+  , mHostQueueBusy(0)
+  , mLatencyChangePending(0)
+  , mReportedOversamplingLatency(0)
+  , mPendingDelayTime(-1)
+  , mSampleAccurateParams(false)
+  , mNativeFloatProcessing(false)
 {
   Trace(TRACELOC, "%s:%s", effectName, CurrentTime());
 
@@ -98,6 +110,11 @@ IPlugBase::IPlugBase(int nParams,
     mPresets.Add(new IPreset(i));
   }
 
+  for (int i = 0; i < 3; ++i)
+  {
+    mParamSnapshot.GetSlot(i)->mValues.Resize(nParams);
+  }
+
   strcpy(mEffectName, effectName);
   strcpy(mProductName, productName);
   strcpy(mMfrName, mfrName);
@@ -126,6 +143,13 @@ IPlugBase::IPlugBase(int nParams,
 
   mInData.Resize(nInputs);
   mOutData.Resize(nOutputs);
+  mSmoothedParams.Resize(nParams);
+  mInSubBlock.Resize(nInputs);
+  mOutSubBlock.Resize(nOutputs);
+  mInFData.Resize(nInputs);
+  mOutFData.Resize(nOutputs);
+  mInFSubBlock.Resize(nInputs);
+  mOutFSubBlock.Resize(nOutputs);
   
   double** ppInData = mInData.Get();
 
@@ -229,7 +253,7 @@ void IPlugBase::AttachGraphics(IGraphics* pGraphics)
 {
   if (pGraphics)
   {
-    WDL_MutexLock lock(&mMutex);
+    IMutexLock lock(this);
     int i, n = mParams.GetSize();
     
     for (i = 0; i < n; ++i)
@@ -276,6 +300,7 @@ const char* IPlugBase::GetAPIString()
     case kAPIRTAS: return "RTAS";
     case kAPIAAX: return "AAX";
     case kAPISA: return "Standalone";
+    case kAPIHeadless: return "Headless";
     default: return "";
   }
 }
@@ -304,6 +329,7 @@ double IPlugBase::GetSamplesPerBeat()
 void IPlugBase::SetSampleRate(double sampleRate)
 {
   mSampleRate = sampleRate;
+  mSmoothedParams.SetSampleRate(sampleRate);
 }
 
 void IPlugBase::SetBlockSize(int blockSize)
@@ -317,6 +343,12 @@ void IPlugBase::SetBlockSize(int blockSize)
       InChannel* pInChannel = mInChannels.Get(i);
       pInChannel->mScratchBuf.Resize(blockSize);
       memset(pInChannel->mScratchBuf.Get(), 0, blockSize * sizeof(double));
+      pInChannel->mFScratchBuf.Resize(blockSize);
+      memset(pInChannel->mFScratchBuf.Get(), 0, blockSize * sizeof(float));
+      if (!pInChannel->mConnected)
+      {
+        mInFData.Get()[i] = pInChannel->mFScratchBuf.Get();
+      }
     }
     
     for (i = 0; i < nOut; ++i)
@@ -324,10 +356,23 @@ void IPlugBase::SetBlockSize(int blockSize)
       OutChannel* pOutChannel = mOutChannels.Get(i);
       pOutChannel->mScratchBuf.Resize(blockSize);
       memset(pOutChannel->mScratchBuf.Get(), 0, blockSize * sizeof(double));
+      pOutChannel->mFScratchBuf.Resize(blockSize);
+      if (!pOutChannel->mConnected)
+      {
+        mOutFData.Get()[i] = pOutChannel->mFScratchBuf.Get();
+      }
     }
     
+    mParamEvents.Resize(blockSize);
+    mSmoothedParams.SetBlockSize(blockSize * mOversampler.GetMaxFactor());
+    if (mOversampler.GetMaxFactor() > 1)
+    {
+      mOversampler.Resize(nIn, nOut, blockSize, mOversampler.GetMaxFactor());
+    }
     mBlockSize = blockSize;
   }
+
+  ReportLatencyChange();
 }
 
 void IPlugBase::SetInputChannelConnections(int idx, int n, bool connected)
@@ -342,6 +387,7 @@ void IPlugBase::SetInputChannelConnections(int idx, int n, bool connected)
     if (!connected)
     {
       *(pInChannel->mSrc) = pInChannel->mScratchBuf.Get();
+      mInFData.Get()[i] = pInChannel->mFScratchBuf.Get();
     }
   }
 }
@@ -358,6 +404,7 @@ void IPlugBase::SetOutputChannelConnections(int idx, int n, bool connected)
     if (!connected)
     {
       *(pOutChannel->mDest) = pOutChannel->mScratchBuf.Get();
+      mOutFData.Get()[i] = pOutChannel->mFScratchBuf.Get();
     }
   }
 }
@@ -390,12 +437,34 @@ void IPlugBase::AttachInputBuffers(int idx, int n, float** ppData, int nFrames)
 {
   int iEnd = IPMIN(idx + n, mInChannels.GetSize());
   for (int i = idx; i < iEnd; ++i)
+  {
+    InChannel* pInChannel = mInChannels.Get(i);
+    if (pInChannel->mConnected)
+    {
+      mInFData.Get()[i] = *(ppData++);
+
+      // With native float processing this is left until something needs doubles, see CastInputsToDouble().
+      if (!mNativeFloatProcessing)
+      {
+        double* pScratch = pInChannel->mScratchBuf.Get();
+        CastCopy(pScratch, mInFData.Get()[i], nFrames);
+        *(pInChannel->mSrc) = pScratch;
+      }
+    }
+  }
+}
+
+void IPlugBase::CastInputsToDouble(int nFrames)
+{
+  int i, n = NInChannels();
+
+  for (i = 0; i < n; ++i)
   {
     InChannel* pInChannel = mInChannels.Get(i);
     if (pInChannel->mConnected)
     {
       double* pScratch = pInChannel->mScratchBuf.Get();
-      CastCopy(pScratch, *(ppData++), nFrames);
+      CastCopy(pScratch, mInFData.Get()[i], nFrames);
       *(pInChannel->mSrc) = pScratch;
     }
   }
@@ -424,13 +493,27 @@ void IPlugBase::AttachOutputBuffers(int idx, int n, float** ppData)
     {
       *(pOutChannel->mDest) = pOutChannel->mScratchBuf.Get();
       pOutChannel->mFDest = *(ppData++);
+      mOutFData.Get()[i] = pOutChannel->mFDest;
     }
   }
 }
 
 void IPlugBase::PassThroughBuffers(double sampleType, int nFrames)
 {
-  if (mLatency && mDelay) 
+  ApplyParamChanges();
+  ApplyParamEvents(nFrames);
+
+  if (mDelay && wdl_atomic_get(&mPendingDelayTime) >= 0)
+  {
+    int delayTime = wdl_atomic_exchange(&mPendingDelayTime, -1);
+    if (delayTime >= 0)
+    {
+      mDelay->SetDelayTime(delayTime);
+    }
+  }
+
+  // mLatency may already be ahead of the delay line, which catches up at the start of a block
+  if (mDelay && mDelay->GetDelayTime()) 
   {
     mDelay->ProcessBlock(mInData.Get(), mOutData.Get(), nFrames);
   }
@@ -443,6 +526,10 @@ void IPlugBase::PassThroughBuffers(double sampleType, int nFrames)
 void IPlugBase::PassThroughBuffers(float sampleType, int nFrames)
 {
   // for 32 bit buffers, first run the delay (if mLatency) on the 64bit IPlug buffers
+  if (mNativeFloatProcessing)
+  {
+    CastInputsToDouble(nFrames);
+  }
   PassThroughBuffers(0., nFrames);
   
   int i, n = NOutChannels();
@@ -458,14 +545,195 @@ void IPlugBase::PassThroughBuffers(float sampleType, int nFrames)
   }
 }
 
+void IPlugBase::ProcessDoubleReplacingWithParamEvents(int nFrames)
+{
+  if (mParamEvents.Empty())
+  {
+    SmoothParams(nFrames);
+    ProcessOversampled(mInData.Get(), mOutData.Get(), nFrames);
+  }
+  else
+  {
+    ProcessParamEvents(&mParamEvents, mInData.Get(), mOutData.Get(), nFrames);
+    ApplyParamEvents(nFrames);
+  }
+}
+
+void IPlugBase::ApplyParamEvent(IParamEvent* pEvent)
+{
+  if (pEvent->mIdx >= 0 && pEvent->mIdx < mParams.GetSize())
+  {
+    GetParam(pEvent->mIdx)->SetNormalized(pEvent->mNormalizedValue);
+    #ifndef OS_IOS
+    if (mGraphics)
+    {
+      mGraphics->SetParameterFromPlug(pEvent->mIdx, pEvent->mNormalizedValue, true);
+    }
+    #endif
+    OnParamChange(pEvent->mIdx);
+  }
+}
+
+// Applies everything due in this block and moves the rest on to the next one.
+void IPlugBase::ApplyParamEvents(int nFrames)
+{
+  while (!mParamEvents.Empty() && mParamEvents.Peek()->mOffset < nFrames)
+  {
+    ApplyParamEvent(mParamEvents.Peek());
+    mParamEvents.Remove();
+  }
+  mParamEvents.Flush(nFrames);
+}
+
+void IPlugBase::ProcessSingleReplacingWithParamEvents(int nFrames)
+{
+  if (mParamEvents.Empty())
+  {
+    SmoothParams(nFrames);
+    ProcessSingleReplacing(mInFData.Get(), mOutFData.Get(), nFrames);
+  }
+  else
+  {
+    SplitAtParamEvents(&mParamEvents, mInFData.Get(), mOutFData.Get(), nFrames, mInFSubBlock.Get(), mOutFSubBlock.Get());
+    ApplyParamEvents(nFrames);
+  }
+}
+
+void IPlugBase::ProcessParamEvents(IParamEventQueue* pEvents, double** inputs, double** outputs, int nFrames)
+{
+  SplitAtParamEvents(pEvents, inputs, outputs, nFrames, mInSubBlock.Get(), mOutSubBlock.Get());
+}
+
+template <class SAMPLETYPE>
+void IPlugBase::SplitAtParamEvents(IParamEventQueue* pEvents, SAMPLETYPE** inputs, SAMPLETYPE** outputs, int nFrames, SAMPLETYPE** ppIn, SAMPLETYPE** ppOut)
+{
+  int i, nIn = mInChannels.GetSize(), nOut = mOutChannels.GetSize();
+  int offset = 0;
+
+  while (offset < nFrames)
+  {
+    while (!pEvents->Empty() && pEvents->Peek()->mOffset <= offset)
+    {
+      ApplyParamEvent(pEvents->Peek());
+      pEvents->Remove();
+    }
+
+    int end = (pEvents->Empty() ? nFrames : IPMIN(pEvents->Peek()->mOffset, nFrames));
+
+    for (i = 0; i < nIn; ++i)
+    {
+      ppIn[i] = inputs[i] + offset;
+    }
+    for (i = 0; i < nOut; ++i)
+    {
+      ppOut[i] = outputs[i] + offset;
+    }
+
+    SmoothParams(end - offset);
+    ProcessReplacing(ppIn, ppOut, end - offset);
+    offset = end;
+  }
+}
+
+void IPlugBase::SetParamSmoothing(int idx, double timeMs, SmoothedParamBank::ERampMode mode)
+{
+  IParam* pParam = GetParam(idx);
+  // Settle within a millionth of the range, well below anything audible or displayable.
+  mSmoothedParams.SetSmoothing(idx, timeMs, mode, 1e-6 * IPMAX(pParam->GetRange(), 1e-3));
+  mSmoothedParams.SetValue(idx, pParam->Value());
+}
+
+void IPlugBase::SmoothParams(int nFrames)
+{
+  int i, n = mSmoothedParams.NEnabled();
+
+  if (n)
+  {
+    for (i = 0; i < n; ++i)
+    {
+      int idx = mSmoothedParams.GetEnabledIdx(i);
+      mSmoothedParams.SetTarget(idx, mParams.Get(idx)->Value());
+    }
+    mSmoothedParams.ProcessBlock(nFrames);
+
+    if (mOversampler.GetFactor() > 1)
+    {
+      mSmoothedParams.Upsample(nFrames, mOversampler.GetFactor());
+    }
+  }
+}
+
+void IPlugBase::ProcessOversampled(double** inputs, double** outputs, int nFrames)
+{
+  int factor = mOversampler.GetFactor();
+
+  if (factor > 1)
+  {
+    double** ppOsIn = mOversampler.Upsample(inputs, nFrames);
+    ProcessDoubleReplacing(ppOsIn, mOversampler.GetOutputs(), nFrames * factor);
+    mOversampler.Downsample(outputs, nFrames);
+  }
+  else
+  {
+    ProcessDoubleReplacing(inputs, outputs, nFrames);
+  }
+}
+
+void IPlugBase::EnableOversampling(int maxFactor)
+{
+  mOversampler.Resize(NInChannels(), NOutChannels(), mBlockSize, maxFactor);
+  mSmoothedParams.SetBlockSize(mBlockSize * mOversampler.GetMaxFactor());
+
+  if (mDelay)
+  {
+    mDelay->Reserve(mLatency + mOversampler.GetLatency(mOversampler.GetMaxFactor()));
+  }
+}
+
+void IPlugBase::SetOversampling(int factor)
+{
+  int oldLatency = mOversampler.GetLatency();
+  mOversampler.SetFactor(factor);
+
+  if (mOversampler.GetLatency() != oldLatency)
+  {
+    // Telling the host isn't safe from the audio thread, ReportLatencyChange() does it later.
+    wdl_atomic_set(&mLatencyChangePending, 1);
+  }
+}
+
+void IPlugBase::ReportLatencyChange()
+{
+  if (wdl_atomic_get(&mLatencyChangePending) && wdl_atomic_exchange(&mLatencyChangePending, 0))
+  {
+    int osLatency = mOversampler.GetLatency();
+    SetLatency(mLatency - mReportedOversamplingLatency + osLatency);
+    mReportedOversamplingLatency = osLatency;
+  }
+}
+
 void IPlugBase::ProcessBuffers(double sampleType, int nFrames)
 {
-  ProcessDoubleReplacing(mInData.Get(), mOutData.Get(), nFrames);
+  ApplyParamChanges();
+  ProcessDoubleReplacingWithParamEvents(nFrames);
 }
 
 void IPlugBase::ProcessBuffers(float sampleType, int nFrames)
 {
-  ProcessDoubleReplacing(mInData.Get(), mOutData.Get(), nFrames);
+  ApplyParamChanges();
+
+  // The oversampler works in double, so that still goes through the conversion.
+  if (mNativeFloatProcessing)
+  {
+    if (mOversampler.GetFactor() == 1)
+    {
+      ProcessSingleReplacingWithParamEvents(nFrames);
+      return;
+    }
+    CastInputsToDouble(nFrames);
+  }
+
+  ProcessDoubleReplacingWithParamEvents(nFrames);
   int i, n = NOutChannels();
   OutChannel** ppOutChannel = mOutChannels.GetList();
   
@@ -482,7 +750,12 @@ void IPlugBase::ProcessBuffers(float sampleType, int nFrames)
 
 void IPlugBase::ProcessBuffersAccumulating(float sampleType, int nFrames)
 {
-  ProcessDoubleReplacing(mInData.Get(), mOutData.Get(), nFrames);
+  ApplyParamChanges();
+  if (mNativeFloatProcessing)
+  {
+    CastInputsToDouble(nFrames);
+  }
+  ProcessDoubleReplacingWithParamEvents(nFrames);
   int i, n = NOutChannels();
   OutChannel** ppOutChannel = mOutChannels.GetList();
   
@@ -510,12 +783,14 @@ void IPlugBase::ZeroScratchBuffers()
   {
     InChannel* pInChannel = mInChannels.Get(i);
     memset(pInChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(double));
+    memset(pInChannel->mFScratchBuf.Get(), 0, mBlockSize * sizeof(float));
   }
 
   for (i = 0; i < nOut; ++i)
   {
     OutChannel* pOutChannel = mOutChannels.Get(i);
     memset(pOutChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(double));
+    memset(pOutChannel->mFScratchBuf.Get(), 0, mBlockSize * sizeof(float));
   }
 }
 
@@ -526,7 +801,12 @@ void IPlugBase::SetLatency(int samples)
   
   if (mDelay) 
   {
-    mDelay->SetDelayTime(mLatency);
+    // The bypass delay is resized by PassThroughBuffers() on the audio thread, make room for it here.
+    {
+      IMutexLock lock(this);
+      mDelay->Reserve(samples);
+    }
+    wdl_atomic_set(&mPendingDelayTime, samples);
   }
 }
 
@@ -534,10 +814,10 @@ void IPlugBase::SetLatency(int samples)
 void IPlugBase::SetParameterFromGUI(int idx, double normalizedValue)
 {
   Trace(TRACELOC, "%d:%f", idx, normalizedValue);
-  WDL_MutexLock lock(&mMutex);
+  IMutexLock lock(this);
   GetParam(idx)->SetNormalized(normalizedValue);
   InformHostOfParamChange(idx, normalizedValue);
-  OnParamChange(idx);
+  HandleParamChange(idx, true);
 }
 
 void IPlugBase::OnParamReset()
@@ -549,6 +829,93 @@ void IPlugBase::OnParamReset()
   //Reset();
 }
 
+void IPlugBase::HandleParamChange(int idx, bool fromGUI)
+{
+  if (mMutexCompatibility)
+  {
+    OnParamChange(idx);
+    return;
+  }
+
+  IParamChange change(idx, GetParam(idx)->Value(), wdl_atomic_get(&mParamGeneration));
+  bool queued = false;
+
+  if (fromGUI)
+  {
+    queued = mParamChangesFromGUI.Push(change);
+  }
+  // Hosts may set parameters from more than one thread, only one of them gets to produce at a time.
+  // The others don't wait, they fall back to a full resync like on overflow.
+  else if (!wdl_atomic_exchange(&mHostQueueBusy, 1))
+  {
+    queued = mParamChangesFromHost.Push(change);
+    wdl_atomic_set(&mHostQueueBusy, 0);
+  }
+
+  if (!queued)
+  {
+    // The IParam already holds the new value, have the audio thread re-read all of them.
+    wdl_atomic_set(&mParamResyncPending, 1);
+  }
+}
+
+void IPlugBase::ApplyParamChanges()
+{
+  if (mMutexCompatibility)
+  {
+    return;
+  }
+
+  // A restored state arrives as one snapshot, so OnParamReset() never sees half of a preset.
+  int i, n = mParams.GetSize();
+  IParamSnapshot* pSnapshot = mParamSnapshot.Acquire();
+
+  if (pSnapshot)
+  {
+    const double* pValue = pSnapshot->mValues.Get();
+    for (i = 0; i < n; ++i)
+    {
+      mParams.Get(i)->Set(pValue[i]);
+    }
+    mAppliedParamGeneration = pSnapshot->mGeneration;
+  }
+
+  // OnParamChange() reads the IParam, which holds the latest value from whichever thread set it last,
+  // so the order of the queues doesn't matter.
+  IParamChange change;
+  IPlugQueue<IParamChange>* queues[2] = { &mParamChangesFromHost, &mParamChangesFromGUI };
+
+  for (i = 0; i < 2; ++i)
+  {
+    while (queues[i]->Pop(change))
+    {
+      // Changes made before the snapshot was taken are part of it, or were overwritten by it.
+      if (change.mGeneration - mAppliedParamGeneration < 0) continue;
+
+      if (pSnapshot)
+      {
+        // Made after the restore, but the snapshot was just written over it.
+        mParams.Get(change.mIdx)->Set(change.mValue);
+      }
+      else
+      {
+        OnParamChange(change.mIdx);
+      }
+    }
+  }
+
+  bool reset = (pSnapshot != 0);
+  if (wdl_atomic_get(&mParamResyncPending) && wdl_atomic_exchange(&mParamResyncPending, 0))
+  {
+    reset = true;
+  }
+
+  if (reset)
+  {
+    OnParamReset();
+  }
+}
+
 // Default passthrough.
 void IPlugBase::ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames)
 {
@@ -570,12 +937,12 @@ void IPlugBase::ProcessDoubleReplacing(double** inputs, double** outputs, int nF
   }
 }
 
-// Default passthrough ONLY USED BY IOS.
+// Default passthrough, used by IOS and SetNativeFloatProcessing().
 void IPlugBase::ProcessSingleReplacing(float** inputs, float** outputs, int nFrames)
 {
   // Mutex is already locked.
   int i, nIn = mInChannels.GetSize(), nOut = mOutChannels.GetSize();
-  for (i = 0; i < nIn; ++i)
+  for (i = 0; i < nIn && i < nOut; ++i)
   {
     memcpy(outputs[i], inputs[i], nFrames * sizeof(float));
   }
@@ -893,7 +1260,7 @@ bool IPlugBase::SerializeParams(ByteChunk* pChunk)
 {
   TRACE;
 
-  WDL_MutexLock lock(&mMutex);
+  IMutexLock lock(this);
   bool savedOK = true;
   int i, n = mParams.GetSize();
   for (i = 0; i < n && savedOK; ++i)
@@ -910,17 +1277,43 @@ int IPlugBase::UnserializeParams(ByteChunk* pChunk, int startPos)
 {
   TRACE;
 
+  // In lock-free mode this only serializes the threads restoring state, the audio thread never takes mMutex.
   WDL_MutexLock lock(&mMutex);
+  IParamSnapshot* pSnapshot = mParamSnapshot.GetBack();
   int i, n = mParams.GetSize(), pos = startPos;
+  pSnapshot->mValues.Resize(n, false);
+  double* pValues = pSnapshot->mValues.Get();
   for (i = 0; i < n && pos >= 0; ++i)
   {
     IParam* pParam = mParams.Get(i);
     double v = 0.0;
     Trace(TRACELOC, "%d %s %f", i, pParam->GetNameForHost(), pParam->Value());
     pos = pChunk->Get(&v, pos);
-    pParam->Set(v);
+    pValues[i] = BOUNDED(v, pParam->GetMin(), pParam->GetMax());
+  }
+  for (/* same i */; i < n; ++i)
+  {
+    pValues[i] = mParams.Get(i)->Value();
+  }
+
+  if (!mMutexCompatibility)
+  {
+    // The audio thread takes all the values from the snapshot at the start of its next block, so it never
+    // works from a half restored state. The slot stays ours to read until the next restore, which waits on mMutex.
+    pSnapshot->mGeneration = wdl_atomic_incr(&mParamGeneration);
+    mParamSnapshot.Publish();
+  }
+
+  // For the GUI and the host, after publishing so that the audio thread only ever sees these values together.
+  for (i = 0; i < n; ++i)
+  {
+    mParams.Get(i)->Set(pValues[i]);
+  }
+
+  if (mMutexCompatibility)
+  {
+    OnParamReset();
   }
-  OnParamReset();
   return pos;
 }
 
@@ -959,7 +1352,7 @@ void IPlugBase::RedrawParamControls()
 #endif
 void IPlugBase::DirtyParameters()
 {
-  WDL_MutexLock lock(&mMutex);
+  IMutexLock lock(this);
 
   for (int p = 0; p < NParams(); p++)
   {
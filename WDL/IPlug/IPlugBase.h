@@ -6,18 +6,24 @@
 
 #include "Containers.h"
 #include "IPlugStructs.h"
+#include "IPlugQueue.h"
 #include "IParam.h"
 #include "Hosts.h"
 #include "Log.h"
 #include "NChanDelay.h"
 #include "../../WDL/IPlug/DSP/DSP.h"
 #include "CParamSmooth.h"
+#include "SmoothedParamBank.h"
+#include "Oversampler.h"
 
 // Uncomment to enable IPlug::OnIdle() and IGraphics::OnGUIIdle().
 #define USE_IDLE_CALLS
 #define MAX_EFFECT_NAME_LEN 128
 #define DEFAULT_BLOCK_SIZE 1024
 #define DEFAULT_TEMPO 120.0
+#define DEFAULT_PARAM_QUEUE_SIZE 1024
+
+#include "IParamEventQueue.h"
 
 // All version ints are stored as 0xVVVVRRMM: V = version, R = revision, M = minor revision.
 
@@ -49,14 +55,22 @@ public:
   virtual ~IPlugBase();
 
   // Implementations should set a mutex lock like in the no-op!
+  // IMutexLock is a no-op unless mutex compatibility mode is enabled, see SetMutexCompatibility().
+  // In the default lock-free mode OnParamChange() is called on the audio thread, at the start of the block.
   virtual void Reset() { TRACE; IMutexLock lock(this); }
   virtual void OnParamChange(int paramIdx) { IMutexLock lock(this); }
 
   // Default passthrough.  Inputs and outputs are [nChannel][nSample].
-  // Mutex is already locked.
+  // Mutex is already locked (in mutex compatibility mode).
   virtual void ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames);
+  // Only called by single precision hosts with SetNativeFloatProcessing(true), and on IOS.
   virtual void ProcessSingleReplacing(float** inputs, float** outputs, int nFrames);
 
+  // Only called with SetSampleAccurateParams(true), for blocks that have parameter events.
+  // The default splits the block at the event offsets, applying the events and calling
+  // ProcessDoubleReplacing() for each sub-block. Events left in the queue are applied afterwards.
+  virtual void ProcessParamEvents(IParamEventQueue* pEvents, double** inputs, double** outputs, int nFrames);
+
   // In case the audio processing thread needs to do anything when the GUI opens
   // (like for example, set some state dependent initial values for controls).
   virtual void OnGUIOpen() { TRACE; }
@@ -102,6 +116,22 @@ public:
 
   int NParams() { return mParams.GetSize(); }
   IParam* GetParam(int idx) { return mParams.Get(idx); }
+
+  // Call after the param has been initialized, e.g. in the constructor. timeMs <= 0 turns smoothing off again.
+  void SetParamSmoothing(int idx, double timeMs, SmoothedParamBank::ERampMode mode = SmoothedParamBank::kRampExponential);
+  // In ProcessDoubleReplacing: nFrames smoothed values of a param set up with SetParamSmoothing(), otherwise 0.
+  const double* GetSmoothedParam(int idx) { return mSmoothedParams.Get(idx); }
+
+  // Call in the constructor to let ProcessDoubleReplacing() run at up to maxFactor (2, 4 or 8) times the sample rate.
+  void EnableOversampling(int maxFactor = Oversampler::kMaxFactor);
+  // 1 (off), 2, 4 or 8, clamped to the EnableOversampling() maximum. Doesn't allocate, so it can be called
+  // from OnParamChange(). ProcessDoubleReplacing() then gets nFrames * factor samples at GetSampleRate() * factor,
+  // and so does GetSmoothedParam(). The filter latency is added to the plugin's by ReportLatencyChange().
+  void SetOversampling(int factor);
+  // Main thread: passes a latency change from SetOversampling() on to SetLatency() and the host. Called from
+  // SetBlockSize(), the GUI timer, VST2 idle and a timer in the VST3, AU and AAX wrappers.
+  void ReportLatencyChange();
+  int GetOversampling() { return mOversampler.GetFactor(); }
   IGraphics* GetGUI() { return mGraphics; }
 
   const char* GetEffectName() { return mEffectName; }
@@ -227,7 +257,8 @@ protected:
 
   // Will append if the chunk is already started
   bool SerializeParams(ByteChunk* pChunk);
-  int UnserializeParams(ByteChunk* pChunk, int startPos); // Returns the new chunk position (endPos)
+  // Returns the new chunk position (endPos). In lock-free mode the values reach the audio thread as one snapshot.
+  int UnserializeParams(ByteChunk* pChunk, int startPos);
 
   #ifndef OS_IOS
   virtual void RedrawParamControls();  // Called after restoring state.
@@ -238,6 +269,24 @@ protected:
 
   void OnParamReset();  // Calls OnParamChange(each param) + Reset().
 
+  // Call after the IParam value has been updated from the host or the GUI.
+  // With mutex compatibility this calls OnParamChange() right away (the caller holds the mutex),
+  // otherwise the change is queued for the audio thread. Host changes may come from several threads.
+  void HandleParamChange(int idx, bool fromGUI = false);
+  // Audio thread: applies queued changes and state snapshots. Called at the start of the Process/PassThroughBuffers methods.
+  void ApplyParamChanges();
+
+  // Audio thread only. API classes add host automation with a sample offset here when GetSampleAccurateParams().
+  void AddParamEvent(int offset, int idx, double normalizedValue) { mParamEvents.Add(IParamEvent(offset, idx, normalizedValue)); }
+  void ApplyParamEvent(IParamEvent* pEvent);
+
+  // Ramps the smoothed params towards their current values for the next nFrames.
+  // Done before every ProcessDoubleReplacing() call, only needed by plugins overriding ProcessParamEvents().
+  void SmoothParams(int nFrames);
+  // Calls ProcessDoubleReplacing(), through the oversampler if SetOversampling() is on.
+  // Plugins overriding ProcessParamEvents() should call this instead of ProcessDoubleReplacing().
+  void ProcessOversampled(double** inputs, double** outputs, int nFrames);
+
   void PruneUninitializedPresets();
 
   // Unserialize / SerializePresets - Only used by VST2
@@ -261,6 +310,20 @@ protected:
   void ProcessBuffersAccumulating(float sampleType, int nFrames);
   void ZeroScratchBuffers();
   
+private:
+  void ProcessDoubleReplacingWithParamEvents(int nFrames);
+  void ProcessSingleReplacingWithParamEvents(int nFrames);
+  void ApplyParamEvents(int nFrames);
+  void CastInputsToDouble(int nFrames); // Native float inputs, when something needs doubles after all.
+
+  // Splits the block at the event offsets into ppIn/ppOut sub-block pointers, for either sample type.
+  template <class SAMPLETYPE>
+  void SplitAtParamEvents(IParamEventQueue* pEvents, SAMPLETYPE** inputs, SAMPLETYPE** outputs, int nFrames, SAMPLETYPE** ppIn, SAMPLETYPE** ppOut);
+  void ProcessReplacing(double** inputs, double** outputs, int nFrames) { ProcessOversampled(inputs, outputs, nFrames); }
+  void ProcessReplacing(float** inputs, float** outputs, int nFrames) { ProcessSingleReplacing(inputs, outputs, nFrames); }
+
+protected:
+  
 public:
   void ModifyCurrentPreset(const char* name = 0);     // Sets the currently active preset to whatever current params are.
   int NPresets() { return mPresets.GetSize(); }
@@ -284,17 +347,36 @@ public:
   bool LoadProgramFromFXP(WDL_String* fileName);
   bool LoadBankFromFXB(WDL_String* fileName);
   
+  // Call in the constructor to get timestamped automation as IParamEvents, see IParamEventQueue.h.
+  void SetSampleAccurateParams(bool enable) { mSampleAccurateParams = enable; }
+  bool GetSampleAccurateParams() { return mSampleAccurateParams; }
+
+  // Call in the constructor if the plugin overrides ProcessSingleReplacing() too. Single precision hosts
+  // (VST2 processReplacing, VST3 kSample32, AU, AAX, RTAS) then call it with their own buffers, instead of
+  // ProcessDoubleReplacing() with copies converted to double. Both can forward to one template:
+  //   template <class SAMPLETYPE> void ProcessReplacing(SAMPLETYPE** inputs, SAMPLETYPE** outputs, int nFrames);
+  // Param events are split with the default ProcessParamEvents() behaviour. Oversampling, bypass with latency
+  // and VST2 accumulating process() still go through ProcessDoubleReplacing().
+  void SetNativeFloatProcessing(bool enable) { mNativeFloatProcessing = enable; }
+  bool GetNativeFloatProcessing() { return mNativeFloatProcessing; }
+
   void SetSampleRate(double sampleRate);
   virtual void SetBlockSize(int blockSize); // overridden in IPlugAU
   
+  // By default the audio thread never takes mMutex: parameter changes and state restores are handed over
+  // through wait-free queues and flags instead. Enable this (in the constructor, before processing starts) for
+  // plugins that rely on the old behaviour of every callback being serialized by mMutex.
+  void SetMutexCompatibility(bool enable) { mMutexCompatibility = enable; }
+  bool GetMutexCompatibility() { return mMutexCompatibility; }
+
   WDL_Mutex mMutex;
 
   struct IMutexLock
   {
     WDL_Mutex* mpMutex;
-    IMutexLock(IPlugBase* pPlug) : mpMutex(&(pPlug->mMutex)) { mpMutex->Enter(); }
+    IMutexLock(IPlugBase* pPlug) : mpMutex(pPlug->mMutexCompatibility ? &(pPlug->mMutex) : 0) { if (mpMutex) { mpMutex->Enter(); } }
     ~IMutexLock() { if (mpMutex) { mpMutex->Leave(); } }
-    void Destroy() { mpMutex->Leave(); mpMutex = 0; }
+    void Destroy() { if (mpMutex) { mpMutex->Leave(); mpMutex = 0; } }
   };
 
 private:
@@ -310,6 +392,7 @@ private:
     bool mConnected;
     double** mSrc;   // Points into mInData.
     WDL_TypedBuf<double> mScratchBuf;
+    WDL_TypedBuf<float> mFScratchBuf; // Unconnected with native float processing.
     WDL_String mLabel;
   };
 
@@ -319,6 +402,7 @@ private:
     double** mDest;  // Points into mOutData.
     float* mFDest;
     WDL_TypedBuf<double> mScratchBuf;
+    WDL_TypedBuf<float> mFScratchBuf; // Unconnected with native float processing.
     WDL_String mLabel;
   };
 
@@ -336,10 +420,25 @@ private:
   WDL_PtrList<IParam> mParams;
   WDL_PtrList<IPreset> mPresets;
   WDL_TypedBuf<double*> mInData, mOutData;
+  WDL_TypedBuf<double*> mInSubBlock, mOutSubBlock; // Offset pointers into mInData/mOutData for ProcessParamEvents().
+  WDL_TypedBuf<float*> mInFData, mOutFData; // Host float buffers (or mFScratchBuf), by channel.
+  WDL_TypedBuf<float*> mInFSubBlock, mOutFSubBlock;
   WDL_PtrList<InChannel> mInChannels;
   WDL_PtrList<OutChannel> mOutChannels;
   WDL_PtrList<WDL_String> mInputBusLabels;
   WDL_PtrList<WDL_String> mOutputBusLabels;
+
+  bool mMutexCompatibility;
+  IPlugQueue<IParamChange> mParamChangesFromGUI, mParamChangesFromHost;
+  IPlugSnapshot<IParamSnapshot> mParamSnapshot;
+  int mParamGeneration, mAppliedParamGeneration;
+  int mParamResyncPending, mHostQueueBusy;
+  int mLatencyChangePending, mReportedOversamplingLatency;
+  int mPendingDelayTime; // from SetLatency() for the audio thread, -1 if none
+  bool mSampleAccurateParams, mNativeFloatProcessing;
+  IParamEventQueue mParamEvents;
+  SmoothedParamBank mSmoothedParams;
+  Oversampler mOversampler;
 };
 
 #endif
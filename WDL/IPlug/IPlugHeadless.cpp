@@ -0,0 +1,70 @@
+#include "IPlugHeadless.h"
+#include <math.h>
+
+IPlugHeadless::IPlugHeadless(IPlugInstanceInfo instanceInfo,
+                             int nParams,
+                             const char* channelIOStr,
+                             int nPresets,
+                             const char* effectName,
+                             const char* productName,
+                             const char* mfrName,
+                             int vendorVersion,
+                             int uniqueID,
+                             int mfrID,
+                             int latency,
+                             bool plugDoesMidi,
+                             bool plugDoesChunks,
+                             bool plugIsInst,
+                             int plugScChans)
+  : IPlugBase(nParams,
+              channelIOStr,
+              nPresets,
+              effectName,
+              productName,
+              mfrName,
+              vendorVersion,
+              uniqueID,
+              mfrID,
+              latency,
+              plugDoesMidi,
+              plugDoesChunks,
+              plugIsInst,
+              kAPIHeadless)
+  , mSamplePos(0)
+  , mTempo(DEFAULT_TEMPO)
+{
+  Trace(TRACELOC, "%s%s", effectName, channelIOStr);
+
+  SetInputChannelConnections(0, NInChannels(), true);
+  SetOutputChannelConnections(0, NOutChannels(), true);
+
+  SetBlockSize(DEFAULT_BLOCK_SIZE);
+  SetHost("headless", vendorVersion);
+}
+
+void IPlugHeadless::GetTime(ITimeInfo* pTimeInfo)
+{
+  pTimeInfo->mTempo = mTempo;
+  pTimeInfo->mSamplePos = (double) mSamplePos;
+  pTimeInfo->mPPQPos = (double) mSamplePos / GetSamplesPerBeat();
+  pTimeInfo->mLastBar = floor(pTimeInfo->mPPQPos / 4.) * 4.;
+  pTimeInfo->mNumerator = pTimeInfo->mDenominator = 4;
+  pTimeInfo->mTransportIsRunning = true;
+  pTimeInfo->mTransportLoopEnabled = false;
+}
+
+void IPlugHeadless::Prepare(double sampleRate, int blockSize)
+{
+  SetSampleRate(sampleRate);
+  SetBlockSize(blockSize);
+  Reset();
+  OnActivate(true);
+  mSamplePos = 0;
+}
+
+void IPlugHeadless::SetParameter(int idx, double value)
+{
+  if (idx < 0 || idx >= NParams()) return;
+  GetParam(idx)->Set(value);
+  HandleParamChange(idx);
+}
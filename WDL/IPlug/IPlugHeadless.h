@@ -0,0 +1,78 @@
+#ifndef _IPLUGAPI_
+#define _IPLUGAPI_
+// Only load one API class!
+
+// Runs a plugin with no host, audio device or window: IPlugHeadlessMain.cpp streams a WAV file (or generated
+// noise) through ProcessBuffers() and reports how long each block took. Build with HEADLESS_API defined,
+// see IPlugExamples/Makefile.headless.
+
+#include "IPlugBase.h"
+
+struct IPlugInstanceInfo
+{
+};
+
+class IPlugHeadless : public IPlugBase
+{
+public:
+  IPlugHeadless(IPlugInstanceInfo instanceInfo,
+                int nParams,
+                const char* channelIOStr,
+                int nPresets,
+                const char* effectName,
+                const char* productName,
+                const char* mfrName,
+                int vendorVersion,
+                int uniqueID,
+                int mfrID,
+                int latency = 0,
+                bool plugDoesMidi = false,
+                bool plugDoesChunks = false,
+                bool plugIsInst = false,
+                int plugScChans = 0);
+
+  // There is no host to inform.
+  void BeginInformHostOfParamChange(int idx) {}
+  void InformHostOfParamChange(int idx, double normalizedValue) {}
+  void EndInformHostOfParamChange(int idx) {}
+  void InformHostOfProgramChange() {}
+
+  int GetSamplePos() { return mSamplePos; }
+  double GetTempo() { return mTempo; }
+  void GetTimeSig(int* pNum, int* pDenom) { *pNum = *pDenom = 4; }
+  void GetTime(ITimeInfo* pTimeInfo);
+  bool IsRenderingOffline() { return true; }
+
+  void ResizeGraphics(int w, int h) {}
+
+  void SetTempo(double tempo) { mTempo = tempo; }
+  bool IsInstrument() { return IsInst(); }
+
+  // Like host automation: sets the plain (not normalized) value, the plugin sees it at the start of the next block.
+  void SetParameter(int idx, double value);
+
+  // What a host does before the first block: sets the sample rate and block size, resets and activates.
+  void Prepare(double sampleRate, int blockSize);
+
+  // One host process call, nFrames <= the Prepare() block size. MIDI sent with ProcessMidiMsg()
+  // beforehand lands in this block.
+  template <class SAMPLETYPE>
+  void ProcessBlock(SAMPLETYPE** inputs, SAMPLETYPE** outputs, int nFrames)
+  {
+    AttachInputBuffers(0, NInChannels(), inputs, nFrames);
+    AttachOutputBuffers(0, NOutChannels(), outputs);
+    ProcessBuffers((SAMPLETYPE) 0, nFrames);
+    mSamplePos += nFrames;
+  }
+
+protected:
+  bool SendMidiMsg(IMidiMsg* pMsg) { return false; }
+
+private:
+  int mSamplePos;
+  double mTempo;
+};
+
+IPlugHeadless* MakePlug();
+
+#endif
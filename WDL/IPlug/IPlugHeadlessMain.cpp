@@ -0,0 +1,382 @@
+// main() for the headless target: renders a WAV file (or generated noise) through a plugin offline and
+// reports the cost of each ProcessBuffers() call.
+//
+//   <plug>-headless [-i in.wav] [-o out.wav] [-sr 44100] [-bs 512] [-len seconds] [-bits 16|24]
+//                   [-float] [-param idx value]... [-notes]
+//
+// -float sends float buffers (ProcessSingleReplacing() / the native float path), the default is double.
+// -notes plays a note pattern into instruments. Parameter values are plain (not normalized) values.
+//
+// The report gives per-block wall clock latency percentiles, CPU cycles per sample (x86 only) and heap
+// allocations made on the audio thread, which should be zero, plus the process' peak heap size. Exits with 2 if the plugin allocated
+// while processing, so CI can catch it.
+
+#include "IPlugHeadless.h"
+#include "../wavwrite.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+  #include <x86intrin.h>
+  #define HEADLESS_CYCLES() __rdtsc()
+#else
+  #define HEADLESS_CYCLES() 0
+#endif
+
+// Heap accounting. glibc lets us replace malloc() and friends and forward to the real ones, every
+// allocation (new, WDL_HeapBuf, strdup...) is seen. Only allocations made while sCounting is set count.
+#ifdef __GLIBC__
+#include <malloc.h>
+#include <unistd.h>
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+extern "C" void* __libc_memalign(size_t align, size_t size);
+extern "C" void __libc_free(void* p);
+
+static volatile int sCounting = 0;
+static volatile long sNumAllocs = 0;
+static volatile long sLiveBytes = 0, sPeakLiveBytes = 0;
+
+static inline void CountAlloc(void* p)
+{
+  if (!p) return;
+  long live = __sync_add_and_fetch(&sLiveBytes, (long) malloc_usable_size(p));
+  if (live > sPeakLiveBytes) sPeakLiveBytes = live;
+  if (sCounting) __sync_add_and_fetch(&sNumAllocs, 1);
+}
+
+static inline void CountFree(void* p)
+{
+  if (p) __sync_sub_and_fetch(&sLiveBytes, (long) malloc_usable_size(p));
+}
+
+extern "C"
+{
+  void* malloc(size_t size) { void* p = __libc_malloc(size); CountAlloc(p); return p; }
+  void* calloc(size_t n, size_t size) { void* p = __libc_calloc(n, size); CountAlloc(p); return p; }
+  void* memalign(size_t align, size_t size) { void* p = __libc_memalign(align, size); CountAlloc(p); return p; }
+  void free(void* p) { CountFree(p); __libc_free(p); }
+
+  void* realloc(void* p, size_t size)
+  {
+    CountFree(p);
+    void* q = __libc_realloc(p, size);
+    CountAlloc(q ? q : (size ? 0 : p));
+    return q;
+  }
+
+  int posix_memalign(void** pp, size_t align, size_t size)
+  {
+    *pp = memalign(align, size);
+    return *pp ? 0 : 12; // ENOMEM
+  }
+
+  void* aligned_alloc(size_t align, size_t size) { return memalign(align, size); }
+  void* valloc(size_t size) { return memalign(sysconf(_SC_PAGESIZE), size); }
+  void* pvalloc(size_t size)
+  {
+    size_t page = sysconf(_SC_PAGESIZE);
+    return memalign(page, (size + page - 1) & ~(page - 1));
+  }
+}
+#define HEADLESS_ALLOC_COUNTING 1
+#else
+static int sCounting = 0;
+static long sNumAllocs = 0;
+static long sPeakLiveBytes = 0;
+#endif
+
+static double GetSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// Just enough of a WAV reader for test material: PCM 8/16/24/32 bit and 32/64 bit float, deinterleaved to doubles.
+static bool ReadWav(const char* path, WDL_PtrList<WDL_TypedBuf<double> >* pChannels, int* pSampleRate)
+{
+  FILE* fp = fopen(path, "rb");
+  if (!fp) return false;
+
+  unsigned char hdr[12];
+  if (fread(hdr, 1, 12, fp) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVE", 4))
+  {
+    fclose(fp);
+    return false;
+  }
+
+  int fmt = 0, nch = 0, bps = 0;
+  for (;;)
+  {
+    unsigned char ck[8];
+    if (fread(ck, 1, 8, fp) != 8) break;
+    unsigned int len = ck[4] | (ck[5] << 8) | (ck[6] << 16) | ((unsigned int) ck[7] << 24);
+
+    if (!memcmp(ck, "fmt ", 4) && len >= 16)
+    {
+      unsigned char f[40];
+      int n = len < sizeof(f) ? len : sizeof(f);
+      if (fread(f, 1, n, fp) != (size_t) n) break;
+      fseek(fp, len - n + (len & 1), SEEK_CUR);
+      fmt = f[0] | (f[1] << 8);
+      nch = f[2] | (f[3] << 8);
+      *pSampleRate = f[4] | (f[5] << 8) | (f[6] << 16) | (f[7] << 24);
+      bps = f[14] | (f[15] << 8);
+      if (fmt == 0xFFFE && n >= 26) fmt = f[24] | (f[25] << 8); // WAVE_FORMAT_EXTENSIBLE: the subformat GUID starts with the tag
+    }
+    else if (!memcmp(ck, "data", 4) && nch > 0 && bps >= 8)
+    {
+      int bytesPerSample = bps / 8;
+      int nFrames = len / (bytesPerSample * nch);
+      WDL_HeapBuf raw;
+      unsigned char* p = (unsigned char*) raw.Resize(nFrames * bytesPerSample * nch, false);
+      nFrames = (int) fread(p, bytesPerSample * nch, nFrames, fp);
+      fclose(fp);
+
+      if ((fmt != 1 && fmt != 3) || (fmt == 3 && bps != 32 && bps != 64)) return false;
+
+      for (int c = 0; c < nch; ++c)
+      {
+        WDL_TypedBuf<double>* pBuf = new WDL_TypedBuf<double>;
+        pBuf->Resize(nFrames);
+        pChannels->Add(pBuf);
+      }
+
+      for (int s = 0; s < nFrames; ++s)
+      {
+        for (int c = 0; c < nch; ++c, p += bytesPerSample)
+        {
+          double v;
+          if (fmt == 3)
+          {
+            if (bps == 32) { float f; memcpy(&f, p, 4); v = f; }
+            else memcpy(&v, p, 8);
+          }
+          else if (bps == 8) v = (p[0] - 128) / 128.;
+          else if (bps == 16) v = (short) (p[0] | (p[1] << 8)) / 32768.;
+          else if (bps == 24) v = ((int) ((p[0] << 8) | (p[1] << 16) | ((unsigned int) p[2] << 24)) >> 8) / 8388608.;
+          else v = (int) (p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24)) / 2147483648.;
+          pChannels->Get(c)->Get()[s] = v;
+        }
+      }
+      return true;
+    }
+    else
+    {
+      fseek(fp, len + (len & 1), SEEK_CUR);
+    }
+  }
+
+  fclose(fp);
+  return false;
+}
+
+static double Percentile(WDL_TypedBuf<double>* pSorted, double pct)
+{
+  int n = pSorted->GetSize();
+  if (!n) return 0.;
+  int i = (int) (pct * (n - 1) + 0.5);
+  return pSorted->Get()[i];
+}
+
+static int CompareDoubles(const void* a, const void* b)
+{
+  double x = *(const double*) a, y = *(const double*) b;
+  return x < y ? -1 : x > y;
+}
+
+template <class SAMPLETYPE>
+static void Render(IPlugHeadless* pPlug, WDL_PtrList<WDL_TypedBuf<double> >* pInput, int nFrames, int blockSize,
+                   bool playNotes, WaveWriter* pWav, WDL_TypedBuf<double>* pBlockTimes, double* pCycles, long* pMaxAllocsPerBlock)
+{
+  int nIn = pPlug->NInChannels(), nOut = pPlug->NOutChannels();
+
+  // All buffers are allocated before the first block so the only heap traffic counted is the plugin's own.
+  WDL_TypedBuf<SAMPLETYPE> inBuf, outBuf;
+  WDL_TypedBuf<SAMPLETYPE*> inPtrs, outPtrs;
+  inBuf.Resize(blockSize * (nIn ? nIn : 1));
+  outBuf.Resize(blockSize * (nOut ? nOut : 1));
+  inPtrs.Resize(nIn ? nIn : 1);
+  outPtrs.Resize(nOut ? nOut : 1);
+  for (int c = 0; c < nIn; ++c) inPtrs.Get()[c] = inBuf.Get() + c * blockSize;
+  for (int c = 0; c < nOut; ++c) outPtrs.Get()[c] = outBuf.Get() + c * blockSize;
+  pBlockTimes->Resize((nFrames + blockSize - 1) / blockSize);
+  pBlockTimes->Resize(0, false);
+
+  unsigned int noise = 0x12345678;
+  int nSrcChans = pInput->GetSize();
+  int notePeriod = (int) (pPlug->GetSampleRate() / 4.); // sixteenths at 60bpm
+  int note = 0, noteOn = -1;
+
+  for (int pos = 0; pos < nFrames; pos += blockSize)
+  {
+    int n = nFrames - pos < blockSize ? nFrames - pos : blockSize;
+
+    for (int c = 0; c < nIn; ++c)
+    {
+      SAMPLETYPE* pIn = inPtrs.Get()[c];
+      if (nSrcChans)
+      {
+        double* pSrc = pInput->Get(c % nSrcChans)->Get() + pos;
+        for (int s = 0; s < n; ++s) pIn[s] = (SAMPLETYPE) pSrc[s];
+      }
+      else
+      {
+        for (int s = 0; s < n; ++s)
+        {
+          noise = noise * 1664525 + 1013904223;
+          pIn[s] = (SAMPLETYPE) ((int) noise * (0.25 / 2147483648.));
+        }
+      }
+    }
+
+    if (playNotes)
+    {
+      for (int s = (notePeriod - pos % notePeriod) % notePeriod; s < n; s += notePeriod)
+      {
+        IMidiMsg msg;
+        if (noteOn >= 0)
+        {
+          msg.MakeNoteOffMsg(noteOn, s);
+          pPlug->ProcessMidiMsg(&msg);
+        }
+        static const int kPattern[8] = { 48, 55, 60, 63, 67, 63, 60, 55 };
+        noteOn = kPattern[note++ & 7];
+        msg.MakeNoteOnMsg(noteOn, 100, s);
+        pPlug->ProcessMidiMsg(&msg);
+      }
+    }
+
+    long allocsBefore = sNumAllocs;
+    sCounting = 1;
+    unsigned long long c0 = HEADLESS_CYCLES();
+    double t0 = GetSeconds();
+
+    pPlug->ProcessBlock(inPtrs.Get(), outPtrs.Get(), n);
+
+    double t1 = GetSeconds();
+    unsigned long long c1 = HEADLESS_CYCLES();
+    sCounting = 0;
+
+    long allocs = sNumAllocs - allocsBefore;
+    if (allocs > *pMaxAllocsPerBlock) *pMaxAllocsPerBlock = allocs;
+    *pCycles += (double) (c1 - c0);
+    pBlockTimes->Add(t1 - t0);
+
+    if (pWav && nOut)
+    {
+      if (sizeof(SAMPLETYPE) == sizeof(float)) pWav->WriteFloatsNI((float**) outPtrs.Get(), 0, n, nOut);
+      else pWav->WriteDoublesNI((double**) outPtrs.Get(), 0, n, nOut);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* inPath = 0;
+  const char* outPath = 0;
+  double sampleRate = 0., seconds = 10.;
+  int blockSize = DEFAULT_BLOCK_SIZE, bits = 24;
+  bool useFloat = false, playNotes = false;
+  WDL_TypedBuf<int> paramIdx;
+  WDL_TypedBuf<double> paramValues;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const char* a = argv[i];
+    bool hasArg = i + 1 < argc;
+    if (!strcmp(a, "-i") && hasArg) inPath = argv[++i];
+    else if (!strcmp(a, "-o") && hasArg) outPath = argv[++i];
+    else if (!strcmp(a, "-sr") && hasArg) sampleRate = atof(argv[++i]);
+    else if (!strcmp(a, "-bs") && hasArg) blockSize = atoi(argv[++i]);
+    else if (!strcmp(a, "-len") && hasArg) seconds = atof(argv[++i]);
+    else if (!strcmp(a, "-bits") && hasArg) bits = atoi(argv[++i]);
+    else if (!strcmp(a, "-float")) useFloat = true;
+    else if (!strcmp(a, "-notes")) playNotes = true;
+    else if (!strcmp(a, "-param") && i + 2 < argc)
+    {
+      paramIdx.Add(atoi(argv[i + 1]));
+      paramValues.Add(atof(argv[i + 2]));
+      i += 2;
+    }
+    else
+    {
+      fprintf(stderr, "usage: %s [-i in.wav] [-o out.wav] [-sr rate] [-bs blocksize] [-len seconds] [-bits 16|24] "
+                      "[-float] [-notes] [-param idx value]...\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (blockSize < 1) blockSize = 1;
+  if (bits != 16) bits = 24;
+
+  WDL_PtrList<WDL_TypedBuf<double> > input;
+  int fileRate = 44100;
+  if (inPath && !ReadWav(inPath, &input, &fileRate))
+  {
+    fprintf(stderr, "could not read %s (PCM or float WAV expected)\n", inPath);
+    return 1;
+  }
+  if (sampleRate <= 0.) sampleRate = (double) fileRate;
+
+  int nFrames = input.GetSize() ? input.Get(0)->GetSize() : (int) (seconds * sampleRate);
+
+  IPlugHeadless* pPlug = MakePlug();
+  if (!pPlug) return 1;
+
+  for (int i = 0; i < paramIdx.GetSize(); ++i)
+  {
+    pPlug->SetParameter(paramIdx.Get()[i], paramValues.Get()[i]);
+  }
+
+  pPlug->Prepare(sampleRate, blockSize);
+  if (playNotes && !pPlug->IsInstrument()) playNotes = false;
+
+  WaveWriter* pWav = 0;
+  if (outPath)
+  {
+    pWav = new WaveWriter(outPath, bits, pPlug->NOutChannels(), (int) sampleRate, 0);
+    if (!pWav->Status())
+    {
+      fprintf(stderr, "could not write %s\n", outPath);
+      return 1;
+    }
+  }
+
+  WDL_TypedBuf<double> blockTimes;
+  double cycles = 0.;
+  long maxAllocsPerBlock = 0;
+
+  if (useFloat) Render<float>(pPlug, &input, nFrames, blockSize, playNotes, pWav, &blockTimes, &cycles, &maxAllocsPerBlock);
+  else Render<double>(pPlug, &input, nFrames, blockSize, playNotes, pWav, &blockTimes, &cycles, &maxAllocsPerBlock);
+
+  delete pWav;
+
+  double total = 0.;
+  for (int i = 0; i < blockTimes.GetSize(); ++i) total += blockTimes.Get()[i];
+  qsort(blockTimes.Get(), blockTimes.GetSize(), sizeof(double), CompareDoubles);
+
+  double blockBudget = (double) blockSize / sampleRate;
+  printf("plugin:       %s %s\n", pPlug->GetEffectName(), pPlug->GetAPIString());
+  printf("channels:     %d in, %d out, %s, latency %d\n", pPlug->NInChannels(), pPlug->NOutChannels(), useFloat ? "float" : "double", pPlug->GetLatency());
+  printf("rendered:     %d frames at %.0f Hz in %d blocks of %d\n", nFrames, sampleRate, blockTimes.GetSize(), blockSize);
+  printf("block (us):   p50 %.2f  p90 %.2f  p99 %.2f  max %.2f  (budget %.2f)\n",
+         Percentile(&blockTimes, 0.5) * 1e6, Percentile(&blockTimes, 0.9) * 1e6, Percentile(&blockTimes, 0.99) * 1e6,
+         Percentile(&blockTimes, 1.) * 1e6, blockBudget * 1e6);
+  printf("realtime:     %.1fx\n", total > 0. ? (double) nFrames / sampleRate / total : 0.);
+  if (cycles > 0.) printf("cycles/frame: %.1f\n", cycles / (double) (nFrames ? nFrames : 1));
+  #ifdef HEADLESS_ALLOC_COUNTING
+  printf("allocations:  %ld while processing, at most %ld in one block, peak heap %ld bytes\n", sNumAllocs, maxAllocsPerBlock, sPeakLiveBytes);
+  #endif
+
+  delete pPlug;
+  input.Empty(true);
+
+  return sNumAllocs ? 2 : 0;
+}
@@ -0,0 +1,106 @@
+#ifndef _IPLUGQUEUE_
+#define _IPLUGQUEUE_
+
+/*
+
+IPlugQueue is a wait-free, fixed size FIFO for passing data from exactly one
+producer thread to exactly one consumer thread, e.g. parameter changes from
+the GUI to the audio thread. Neither Push() nor Pop() ever blocks or
+allocates, so the audio thread can safely be either side.
+
+IPlugSnapshot is a lock-free triple buffer for handing a whole block of state
+(e.g. every parameter value of a preset) from one writer to one reader. The
+writer fills a slot nobody else is using and publishes it with one atomic
+swap, the reader always gets the most recently published one, and neither
+side waits for the other.
+
+*/
+
+#include "../heapbuf.h"
+#include "../wdlatomic.h"
+
+template <class T>
+class IPlugQueue
+{
+public:
+  IPlugQueue(int size = 0) : mReadPos(0), mWritePos(0) { Resize(size); }
+  ~IPlugQueue() {}
+
+  // Not thread safe, only call this when neither side is using the queue.
+  void Resize(int size)
+  {
+    mBuf.Resize(size + 1); // One slot is always kept free to tell full from empty.
+    mReadPos = mWritePos = 0;
+  }
+
+  // Producer side. Returns false (and drops the item) if the queue is full.
+  bool Push(const T& item)
+  {
+    int writePos = mWritePos;
+    int next = writePos + 1;
+    if (next >= mBuf.GetSize()) next = 0;
+    if (next == wdl_atomic_get(&mReadPos)) return false;
+
+    mBuf.Get()[writePos] = item;
+    wdl_atomic_set(&mWritePos, next);
+    return true;
+  }
+
+  // Consumer side. Returns false if the queue is empty.
+  bool Pop(T& item)
+  {
+    int readPos = mReadPos;
+    if (readPos == wdl_atomic_get(&mWritePos)) return false;
+
+    item = mBuf.Get()[readPos];
+    if (++readPos >= mBuf.GetSize()) readPos = 0;
+    wdl_atomic_set(&mReadPos, readPos);
+    return true;
+  }
+
+  // Safe from either side, but only a snapshot.
+  int ToDo() const
+  {
+    int n = wdl_atomic_get(&mWritePos) - wdl_atomic_get(&mReadPos);
+    return n < 0 ? n + mBuf.GetSize() : n;
+  }
+
+  inline bool Empty() const { return ToDo() == 0; }
+  inline int GetSize() const { return mBuf.GetSize() - 1; }
+
+private:
+  WDL_TypedBuf<T> mBuf;
+  int mReadPos, mWritePos;
+} WDL_FIXALIGN;
+
+template <class T>
+class IPlugSnapshot
+{
+public:
+  IPlugSnapshot() : mMiddle(1), mBack(0), mFront(2) {}
+  ~IPlugSnapshot() {}
+
+  // Not thread safe, for preallocating the slots before processing starts.
+  T* GetSlot(int idx) { return &mSlots[idx]; }
+
+  // Writer side: fill GetBack(), then Publish() it.
+  T* GetBack() { return &mSlots[mBack]; }
+  void Publish() { mBack = wdl_atomic_exchange(&mMiddle, mBack | kDirty) & kIdxMask; }
+
+  // Reader side: returns the most recently published slot, or 0 if nothing
+  // has been published since the last call.
+  T* Acquire()
+  {
+    if (!(wdl_atomic_get(&mMiddle) & kDirty)) return 0;
+    mFront = wdl_atomic_exchange(&mMiddle, mFront) & kIdxMask;
+    return &mSlots[mFront];
+  }
+
+private:
+  enum { kIdxMask = 3, kDirty = 4 };
+
+  T mSlots[3];
+  int mMiddle, mBack, mFront;
+};
+
+#endif // _IPLUGQUEUE_
@@ -117,12 +117,14 @@ bool IPlugStandalone::SendSysEx(ISysEx* pSysEx)
 void IPlugStandalone::LockMutexAndProcessSingleReplacing(float** inputs, float** outputs, int nFrames)
 {
   IMutexLock lock(this);
+  ApplyParamChanges();
   ProcessSingleReplacing(inputs, outputs, nFrames);
 }
 #else
 void IPlugStandalone::LockMutexAndProcessDoubleReplacing(double** inputs, double** outputs, int nFrames)
 {
   IMutexLock lock(this);
+  ApplyParamChanges();
   ProcessDoubleReplacing(inputs, outputs, nFrames);
 }
 #endif
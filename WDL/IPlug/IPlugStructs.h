@@ -86,6 +86,9 @@ const IColor DEFAULT_TEXT_ENTRY_FGCOLOR = COLOR_BLACK;
 #elif defined OS_OSX
   const char* const DEFAULT_FONT = "Monaco";
   const int DEFAULT_TEXT_SIZE = 10;
+#else
+  const char* const DEFAULT_FONT = "Monospace";
+  const int DEFAULT_TEXT_SIZE = 10;
 #endif
 
 const int FONT_LEN = 32;
@@ -454,6 +457,25 @@ struct ISysEx
   void LogMsg();
 };
 
+// A parameter change on its way to the audio thread, see IPlugBase::HandleParamChange().
+// mGeneration is the state restore it followed, mValue is only needed if a later restore reaches the audio thread first.
+struct IParamChange
+{
+  int mIdx, mGeneration;
+  double mValue;
+
+  IParamChange(int idx = 0, double value = 0., int generation = 0) : mIdx(idx), mGeneration(generation), mValue(value) {}
+};
+
+// All parameter values at once, e.g. from a preset or a host state restore.
+struct IParamSnapshot
+{
+  int mGeneration;
+  WDL_TypedBuf<double> mValues;
+
+  IParamSnapshot() : mGeneration(0) {}
+};
+
 const int MAX_PRESET_NAME_LEN = 256;
 #define UNUSED_PRESET_NAME "empty"
 
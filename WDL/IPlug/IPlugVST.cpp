@@ -338,6 +338,7 @@ VstIntPtr VSTCALLBACK IPlugVST::VSTDispatcher(AEffect *pEffect, VstInt32 opCode,
   {
     case effEditIdle:
     case __effIdleDeprecated:
+    _this->ReportLatencyChange();
     #ifdef USE_IDLE_CALLS
     _this->OnIdle();
     #endif
@@ -419,7 +420,7 @@ VstIntPtr VSTCALLBACK IPlugVST::VSTDispatcher(AEffect *pEffect, VstInt32 opCode,
           }
           if (_this->GetGUI()) _this->GetGUI()->SetParameterFromPlug(idx, v, false);
           pParam->Set(v);
-          _this->OnParamChange(idx);
+          _this->HandleParamChange(idx);
         }
         return 1;
       }
@@ -906,6 +907,6 @@ void VSTCALLBACK IPlugVST::VSTSetParameter(AEffect *pEffect, VstInt32 idx, float
       _this->GetGUI()->SetParameterFromPlug(idx, value, true);
     }
     _this->GetParam(idx)->SetNormalized(value);
-    _this->OnParamChange(idx);
+    _this->HandleParamChange(idx);
   }
 }
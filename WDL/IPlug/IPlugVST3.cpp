@@ -40,6 +40,7 @@ IPlugVST3::IPlugVST3(IPlugInstanceInfo instanceInfo,
               kAPIVST3)
   , mScChans(plugScChans)
   , mSidechainActive(false)
+  , mLatencyTimer(0)
 {
   SetInputChannelConnections(0, NInChannels(), true);
   SetOutputChannelConnections(0, NOutChannels(), true);
@@ -236,6 +237,11 @@ tresult PLUGIN_API IPlugVST3::initialize (FUnknown* context)
     }
   }
 
+  if (result == kResultOk && !mLatencyTimer)
+  {
+    mLatencyTimer = Timer::create(this, 50);
+  }
+
   OnHostIdentified();
   RestorePreset(0);
   
@@ -247,6 +253,13 @@ tresult PLUGIN_API IPlugVST3::terminate ()
   TRACE;
 
   viewsArray.removeAll();
+
+  if (mLatencyTimer)
+  {
+    mLatencyTimer->release();
+    mLatencyTimer = 0;
+  }
+
   return SingleComponentEffect::terminate();
 }
 
@@ -349,8 +362,7 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
   {
     int32 numParamsChanged = paramChanges->getParameterCount();
 
-    //it is possible to get a finer resolution of control here by retrieving more values (points) from the queue
-    //for now we just grab the last one
+    //unless the plugin asked for sample accurate parameters, we just grab the last value (point) from the queue
 
     for (int32 i = 0; i < numParamsChanged; i++)
     {
@@ -360,6 +372,19 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
         int32 numPoints = paramQueue->getPointCount();
         int32 offsetSamples;
         double value;
+        int paramIdx = paramQueue->getParameterId();
+
+        if (GetSampleAccurateParams() && paramIdx >= 0 && paramIdx < NParams())
+        {
+          for (int32 j = 0; j < numPoints; j++)
+          {
+            if (paramQueue->getPoint(j, offsetSamples, value) == kResultTrue)
+            {
+              AddParamEvent(offsetSamples, paramIdx, value);
+            }
+          }
+          continue;
+        }
 
         if (paramQueue->getPoint(numPoints - 1,  offsetSamples, value) == kResultTrue)
         {
@@ -379,7 +404,8 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
               break;
             }
             case kPresetParam:
-              RestorePreset(FromNormalizedParam(value, 0, NPresets(), 1.));
+              // Restored from setParamNormalized() on the controller side, loading a preset
+              // (chunks, OnParamReset(), redraws) is not something to do on the audio thread.
               break;
               //TODO pitch bend, modwheel etc
             default:
@@ -387,7 +413,7 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
               {
                 GetParam(idx)->SetNormalized((double)value);
                 if (GetGUI()) GetGUI()->SetParameterFromPlug(idx, (double)value, true);
-                OnParamChange(idx);
+                HandleParamChange(idx);
               }
               break;
           }
@@ -646,7 +672,7 @@ IPlugView* PLUGIN_API IPlugVST3::createView (const char* name)
 tresult PLUGIN_API IPlugVST3::setEditorState(IBStream* state)
 {
   TRACE;
-  WDL_MutexLock lock(&mMutex);
+  IMutexLock lock(this);
 
   ByteChunk chunk;
   SerializeState(&chunk); // to get the size
@@ -675,7 +701,7 @@ tresult PLUGIN_API IPlugVST3::setEditorState(IBStream* state)
 tresult PLUGIN_API IPlugVST3::getEditorState(IBStream* state)
 {
   TRACE;
-  WDL_MutexLock lock(&mMutex);
+  IMutexLock lock(this);
 
   ByteChunk chunk;
 
@@ -729,6 +755,11 @@ ParamValue PLUGIN_API IPlugVST3::getParamNormalized(ParamID tag)
 
 tresult PLUGIN_API IPlugVST3::setParamNormalized(ParamID tag, ParamValue value)
 {
+  if (tag == kPresetParam)
+  {
+    return RestorePreset(FromNormalizedParam(value, 0, NPresets(), 1.)) ? kResultOk : kResultFalse;
+  }
+
   IParam* param = GetParam(tag);
 
   if (param)
@@ -972,7 +1003,10 @@ void IPlugVST3::SetLatency(int latency)
   IPlugBase::SetLatency(latency);
 
   FUnknownPtr<IComponentHandler>handler(componentHandler);
-  handler->restartComponent(kLatencyChanged);  
+  if (handler) // not connected yet when called from the plugin constructor
+  {
+    handler->restartComponent(kLatencyChanged);
+  }
 }
 
 void IPlugVST3::PopupHostContextMenuForParam(int param, int x, int y)
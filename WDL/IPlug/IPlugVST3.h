@@ -8,6 +8,7 @@
 #include "pluginterfaces/vst/ivstprocesscontext.h"
 #include "pluginterfaces/vst/vsttypes.h"
 #include "pluginterfaces/vst/ivstcontextmenu.h"
+#include "base/source/timer.h"
 //#include "IMidiQueue.h"
 
 struct IPlugInstanceInfo
@@ -23,6 +24,7 @@ class IPlugVST3View;
 class IPlugVST3 : public IPlugBase
                 , public IUnitInfo
                 , public SingleComponentEffect
+                , public ITimerCallback
 {
 public:
   IPlugVST3(IPlugInstanceInfo instanceInfo,
@@ -99,6 +101,9 @@ public:
 
   void PopupHostContextMenuForParam(int param, int x, int y);
 
+  // ITimerCallback, a main thread tick for ReportLatencyChange() that doesn't depend on the editor being open
+  void onTimer(Timer* timer);
+
   // DumpFactoryPresets("/Users/oli/Desktop/",  GUID_DATA1, GUID_DATA2, GUID_DATA3, GUID_DATA4);
 //  void DumpFactoryPresets(const char* path, int a, int b, int c, int d);  // TODO
 
@@ -136,6 +141,7 @@ private:
 
   int mScChans;
   bool mSidechainActive;
+  Timer* mLatencyTimer;
 //  IMidiQueue mMidiOutputQueue;
   ProcessContext mProcessContext;
   TArray <IPlugVST3View*> viewsArray;
@@ -33,10 +33,18 @@
   #include "IPlugStandalone.h"
   typedef IPlugStandalone IPlug;
   #define API_EXT "standalone"
+#elif defined HEADLESS_API
+  #include "IPlugHeadless.h"
+  typedef IPlugHeadless IPlug;
+  #define API_EXT "headless"
 #else
   #error "No API defined!"
 #endif
 
+#ifdef HEADLESS_API
+  #include "IGraphicsHeadless.h"
+#endif
+
 #ifdef OS_WIN
   #include "IGraphicsWin.h"
   #ifdef __MINGW32__
@@ -52,7 +60,7 @@
   #define EXPORT __attribute__ ((visibility("default")))
   #define BUNDLE_ID "com." BUNDLE_MFR "." API_EXT "." BUNDLE_NAME
 #elif defined OS_LINUX
-  //TODO
+  #define EXPORT __attribute__ ((visibility("default")))
 #endif
 
 #endif // _IPLUG_INCLUDE_HDR_
@@ -4,7 +4,12 @@
 // Include this file in the main source for your plugin,
 // after #including the main header for your plugin.
 
-#if defined OS_WIN
+#if defined HEADLESS_API
+  IGraphics* MakeGraphics(IPlug* pPlug, int w, int h, int FPS = 0)
+  {
+    return new IGraphicsHeadless(pPlug, w, h, FPS);
+  }
+#elif defined OS_WIN
   HINSTANCE gHInstance = 0;
   #if defined(VST_API) || defined(AAX_API) //TODO check
   #ifdef __MINGW32__
@@ -188,6 +193,15 @@ END_FACTORY
       instanceInfo.mIOSLink = (IOSLink*) ioslink;
     #endif
 
+    return new PLUG_CLASS_NAME(instanceInfo);
+  }
+#elif defined HEADLESS_API
+  IPlug* MakePlug()
+  {
+    static WDL_Mutex sMutex;
+    WDL_MutexLock lock(&sMutex);
+    IPlugInstanceInfo instanceInfo;
+
     return new PLUG_CLASS_NAME(instanceInfo);
   }
 
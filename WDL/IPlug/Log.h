@@ -21,6 +21,10 @@
 #elif defined __APPLE__ // TODO: check on ios
   #define SYS_THREAD_ID (intptr_t) pthread_self()
   #define DBGMSG(...) printf(__VA_ARGS__)
+#elif defined OS_LINUX
+  #include <pthread.h>
+  #define SYS_THREAD_ID (intptr_t) pthread_self()
+  #define DBGMSG(...) printf(__VA_ARGS__)
 #else
   #error "No OS defined!"
 #endif
@@ -19,13 +19,25 @@ public:
   
   ~NChanDelayLine() {}
   
+  // Doesn't allocate for delay times up to the last Reserve().
   void SetDelayTime(int delayTimeSamples)
   {
     mDTSamples = delayTimeSamples;
-    mBuffer.Resize(mNumInChans * delayTimeSamples);
+    mBuffer.Resize(mNumInChans * delayTimeSamples, false);
     mWriteAddress = 0;
     ClearBuffer();
   }
+
+  int GetDelayTime() const { return mDTSamples; }
+
+  // Not while ProcessBlock() may be running.
+  void Reserve(int maxDelayTimeSamples)
+  {
+    if (mBuffer.GetSize() < (int) mNumInChans * maxDelayTimeSamples)
+    {
+      mBuffer.Resize(mNumInChans * maxDelayTimeSamples, false);
+    }
+  }
   
   void ClearBuffer()
   {
@@ -0,0 +1,295 @@
+#ifndef _SMOOTHEDPARAMBANK_
+#define _SMOOTHEDPARAMBANK_
+
+/*
+
+SmoothedParamBank de-zippers any number of parameters a whole block at a
+time, instead of calling a one pole filter like CParamSmooth::process() once
+per sample per parameter.
+
+Both ramp modes have a closed form, so a block is just
+out[i] = base + scale * table[i]:
+
+  kRampExponential  the CParamSmooth one pole, table[i] = a^(i+1). Tables are
+                    shared between parameters with the same smoothing time.
+  kRampLinear       reaches the target in exactly timeMs, table[i] = i+1.
+
+That inner loop is done with SSE2 where available. Parameters that have
+settled are skipped, their buffer is filled with the final value once.
+
+When IPlugBase oversamples, the ramps are computed at the host rate and
+Upsample() interpolates them up to the oversampled block, so changing the
+factor doesn't change the coefficients (or allocate).
+
+IPlugBase owns one bank, see IPlugBase::SetParamSmoothing() and
+IPlugBase::GetSmoothedParam().
+
+*/
+
+#include <math.h>
+#include "../heapbuf.h"
+#include "../ptrlist.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SMOOTHEDPARAMBANK_SSE2
+#endif
+
+class SmoothedParamBank
+{
+public:
+  enum ERampMode { kRampExponential, kRampLinear };
+
+  SmoothedParamBank() : mSampleRate(44100.), mBlockSize(0) {}
+  ~SmoothedParamBank() { mParams.Empty(true); mTables.Empty(true); }
+
+  // Everything up to SetSmoothing() allocates, don't call these from the audio thread.
+  void Resize(int nParams)
+  {
+    while (mParams.GetSize() > nParams) mParams.Delete(mParams.GetSize() - 1, true);
+    while (mParams.GetSize() < nParams) mParams.Add(new SmoothedParam);
+  }
+
+  void SetSampleRate(double sampleRate)
+  {
+    mSampleRate = sampleRate;
+    UpdateCoefficients();
+  }
+
+  void SetBlockSize(int blockSize)
+  {
+    mBlockSize = blockSize;
+
+    mRamp.Resize(blockSize);
+    double* pRamp = mRamp.Get();
+    for (int i = 0; i < blockSize; ++i) pRamp[i] = (double) (i + 1);
+
+    for (int i = 0; i < mParams.GetSize(); ++i)
+    {
+      SmoothedParam* pParam = mParams.Get(i);
+      if (pParam->mEnabled)
+      {
+        pParam->mBuf.Resize(blockSize);
+        pParam->mBufFilled = false;
+      }
+    }
+    UpdateCoefficients();
+  }
+
+  // timeMs <= 0 disables smoothing for the parameter. settleThreshold is in
+  // parameter units: once within it of the target the ramp snaps to the target.
+  void SetSmoothing(int idx, double timeMs, ERampMode mode = kRampExponential, double settleThreshold = 1e-6)
+  {
+    SmoothedParam* pParam = mParams.Get(idx);
+    if (!pParam) return;
+
+    pParam->mEnabled = (timeMs > 0.);
+    pParam->mMode = mode;
+    pParam->mTimeMs = timeMs;
+    pParam->mThreshold = settleThreshold;
+    pParam->mBuf.Resize(pParam->mEnabled ? mBlockSize : 0);
+    pParam->mBufFilled = false;
+
+    mEnabled.Resize(0);
+    for (int i = 0; i < mParams.GetSize(); ++i)
+    {
+      if (mParams.Get(i)->mEnabled) mEnabled.Add(i);
+    }
+    UpdateCoefficients();
+  }
+
+  // Jumps straight to value.
+  void SetValue(int idx, double value)
+  {
+    SmoothedParam* pParam = mParams.Get(idx);
+    pParam->mValue = pParam->mTarget = value;
+    pParam->mRampRemaining = 0;
+    pParam->mSettled = true;
+    pParam->mBufFilled = false;
+  }
+
+  void SetTarget(int idx, double target)
+  {
+    SmoothedParam* pParam = mParams.Get(idx);
+    if (target == pParam->mTarget) return;
+
+    pParam->mTarget = target;
+    pParam->mSettled = false;
+    pParam->mBufFilled = false;
+
+    if (pParam->mMode == kRampLinear)
+    {
+      pParam->mRampRemaining = pParam->mRampLength;
+      pParam->mStep = (target - pParam->mValue) / (double) pParam->mRampLength;
+    }
+  }
+
+  // Computes the next nFrames (<= block size) values of every enabled parameter.
+  void ProcessBlock(int nFrames)
+  {
+    if (nFrames <= 0) return;
+
+    const int* pIdx = mEnabled.Get();
+
+    for (int e = 0; e < mEnabled.GetSize(); ++e)
+    {
+      SmoothedParam* pParam = mParams.Get(pIdx[e]);
+      double* pOut = pParam->mBuf.Get();
+
+      if (pParam->mSettled)
+      {
+        if (!pParam->mBufFilled)
+        {
+          for (int i = 0; i < mBlockSize; ++i) pOut[i] = pParam->mValue;
+          pParam->mBufFilled = true;
+        }
+        continue;
+      }
+
+      pParam->mBlockStart = pParam->mValue;
+
+      if (pParam->mMode == kRampExponential)
+      {
+        double target = pParam->mTarget;
+        Ramp(pOut, target, pParam->mValue - target, pParam->mPow, nFrames);
+        pParam->mValue = pOut[nFrames - 1];
+
+        if (fabs(pParam->mValue - target) < pParam->mThreshold)
+        {
+          pParam->mValue = target;
+          pParam->mSettled = true;
+        }
+      }
+      else
+      {
+        int n = (pParam->mRampRemaining < nFrames ? pParam->mRampRemaining : nFrames);
+        Ramp(pOut, pParam->mValue, pParam->mStep, mRamp.Get(), n);
+        for (int i = n; i < nFrames; ++i) pOut[i] = pParam->mTarget;
+
+        pParam->mRampRemaining -= n;
+        pParam->mValue = (pParam->mRampRemaining ? pOut[n - 1] : pParam->mTarget);
+        pParam->mSettled = !pParam->mRampRemaining;
+      }
+    }
+  }
+
+  // Spreads the nFrames values of the last ProcessBlock() linearly over nFrames * factor,
+  // for processing at factor times the sample rate. nFrames * factor must be <= block size.
+  void Upsample(int nFrames, int factor)
+  {
+    const int* pIdx = mEnabled.Get();
+    double r = 1. / (double) factor;
+
+    for (int e = 0; e < mEnabled.GetSize(); ++e)
+    {
+      SmoothedParam* pParam = mParams.Get(pIdx[e]);
+      if (pParam->mBufFilled) continue; // constant
+
+      // Backwards, so the values still to be read are never overwritten.
+      double* pBuf = pParam->mBuf.Get();
+      for (int i = nFrames - 1; i >= 0; --i)
+      {
+        double a = (i ? pBuf[i - 1] : pParam->mBlockStart), d = (pBuf[i] - a) * r;
+        double* pOut = pBuf + i * factor;
+        for (int j = 0; j < factor; ++j) pOut[j] = a + d * (double) (j + 1);
+      }
+    }
+  }
+
+  // The values computed by the last ProcessBlock(), 0 if the parameter isn't smoothed.
+  const double* Get(int idx) const
+  {
+    SmoothedParam* pParam = mParams.Get(idx);
+    return (pParam && pParam->mEnabled ? pParam->mBuf.Get() : 0);
+  }
+
+  double GetValue(int idx) const { return mParams.Get(idx)->mValue; }
+  bool IsEnabled(int idx) const { SmoothedParam* pParam = mParams.Get(idx); return pParam && pParam->mEnabled; }
+  bool IsSettled(int idx) const { return mParams.Get(idx)->mSettled; }
+
+  int NEnabled() const { return mEnabled.GetSize(); }
+  int GetEnabledIdx(int i) const { return mEnabled.Get()[i]; }
+
+private:
+  struct SmoothedParam
+  {
+    bool mEnabled, mSettled, mBufFilled;
+    ERampMode mMode;
+    double mTimeMs, mThreshold;
+    double mValue, mTarget, mStep, mBlockStart;
+    int mRampLength, mRampRemaining;
+    const double* mPow;
+    WDL_TypedBuf<double> mBuf;
+
+    SmoothedParam()
+      : mEnabled(false), mSettled(true), mBufFilled(false), mMode(kRampExponential)
+      , mTimeMs(0.), mThreshold(1e-6), mValue(0.), mTarget(0.), mStep(0.), mBlockStart(0.)
+      , mRampLength(1), mRampRemaining(0), mPow(0) {}
+  };
+
+  // a^(i+1) for i < block size, for one exponential smoothing time.
+  struct PowTable
+  {
+    double mCoeff;
+    WDL_TypedBuf<double> mPow;
+  };
+
+  // pOut[i] = base + scale * pTable[i]
+  static void Ramp(double* pOut, double base, double scale, const double* pTable, int n)
+  {
+    int i = 0;
+#ifdef SMOOTHEDPARAMBANK_SSE2
+    __m128d b = _mm_set1_pd(base), s = _mm_set1_pd(scale);
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128d t0 = _mm_loadu_pd(pTable + i), t1 = _mm_loadu_pd(pTable + i + 2);
+      _mm_storeu_pd(pOut + i, _mm_add_pd(b, _mm_mul_pd(s, t0)));
+      _mm_storeu_pd(pOut + i + 2, _mm_add_pd(b, _mm_mul_pd(s, t1)));
+    }
+#endif
+    for (; i < n; ++i) pOut[i] = base + scale * pTable[i];
+  }
+
+  void UpdateCoefficients()
+  {
+    mTables.Empty(true);
+
+    for (int e = 0; e < mEnabled.GetSize(); ++e)
+    {
+      SmoothedParam* pParam = mParams.Get(mEnabled.Get()[e]);
+      double nSamples = pParam->mTimeMs * 0.001 * mSampleRate;
+
+      pParam->mRampLength = (nSamples < 1. ? 1 : (int) (nSamples + 0.5));
+      pParam->mPow = 0;
+      if (pParam->mMode != kRampExponential) continue;
+
+      // Same coefficient as CParamSmooth.
+      double a = exp(-6.283185307179586476925286766559 / (nSamples > 0. ? nSamples : 1.));
+      PowTable* pTable = 0;
+      for (int t = 0; t < mTables.GetSize() && !pTable; ++t)
+      {
+        if (mTables.Get(t)->mCoeff == a) pTable = mTables.Get(t);
+      }
+
+      if (!pTable)
+      {
+        pTable = mTables.Add(new PowTable);
+        pTable->mCoeff = a;
+        pTable->mPow.Resize(mBlockSize);
+        double* pPow = pTable->mPow.Get();
+        double p = 1.;
+        for (int i = 0; i < mBlockSize; ++i) pPow[i] = (p *= a);
+      }
+      pParam->mPow = pTable->mPow.Get();
+    }
+  }
+
+  double mSampleRate;
+  int mBlockSize;
+  WDL_PtrList<SmoothedParam> mParams;
+  WDL_PtrList<PowTable> mTables;
+  WDL_TypedBuf<int> mEnabled;
+  WDL_TypedBuf<double> mRamp;
+};
+
+#endif // _SMOOTHEDPARAMBANK_
@@ -0,0 +1,349 @@
+#ifndef _WAVETABLEBANK_
+#define _WAVETABLEBANK_
+
+/*
+
+WavetableBank holds one single cycle waveform as a set of band-limited
+tables, one per octave. Level 0 has the most harmonics, each level above it
+has half as many, so for any pitch GetLevel() picks the fullest table whose
+highest harmonic still stays below nyquist, and a saw played at 5kHz doesn't
+alias like a naive table does.
+
+The levels are made with WDL_real_fft: the spectrum of the cycle (computed
+for the built in shapes, transformed for a custom one) is cut off above the
+level's last harmonic and transformed back. Levels that would come out the
+same (a sine has nothing to cut) share their table. A table has guard points
+on both sides, so lookups never wrap and never mask.
+
+Building a bank is slow and allocates. WavetableCache keeps one bank per
+shape and size for the whole process, banks are read only once built, so
+every instance and voice can read them without locking:
+
+// constructor
+mBank = WavetableCache::Acquire(WavetableBank::kWaveSaw);
+
+// per voice, when the pitch changes
+const float* pTable = mBank->GetTable(mBank->GetLevel(phaseIncr));
+
+// per sample, phase between 0 and 1
+out = WavetableBank::Read(pTable, phase * mBank->GetSizeF(), WavetableBank::kInterpCubic);
+
+// destructor
+WavetableCache::Release(mBank);
+
+Read4() does the same for four oscillators at once with SSE2, each with its
+own table, phase and interpolation order.
+
+Needs fft.c compiled in.
+
+*/
+
+#include <math.h>
+#include <string.h>
+#include "../fft.h"
+#include "../heapbuf.h"
+#include "../ptrlist.h"
+#include "../mutex.h"
+#include "../wdlstring.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define WAVETABLEBANK_SSE2
+#endif
+
+class WavetableBank
+{
+public:
+  enum EWaveform { kWaveSine, kWaveSaw, kWaveSquare, kWaveTriangle, kWaveCustom };
+  enum EInterp { kInterpLinear, kInterpCubic };
+  enum { kDefaultSize = 2048, kMinSize = 16, kMaxSize = 32768, kGuardBefore = 1, kGuardAfter = 3, kMaxLevels = 16 };
+
+  // size is rounded up to a power of 2 between kMinSize and kMaxSize.
+  WavetableBank(EWaveform shape, int size = kDefaultSize) : mShape(shape)
+  {
+    InitSize(size);
+    WDL_FFT_REAL* pSpectrum = mSpectrum.Resize(mSize);
+    memset(pSpectrum, 0, mSize * sizeof(WDL_FFT_REAL));
+    const int nHarmonics = mSize / 2;
+    const double pi = 3.1415926535897932384626433832795;
+
+    // Sine phase series, each harmonic h of amplitude a goes in as sin(2 pi h t) * a.
+    for (int h = 1; h < nHarmonics; ++h)
+    {
+      double a = 0.;
+      switch (shape)
+      {
+        case kWaveSine: a = h == 1 ? 1. : 0.; break;
+        case kWaveSaw: a = (h & 1 ? 2. : -2.) / (pi * h); break;
+        case kWaveSquare: a = h & 1 ? 4. / (pi * h) : 0.; break;
+        case kWaveTriangle: a = h & 1 ? ((h & 3) == 1 ? 8. : -8.) / (pi * pi * h * h) : 0.; break;
+        default: break;
+      }
+      if (a != 0.) SetBin(h, 0., -0.5 * a);
+    }
+    Build();
+  }
+
+  // One cycle of size samples (a power of 2, kMinSize to kMaxSize), whatever amplitude and DC it has is kept.
+  WavetableBank(const double* pCycle, int size) : mShape(kWaveCustom)
+  {
+    InitSize(size);
+    WDL_FFT_REAL* pSpectrum = mSpectrum.Resize(mSize);
+    for (int i = 0; i < mSize; ++i) pSpectrum[i] = (WDL_FFT_REAL) (i < size ? pCycle[i] : 0.);
+    WDL_real_fft(pSpectrum, mSize, 0);
+
+    // Scaled so the inverse transform gives the cycle back at its own amplitude.
+    const WDL_FFT_REAL scale = (WDL_FFT_REAL) (1. / mSize);
+    for (int i = 0; i < mSize; ++i) pSpectrum[i] *= scale;
+    pSpectrum[1] = 0.; // nyquist can't be interpolated
+    Build();
+  }
+
+  ~WavetableBank() {}
+
+  EWaveform GetShape() const { return mShape; }
+  int GetSize() const { return mSize; }
+  float GetSizeF() const { return (float) mSize; }
+  int GetNumLevels() const { return mNumLevels; }
+
+  // The level to play at phaseIncr (frequency / sample rate). Its highest harmonic is below nyquist, and above
+  // nyquist / 2 unless that is more than level 0 holds (GetSize() / 4 harmonics) or the waveform has nothing there.
+  int GetLevel(double phaseIncr) const
+  {
+    // Level k holds mSize / 4 >> k harmonics, so it is alias free while mSize * phaseIncr / 2 <= 2^k.
+    double x = fabs(phaseIncr) * (double) mSize * 0.5;
+    int level = 0;
+    if (x > 1.)
+    {
+      frexp(x, &level);
+      if (ldexp(1., level - 1) >= x) --level;
+    }
+    return level < mNumLevels ? level : mNumLevels - 1;
+  }
+
+  // GetSize() samples, readable from index -kGuardBefore to GetSize() + kGuardAfter - 1.
+  const float* GetTable(int level) const
+  {
+    return mTables.Get() + mLevelOffset[level] + kGuardBefore;
+  }
+
+  // pos is phase * GetSizeF(), from 0 to GetSizeF().
+  static inline float Read(const float* pTable, float pos, int interp)
+  {
+    const int i = (int) pos;
+    const float f = pos - (float) i;
+    const float* p = pTable + i;
+    if (interp == kInterpCubic)
+    {
+      // 4 point, 3rd order Hermite
+      const float c = (p[1] - p[-1]) * 0.5f;
+      const float v = p[0] - p[1];
+      const float w = c + v;
+      const float a = w + v + (p[2] - p[0]) * 0.5f;
+      const float b = w + a;
+      return ((a * f - b) * f + c) * f + p[0];
+    }
+    return p[0] + (p[1] - p[0]) * f;
+  }
+
+#ifdef WAVETABLEBANK_SSE2
+  // Read() for four oscillators, lane l reads pTables[l] at pos[l]. cubicMask has all bits set in the lanes that
+  // use kInterpCubic. Every lane loads its four points in one go, the weights decide which of them count.
+  static inline __m128 Read4(const float* const* pTables, __m128 pos, __m128 cubicMask)
+  {
+    __m128i xi = _mm_cvttps_epi32(pos);
+    __m128 f = _mm_sub_ps(pos, _mm_cvtepi32_ps(xi));
+    int idx[4];
+    _mm_storeu_si128((__m128i*) idx, xi);
+
+    __m128 xm1 = _mm_loadu_ps(pTables[0] + idx[0] - 1);
+    __m128 x0 = _mm_loadu_ps(pTables[1] + idx[1] - 1);
+    __m128 x1 = _mm_loadu_ps(pTables[2] + idx[2] - 1);
+    __m128 x2 = _mm_loadu_ps(pTables[3] + idx[3] - 1);
+    _MM_TRANSPOSE4_PS(xm1, x0, x1, x2);
+
+    const __m128 half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.f), onehalf = _mm_set1_ps(1.5f);
+    const __m128 two = _mm_set1_ps(2.f), twohalf = _mm_set1_ps(2.5f);
+    __m128 f2 = _mm_mul_ps(f, f);
+
+    // Catmull-Rom weights, the same curve as Read()
+    __m128 cm1 = _mm_mul_ps(f, _mm_sub_ps(_mm_mul_ps(f, _mm_sub_ps(one, _mm_mul_ps(half, f))), half));
+    __m128 c0 = _mm_add_ps(one, _mm_mul_ps(f2, _mm_sub_ps(_mm_mul_ps(onehalf, f), twohalf)));
+    __m128 c1 = _mm_mul_ps(f, _mm_add_ps(half, _mm_mul_ps(f, _mm_sub_ps(two, _mm_mul_ps(onehalf, f)))));
+    __m128 c2 = _mm_mul_ps(f2, _mm_mul_ps(half, _mm_sub_ps(f, one)));
+
+    // Linear lanes get 0, 1 - f, f, 0
+    cm1 = _mm_and_ps(cubicMask, cm1);
+    c0 = _mm_or_ps(_mm_and_ps(cubicMask, c0), _mm_andnot_ps(cubicMask, _mm_sub_ps(one, f)));
+    c1 = _mm_or_ps(_mm_and_ps(cubicMask, c1), _mm_andnot_ps(cubicMask, f));
+    c2 = _mm_and_ps(cubicMask, c2);
+
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(xm1, cm1), _mm_mul_ps(x0, c0)),
+                      _mm_add_ps(_mm_mul_ps(x1, c1), _mm_mul_ps(x2, c2)));
+  }
+#endif
+
+private:
+  EWaveform mShape;
+  int mSize, mNumLevels;
+  int mLevelOffset[kMaxLevels];
+  WDL_TypedBuf<float> mTables;
+  WDL_TypedBuf<WDL_FFT_REAL> mSpectrum; // only while building
+
+  void InitSize(int size)
+  {
+    mSize = kMinSize;
+    while (mSize < size && mSize < kMaxSize) mSize *= 2;
+    mNumLevels = 0;
+    WDL_fft_init();
+  }
+
+  void SetBin(int h, double re, double im)
+  {
+    WDL_FFT_COMPLEX* pBin = (WDL_FFT_COMPLEX*) mSpectrum.Get() + WDL_fft_permute(mSize / 2, h);
+    pBin->re = (WDL_FFT_REAL) re;
+    pBin->im = (WDL_FFT_REAL) im;
+  }
+
+  int HighestHarmonic()
+  {
+    const WDL_FFT_COMPLEX* pBins = (const WDL_FFT_COMPLEX*) mSpectrum.Get();
+    for (int h = mSize / 2 - 1; h > 0; --h)
+    {
+      const WDL_FFT_COMPLEX* pBin = pBins + WDL_fft_permute(mSize / 2, h);
+      if (pBin->re != 0. || pBin->im != 0.) return h;
+    }
+    return 0;
+  }
+
+  // mSpectrum in, one table per level out.
+  void Build()
+  {
+    const int stride = mSize + kGuardBefore + kGuardAfter;
+    const int top = HighestHarmonic();
+    int nTables = 0, last = -1;
+
+    mNumLevels = 0;
+    for (int nHarmonics = mSize / 4; nHarmonics >= 1 && mNumLevels < kMaxLevels; nHarmonics /= 2)
+    {
+      const int h = nHarmonics < top ? nHarmonics : top;
+      if (h != last) ++nTables;
+      mLevelOffset[mNumLevels++] = (nTables - 1) * stride;
+      last = h;
+    }
+
+    float* pTables = mTables.Resize(nTables * stride);
+    WDL_TypedBuf<WDL_FFT_REAL> work;
+    WDL_FFT_REAL* pWork = work.Resize(mSize);
+
+    last = -1;
+    for (int level = 0, nHarmonics = mSize / 4; level < mNumLevels; ++level, nHarmonics /= 2)
+    {
+      const int h = nHarmonics < top ? nHarmonics : top;
+      if (h == last) continue;
+      last = h;
+
+      memcpy(pWork, mSpectrum.Get(), mSize * sizeof(WDL_FFT_REAL));
+      WDL_FFT_COMPLEX* pBins = (WDL_FFT_COMPLEX*) pWork;
+      for (int k = h + 1; k < mSize / 2; ++k)
+      {
+        WDL_FFT_COMPLEX* pBin = pBins + WDL_fft_permute(mSize / 2, k);
+        pBin->re = pBin->im = 0.;
+      }
+      pWork[1] = 0.;
+      WDL_real_fft(pWork, mSize, 1);
+
+      float* pTable = pTables + mLevelOffset[level] + kGuardBefore;
+      for (int i = 0; i < mSize; ++i) pTable[i] = (float) pWork[i];
+      for (int i = 1; i <= kGuardBefore; ++i) pTable[-i] = pTable[mSize - i];
+      for (int i = 0; i < kGuardAfter; ++i) pTable[mSize + i] = pTable[i];
+    }
+
+    mSpectrum.Resize(0, false);
+  }
+};
+
+// One bank per shape and size (or per name, for custom cycles) for the whole process. Acquire() builds the bank the
+// first time, under a lock, so call it from the constructor rather than the audio thread. A bank is freed when the
+// last Release() for it comes in.
+class WavetableCache
+{
+public:
+  static const WavetableBank* Acquire(WavetableBank::EWaveform shape, int size = WavetableBank::kDefaultSize)
+  {
+    return Find(shape, size, 0, 0);
+  }
+
+  // A custom cycle is built the first time its name is asked for, later calls with the same name and size share it.
+  static const WavetableBank* Acquire(const char* name, const double* pCycle, int size)
+  {
+    return Find(WavetableBank::kWaveCustom, size, name, pCycle);
+  }
+
+  static void Release(const WavetableBank* pBank)
+  {
+    if (!pBank) return;
+    WDL_MutexLock lock(GetMutex());
+    WDL_PtrList<Entry>* pEntries = GetEntries();
+    for (int i = 0; i < pEntries->GetSize(); ++i)
+    {
+      Entry* pEntry = pEntries->Get(i);
+      if (pEntry->mBank == pBank)
+      {
+        if (!--pEntry->mRefs)
+        {
+          delete pEntry->mBank;
+          pEntries->Delete(i, true);
+        }
+        return;
+      }
+    }
+  }
+
+private:
+  struct Entry
+  {
+    WavetableBank* mBank;
+    int mShape, mSize, mRefs;
+    WDL_String mName;
+  };
+
+  // Function statics, so the header is all there is to it.
+  static WDL_Mutex* GetMutex()
+  {
+    static WDL_Mutex sMutex;
+    return &sMutex;
+  }
+
+  static WDL_PtrList<Entry>* GetEntries()
+  {
+    static WDL_PtrList<Entry> sEntries;
+    return &sEntries;
+  }
+
+  static const WavetableBank* Find(int shape, int size, const char* name, const double* pCycle)
+  {
+    WDL_MutexLock lock(GetMutex());
+    WDL_PtrList<Entry>* pEntries = GetEntries();
+    for (int i = 0; i < pEntries->GetSize(); ++i)
+    {
+      Entry* pEntry = pEntries->Get(i);
+      if (pEntry->mShape == shape && pEntry->mSize == size && (!name || !strcmp(pEntry->mName.Get(), name)))
+      {
+        ++pEntry->mRefs;
+        return pEntry->mBank;
+      }
+    }
+
+    Entry* pEntry = new Entry;
+    pEntry->mBank = name ? new WavetableBank(pCycle, size) : new WavetableBank((WavetableBank::EWaveform) shape, size);
+    pEntry->mShape = shape;
+    pEntry->mSize = size;
+    pEntry->mRefs = 1;
+    if (name) pEntry->mName.Set(name);
+    pEntries->Add(pEntry);
+    return pEntry->mBank;
+  }
+};
+
+#endif
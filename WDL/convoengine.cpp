@@ -23,6 +23,9 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sched.h>
+#include <errno.h>
 #endif
 #include <math.h>
 #include <stdio.h>
@@ -38,11 +41,18 @@
 #define CONVOENGINE_SILENCE_THRESH 1.0e-12 // -240dB
 #define CONVOENGINE_IMPULSE_SILENCE_THRESH 1.0e-15 // -300dB
 
+#ifndef WDL_CONVO_SPLIT_COMPLEX
 static void WDL_CONVO_CplxMul2(WDL_FFT_COMPLEX *c, WDL_FFT_COMPLEX *a, WDL_CONVO_IMPULSEBUFCPLXf *b, int n)
 {
   WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
   if (n<2 || (n&1)) return;
 
+  if (sizeof(WDL_CONVO_IMPULSEBUFf)==sizeof(WDL_FFT_REAL)) // same layout, use the SIMD version
+  {
+    WDL_fft_complexmul2(c,a,(WDL_FFT_COMPLEX*)b,n);
+    return;
+  }
+
   do {
     t1 = a[0].re * b[0].re;
     t2 = a[0].im * b[0].im;
@@ -70,6 +80,12 @@ static void WDL_CONVO_CplxMul3(WDL_FFT_COMPLEX *c, WDL_FFT_COMPLEX *a, WDL_CONVO
   WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
   if (n<2 || (n&1)) return;
 
+  if (sizeof(WDL_CONVO_IMPULSEBUFf)==sizeof(WDL_FFT_REAL)) // same layout, use the SIMD version
+  {
+    WDL_fft_complexmul3(c,a,(WDL_FFT_COMPLEX*)b,n);
+    return;
+  }
+
   do {
     t1 = a[0].re * b[0].re;
     t2 = a[0].im * b[0].im;
@@ -92,32 +108,139 @@ static void WDL_CONVO_CplxMul3(WDL_FFT_COMPLEX *c, WDL_FFT_COMPLEX *a, WDL_CONVO
     c += 2;
   } while (n -= 2);
 }
+#endif
 
-static bool CompareQueueToBuf(WDL_FastQueue *q, const void *data, int len)
+#ifdef WDL_CONVO_SPLIT_COMPLEX
+
+// n reals of WDL_real_fft() output, rearranged to n/2 real parts followed by n/2 imaginary parts.
+// re[0] is the DC bin and im[0] the nyquist bin, both real.
+static void WDL_CONVO_ToSplit(WDL_FFT_REAL *buf, WDL_FFT_REAL *tmp, int n)
 {
-  int offs=0;
-  while (len>0)
-  {
-    void *td=NULL;
-    int sz=q->GetPtr(offs,&td);
-    if (sz<1) return true; // not enough data = not equal!
-    if (sz>len) sz=len;
-    
-    int i=sz/sizeof(WDL_FFT_REAL);
-    WDL_FFT_REAL *a1=(WDL_FFT_REAL*)td;
-    WDL_FFT_REAL *b1=(WDL_FFT_REAL*)data;
-    while (i--) 
+  const int h=n/2;
+  int i;
+  for (i = 0; i < h; i ++)
+  {
+    tmp[i]=buf[i*2];
+    tmp[h+i]=buf[i*2+1];
+  }
+  memcpy(buf,tmp,n*sizeof(WDL_FFT_REAL));
+}
+static void WDL_CONVO_FromSplit(WDL_FFT_REAL *buf, WDL_FFT_REAL *tmp, int n)
+{
+  const int h=n/2;
+  int i;
+  for (i = 0; i < h; i ++)
+  {
+    tmp[i*2]=buf[i];
+    tmp[i*2+1]=buf[h+i];
+  }
+  memcpy(buf,tmp,n*sizeof(WDL_FFT_REAL));
+}
+
+static void WDL_CONVO_SplitMul(WDL_FFT_REAL *c, WDL_FFT_REAL *a, WDL_CONVO_IMPULSEBUFf *b, int n, bool add)
+{
+  const int h=n/2;
+  const WDL_FFT_REAL dc = (add ? c[0] : 0) + a[0] * b[0], ny = (add ? c[h] : 0) + a[h] * b[h];
+
+  if (sizeof(WDL_CONVO_IMPULSEBUFf)==sizeof(WDL_FFT_REAL))
+  {
+    const WDL_FFT_REAL *bf=(const WDL_FFT_REAL *)b;
+    if (add) WDL_fft_splitmul3(c,c+h,a,a+h,bf,bf+h,h);
+    else WDL_fft_splitmul2(c,c+h,a,a+h,bf,bf+h,h);
+  }
+  else
+  {
+    int i;
+    for (i = 0; i < h; i ++)
+    {
+      WDL_FFT_REAL re = a[i] * b[i] - a[h+i] * b[h+i], im = a[i] * b[h+i] + a[h+i] * b[i];
+      if (add) { re += c[i]; im += c[h+i]; }
+      c[i] = re;
+      c[h+i] = im;
+    }
+  }
+  c[0] = dc;
+  c[h] = ny;
+}
+static void WDL_CONVO_RealMul2(WDL_FFT_REAL *c, WDL_FFT_REAL *a, WDL_CONVO_IMPULSEBUFf *b, int n)
+{
+  WDL_CONVO_SplitMul(c,a,b,n,false);
+}
+static void WDL_CONVO_RealMul3(WDL_FFT_REAL *c, WDL_FFT_REAL *a, WDL_CONVO_IMPULSEBUFf *b, int n)
+{
+  WDL_CONVO_SplitMul(c,a,b,n,true);
+}
+
+#else
+
+// n reals of WDL_real_fft() output: [0] and [1] are the real DC and nyquist bins, the rest n/2-1 complex bins
+static void WDL_CONVO_RealMul2(WDL_FFT_REAL *c, WDL_FFT_REAL *a, WDL_CONVO_IMPULSEBUFf *b, int n)
+{
+  const WDL_FFT_REAL dc = a[0] * b[0], ny = a[1] * b[1];
+  WDL_CONVO_CplxMul2((WDL_FFT_COMPLEX*)c,(WDL_FFT_COMPLEX*)a,(WDL_CONVO_IMPULSEBUFCPLXf*)b,n/2);
+  c[0] = dc;
+  c[1] = ny;
+}
+static void WDL_CONVO_RealMul3(WDL_FFT_REAL *c, WDL_FFT_REAL *a, WDL_CONVO_IMPULSEBUFf *b, int n)
+{
+  const WDL_FFT_REAL dc = c[0] + a[0] * b[0], ny = c[1] + a[1] * b[1];
+  WDL_CONVO_CplxMul3((WDL_FFT_COMPLEX*)c,(WDL_FFT_COMPLEX*)a,(WDL_CONVO_IMPULSEBUFCPLXf*)b,n/2);
+  c[0] = dc;
+  c[1] = ny;
+}
+
+#endif
+
+
+// pout[x] += sum of imp[j]*psrc[x-imp_len+1+j], imp is time reversed and psrc has imp_len-1 samples of history before it
+static void WDL_CONVO_BruteAdd(WDL_FFT_REAL *pout, WDL_FFT_REAL *psrc, WDL_CONVO_IMPULSEBUFf *imp, int imp_len, int len)
+{
+  int x;
+  int len1 = len&~1;
+  for (x=0; x < len1 ; x += 2)
+  {
+    int i=imp_len;
+    double sum=0.0,sum2=0.0;
+    WDL_FFT_REAL *sp=psrc+x-imp_len + 1;
+    WDL_CONVO_IMPULSEBUFf *ip=imp;
+    int j=i/4; i&=3;
+    while (j--) // produce 2 samples, 4 impulse samples at a time
+    {
+      double a = ip[0],b=ip[1],aa=ip[2],bb=ip[3];
+      double c = sp[1],d=sp[2],cc=sp[3];
+      sum+=a * sp[0] + b * c + aa * d + bb * cc;
+      sum2+=a * c + b * d + aa * cc + bb * sp[4];
+      ip+=4;
+      sp+=4;
+    }
+
+    while (i--)
+    {
+      double a = *ip++;
+      sum+=a * sp[0];
+      sum2+=a * sp[1];
+      sp++;
+    }
+    pout[x]+=(WDL_FFT_REAL) sum;
+    pout[x+1]+=(WDL_FFT_REAL) sum2;
+  }
+  for(;x<len;x++) // any odd samples left
+  {
+    int i=imp_len;
+    double sum=0.0;
+    WDL_FFT_REAL *sp=psrc+x-imp_len + 1;
+    WDL_CONVO_IMPULSEBUFf *ip=imp;
+    int j=i/4; i&=3;
+    while (j--)
     {
-      if (fabs(*a1-*b1)>CONVOENGINE_SILENCE_THRESH) return true;
-      a1++;
-      b1++;
+      sum+=ip[0] * sp[0] + ip[1] * sp[1] + ip[2] * sp[2] + ip[3] * sp[3];
+      ip+=4;
+      sp+=4;
     }
 
-    data = ((char *)data)+sz;
-    offs+=sz;
-    len-=sz;
+    while (i--) sum+=*ip++ * *sp++;
+    pout[x]+=(WDL_FFT_REAL) sum;
   }
-  return false;
 }
 
 
@@ -125,29 +248,58 @@ WDL_ConvolutionEngine::WDL_ConvolutionEngine()
 {
   WDL_fft_init();
   m_impulse_nch=1;
+  m_matrix_in_nch=m_matrix_out_nch=0;
   m_fft_size=0;
   m_impulse_len=0;
-  m_proc_nch=0;
+  m_proc_nch=m_out_nch=0;
+  m_hist_pos=0;
 }
 
 WDL_ConvolutionEngine::~WDL_ConvolutionEngine()
 {
+  m_impulses.Empty(true);
+  m_chans.Empty(true);
 }
 
 int WDL_ConvolutionEngine::SetImpulse(WDL_ImpulseBuffer *impulse, int fft_size, int impulse_sample_offset, int max_imp_size, bool forceBrute)
+{
+  return SetImpulseInt(impulse,NULL,fft_size,impulse_sample_offset,max_imp_size,forceBrute);
+}
+
+int WDL_ConvolutionEngine::SetImpulseMatrix(WDL_ImpulseMatrix *impulses, int fft_size, int impulse_sample_offset, int max_imp_size, bool forceBrute)
+{
+  return SetImpulseInt(NULL,impulses,fft_size,impulse_sample_offset,max_imp_size,forceBrute);
+}
+
+int WDL_ConvolutionEngine::SetImpulseInt(WDL_ImpulseBuffer *impulse, WDL_ImpulseMatrix *matrix, int fft_size, int impulse_sample_offset, int max_imp_size, bool forceBrute)
 {
   int impulse_len=0;
   int x;
-  int nch=impulse->GetNumChannels();
+  WDL_PtrList<WDL_TypedBuf<WDL_FFT_REAL> > srcs; // matrix impulses are in*out, in major
+  if (matrix)
+  {
+    int i,o;
+    for (i = 0; i < matrix->GetInChannels(); i ++)
+      for (o = 0; o < matrix->GetOutChannels(); o ++)
+        srcs.Add(matrix->Get(i,o));
+  }
+  else
+  {
+    for (x = 0; x < impulse->GetNumChannels(); x ++) srcs.Add(&impulse->impulses[x]);
+  }
+
+  int nch=srcs.GetSize();
   for (x = 0; x < nch; x ++)
   {
-    int l=impulse->impulses[x].GetSize()-impulse_sample_offset;
+    int l=srcs.Get(x)->GetSize()-impulse_sample_offset;
     if (max_imp_size && l>max_imp_size) l=max_imp_size;
     if (impulse_len < l) impulse_len=l;
   }
   m_impulse_nch=nch;
+  m_matrix_in_nch=matrix ? matrix->GetInChannels() : 0;
+  m_matrix_out_nch=matrix ? matrix->GetOutChannels() : 0;
 
-  if (m_impulse_nch>1) // detect mono signals pretending to be multichannel
+  if (!matrix && m_impulse_nch>1) // detect mono signals pretending to be multichannel
   {
     for (x = 1; x < m_impulse_nch; x ++)
     {
@@ -159,6 +311,9 @@ int WDL_ConvolutionEngine::SetImpulse(WDL_ImpulseBuffer *impulse, int fft_size,
     if (x >= m_impulse_nch) m_impulse_nch=1;
   }
 
+  while (m_impulses.GetSize() > m_impulse_nch) m_impulses.Delete(m_impulses.GetSize()-1,true);
+  while (m_impulses.GetSize() < m_impulse_nch) m_impulses.Add(new ImpulseBlocks);
+
   m_impulse_len=impulse_len;
   m_proc_nch=-1;
 
@@ -170,25 +325,28 @@ int WDL_ConvolutionEngine::SetImpulse(WDL_ImpulseBuffer *impulse, int fft_size,
     // save impulse
     for (x = 0; x < m_impulse_nch; x ++)
     {
-      WDL_FFT_REAL *imp=impulse->impulses[x].Get()+impulse_sample_offset;
-      int lenout=impulse->impulses[x].GetSize()-impulse_sample_offset;  
+      WDL_FFT_REAL *imp=srcs.Get(x)->Get()+impulse_sample_offset;
+      int lenout=srcs.Get(x)->GetSize()-impulse_sample_offset;
       if (max_imp_size && lenout>max_imp_size) lenout=max_imp_size;
+      if (lenout<0) lenout=0;
 
-      WDL_CONVO_IMPULSEBUFf *impout=m_impulse[x].Resize(lenout)+lenout;
+      WDL_CONVO_IMPULSEBUFf *impout=m_impulses.Get(x)->buf.Resize(lenout)+lenout;
       while (lenout-->0) *--impout = (WDL_CONVO_IMPULSEBUFf) *imp++;
     }
 
-    for (x = 0; x < WDL_CONVO_MAX_PROC_NCH; x ++)
+    for (x = 0; x < m_chans.GetSize(); x ++)
     {
-      m_samplesin[x].Clear();
-      m_samplesin2[x].Clear();
-      m_samplesout[x].Clear();
+      ProcChannel *c=m_chans.Get(x);
+      c->samplesin.Clear();
+      c->samplesin2.Clear();
+      c->samplesout.Clear();
     }
 
+    if (matrix) SetProcChannels(m_matrix_in_nch,m_matrix_out_nch);
     return 0;
   }
 
- 
+
   if (fft_size<=0)
   {
     int msz=fft_size<=-16? -fft_size*2 : 32768;
@@ -206,19 +364,19 @@ int WDL_ConvolutionEngine::SetImpulse(WDL_ImpulseBuffer *impulse, int fft_size,
   //OutputDebugString(buf);
 
   const bool smallerSizeMode=sizeof(WDL_CONVO_IMPULSEBUFf)!=sizeof(WDL_FFT_REAL);
- 
+
   WDL_FFT_REAL scale=(WDL_FFT_REAL) (1.0/fft_size);
   for (x = 0; x < m_impulse_nch; x ++)
   {
-    WDL_FFT_REAL *imp=impulse->impulses[x].Get()+impulse_sample_offset;
+    WDL_FFT_REAL *imp=srcs.Get(x)->Get()+impulse_sample_offset;
+    ImpulseBlocks *dest=m_impulses.Get(x);
 
-    WDL_FFT_REAL *imp2=x < m_impulse_nch-1 ? impulse->impulses[x+1].Get()+impulse_sample_offset : NULL;
-
-    WDL_CONVO_IMPULSEBUFf *impout=m_impulse[x].Resize((nblocks+!!smallerSizeMode)*fft_size*2);
-    char *zbuf=m_impulse_zflag[x].Resize(nblocks);
-    int lenout=impulse->impulses[x].GetSize()-impulse_sample_offset;  
+    WDL_CONVO_IMPULSEBUFf *impout=dest->buf.Resize((nblocks+!!smallerSizeMode)*fft_size);
+    char *zbuf=dest->zflag.Resize(nblocks);
+    int lenout=srcs.Get(x)->GetSize()-impulse_sample_offset;
     if (max_imp_size && lenout>max_imp_size) lenout=max_imp_size;
-      
+    bool any=false;
+
     int bl;
     for (bl = 0; bl < nblocks; bl ++)
     {
@@ -227,9 +385,8 @@ int WDL_ConvolutionEngine::SetImpulse(WDL_ImpulseBuffer *impulse, int fft_size,
       if (thissz > impchunksize) thissz=impchunksize;
 
       lenout -= thissz;
-      int i=0;    
+      int i=0;
       WDL_FFT_REAL mv=0.0;
-      WDL_FFT_REAL mv2=0.0;
       WDL_FFT_REAL *imptmp = (WDL_FFT_REAL *)impout; //-V615
 
       for (; i < thissz; i ++)
@@ -238,147 +395,180 @@ int WDL_ConvolutionEngine::SetImpulse(WDL_ImpulseBuffer *impulse, int fft_size,
         WDL_FFT_REAL v2=(WDL_FFT_REAL)fabs(v);
         if (v2 > mv) mv=v2;
 
-        imptmp[i*2]=denormal_filter_aggressive(v * scale);
-
-        if (imp2)
-        {
-          v=*imp2++;
-          v2=(WDL_FFT_REAL)fabs(v);
-          if (v2>mv2) mv2=v2;
-          imptmp[i*2+1]=denormal_filter_aggressive(v*scale);
-        }
-        else imptmp[i*2+1]=0.0;
+        imptmp[i]=denormal_filter_aggressive(v * scale);
       }
       for (; i < fft_size; i ++)
       {
-        imptmp[i*2]=0.0;
-        imptmp[i*2+1]=0.0;
+        imptmp[i]=0.0;
       }
-      if (mv>CONVOENGINE_IMPULSE_SILENCE_THRESH||mv2>CONVOENGINE_IMPULSE_SILENCE_THRESH)
+      if (mv>CONVOENGINE_IMPULSE_SILENCE_THRESH)
       {
-        *zbuf++=mv>CONVOENGINE_IMPULSE_SILENCE_THRESH ? 2 : 1; // 1 means only second channel has content
-        WDL_fft((WDL_FFT_COMPLEX*)impout,fft_size,0);
+        *zbuf++=1;
+        any=true;
+        WDL_real_fft(imptmp,fft_size,0);
+#ifdef WDL_CONVO_SPLIT_COMPLEX
+        WDL_CONVO_ToSplit(imptmp,m_combinebuf.Resize(fft_size),fft_size);
+#endif
 
         if (smallerSizeMode)
         {
-          int x,n=fft_size*2;
+          int x,n=fft_size;
           for(x=0;x<n;x++) impout[x]=(WDL_CONVO_IMPULSEBUFf)imptmp[x];
         }
       }
       else *zbuf++=0;
 
-      impout+=fft_size*2;
+      impout+=fft_size;
+    }
+
+    if (!any) // silent, no need to multiply by it
+    {
+      dest->buf.Resize(0);
+      dest->zflag.Resize(0);
     }
   }
+
+  if (matrix) SetProcChannels(m_matrix_in_nch,m_matrix_out_nch);
   return m_fft_size/2;
 }
 
+WDL_ConvolutionEngine::ImpulseBlocks *WDL_ConvolutionEngine::GetImpulseFor(int in_ch, int out_ch)
+{
+  ImpulseBlocks *imp;
+  if (m_matrix_in_nch) imp=m_impulses.Get(in_ch*m_matrix_out_nch+out_ch);
+  else imp=in_ch==out_ch && m_impulse_nch>0 ? m_impulses.Get(in_ch%m_impulse_nch) : NULL;
+  return imp && imp->buf.GetSize() ? imp : NULL;
+}
+
+// (re)allocates per channel state, existing channels keep their queued samples and new ones are aligned to them
+void WDL_ConvolutionEngine::SetProcChannels(int in_nch, int out_nch)
+{
+  const int chunksize=m_fft_size/2;
+  const int nblocks=m_fft_size>0 ? (m_impulse_len+chunksize-1)/chunksize : 0;
+  const bool passthrough=m_fft_size>0 && (m_impulse_len<1||!nblocks);
+  int x, mi=0, mo=0;
+  for (x = 0; x < m_chans.GetSize(); x ++)
+  {
+    ProcChannel *c=m_chans.Get(x);
+    if (c->samplesin.Available()>mi) mi=c->samplesin.Available();
+    if (c->samplesout.Available()>mo) mo=c->samplesout.Available();
+  }
+
+  while (m_chans.GetSize() < wdl_max(in_nch,out_nch)) m_chans.Add(new ProcChannel);
+  m_get_tmpptrs.Resize(m_chans.GetSize());
+
+  m_proc_nch=in_nch;
+  m_out_nch=out_nch;
+  m_hist_pos=0;
+
+  for (x = 0; x < m_chans.GetSize(); x ++)
+  {
+    ProcChannel *c=m_chans.Get(x);
+    if (x>=in_nch)
+    {
+      c->samplesin.Clear();
+      c->samplesin2.Clear();
+    }
+    else if (c->samplesin.Available() < mi) c->samplesin.Add(NULL,mi-c->samplesin.Available());
+
+    if (x>=out_nch) c->samplesout.Clear();
+    else
+    {
+      int so=c->samplesout.Available();
+      if (so < mo) memset(c->samplesout.Add(NULL,mo-so),0,mo-so);
+
+      if (passthrough && mi>0)
+      {
+        void *buf=c->samplesout.Add(NULL,mi);
+        if (x<in_nch && !m_matrix_in_nch) c->samplesin.GetToBuf(0,buf,mi);
+        else memset(buf,0,mi);
+      }
+    }
+    if (passthrough) c->samplesin.Clear();
+
+    memset(c->samplehist_zflag.Resize(nblocks),0,nblocks);
+    c->samplehist.Resize(x<in_nch ? nblocks*m_fft_size : 0);
+    c->overlaphist.Resize(x<out_nch && m_fft_size>0 ? m_fft_size/2 : 0);
+    memset(c->samplehist.Get(),0,c->samplehist.GetSize()*sizeof(WDL_FFT_REAL));
+    memset(c->overlaphist.Get(),0,c->overlaphist.GetSize()*sizeof(WDL_FFT_REAL));
+  }
+}
+
 
 void WDL_ConvolutionEngine::Reset() // clears out any latent samples
 {
   int x;
-  memset(m_hist_pos,0,sizeof(m_hist_pos));
-  for (x = 0; x < WDL_CONVO_MAX_PROC_NCH; x ++)
+  m_hist_pos=0;
+  for (x = 0; x < m_chans.GetSize(); x ++)
   {
-    m_samplesin[x].Clear();
-    m_samplesin2[x].Clear();
-    m_samplesout[x].Clear();
-    memset(m_samplehist_zflag[x].Get(),0,m_samplehist_zflag[x].GetSize());
-    memset(m_samplehist[x].Get(),0,m_samplehist[x].GetSize()*sizeof(WDL_FFT_REAL));
-    memset(m_overlaphist[x].Get(),0,m_overlaphist[x].GetSize()*sizeof(WDL_FFT_REAL));
+    ProcChannel *c=m_chans.Get(x);
+    c->samplesin.Clear();
+    c->samplesin2.Clear();
+    c->samplesout.Clear();
+    memset(c->samplehist_zflag.Get(),0,c->samplehist_zflag.GetSize());
+    memset(c->samplehist.Get(),0,c->samplehist.GetSize()*sizeof(WDL_FFT_REAL));
+    memset(c->overlaphist.Get(),0,c->overlaphist.GetSize()*sizeof(WDL_FFT_REAL));
   }
 }
 
 void WDL_ConvolutionEngine::Add(WDL_FFT_REAL **bufs, int len, int nch)
 {
+  if (m_matrix_in_nch)
+  {
+    if (m_proc_nch != m_matrix_in_nch) SetProcChannels(m_matrix_in_nch,m_matrix_out_nch);
+  }
+  else if (m_proc_nch != nch) SetProcChannels(nch,nch);
+
+  int ch;
   if (m_fft_size<1)
   {
-    int ch;
-    m_proc_nch=nch;
-    for (ch = 0; ch < nch; ch ++)
+    int max_len=0;
+    for (ch = 0; ch < m_impulses.GetSize(); ch ++)
     {
-      int wch=ch;
-      if (wch >=m_impulse_nch) wch-=m_impulse_nch;
-      WDL_CONVO_IMPULSEBUFf *imp=m_impulse[wch].Get();
-      int imp_len = m_impulse[wch].GetSize();
-
+      int l=m_impulses.Get(ch)->buf.GetSize();
+      if (l>max_len) max_len=l;
+    }
 
-      if (imp_len>0) 
+    if (max_len>0) for (ch = 0; ch < m_proc_nch; ch ++)
+    {
+      WDL_Queue *hist=&m_chans.Get(ch)->samplesin2;
+      if (hist->Available()<max_len*(int)sizeof(WDL_FFT_REAL))
       {
-        if (m_samplesin2[ch].Available()<imp_len*(int)sizeof(WDL_FFT_REAL)) 
-        {
-          int sza=imp_len*sizeof(WDL_FFT_REAL)-m_samplesin2[ch].Available();
-          memset(m_samplesin2[ch].Add(NULL,sza),0,sza);
-        }
-        WDL_FFT_REAL *psrc;
-        
-        if (bufs && bufs[ch])
-          psrc=(WDL_FFT_REAL*)m_samplesin2[ch].Add(bufs[ch],len*sizeof(WDL_FFT_REAL));
-        else
-        {
-          psrc=(WDL_FFT_REAL*)m_samplesin2[ch].Add(NULL,len*sizeof(WDL_FFT_REAL));
-          memset(psrc,0,len*sizeof(WDL_FFT_REAL));
-        }
-
-        WDL_FFT_REAL *pout=(WDL_FFT_REAL*)m_samplesout[ch].Add(NULL,len*sizeof(WDL_FFT_REAL));
-        int x;
-        int len1 = len&~1;
-        for (x=0; x < len1 ; x += 2)
-        {
-          int i=imp_len;
-          double sum=0.0,sum2=0.0;
-          WDL_FFT_REAL *sp=psrc+x-imp_len + 1;
-          WDL_CONVO_IMPULSEBUFf *ip=imp;
-          int j=i/4; i&=3;
-          while (j--) // produce 2 samples, 4 impulse samples at a time
-          {
-            double a = ip[0],b=ip[1],aa=ip[2],bb=ip[3];
-            double c = sp[1],d=sp[2],cc=sp[3];
-            sum+=a * sp[0] + b * c + aa * d + bb * cc;
-            sum2+=a * c + b * d + aa * cc + bb * sp[4];
-            ip+=4;
-            sp+=4;
-          }
-
-          while (i--)
-          {
-            double a = *ip++;
-            sum+=a * sp[0];
-            sum2+=a * sp[1];
-            sp++;
-          }
-          pout[x]=(WDL_FFT_REAL) sum;
-          pout[x+1]=(WDL_FFT_REAL) sum2;
-        }
-        for(;x<len;x++) // any odd samples left
-        {
-          int i=imp_len;
-          double sum=0.0;
-          WDL_FFT_REAL *sp=psrc+x-imp_len + 1;
-          WDL_CONVO_IMPULSEBUFf *ip=imp;
-          int j=i/4; i&=3;
-          while (j--)
-          {
-            sum+=ip[0] * sp[0] + ip[1] * sp[1] + ip[2] * sp[2] + ip[3] * sp[3];
-            ip+=4;
-            sp+=4;
-          }
-
-          while (i--) sum+=*ip++ * *sp++;
-          pout[x]=(WDL_FFT_REAL) sum;
-        }
-        m_samplesin2[ch].Advance(len*sizeof(WDL_FFT_REAL));
-        m_samplesin2[ch].Compact();
+        int sza=max_len*sizeof(WDL_FFT_REAL)-hist->Available();
+        memset(hist->Add(NULL,sza),0,sza);
       }
+
+      if (bufs && ch<nch && bufs[ch])
+        hist->Add(bufs[ch],len*sizeof(WDL_FFT_REAL));
       else
+        memset(hist->Add(NULL,len*sizeof(WDL_FFT_REAL)),0,len*sizeof(WDL_FFT_REAL));
+    }
+
+    for (ch = 0; ch < m_out_nch; ch ++)
+    {
+      WDL_FFT_REAL *pout=(WDL_FFT_REAL*)m_chans.Get(ch)->samplesout.Add(NULL,len*sizeof(WDL_FFT_REAL));
+      memset(pout,0,len*sizeof(WDL_FFT_REAL));
+
+      bool used=false;
+      int in_ch;
+      for (in_ch = 0; in_ch < m_proc_nch; in_ch ++)
       {
-        if (bufs && bufs[ch]) m_samplesout[ch].Add(bufs[ch],len*sizeof(WDL_FFT_REAL));
-        else
-        {
-          memset(m_samplesout[ch].Add(NULL,len*sizeof(WDL_FFT_REAL)),0,len*sizeof(WDL_FFT_REAL));
-        }
+        ImpulseBlocks *imp=GetImpulseFor(in_ch,ch);
+        if (!imp) continue;
+
+        WDL_Queue *hist=&m_chans.Get(in_ch)->samplesin2;
+        WDL_FFT_REAL *psrc=(WDL_FFT_REAL*)hist->Get() + hist->Available()/sizeof(WDL_FFT_REAL) - len;
+        WDL_CONVO_BruteAdd(pout,psrc,imp->buf.Get(),imp->buf.GetSize(),len);
+        used=true;
       }
+      if (!used && !m_matrix_in_nch && bufs && ch<nch && bufs[ch]) memcpy(pout,bufs[ch],len*sizeof(WDL_FFT_REAL)); // no impulse, pass through
+    }
 
+    if (max_len>0) for (ch = 0; ch < m_proc_nch; ch ++)
+    {
+      WDL_Queue *hist=&m_chans.Get(ch)->samplesin2;
+      hist->Advance(len*sizeof(WDL_FFT_REAL));
+      hist->Compact();
     }
     return;
   }
@@ -387,315 +577,183 @@ void WDL_ConvolutionEngine::Add(WDL_FFT_REAL **bufs, int len, int nch)
   int impchunksize=m_fft_size/2;
   int nblocks=(m_impulse_len+impchunksize-1)/impchunksize;
 
-  if (m_proc_nch != nch)
-  {
-    m_proc_nch=nch;
-    memset(m_hist_pos,0,sizeof(m_hist_pos));
-    int x;
-    int mso=0;
-    for (x = 0; x < WDL_CONVO_MAX_PROC_NCH; x ++)
-    {
-      int so=m_samplesin[x].Available() + m_samplesout[x].Available();
-      if (so>mso) mso=so;
-
-      if (x>=nch)
-      {
-        m_samplesin[x].Clear();
-        m_samplesout[x].Clear();
-      }
-      else 
-      {
-        if (m_impulse_len<1||!nblocks) 
-        {
-          if (m_samplesin[x].Available())
-          {
-            int s=m_samplesin[x].Available();
-            void *buf=m_samplesout[x].Add(NULL,s);
-            m_samplesin[x].GetToBuf(0,buf,s);
-            m_samplesin[x].Clear();
-          }
-        }
-
-        if (so < mso)
-        {
-          memset(m_samplesout[x].Add(NULL,mso-so),0,mso-so);
-        }
-      }
-      
-      int sz=0;
-      if (x<nch) sz=nblocks*m_fft_size;
-
-      memset(m_samplehist_zflag[x].Resize(nblocks),0,nblocks);
-      m_samplehist[x].Resize(sz*2);
-      m_overlaphist[x].Resize(x<nch ? m_fft_size/2 : 0);
-      memset(m_samplehist[x].Get(),0,m_samplehist[x].GetSize()*sizeof(WDL_FFT_REAL));
-      memset(m_overlaphist[x].Get(),0,m_overlaphist[x].GetSize()*sizeof(WDL_FFT_REAL));
-    }
-  }
-
-  int ch;
-  if (m_impulse_len<1||!nblocks) 
+  if (m_impulse_len<1||!nblocks)
   {
-    for (ch = 0; ch < nch; ch ++)
+    for (ch = 0; ch < m_out_nch; ch ++)
     {
-      if (bufs && bufs[ch])
-        m_samplesout[ch].Add(bufs[ch],len*sizeof(WDL_FFT_REAL));
+      WDL_Queue *q=&m_chans.Get(ch)->samplesout;
+      if (bufs && ch<nch && bufs[ch] && !m_matrix_in_nch)
+        q->Add(bufs[ch],len*sizeof(WDL_FFT_REAL));
       else
-        memset(m_samplesout[ch].Add(NULL,len*sizeof(WDL_FFT_REAL)),0,len*sizeof(WDL_FFT_REAL));
+        memset(q->Add(NULL,len*sizeof(WDL_FFT_REAL)),0,len*sizeof(WDL_FFT_REAL));
     }
     // pass through
     return;
   }
 
-  for (ch = 0; ch < nch; ch ++)
+  for (ch = 0; ch < m_proc_nch; ch ++)
   {
-    if (!m_samplehist[ch].GetSize()||!m_overlaphist[ch].GetSize()) continue;
-
-    m_samplesin[ch].Add(bufs ? bufs[ch] : NULL,len*sizeof(WDL_FFT_REAL));
-
+    m_chans.Get(ch)->samplesin.Add(bufs && ch<nch ? bufs[ch] : NULL,len*sizeof(WDL_FFT_REAL));
   }
 }
 
 void WDL_ConvolutionEngine::AddSilenceToOutput(int len, int nch)
-{  
+{
   int x;
-  for(x=0;x<nch&&x<m_proc_nch;x++)
+  for(x=0;x<nch&&x<m_out_nch;x++)
   {
-    memset(m_samplesout[x].Add(NULL,len*sizeof(WDL_FFT_REAL)),0,len*sizeof(WDL_FFT_REAL));
+    memset(m_chans.Get(x)->samplesout.Add(NULL,len*sizeof(WDL_FFT_REAL)),0,len*sizeof(WDL_FFT_REAL));
   }
 }
 
 int WDL_ConvolutionEngine::Avail(int want)
 {
+  if (m_out_nch<1) return 0;
   if (m_fft_size<1)
   {
-    return m_samplesout[0].Available()/sizeof(WDL_FFT_REAL);
+    return m_chans.Get(0)->samplesout.Available()/sizeof(WDL_FFT_REAL);
   }
 
   const int sz=m_fft_size/2;
   const int chunksize=m_fft_size/2;
   const int nblocks=(m_impulse_len+chunksize-1)/chunksize;
   // clear combining buffer
-  WDL_FFT_REAL *workbuf2 = m_combinebuf.Resize(m_fft_size*4); // temp space
+  WDL_FFT_REAL *workbuf2 = m_combinebuf.Resize(m_fft_size*2); // temp space
 
   int ch;
 
-  for (ch = 0; ch < m_proc_nch; ch ++)
+  // all channels are fed the same number of samples, so channel 0 can tell when a block is ready
+  ProcChannel *chan0=m_chans.Get(0);
+  while (nblocks>0 && m_proc_nch>0 &&
+         chan0->samplesin.Available()/(int)sizeof(WDL_FFT_REAL) >= sz &&
+         chan0->samplesout.Available() < want*(int)sizeof(WDL_FFT_REAL))
   {
-    if (!m_samplehist[ch].GetSize()||!m_overlaphist[ch].GetSize()) continue;
-    int srcc=ch;
-    if (srcc>=m_impulse_nch) srcc=m_impulse_nch-1;
-
-    bool allow_mono_input_mode=true;
-    bool mono_impulse_mode=false;
-
-    if (m_impulse_nch==1 && ch<m_proc_nch-1 && 
-        m_samplehist[ch+1].GetSize()&&m_overlaphist[ch+1].GetSize() &&
-        m_samplesin[ch].Available()==m_samplesin[ch+1].Available() &&
-        m_samplesout[ch].Available()==m_samplesout[ch+1].Available()
-        )
-    { // 2x processing mode
-      mono_impulse_mode=true;
-      allow_mono_input_mode=false;
-    }
-
+    int histpos;
+    if ((histpos=++m_hist_pos) >= nblocks) histpos=m_hist_pos=0;
 
-    const int in_needed=sz;
-
-    // useSilentList[x] = 1 for mono signal, 2 for stereo, 0 for silent
-    char *useSilentList=m_samplehist_zflag[ch].GetSize()==nblocks ? m_samplehist_zflag[ch].Get() : NULL;
-    while (m_samplesin[ch].Available()/(int)sizeof(WDL_FFT_REAL) >= sz && 
-           m_samplesout[ch].Available() < want*(int)sizeof(WDL_FFT_REAL))
+    // FFT each input block once, every output it feeds reuses it
+    for (ch = 0; ch < m_proc_nch; ch ++)
     {
-      int histpos;
-      if ((histpos=++m_hist_pos[ch]) >= nblocks) histpos=m_hist_pos[ch]=0;
-
-      // get samples from input, to history
-      WDL_FFT_REAL *optr = m_samplehist[ch].Get()+histpos*m_fft_size*2;   
+      ProcChannel *c=m_chans.Get(ch);
 
-      m_samplesin[ch].GetToBuf(0,optr+sz,in_needed*sizeof(WDL_FFT_REAL));
-      m_samplesin[ch].Advance(in_needed*sizeof(WDL_FFT_REAL));
+      // useSilentList[x] = 1 for signal, 0 for silent
+      char *useSilentList=c->samplehist_zflag.GetSize()==nblocks ? c->samplehist_zflag.Get() : NULL;
 
+      // get samples from input, to history
+      WDL_FFT_REAL *optr = c->samplehist.Get()+histpos*m_fft_size;
 
-      bool mono_input_mode=false;
+      c->samplesin.GetToBuf(0,optr,sz*sizeof(WDL_FFT_REAL));
+      c->samplesin.Advance(sz*sizeof(WDL_FFT_REAL));
 
       bool nonzflag=false;
-      if (mono_impulse_mode)
-      {
-        if (++m_hist_pos[ch+1] >= nblocks) m_hist_pos[ch+1]=0;
-        m_samplesin[ch+1].GetToBuf(0,workbuf2,sz*sizeof(WDL_FFT_REAL));
-        m_samplesin[ch+1].Advance(sz*sizeof(WDL_FFT_REAL));
-        int i;
-        for (i = 0; i < sz; i ++) // unpack samples
-        {
-          WDL_FFT_REAL f = optr[i*2]=denormal_filter_aggressive(optr[sz+i]);
-          if (!nonzflag && (f<-CONVOENGINE_SILENCE_THRESH || f>CONVOENGINE_SILENCE_THRESH)) nonzflag=true;
-          f=optr[i*2+1]=denormal_filter_aggressive(workbuf2[i]);
-          if (!nonzflag && (f<-CONVOENGINE_SILENCE_THRESH || f>CONVOENGINE_SILENCE_THRESH)) nonzflag=true;
-        }
-      }
-      else
-      {
-        if (allow_mono_input_mode && 
-          ch < m_proc_nch-1 && 
-          srcc<m_impulse_nch-1 && 
-          !CompareQueueToBuf(&m_samplesin[ch+1],optr+sz,sz*sizeof(WDL_FFT_REAL))
-          )
-        {
-          mono_input_mode=true;
-        }
-        else 
-        {
-          allow_mono_input_mode=false;
-        }
-
-        int i;
-        for (i = 0; i < sz; i ++) // unpack samples
-        {
-          WDL_FFT_REAL f=optr[i*2]=denormal_filter_aggressive(optr[sz+i]);
-          optr[i*2+1]=0.0;
-          if (!nonzflag && (f<-CONVOENGINE_SILENCE_THRESH || f>CONVOENGINE_SILENCE_THRESH)) nonzflag=true;
-        }
-      }
-
       int i;
-      for (i = 1; mono_input_mode && i < nblocks; i ++) // start @ 1, since hist[histpos] is no longer used for here
+      for (i = 0; i < sz; i ++)
       {
-        int srchistpos = histpos-i;
-        if (srchistpos < 0) srchistpos += nblocks;
-        if (!useSilentList || useSilentList[srchistpos]==2) mono_input_mode=false;
+        WDL_FFT_REAL f=optr[i]=denormal_filter_aggressive(optr[i]);
+        if (!nonzflag && (f<-CONVOENGINE_SILENCE_THRESH || f>CONVOENGINE_SILENCE_THRESH)) nonzflag=true;
       }
 
-      if (nonzflag||!useSilentList) memset(optr+sz*2,0,sz*2*sizeof(WDL_FFT_REAL));
+      if (nonzflag||!useSilentList) memset(optr+sz,0,sz*sizeof(WDL_FFT_REAL));
 
 
 #ifdef WDLCONVO_ZL_ACCOUNTING
       m_zl_fftcnt++;
 #endif
 
-      if (nonzflag) WDL_fft((WDL_FFT_COMPLEX*)optr,m_fft_size,0);
-
-      if (useSilentList) useSilentList[histpos]=nonzflag ? (mono_input_mode ? 1 : 2) : 0;
-    
-      int mzfl=2;
-      if (mono_input_mode)
+      if (nonzflag)
       {
-        mzfl=1;
-
-        m_samplesin[ch+1].Advance(sz*sizeof(WDL_FFT_REAL));
-
-        // save a valid copy in sample hist incase we switch from mono to stereo
-        if (++m_hist_pos[ch+1] >= nblocks) m_hist_pos[ch+1]=0;
-        WDL_FFT_REAL *optr2 = m_samplehist[ch+1].Get()+m_hist_pos[ch+1]*m_fft_size*2;   
-        memcpy(optr2,optr,m_fft_size*2*sizeof(WDL_FFT_REAL));
+        WDL_real_fft(optr,m_fft_size,0);
+#ifdef WDL_CONVO_SPLIT_COMPLEX
+        WDL_CONVO_ToSplit(optr,workbuf2+m_fft_size,m_fft_size);
+#endif
       }
 
+      if (useSilentList) useSilentList[histpos]=nonzflag ? 1 : 0;
+    }
+
+    for (ch = 0; ch < m_out_nch; ch ++)
+    {
+      ProcChannel *c=m_chans.Get(ch);
       int applycnt=0;
-      char *useImpSilentList=m_impulse_zflag[srcc].GetSize() == nblocks ? m_impulse_zflag[srcc].Get() : NULL;
 
-      WDL_CONVO_IMPULSEBUFf *impulseptr=m_impulse[srcc].Get();
-      for (i = 0; i < nblocks; i ++, impulseptr+=m_fft_size*2)
+      int in_ch;
+      for (in_ch = 0; in_ch < m_proc_nch; in_ch ++)
       {
-        int srchistpos = histpos-i;
-        if (srchistpos < 0) srchistpos += nblocks;
+        ImpulseBlocks *imp=GetImpulseFor(in_ch,ch);
+        if (!imp) continue;
 
-        if (useImpSilentList && useImpSilentList[i]<mzfl) continue;
-        if (useSilentList && !useSilentList[srchistpos]) continue; // silent block
+        ProcChannel *src=m_chans.Get(in_ch);
+        char *useSilentList=src->samplehist_zflag.GetSize()==nblocks ? src->samplehist_zflag.Get() : NULL;
+        char *useImpSilentList=imp->zflag.GetSize() == nblocks ? imp->zflag.Get() : NULL;
 
-        WDL_FFT_REAL *samplehist=m_samplehist[ch].Get() + m_fft_size*srchistpos*2;
-
-        if (applycnt++) // add to output
-          WDL_CONVO_CplxMul3((WDL_FFT_COMPLEX*)workbuf2,(WDL_FFT_COMPLEX*)samplehist,(WDL_CONVO_IMPULSEBUFCPLXf*)impulseptr,m_fft_size);   
-        else // replace output
-          WDL_CONVO_CplxMul2((WDL_FFT_COMPLEX*)workbuf2,(WDL_FFT_COMPLEX*)samplehist,(WDL_CONVO_IMPULSEBUFCPLXf*)impulseptr,m_fft_size);  
+        WDL_CONVO_IMPULSEBUFf *impulseptr=imp->buf.Get();
+        int i;
+        for (i = 0; i < nblocks; i ++, impulseptr+=m_fft_size)
+        {
+          int srchistpos = histpos-i;
+          if (srchistpos < 0) srchistpos += nblocks;
 
-      }
-      if (!applycnt)
-        memset(workbuf2,0,m_fft_size*2*sizeof(WDL_FFT_REAL));
-      else
-        WDL_fft((WDL_FFT_COMPLEX*)workbuf2,m_fft_size,1);
+          if (useImpSilentList && !useImpSilentList[i]) continue;
+          if (useSilentList && !useSilentList[srchistpos]) continue; // silent block
 
-      WDL_FFT_REAL *olhist=m_overlaphist[ch].Get(); // errors from last time
-      WDL_FFT_REAL *p1=workbuf2,*p3=workbuf2+m_fft_size,*p1o=workbuf2;
+          WDL_FFT_REAL *samplehist=src->samplehist.Get() + m_fft_size*srchistpos;
 
-      if (mono_impulse_mode||mono_input_mode)
-      {
-        WDL_FFT_REAL *p2o=workbuf2+m_fft_size*2;
-        WDL_FFT_REAL *olhist2=m_overlaphist[ch+1].Get(); // errors from last time
-        int s=sz/2;
-        while (s--)
-        {
-          p2o[0] = p1[1]+olhist2[0];
-          p2o[1] = p1[3]+olhist2[1];
-          p1o[0] = p1[0]+olhist[0];
-          p1o[1] = p1[2]+olhist[1];
-          p1o+=2;
-          p2o+=2;
-          p1+=4;
-
-          olhist[0]=p3[0];
-          olhist[1]=p3[2];
-          olhist2[0]=p3[1];
-          olhist2[1]=p3[3];
-          p3+=4;
-
-          olhist+=2;
-          olhist2+=2;
+          if (applycnt++) // add to output
+            WDL_CONVO_RealMul3(workbuf2,samplehist,impulseptr,m_fft_size);
+          else // replace output
+            WDL_CONVO_RealMul2(workbuf2,samplehist,impulseptr,m_fft_size);
         }
-        // add samples to output
-        m_samplesout[ch].Add(workbuf2,sz*sizeof(WDL_FFT_REAL));
-        m_samplesout[ch+1].Add(workbuf2+m_fft_size*2,sz*sizeof(WDL_FFT_REAL));
       }
+      if (!applycnt)
+        memset(workbuf2,0,m_fft_size*sizeof(WDL_FFT_REAL));
       else
       {
-        int s=sz/2;
-        while (s--)
-        {
-          p1o[0] = p1[0]+olhist[0];
-          p1o[1] = p1[2]+olhist[1];
-          p1o+=2;
-          p1+=4;
-
-          olhist[0]=p3[0];
-          olhist[1]=p3[2];
-          p3+=4;
-
-          olhist+=2;
-        }
-        // add samples to output
-        m_samplesout[ch].Add(workbuf2,sz*sizeof(WDL_FFT_REAL));
+#ifdef WDL_CONVO_SPLIT_COMPLEX
+        WDL_CONVO_FromSplit(workbuf2,workbuf2+m_fft_size,m_fft_size);
+#endif
+        WDL_real_fft(workbuf2,m_fft_size,1);
       }
-    } // while available
 
-    if (mono_impulse_mode) ch++;
-  }
+      WDL_FFT_REAL *olhist=c->overlaphist.Get(); // errors from last time
+      WDL_FFT_REAL *p1=workbuf2,*p3=workbuf2+sz;
+      int s=sz;
+      while (s--)
+      {
+        *p1++ += *olhist;
+        *olhist++ = *p3++;
+      }
+      // add samples to output
+      c->samplesout.Add(workbuf2,sz*sizeof(WDL_FFT_REAL));
+    }
+  } // while available
 
   int mv = want;
-  for (ch=0;ch<m_proc_nch;ch++)
+  for (ch=0;ch<m_out_nch;ch++)
   {
-    int v = m_samplesout[ch].Available()/sizeof(WDL_FFT_REAL);
+    int v = m_chans.Get(ch)->samplesout.Available()/sizeof(WDL_FFT_REAL);
     if (!ch || v<mv)mv=v;
   }
   return mv;
 }
 
-WDL_FFT_REAL **WDL_ConvolutionEngine::Get() 
+WDL_FFT_REAL **WDL_ConvolutionEngine::Get()
 {
   int x;
-  for (x = 0; x < m_proc_nch; x ++)
+  for (x = 0; x < m_out_nch; x ++)
   {
-    m_get_tmpptrs[x]=(WDL_FFT_REAL *)m_samplesout[x].Get();
+    m_get_tmpptrs.Get()[x]=(WDL_FFT_REAL *)m_chans.Get(x)->samplesout.Get();
   }
-  return m_get_tmpptrs;
+  return m_get_tmpptrs.Get();
 }
 
 void WDL_ConvolutionEngine::Advance(int len)
 {
   int x;
-  for (x = 0; x < m_proc_nch; x ++)
+  for (x = 0; x < m_out_nch; x ++)
   {
-    m_samplesout[x].Advance(len*sizeof(WDL_FFT_REAL));
-    m_samplesout[x].Compact();
+    WDL_Queue *q=&m_chans.Get(x)->samplesout;
+    q->Advance(len*sizeof(WDL_FFT_REAL));
+    q->Compact();
   }
 }
 
@@ -708,15 +766,29 @@ void WDL_ConvolutionEngine::Advance(int len)
 WDL_ConvolutionEngine_Div::WDL_ConvolutionEngine_Div()
 {
   timingInit();
-  m_proc_nch=2;
+  m_matrix_out_nch=0;
+  m_pool=m_threaded_pool=NULL;
+  m_pool_first=2;
+  SetProcChannels(2);
   m_need_feedsilence=true;
 }
 
 int WDL_ConvolutionEngine_Div::SetImpulse(WDL_ImpulseBuffer *impulse, int maxfft_size, int known_blocksize, int max_imp_size, int impulse_offset, int latency_allowed)
+{
+  return SetImpulseInt(impulse,NULL,maxfft_size,known_blocksize,max_imp_size,impulse_offset,latency_allowed);
+}
+
+int WDL_ConvolutionEngine_Div::SetImpulseMatrix(WDL_ImpulseMatrix *impulses, int maxfft_size, int known_blocksize, int max_imp_size, int impulse_offset, int latency_allowed)
+{
+  return SetImpulseInt(NULL,impulses,maxfft_size,known_blocksize,max_imp_size,impulse_offset,latency_allowed);
+}
+
+int WDL_ConvolutionEngine_Div::SetImpulseInt(WDL_ImpulseBuffer *impulse, WDL_ImpulseMatrix *matrix, int maxfft_size, int known_blocksize, int max_imp_size, int impulse_offset, int latency_allowed)
 {
   m_need_feedsilence=true;
 
   m_engines.Empty(true);
+  ClearThreaded();
   if (maxfft_size<0)maxfft_size=-maxfft_size;
   maxfft_size*=2;
   if (!maxfft_size || maxfft_size>32768) maxfft_size=32768;
@@ -741,9 +813,12 @@ int WDL_ConvolutionEngine_Div::SetImpulse(WDL_ImpulseBuffer *impulse, int maxfft
   }
 
   int offs=0;
-  int samplesleft=impulse->impulses[0].GetSize()-impulse_offset;
+  int samplesleft=(matrix ? matrix->GetLength() : impulse->impulses[0].GetSize())-impulse_offset;
   if (max_imp_size>0 && samplesleft>max_imp_size) samplesleft=max_imp_size;
 
+  m_matrix_out_nch=matrix ? matrix->GetOutChannels() : 0;
+  if (matrix) SetProcChannels(m_matrix_out_nch);
+
   do
   {
     WDL_ConvolutionEngine *eng=new WDL_ConvolutionEngine;
@@ -752,10 +827,25 @@ int WDL_ConvolutionEngine_Div::SetImpulse(WDL_ImpulseBuffer *impulse, int maxfft
     if (impulsechunksize*(wantBrute ? 2 : 3) >= samplesleft) impulsechunksize=samplesleft; // early-out, no point going to a larger FFT (since if we did this, we wouldnt have enough samples for a complete next pass)
     if (fftsize>=maxfft_size) { impulsechunksize=samplesleft; fftsize=maxfft_size; } // if FFTs are as large as possible, finish up
 
-    eng->SetImpulse(impulse,fftsize,offs+impulse_offset,impulsechunksize, wantBrute);
+    // a partition's output is due as soon as its fftsize/2 input block is complete. halving the FFT for threaded
+    // partitions leaves offs-fftsize/2 samples (at least one block) for a pool thread to get it done
+    const bool threaded = m_pool && !wantBrute && offs>0 && m_engines.GetSize()+m_threaded.GetSize() >= m_pool_first;
+    int usefftsize=fftsize;
+    if (threaded) while (usefftsize > offs && usefftsize > 32) usefftsize/=2;
+
+    if (matrix) eng->SetImpulseMatrix(matrix,usefftsize,offs+impulse_offset,impulsechunksize, wantBrute);
+    else eng->SetImpulse(impulse,usefftsize,offs+impulse_offset,impulsechunksize, wantBrute);
     eng->m_zl_delaypos = offs;
     eng->m_zl_dumpage=0;
-    m_engines.Add(eng);
+    if (threaded)
+    {
+      const int bsize=usefftsize/2;
+      WDL_ConvolutionEngine_Threaded *t=new WDL_ConvolutionEngine_Threaded(eng,bsize,offs,3+(known_blocksize>0 ? known_blocksize/bsize : 0));
+      m_threaded.Add(t);
+      m_pool->AddPartition(t);
+      m_threaded_pool=m_pool;
+    }
+    else m_engines.Add(eng);
 
 #ifdef WDLCONVO_ZL_ACCOUNTING
     char buf[512];
@@ -776,15 +866,40 @@ int WDL_ConvolutionEngine_Div::SetImpulse(WDL_ImpulseBuffer *impulse, int maxfft
 #endif
   }
   while (samplesleft > 0);
-  
+
   return GetLatency();
 }
 
+void WDL_ConvolutionEngine_Div::ClearThreaded()
+{
+  int x;
+  for (x = 0; x < m_threaded.GetSize(); x ++)
+  {
+    m_threaded_pool->RemovePartition(m_threaded.Get(x));
+  }
+  m_threaded.Empty(true);
+  m_threaded_pool=NULL;
+}
+
+int WDL_ConvolutionEngine_Div::GetLateBlocks()
+{
+  int x, cnt=0;
+  for (x = 0; x < m_threaded.GetSize(); x ++) cnt+=m_threaded.Get(x)->GetLateBlocks();
+  return cnt;
+}
+
 int WDL_ConvolutionEngine_Div::GetLatency()
 {
   return m_engines.GetSize() ? m_engines.Get(0)->GetLatency() : 0;
 }
 
+void WDL_ConvolutionEngine_Div::SetProcChannels(int nch)
+{
+  m_proc_nch=nch;
+  while (m_samplesout.GetSize() < nch) m_samplesout.Add(new WDL_Queue);
+  if (m_get_tmpptrs.GetSize() < nch) m_get_tmpptrs.Resize(nch);
+}
+
 
 void WDL_ConvolutionEngine_Div::Reset()
 {
@@ -794,9 +909,13 @@ void WDL_ConvolutionEngine_Div::Reset()
     WDL_ConvolutionEngine *eng=m_engines.Get(x);
     eng->Reset();
   }
-  for (x = 0; x < WDL_CONVO_MAX_PROC_NCH; x ++)
+  for (x = 0; x < m_threaded.GetSize(); x ++)
+  {
+    m_threaded.Get(x)->Reset();
+  }
+  for (x = 0; x < m_samplesout.GetSize(); x ++)
   {
-    m_samplesout[x].Clear();
+    m_samplesout.Get(x)->Clear();
   }
 
   m_need_feedsilence=true;
@@ -806,11 +925,13 @@ WDL_ConvolutionEngine_Div::~WDL_ConvolutionEngine_Div()
 {
   timingPrint();
   m_engines.Empty(true);
+  ClearThreaded();
+  m_samplesout.Empty(true);
 }
 
 void WDL_ConvolutionEngine_Div::Add(WDL_FFT_REAL **bufs, int len, int nch)
 {
-  m_proc_nch=nch;
+  SetProcChannels(m_matrix_out_nch ? m_matrix_out_nch : nch);
 
   bool ns=m_need_feedsilence;
   m_need_feedsilence=false;
@@ -829,18 +950,25 @@ void WDL_ConvolutionEngine_Div::Add(WDL_FFT_REAL **bufs, int len, int nch)
 
     eng->Add(bufs,len,nch);
 
-    if (ns) eng->AddSilenceToOutput(eng->m_zl_delaypos,nch); // add silence to output (to delay output to its correct time)
+    if (ns) eng->AddSilenceToOutput(eng->m_zl_delaypos,m_proc_nch); // add silence to output (to delay output to its correct time)
 
   }
+
+  int queued=0;
+  for (x = 0; x < m_threaded.GetSize(); x ++)
+  {
+    if (m_threaded.Get(x)->Add(bufs,len,nch,m_proc_nch,ns)) queued++;
+  }
+  if (queued) m_threaded_pool->Signal(queued);
 }
-WDL_FFT_REAL **WDL_ConvolutionEngine_Div::Get() 
+WDL_FFT_REAL **WDL_ConvolutionEngine_Div::Get()
 {
   int x;
   for (x = 0; x < m_proc_nch; x ++)
   {
-    m_get_tmpptrs[x]=(WDL_FFT_REAL *)m_samplesout[x].Get();
+    m_get_tmpptrs.Get()[x]=(WDL_FFT_REAL *)m_samplesout.Get(x)->Get();
   }
-  return m_get_tmpptrs;
+  return m_get_tmpptrs.Get();
 }
 
 void WDL_ConvolutionEngine_Div::Advance(int len)
@@ -848,8 +976,9 @@ void WDL_ConvolutionEngine_Div::Advance(int len)
   int x;
   for (x = 0; x < m_proc_nch; x ++)
   {
-    m_samplesout[x].Advance(len*sizeof(WDL_FFT_REAL));
-    m_samplesout[x].Compact();
+    WDL_Queue *q=m_samplesout.Get(x);
+    q->Advance(len*sizeof(WDL_FFT_REAL));
+    q->Compact();
   }
 }
 
@@ -876,7 +1005,7 @@ int WDL_ConvolutionEngine_Div::Avail(int wantSamples)
 #if 0
     if (eng->m_zl_fftcnt)
       h|=1<<x;
-    
+
     if (eng->m_zl_fftcnt && x==m_engines.GetSize()-1 && cnt>1)
     {
       char buf[512];
@@ -887,6 +1016,11 @@ int WDL_ConvolutionEngine_Div::Avail(int wantSamples)
 #endif
     if (a < wantSamples) wantSamples=a;
   }
+  for (x = 0; x < m_threaded.GetSize(); x ++)
+  {
+    int a=m_threaded.Get(x)->Avail(wso);
+    if (a < wantSamples) wantSamples=a;
+  }
 
 #ifdef WDLCONVO_ZL_ACCOUNTING
   static DWORD lastt=0;
@@ -902,10 +1036,10 @@ int WDL_ConvolutionEngine_Div::Avail(int wantSamples)
 #endif
   if (wantSamples>0)
   {
-    WDL_FFT_REAL *tp[WDL_CONVO_MAX_PROC_NCH];
+    WDL_FFT_REAL **tp=m_get_tmpptrs.Get();
     for (x =0; x < m_proc_nch; x ++)
     {
-      memset(tp[x]=(WDL_FFT_REAL*)m_samplesout[x].Add(NULL,wantSamples*sizeof(WDL_FFT_REAL)),0,wantSamples*sizeof(WDL_FFT_REAL));
+      memset(tp[x]=(WDL_FFT_REAL*)m_samplesout.Get(x)->Add(NULL,wantSamples*sizeof(WDL_FFT_REAL)),0,wantSamples*sizeof(WDL_FFT_REAL));
     }
 
     for (x = 0; x < m_engines.GetSize(); x ++)
@@ -917,7 +1051,7 @@ int WDL_ConvolutionEngine_Div::Avail(int wantSamples)
       if (p)
       {
         int i;
-        for (i =0; i < m_proc_nch; i ++)
+        for (i =0; i < m_proc_nch && i < eng->GetNumOutputChannels(); i ++)
         {
           WDL_FFT_REAL *o=tp[i];
           WDL_FFT_REAL *in=p[i];
@@ -927,25 +1061,580 @@ int WDL_ConvolutionEngine_Div::Avail(int wantSamples)
       }
       eng->Advance(wantSamples);
     }
+    for (x = 0; x < m_threaded.GetSize(); x ++)
+    {
+      m_threaded.Get(x)->Mix(tp,wantSamples);
+    }
   }
   timingLeave(1);
 
-  int av=m_samplesout[0].Available()/sizeof(WDL_FFT_REAL);
+  int av=m_proc_nch>0 ? m_samplesout.Get(0)->Available()/sizeof(WDL_FFT_REAL) : 0;
   return av>wso ? wso : av;
 }
 
 
-#ifdef WDL_TEST_CONVO
-
-#include <stdio.h>
+/****************************************************************
+**  threaded partitions
+*/
 
-int main(int argc, char **argv)
+static void WDL_CONVO_Yield()
 {
-  if (argc!=5)
-  {
-    printf("usage: convoengine fftsize implen oneoffs pingoffs\n");
-    return -1;
-  }
+#ifdef _WIN32
+  Sleep(0);
+#else
+  sched_yield();
+#endif
+}
+
+WDL_ConvolutionEngine_Threaded::WDL_ConvolutionEngine_Threaded(WDL_ConvolutionEngine *eng, int blocksize, int delay, int nslots)
+{
+  m_eng=eng;
+  m_bsize=blocksize;
+  m_delay=delay;
+  m_nslots=nslots<2 ? 2 : nslots;
+  m_nch=m_out_nch=0;
+  m_posted=m_done=m_busy=0;
+  m_finishing=0;
+  m_stage_fill=0;
+  m_collected=0;
+  m_late_blocks=0;
+}
+
+WDL_ConvolutionEngine_Threaded::~WDL_ConvolutionEngine_Threaded()
+{
+  Lock();
+  delete m_eng;
+  m_samplesout.Empty(true);
+}
+
+void WDL_ConvolutionEngine_Threaded::Lock()
+{
+  while (!TryLock()) WDL_CONVO_Yield();
+}
+
+bool WDL_ConvolutionEngine_Threaded::ProcessBlock()
+{
+  const int d=m_done;
+  if (d == wdl_atomic_get(&m_posted)) return false;
+
+  const int slot=d%m_nslots;
+  int ch;
+  WDL_FFT_REAL **ptrs=m_procptrs.Get();
+  for (ch = 0; ch < m_nch; ch ++) ptrs[ch]=m_inslots.Get()+(slot*m_nch+ch)*m_bsize;
+
+  m_eng->Add(ptrs,m_bsize,m_nch);
+  const int a=m_eng->Avail(m_bsize);
+  WDL_FFT_REAL **o=m_eng->Get();
+  for (ch = 0; ch < m_out_nch; ch ++)
+  {
+    WDL_FFT_REAL *out=m_outslots.Get()+(slot*m_out_nch+ch)*m_bsize;
+    if (o && a>=m_bsize && ch<m_eng->GetNumOutputChannels()) memcpy(out,o[ch],m_bsize*sizeof(WDL_FFT_REAL));
+    else memset(out,0,m_bsize*sizeof(WDL_FFT_REAL));
+  }
+  m_eng->Advance(a);
+
+  wdl_atomic_set(&m_done,d+1);
+  return true;
+}
+
+// completes every queued block on this thread. pool threads only hold the lock for one block at a time and
+// don't take the partition again while m_finishing is set, so this waits for at most one block of their work.
+void WDL_ConvolutionEngine_Threaded::Finish()
+{
+  if (wdl_atomic_get(&m_done) == m_posted) return;
+
+  wdl_atomic_set(&m_finishing,1);
+  while (!TryLock()) WDL_CONVO_Yield();
+  while (ProcessBlock());
+  Unlock();
+  wdl_atomic_set(&m_finishing,0);
+}
+
+void WDL_ConvolutionEngine_Threaded::Collect()
+{
+  const int d=wdl_atomic_get(&m_done);
+  while (m_collected != d)
+  {
+    const int slot=m_collected%m_nslots;
+    int ch;
+    for (ch = 0; ch < m_out_nch; ch ++)
+      m_samplesout.Get(ch)->Add(m_outslots.Get()+(slot*m_out_nch+ch)*m_bsize,m_bsize*sizeof(WDL_FFT_REAL));
+    m_collected++;
+  }
+}
+
+void WDL_ConvolutionEngine_Threaded::SetChannels(int nch, int out_nch)
+{
+  Finish();
+  Collect();
+  Lock();
+
+  int ch, so=0;
+  for (ch = 0; ch < m_out_nch; ch ++)
+  {
+    if (m_samplesout.Get(ch)->Available()>so) so=m_samplesout.Get(ch)->Available();
+  }
+  while (m_samplesout.GetSize() < out_nch) m_samplesout.Add(new WDL_Queue);
+  for (ch = 0; ch < m_samplesout.GetSize(); ch ++)
+  {
+    WDL_Queue *q=m_samplesout.Get(ch);
+    if (ch >= out_nch) q->Clear();
+    else if (q->Available() < so) memset(q->Add(NULL,so-q->Available()),0,so-q->Available());
+  }
+
+  const int oldsz=m_stage.GetSize();
+  m_stage.Resize(nch*m_bsize);
+  if (m_stage.GetSize()>oldsz) memset(m_stage.Get()+oldsz,0,(m_stage.GetSize()-oldsz)*sizeof(WDL_FFT_REAL));
+
+  m_inslots.Resize(m_nslots*nch*m_bsize);
+  m_outslots.Resize(m_nslots*out_nch*m_bsize);
+  m_procptrs.Resize(nch);
+  m_nch=nch;
+  m_out_nch=out_nch;
+
+  Unlock();
+}
+
+void WDL_ConvolutionEngine_Threaded::Reset()
+{
+  Lock();
+  m_eng->Reset();
+  wdl_atomic_set(&m_posted,0); // pool threads poll these through HasWork() without the lock
+  wdl_atomic_set(&m_done,0);
+  m_collected=0;
+  m_stage_fill=0;
+  int ch;
+  for (ch = 0; ch < m_samplesout.GetSize(); ch ++) m_samplesout.Get(ch)->Clear();
+  Unlock();
+}
+
+bool WDL_ConvolutionEngine_Threaded::Add(WDL_FFT_REAL **bufs, int len, int nch, int out_nch, bool feedsilence)
+{
+  if (nch != m_nch || out_nch != m_out_nch) SetChannels(nch,out_nch);
+
+  int ch;
+  if (feedsilence) for (ch = 0; ch < m_out_nch; ch ++)
+  {
+    memset(m_samplesout.Get(ch)->Add(NULL,m_delay*sizeof(WDL_FFT_REAL)),0,m_delay*sizeof(WDL_FFT_REAL));
+  }
+
+  bool queued=false;
+  int pos=0;
+  while (pos < len)
+  {
+    int n=m_bsize-m_stage_fill;
+    if (n > len-pos) n=len-pos;
+    for (ch = 0; ch < m_nch; ch ++)
+    {
+      WDL_FFT_REAL *st=m_stage.Get()+ch*m_bsize+m_stage_fill;
+      if (bufs && bufs[ch]) memcpy(st,bufs[ch]+pos,n*sizeof(WDL_FFT_REAL));
+      else memset(st,0,n*sizeof(WDL_FFT_REAL));
+    }
+    m_stage_fill+=n;
+    pos+=n;
+
+    if (m_stage_fill == m_bsize)
+    {
+      Collect();
+      if (m_posted-m_collected >= m_nslots) // host blocks much larger than ours, no slot free
+      {
+        m_late_blocks++;
+        Finish();
+        Collect();
+      }
+      memcpy(m_inslots.Get()+(m_posted%m_nslots)*m_nch*m_bsize,m_stage.Get(),m_nch*m_bsize*sizeof(WDL_FFT_REAL));
+      wdl_atomic_set(&m_posted,m_posted+1);
+      m_stage_fill=0;
+      queued=true;
+    }
+  }
+  return queued;
+}
+
+int WDL_ConvolutionEngine_Threaded::Avail(int want)
+{
+  if (m_out_nch<1) return 0;
+  Collect();
+  const int a=m_samplesout.Get(0)->Available()/sizeof(WDL_FFT_REAL) + (m_posted-m_collected)*m_bsize;
+  return a<want ? a : want;
+}
+
+void WDL_ConvolutionEngine_Threaded::Mix(WDL_FFT_REAL **out, int len)
+{
+  if (m_out_nch<1) return;
+  Collect();
+  if (m_samplesout.Get(0)->Available() < len*(int)sizeof(WDL_FFT_REAL))
+  {
+    // deadline, finish it here
+    m_late_blocks += m_posted-wdl_atomic_get(&m_done);
+    Finish();
+    Collect();
+  }
+
+  const int av=m_samplesout.Get(0)->Available()/sizeof(WDL_FFT_REAL);
+  if (len > av) len=av;
+
+  int ch;
+  for (ch = 0; ch < m_out_nch; ch ++)
+  {
+    WDL_Queue *q=m_samplesout.Get(ch);
+    WDL_FFT_REAL *o=out[ch];
+    const WDL_FFT_REAL *in=(const WDL_FFT_REAL *)q->Get();
+    int j=len;
+    while (j-->0) *o++ += *in++;
+    q->Advance(len*sizeof(WDL_FFT_REAL));
+    q->Compact();
+  }
+}
+
+
+WDL_ConvolutionThreadPool::WDL_ConvolutionThreadPool(int nthreads)
+{
+  m_quit=0;
+  if (nthreads<1)
+  {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    nthreads=(int)si.dwNumberOfProcessors-1;
+#else
+    nthreads=(int)sysconf(_SC_NPROCESSORS_ONLN)-1;
+#endif
+    if (nthreads<1) nthreads=1;
+  }
+
+  int x;
+#ifdef _WIN32
+  m_sem=CreateSemaphore(NULL,0,0x7fffffff,NULL);
+  for (x = 0; x < nthreads; x ++)
+  {
+    DWORD tid;
+    HANDLE h=CreateThread(NULL,0,ThreadProc,this,0,&tid);
+    if (!h) break;
+    SetThreadPriority(h,THREAD_PRIORITY_HIGHEST);
+    m_threads.Add(h);
+  }
+#else
+#ifdef __APPLE__
+  m_sem=dispatch_semaphore_create(0);
+#else
+  sem_init(&m_sem,0,0);
+#endif
+  for (x = 0; x < nthreads; x ++)
+  {
+    pthread_t t;
+    if (pthread_create(&t,NULL,ThreadProc,this)) break;
+    m_threads.Add(t);
+  }
+#endif
+}
+
+WDL_ConvolutionThreadPool::~WDL_ConvolutionThreadPool()
+{
+  wdl_atomic_set(&m_quit,1);
+  int x;
+#ifdef _WIN32
+  ReleaseSemaphore(m_sem,m_threads.GetSize(),NULL);
+  for (x = 0; x < m_threads.GetSize(); x ++)
+  {
+    WaitForSingleObject(m_threads.Get()[x],INFINITE);
+    CloseHandle(m_threads.Get()[x]);
+  }
+  CloseHandle(m_sem);
+#else
+  for (x = 0; x < m_threads.GetSize(); x ++)
+  {
+#ifdef __APPLE__
+    dispatch_semaphore_signal(m_sem);
+#else
+    sem_post(&m_sem);
+#endif
+  }
+  for (x = 0; x < m_threads.GetSize(); x ++) pthread_join(m_threads.Get()[x],NULL);
+#ifdef __APPLE__
+  dispatch_release(m_sem);
+#else
+  sem_destroy(&m_sem);
+#endif
+#endif
+}
+
+void WDL_ConvolutionThreadPool::AddPartition(WDL_ConvolutionEngine_Threaded *p)
+{
+  WDL_MutexLock lock(&m_mutex);
+  int x;
+  for (x = 0; x < m_parts.GetSize() && m_parts.Get(x)->GetBlockSize() <= p->GetBlockSize(); x ++);
+  m_parts.Insert(x,p);
+}
+
+void WDL_ConvolutionThreadPool::RemovePartition(WDL_ConvolutionEngine_Threaded *p)
+{
+  m_mutex.Enter();
+  m_parts.Delete(m_parts.Find(p));
+  m_mutex.Leave();
+
+  // pool threads only take a partition while holding m_mutex, wait out any that already has it
+  while (!p->TryLock()) WDL_CONVO_Yield();
+  p->Unlock();
+}
+
+// called from the audio thread, only posts the semaphore (no locks)
+void WDL_ConvolutionThreadPool::Signal(int cnt)
+{
+  if (cnt<1) return;
+  if (cnt>m_threads.GetSize()) cnt=m_threads.GetSize();
+#ifdef _WIN32
+  ReleaseSemaphore(m_sem,cnt,NULL);
+#else
+  while (cnt-->0)
+  {
+#ifdef __APPLE__
+    dispatch_semaphore_signal(m_sem);
+#else
+    sem_post(&m_sem);
+#endif
+  }
+#endif
+}
+
+#ifdef _WIN32
+DWORD WINAPI WDL_ConvolutionThreadPool::ThreadProc(LPVOID p)
+#else
+void *WDL_ConvolutionThreadPool::ThreadProc(void *p)
+#endif
+{
+  ((WDL_ConvolutionThreadPool *)p)->Run();
+  return 0;
+}
+
+void WDL_ConvolutionThreadPool::Run()
+{
+  for (;;)
+  {
+#ifdef _WIN32
+    WaitForSingleObject(m_sem,INFINITE);
+#elif defined(__APPLE__)
+    dispatch_semaphore_wait(m_sem,DISPATCH_TIME_FOREVER);
+#else
+    while (sem_wait(&m_sem) && errno == EINTR);
+#endif
+    if (wdl_atomic_get(&m_quit)) break;
+
+    for (;;)
+    {
+      WDL_ConvolutionEngine_Threaded *p=NULL;
+      m_mutex.Enter();
+      int x;
+      for (x = 0; x < m_parts.GetSize() && !p; x ++) // sorted by block size, earliest deadline first
+      {
+        WDL_ConvolutionEngine_Threaded *t=m_parts.Get(x);
+        if (t->HasWork() && t->TryLock()) p=t;
+      }
+      m_mutex.Leave();
+      if (!p) break;
+
+      // one block at a time, so the audio thread never waits on more than one in Finish()
+      p->ProcessBlock();
+      p->Unlock();
+    }
+  }
+}
+
+
+/****************************************************************
+**  crossfading impulse changes
+*/
+
+WDL_ConvolutionEngine_Crossfade::WDL_ConvolutionEngine_Crossfade()
+{
+  int x;
+  for (x = 0; x < NSLOTS; x ++) m_inuse[x]=m_len[x]=0;
+  m_pending=m_prepared=-1;
+  m_cur=m_old=-1;
+  m_fade_hold=0;
+  m_fade_len=1024;
+  m_fade_pos=m_fade_mixed=0;
+  m_fade_c=1.0;
+  m_fade_s=m_fade_rc=m_fade_rs=0.0;
+}
+
+WDL_ConvolutionEngine_Crossfade::~WDL_ConvolutionEngine_Crossfade()
+{
+}
+
+void WDL_ConvolutionEngine_Crossfade::SetThreadPool(WDL_ConvolutionThreadPool *pool, int first_partition)
+{
+  int x;
+  for (x = 0; x < NSLOTS; x ++) m_engs[x].SetThreadPool(pool,first_partition);
+}
+
+bool WDL_ConvolutionEngine_Crossfade::PrepareImpulse(WDL_ImpulseBuffer *impulse, int nch, int maxfft_size, int known_blocksize, int max_imp_size, int impulse_offset, int latency_allowed, int max_blocksize)
+{
+  return PrepareInt(impulse,NULL,nch,maxfft_size,known_blocksize,max_imp_size,impulse_offset,latency_allowed,max_blocksize);
+}
+
+bool WDL_ConvolutionEngine_Crossfade::PrepareImpulseMatrix(WDL_ImpulseMatrix *impulses, int maxfft_size, int known_blocksize, int max_imp_size, int impulse_offset, int latency_allowed, int max_blocksize)
+{
+  return PrepareInt(NULL,impulses,impulses->GetInChannels(),maxfft_size,known_blocksize,max_imp_size,impulse_offset,latency_allowed,max_blocksize);
+}
+
+bool WDL_ConvolutionEngine_Crossfade::PrepareInt(WDL_ImpulseBuffer *impulse, WDL_ImpulseMatrix *matrix, int nch, int maxfft_size, int known_blocksize, int max_imp_size, int impulse_offset, int latency_allowed, int max_blocksize)
+{
+  const int len=matrix ? matrix->GetLength() : impulse->GetLength();
+  if (len<1) return false;
+
+  // taking back a prepared slot the audio thread has not picked up leaves it ours to reuse. otherwise the audio
+  // thread holds at most two slots, one of them m_prepared (it may not have flagged that in m_inuse yet)
+  int slot=wdl_atomic_exchange(&m_pending,-1);
+  if (slot<0)
+  {
+    for (slot = 0; slot < NSLOTS-1 && (slot==m_prepared || wdl_atomic_get(&m_inuse[slot])); slot ++);
+  }
+
+  WDL_ConvolutionEngine_Div *eng=&m_engs[slot];
+  if (matrix) eng->SetImpulseMatrix(matrix,maxfft_size,known_blocksize,max_imp_size,impulse_offset,latency_allowed);
+  else eng->SetImpulse(impulse,maxfft_size,known_blocksize,max_imp_size,impulse_offset,latency_allowed);
+
+  // run silence through every partition so that the queues reach their working sizes here rather than on the audio thread.
+  // long enough for the input WDL_FastQueues to have moved on to a second page, too
+  if (max_blocksize<1) max_blocksize=known_blocksize>0 ? known_blocksize : 4096;
+  if (nch<1) nch=1;
+
+  int primelen=len + eng->GetLatency() + max_blocksize*2 + 65536/(int)sizeof(WDL_FFT_REAL);
+
+  WDL_TypedBuf<WDL_FFT_REAL> silence;
+  WDL_TypedBuf<WDL_FFT_REAL *> bufs;
+  memset(silence.Resize(max_blocksize),0,max_blocksize*sizeof(WDL_FFT_REAL));
+  WDL_FFT_REAL **bp=bufs.Resize(nch);
+  int x;
+  for (x = 0; x < nch; x ++) bp[x]=silence.Get();
+
+  while (primelen>0)
+  {
+    eng->Add(bp,max_blocksize,nch);
+    eng->Advance(eng->Avail(max_blocksize));
+    primelen-=max_blocksize;
+  }
+  eng->Reset();
+
+  m_len[slot]=len;
+  m_prepared=slot;
+  wdl_atomic_set(&m_pending,slot);
+  return true;
+}
+
+void WDL_ConvolutionEngine_Crossfade::EndFade()
+{
+  const int o=m_old;
+  m_old=-1;
+  wdl_atomic_set(&m_inuse[o],0);
+}
+
+void WDL_ConvolutionEngine_Crossfade::Reset()
+{
+  if (m_old>=0) EndFade();
+  if (m_cur>=0) m_engs[m_cur].Reset();
+}
+
+void WDL_ConvolutionEngine_Crossfade::Add(WDL_FFT_REAL **bufs, int len, int nch)
+{
+  if (m_old<0) // a new impulse waits for any running crossfade to finish
+  {
+    const int p=wdl_atomic_exchange(&m_pending,-1);
+    if (p>=0)
+    {
+      wdl_atomic_set(&m_inuse[p],1);
+
+      if (m_cur>=0)
+      {
+        // the new engine starts without input history, m_old covers for it until that has filled
+        m_old=m_cur;
+        m_fade_hold=m_len[p];
+        m_fade_pos=m_fade_mixed=0;
+        m_fade_c=1.0;
+        m_fade_s=0.0;
+        const double d=m_fade_len>0 ? 0.5*3.14159265358979323846/m_fade_len : 0.0;
+        m_fade_rc=cos(d);
+        m_fade_rs=sin(d);
+      }
+      m_cur=p;
+    }
+  }
+
+  if (m_cur>=0) m_engs[m_cur].Add(bufs,len,nch);
+  if (m_old>=0) m_engs[m_old].Add(bufs,len,nch);
+}
+
+int WDL_ConvolutionEngine_Crossfade::Avail(int wantSamples)
+{
+  if (m_cur<0) return 0;
+
+  WDL_ConvolutionEngine_Div *cur=&m_engs[m_cur];
+  int avail=cur->Avail(wantSamples);
+  if (m_old<0 || avail<=m_fade_mixed) return avail;
+
+  // m_old's output is consumed as it is mixed, so its first sample lines up with m_cur's sample m_fade_mixed
+  WDL_ConvolutionEngine_Div *old=&m_engs[m_old];
+  const int fade_end=m_fade_hold+m_fade_len;
+  int n=old->Avail(avail-m_fade_mixed);
+  if (n > fade_end-m_fade_pos) n=fade_end-m_fade_pos;
+  if (n>0)
+  {
+    WDL_FFT_REAL **cp=cur->Get(), **op=old->Get();
+    const int nch=cur->GetNumOutputChannels(), onch=old->GetNumOutputChannels();
+    double c=m_fade_c, s=m_fade_s;
+    int i, ch;
+    for (i = 0; i < n; i ++)
+    {
+      for (ch = 0; ch < nch; ch ++)
+      {
+        WDL_FFT_REAL *o=cp[ch]+m_fade_mixed+i;
+        *o = (WDL_FFT_REAL) (*o*s + (ch < onch ? op[ch][i]*c : 0.0));
+      }
+      if (m_fade_pos+i >= m_fade_hold)
+      {
+        const double t=c*m_fade_rc - s*m_fade_rs;
+        s=s*m_fade_rc + c*m_fade_rs;
+        c=t;
+      }
+    }
+    m_fade_c=c;
+    m_fade_s=s;
+    old->Advance(n);
+    m_fade_pos+=n;
+    m_fade_mixed+=n;
+  }
+
+  if (m_fade_pos>=fade_end) EndFade();
+  else if (avail>m_fade_mixed) avail=m_fade_mixed; // m_old is behind, the rest is not mixed yet
+
+  return avail;
+}
+
+WDL_FFT_REAL **WDL_ConvolutionEngine_Crossfade::Get()
+{
+  return m_cur>=0 ? m_engs[m_cur].Get() : NULL;
+}
+
+void WDL_ConvolutionEngine_Crossfade::Advance(int len)
+{
+  if (m_cur<0) return;
+  m_engs[m_cur].Advance(len);
+  if (m_old>=0) m_fade_mixed = len<m_fade_mixed ? m_fade_mixed-len : 0;
+}
+
+
+#ifdef WDL_TEST_CONVO
+
+#include <stdio.h>
+
+int main(int argc, char **argv)
+{
+  if (argc!=5)
+  {
+    printf("usage: convoengine fftsize implen oneoffs pingoffs\n");
+    return -1;
+  }
 
   int fftsize=atoi(argv[1]);
   int implen = atoi(argv[2]);
@@ -1007,6 +1696,233 @@ int main(int argc, char **argv)
 #endif
 
 
+#ifdef WDL_BENCH_CONVO
+
+// cc -O2 -c fft.c && c++ -O2 -DWDL_BENCH_CONVO convoengine.cpp fft.o
+
+#include <stdio.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define WDL_BENCH_CLOCK() ((double)__rdtsc())
+#define WDL_BENCH_UNIT "cycles"
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define WDL_BENCH_CLOCK() ((double)__rdtsc())
+#define WDL_BENCH_UNIT "cycles"
+#else
+#include <time.h>
+#define WDL_BENCH_CLOCK() ((double)clock()*(1.0e9/CLOCKS_PER_SEC))
+#define WDL_BENCH_UNIT "ns"
+#endif
+
+static WDL_FFT_REAL bench_rand(unsigned int *seed)
+{
+  *seed = *seed * 1664525 + 1013904223;
+  return (WDL_FFT_REAL) ((int)(*seed>>8) - (1<<23)) / (WDL_FFT_REAL) (1<<23);
+}
+
+int main(int argc, char **argv)
+{
+  const int blocksize=512, nblocks=2000, nch=2;
+  const int implens[]={ 4096, 32768, 131072 };
+  unsigned int seed=1;
+  int x, ch;
+
+  WDL_fft_init();
+
+  // complex = real samples in a WDL_fft() buffer with zero imaginary parts (what the engine used to do)
+  printf("one overlap-add block (fft, multiply, ifft), %s per output sample:\n",WDL_BENCH_UNIT);
+  printf("%8s %12s %12s\n","fftsize","complex","real");
+  for (x = 256; x <= 16384; x *= 2)
+  {
+    WDL_TypedBuf<WDL_FFT_REAL> buf, imp;
+    WDL_FFT_REAL *b=buf.Resize(x*2), *ib=imp.Resize(x*2);
+    int i, r;
+    const int reps = (1<<22)/x;
+    for (i = 0; i < x*2; i ++) ib[i]=bench_rand(&seed);
+
+    double t=WDL_BENCH_CLOCK();
+    for (r = 0; r < reps; r ++)
+    {
+      for (i = 0; i < x/2; i ++) { b[i*2]=bench_rand(&seed); b[i*2+1]=0.0; }
+      memset(b+x,0,x*sizeof(WDL_FFT_REAL));
+      WDL_fft((WDL_FFT_COMPLEX*)b,x,0);
+      WDL_fft_complexmul((WDL_FFT_COMPLEX*)b,(WDL_FFT_COMPLEX*)ib,x);
+      WDL_fft((WDL_FFT_COMPLEX*)b,x,1);
+    }
+    const double tc=(WDL_BENCH_CLOCK()-t)/((double)reps*x/2);
+
+    t=WDL_BENCH_CLOCK();
+    for (r = 0; r < reps; r ++)
+    {
+      for (i = 0; i < x/2; i ++) b[i]=bench_rand(&seed);
+      memset(b+x/2,0,x/2*sizeof(WDL_FFT_REAL));
+      WDL_real_fft(b,x,0);
+      WDL_fft_realmul(b,ib,x);
+      WDL_real_fft(b,x,1);
+    }
+    const double tr=(WDL_BENCH_CLOCK()-t)/((double)reps*x/2);
+    printf("%8d %12.2f %12.2f\n",x,tc,tr);
+  }
+
+  printf("\n%d channels, %d sample blocks, %s per sample per channel:\n",nch,blocksize,WDL_BENCH_UNIT);
+  printf("%8s %16s %16s\n","implen","ConvolutionEngine","_Div");
+  for (x = 0; x < (int) (sizeof(implens)/sizeof(implens[0])); x ++)
+  {
+    WDL_ImpulseBuffer imp;
+    imp.SetNumChannels(nch);
+    imp.SetLength(implens[x]);
+    for (ch = 0; ch < nch; ch ++)
+    {
+      WDL_FFT_REAL *p=imp.impulses[ch].Get();
+      int i;
+      for (i = 0; i < implens[x]; i ++) p[i]=bench_rand(&seed)*(WDL_FFT_REAL)exp(-4.0*i/implens[x]);
+    }
+
+    double res[2];
+    int e;
+    for (e = 0; e < 2; e ++)
+    {
+      WDL_ConvolutionEngine eng;
+      WDL_ConvolutionEngine_Div engdiv;
+      if (e) engdiv.SetImpulse(&imp,0,blocksize);
+      else eng.SetImpulse(&imp);
+
+      WDL_TypedBuf<WDL_FFT_REAL> inbuf[2];
+      WDL_FFT_REAL *in[2];
+      for (ch = 0; ch < nch; ch ++) in[ch]=inbuf[ch].Resize(blocksize);
+
+      double t=0.0;
+      int bl;
+      for (bl = 0; bl < nblocks; bl ++)
+      {
+        int i;
+        for (ch = 0; ch < nch; ch ++) for (i = 0; i < blocksize; i ++) in[ch][i]=bench_rand(&seed);
+
+        double t0=WDL_BENCH_CLOCK();
+        if (e)
+        {
+          engdiv.Add(in,blocksize,nch);
+          int a=engdiv.Avail(blocksize);
+          engdiv.Get();
+          engdiv.Advance(a);
+        }
+        else
+        {
+          eng.Add(in,blocksize,nch);
+          int a=eng.Avail(blocksize);
+          eng.Get();
+          eng.Advance(a);
+        }
+        t+=WDL_BENCH_CLOCK()-t0;
+      }
+      res[e]=t/((double)nblocks*blocksize*nch);
+    }
+    printf("%8d %16.2f %16.2f\n",implens[x],res[0],res[1]);
+  }
+
+  // N in x M out through one SetImpulseMatrix() engine vs N*M mono engines summed
+  const int min=4, mout=4, mlen=32768;
+  printf("\n%dx%d matrix, implen %d, %s per sample per output:\n",min,mout,mlen,WDL_BENCH_UNIT);
+  {
+    WDL_ImpulseMatrix mat;
+    mat.SetSize(min,mout);
+    WDL_PtrList<WDL_ImpulseBuffer> monoimps;
+    WDL_PtrList<WDL_ConvolutionEngine_Div> monoengs;
+    int i,o;
+    for (i = 0; i < min; i ++) for (o = 0; o < mout; o ++)
+    {
+      WDL_FFT_REAL *p=mat.Get(i,o)->Resize(mlen);
+      WDL_ImpulseBuffer *ib=monoimps.Add(new WDL_ImpulseBuffer);
+      ib->SetLength(mlen);
+      for (x = 0; x < mlen; x ++) ib->impulses[0].Get()[x]=p[x]=bench_rand(&seed)*(WDL_FFT_REAL)exp(-4.0*x/mlen);
+      monoengs.Add(new WDL_ConvolutionEngine_Div)->SetImpulse(ib,0,blocksize);
+    }
+    WDL_ConvolutionEngine_Div engmat;
+    engmat.SetImpulseMatrix(&mat,0,blocksize);
+
+    WDL_TypedBuf<WDL_FFT_REAL> inbuf;
+    WDL_FFT_REAL *in[min];
+    for (i = 0; i < min; i ++) in[i]=inbuf.Resize(min*blocksize)+i*blocksize;
+
+    double tm=0.0, ts=0.0;
+    int bl;
+    for (bl = 0; bl < nblocks/4; bl ++)
+    {
+      for (x = 0; x < min*blocksize; x ++) inbuf.Get()[x]=bench_rand(&seed);
+
+      double t0=WDL_BENCH_CLOCK();
+      engmat.Add(in,blocksize,min);
+      engmat.Advance(engmat.Avail(blocksize));
+      double t1=WDL_BENCH_CLOCK();
+      for (x = 0; x < monoengs.GetSize(); x ++)
+      {
+        WDL_ConvolutionEngine_Div *eng=monoengs.Get(x);
+        eng->Add(in+x/mout,blocksize,1);
+        eng->Advance(eng->Avail(blocksize));
+      }
+      ts+=WDL_BENCH_CLOCK()-t1;
+      tm+=t1-t0;
+    }
+    printf("%16s %16s\n","matrix","mono engines");
+    printf("%16.2f %16.2f\n",tm/((double)(nblocks/4)*blocksize*mout),ts/((double)(nblocks/4)*blocksize*mout));
+    monoengs.Empty(true);
+    monoimps.Empty(true);
+  }
+
+  // per block cost on the calling (audio) thread with a 10 second impulse, all partitions inline vs pool threads.
+  // blocks are paced at 48kHz real time so pool threads get the time they would get in a host
+  const int longlen=480000;
+  printf("\n_Div, implen %d, %d channels, %s per %d sample block on the calling thread (paced at 48kHz):\n",longlen,nch,WDL_BENCH_UNIT,blocksize);
+  printf("%12s %12s %12s %12s\n","threads","mean","max","late blocks");
+  {
+    WDL_ImpulseBuffer imp;
+    imp.SetNumChannels(nch);
+    imp.SetLength(longlen);
+    for (ch = 0; ch < nch; ch ++) for (x = 0; x < longlen; x ++) imp.impulses[ch].Get()[x]=bench_rand(&seed)*(WDL_FFT_REAL)exp(-4.0*x/longlen);
+
+    WDL_TypedBuf<WDL_FFT_REAL> inbuf;
+    WDL_FFT_REAL *in[2];
+    for (ch = 0; ch < nch; ch ++) in[ch]=inbuf.Resize(nch*blocksize)+ch*blocksize;
+
+    int e;
+    for (e = 0; e < 2; e ++)
+    {
+      WDL_ConvolutionThreadPool *pool = e ? new WDL_ConvolutionThreadPool : NULL;
+      WDL_ConvolutionEngine_Div *engp=new WDL_ConvolutionEngine_Div, &eng=*engp;
+      eng.SetThreadPool(pool);
+      eng.SetImpulse(&imp,0,blocksize);
+
+      double tsum=0.0, tmax=0.0;
+      const int nb=longlen*2/blocksize;
+      int bl;
+      for (bl = 0; bl < nb; bl ++)
+      {
+        for (x = 0; x < nch*blocksize; x ++) inbuf.Get()[x]=bench_rand(&seed);
+        double t0=WDL_BENCH_CLOCK();
+        eng.Add(in,blocksize,nch);
+        eng.Advance(eng.Avail(blocksize));
+        double t=WDL_BENCH_CLOCK()-t0;
+        tsum+=t;
+        if (t>tmax) tmax=t;
+#ifdef _WIN32
+        Sleep(blocksize*1000/48000);
+#else
+        usleep(blocksize*1000000/48000);
+#endif
+      }
+      printf("%12d %12.0f %12.0f %12d\n",pool ? pool->GetNumThreads() : 0,tsum/nb,tmax,eng.GetLateBlocks());
+      delete engp; // before the pool it uses
+      delete pool;
+    }
+  }
+  return 0;
+}
+
+#endif
+
+
 int WDL_ImpulseBuffer::SetLength(int samples)
 {
   int x;
@@ -1057,3 +1973,26 @@ void WDL_ImpulseBuffer::SetNumChannels(int usench)
     for(x=usench;x<WDL_CONVO_MAX_IMPULSE_NCH;x++) impulses[x].Resize(0,false);
   }
 }
+
+
+void WDL_ImpulseMatrix::SetSize(int in_nch, int out_nch)
+{
+  if (in_nch<0) in_nch=0;
+  if (out_nch<0) out_nch=0;
+  m_in_nch=in_nch;
+  m_out_nch=out_nch;
+
+  m_impulses.Empty(true);
+  int x;
+  for (x = 0; x < in_nch*out_nch; x ++) m_impulses.Add(new WDL_TypedBuf<WDL_FFT_REAL>);
+}
+
+int WDL_ImpulseMatrix::GetLength()
+{
+  int x, len=0;
+  for (x = 0; x < m_impulses.GetSize(); x ++)
+  {
+    if (m_impulses.Get(x)->GetSize() > len) len=m_impulses.Get(x)->GetSize();
+  }
+  return len;
+}
@@ -24,6 +24,15 @@
 
   Note that this library needs to have lookahead ability in order to process samples. Calling Add(somevalue) may produce Avail() < somevalue.
 
+  SetImpulseMatrix() convolves N inputs to M outputs (ambisonics, 5.1/7.1 reverbs etc) in one engine: each input block is
+  FFT'd once and reused against every impulse of its row, each output is inverse FFT'd once. Add() then takes the N inputs,
+  Get() returns the M outputs.
+
+  WDL_ConvolutionEngine_Div::SetThreadPool() moves the larger partitions onto worker threads, see WDL_ConvolutionThreadPool.
+
+  WDL_ConvolutionEngine_Crossfade changes impulses during playback: the new one is prepared off the audio thread and
+  crossfaded in.
+
 */
 
 
@@ -32,18 +41,29 @@
 
 #include "queue.h"
 #include "fastqueue.h"
+#include "mutex.h"
 #include "fft.h"
 
+#ifndef _WIN32
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+#endif
+
 #ifndef WDL_CONVO_MAX_IMPULSE_NCH
 #define WDL_CONVO_MAX_IMPULSE_NCH 2
 #endif
 
 #ifndef WDL_CONVO_MAX_PROC_NCH
-#define WDL_CONVO_MAX_PROC_NCH 2
+#define WDL_CONVO_MAX_PROC_NCH 2 // no longer limits the engines, they size their channel state at runtime
 #endif
 
 //#define WDL_CONVO_WANT_FULLPRECISION_IMPULSE_STORAGE // define this for slowerness with -138dB error difference in resulting output (+-1 LSB at 24 bit)
 
+//#define WDL_CONVO_SPLIT_COMPLEX // define this to keep spectra as separate real/imaginary arrays, the multiply-accumulate then needs no shuffles (costs a rearrange per FFT)
+
 #ifdef WDL_CONVO_WANT_FULLPRECISION_IMPULSE_STORAGE 
 
 typedef WDL_FFT_REAL WDL_CONVO_IMPULSEBUFf;
@@ -78,6 +98,31 @@ private:
 
 };
 
+class WDL_ImpulseMatrix
+{
+public:
+  WDL_ImpulseMatrix() { samplerate=44100.0; m_in_nch=m_out_nch=0; }
+  ~WDL_ImpulseMatrix() { m_impulses.Empty(true); }
+
+  void SetSize(int in_nch, int out_nch); // clears all impulses
+  int GetInChannels() { return m_in_nch; }
+  int GetOutChannels() { return m_out_nch; }
+  int GetLength(); // longest impulse
+
+  // impulse from input in_ch to output out_ch, leave it empty if there is no path
+  WDL_TypedBuf<WDL_FFT_REAL> *Get(int in_ch, int out_ch)
+  {
+    return in_ch>=0 && in_ch<m_in_nch && out_ch>=0 && out_ch<m_out_nch ? m_impulses.Get(in_ch*m_out_nch+out_ch) : NULL;
+  }
+
+  double samplerate;
+
+private:
+  WDL_PtrList<WDL_TypedBuf<WDL_FFT_REAL> > m_impulses;
+  int m_in_nch, m_out_nch;
+
+};
+
 class WDL_ConvolutionEngine
 {
 public:
@@ -85,7 +130,9 @@ public:
   ~WDL_ConvolutionEngine();
 
   int SetImpulse(WDL_ImpulseBuffer *impulse, int fft_size=-1, int impulse_sample_offset=0, int max_imp_size=0, bool forceBrute=false);
+  int SetImpulseMatrix(WDL_ImpulseMatrix *impulses, int fft_size=-1, int impulse_sample_offset=0, int max_imp_size=0, bool forceBrute=false);
  
+  int GetNumOutputChannels() { return m_out_nch; }
   int GetFFTSize() { return m_fft_size; }
   int GetLatency() { return m_fft_size/2; }
   
@@ -98,26 +145,38 @@ public:
   void Advance(int len);
 
 private:
-  WDL_TypedBuf<WDL_CONVO_IMPULSEBUFf> m_impulse[WDL_CONVO_MAX_IMPULSE_NCH]; // FFT'd data blocks per channel
-  WDL_TypedBuf<char> m_impulse_zflag[WDL_CONVO_MAX_IMPULSE_NCH]; // FFT'd data blocks per channel
-
+  struct ImpulseBlocks
+  {
+    WDL_TypedBuf<WDL_CONVO_IMPULSEBUFf> buf; // WDL_real_fft()'d data blocks, fft_size reals each (time reversed impulse for brute force)
+    WDL_TypedBuf<char> zflag; // nonzero per block
+  };
+  struct ProcChannel // input state is used for channels < m_proc_nch, output state for channels < m_out_nch
+  {
+    WDL_FastQueue samplesin;
+    WDL_Queue samplesin2; // brute force input history
+    WDL_TypedBuf<WDL_FFT_REAL> samplehist; // WDL_real_fft()'d sample blocks
+    WDL_TypedBuf<char> samplehist_zflag;
+
+    WDL_Queue samplesout;
+    WDL_TypedBuf<WDL_FFT_REAL> overlaphist; 
+  };
+
+  int SetImpulseInt(WDL_ImpulseBuffer *impulse, WDL_ImpulseMatrix *matrix, int fft_size, int impulse_sample_offset, int max_imp_size, bool forceBrute);
+  void SetProcChannels(int in_nch, int out_nch);
+  ImpulseBlocks *GetImpulseFor(int in_ch, int out_ch);
+
+  WDL_PtrList<ImpulseBlocks> m_impulses; // m_impulse_nch per channel impulses, or matrix in*out
   int m_impulse_nch;
+  int m_matrix_in_nch, m_matrix_out_nch; // 0 if not SetImpulseMatrix()
   int m_fft_size;
   int m_impulse_len;
-  int m_proc_nch;
+  int m_proc_nch, m_out_nch;
 
-  WDL_Queue m_samplesout[WDL_CONVO_MAX_PROC_NCH];
-  WDL_Queue m_samplesin2[WDL_CONVO_MAX_PROC_NCH];
-  WDL_FastQueue m_samplesin[WDL_CONVO_MAX_PROC_NCH];
+  WDL_PtrList<ProcChannel> m_chans;
+  int m_hist_pos;
 
-  int m_hist_pos[WDL_CONVO_MAX_PROC_NCH];
-
-  WDL_TypedBuf<WDL_FFT_REAL> m_samplehist[WDL_CONVO_MAX_PROC_NCH]; // FFT'd sample blocks per channel
-  WDL_TypedBuf<char> m_samplehist_zflag[WDL_CONVO_MAX_IMPULSE_NCH];
-  WDL_TypedBuf<WDL_FFT_REAL> m_overlaphist[WDL_CONVO_MAX_PROC_NCH]; 
   WDL_TypedBuf<WDL_FFT_REAL> m_combinebuf;
-
-  WDL_FFT_REAL *m_get_tmpptrs[WDL_CONVO_MAX_PROC_NCH];
+  WDL_TypedBuf<WDL_FFT_REAL *> m_get_tmpptrs;
 
 public:
 
@@ -133,6 +192,91 @@ public:
 
 } WDL_FIXALIGN;
 
+// One WDL_ConvolutionEngine_Div partition, processed a block at a time by WDL_ConvolutionThreadPool threads. The output of
+// a block is needed delay-blocksize samples after the block is queued, if no pool thread has finished it by then the
+// audio thread does it itself.
+class WDL_ConvolutionEngine_Threaded
+{
+public:
+  WDL_ConvolutionEngine_Threaded(WDL_ConvolutionEngine *eng, int blocksize, int delay, int nslots); // takes ownership of eng
+  ~WDL_ConvolutionEngine_Threaded();
+
+  void Reset();
+
+  bool Add(WDL_FFT_REAL **bufs, int len, int nch, int out_nch, bool feedsilence); // returns true if blocks were queued
+  int Avail(int want);
+  void Mix(WDL_FFT_REAL **out, int len); // adds len (<= Avail()) output samples to out
+
+  int GetBlockSize() { return m_bsize; }
+  int GetLateBlocks() { return m_late_blocks; } // blocks the audio thread had to finish or wait for
+
+  // pool threads
+  bool HasWork() { return !wdl_atomic_get(&m_finishing) && wdl_atomic_get(&m_done) != wdl_atomic_get(&m_posted); }
+  bool TryLock() { return !wdl_atomic_exchange(&m_busy,1); }
+  void Unlock() { wdl_atomic_set(&m_busy,0); }
+  bool ProcessBlock(); // runs the oldest queued block, returns false if there was none. caller must hold the lock
+
+private:
+  void Lock();
+  void Finish();
+  void Collect();
+  void SetChannels(int nch, int out_nch);
+
+  WDL_ConvolutionEngine *m_eng;
+  int m_bsize, m_delay, m_nslots;
+  int m_nch, m_out_nch;
+
+  // block n is in slot n%m_nslots, queued by the audio thread (m_posted) and processed by the lock holder (m_done)
+  int m_posted, m_done, m_busy;
+  int m_finishing; // set by Finish(), pool threads leave the partition alone
+  WDL_TypedBuf<WDL_FFT_REAL> m_inslots, m_outslots;
+  WDL_TypedBuf<WDL_FFT_REAL *> m_procptrs;
+
+  // audio thread only
+  WDL_TypedBuf<WDL_FFT_REAL> m_stage; // partial input block
+  int m_stage_fill;
+  int m_collected;
+  WDL_PtrList<WDL_Queue> m_samplesout;
+  int m_late_blocks;
+
+} WDL_FIXALIGN;
+
+// Worker threads for WDL_ConvolutionEngine_Div::SetThreadPool(), can be shared by any number of engines. Queued blocks
+// with the smallest block size (least time until they are due) are run first.
+class WDL_ConvolutionThreadPool
+{
+public:
+  WDL_ConvolutionThreadPool(int nthreads=0); // 0 for one less than the number of CPUs, at least 1
+  ~WDL_ConvolutionThreadPool();
+
+  int GetNumThreads() { return m_threads.GetSize(); }
+
+  void AddPartition(WDL_ConvolutionEngine_Threaded *p);
+  void RemovePartition(WDL_ConvolutionEngine_Threaded *p); // returns once no pool thread is using p
+  void Signal(int cnt=1); // cnt blocks were queued
+
+private:
+  void Run();
+
+  WDL_Mutex m_mutex; // protects m_parts
+  WDL_PtrList<WDL_ConvolutionEngine_Threaded> m_parts;
+  int m_quit;
+
+#ifdef _WIN32
+  static DWORD WINAPI ThreadProc(LPVOID p);
+  HANDLE m_sem;
+  WDL_TypedBuf<HANDLE> m_threads;
+#else
+  static void *ThreadProc(void *p);
+#ifdef __APPLE__
+  dispatch_semaphore_t m_sem;
+#else
+  sem_t m_sem;
+#endif
+  WDL_TypedBuf<pthread_t> m_threads;
+#endif
+};
+
 // low latency version
 class WDL_ConvolutionEngine_Div
 {
@@ -141,8 +285,15 @@ public:
   ~WDL_ConvolutionEngine_Div();
 
   int SetImpulse(WDL_ImpulseBuffer *impulse, int maxfft_size=0, int known_blocksize=0, int max_imp_size=0, int impulse_offset=0, int latency_allowed=0);
+  int SetImpulseMatrix(WDL_ImpulseMatrix *impulses, int maxfft_size=0, int known_blocksize=0, int max_imp_size=0, int impulse_offset=0, int latency_allowed=0);
+
+  // partitions from first_partition on are run by pool threads (with half sized FFTs, so their output has a block of
+  // slack). call before SetImpulse(), pool must outlive the engine or be unset
+  void SetThreadPool(WDL_ConvolutionThreadPool *pool, int first_partition=2) { m_pool=pool; m_pool_first=first_partition; }
+  int GetLateBlocks(); // threaded partition blocks that were not done in time, summed
 
   int GetLatency();
+  int GetNumOutputChannels() { return m_proc_nch; }
   void Reset();
 
   void Add(WDL_FFT_REAL **bufs, int len, int nch);
@@ -152,15 +303,76 @@ public:
   void Advance(int len);
 
 private:
+  void ClearThreaded();
+  int SetImpulseInt(WDL_ImpulseBuffer *impulse, WDL_ImpulseMatrix *matrix, int maxfft_size, int known_blocksize, int max_imp_size, int impulse_offset, int latency_allowed);
+  void SetProcChannels(int nch);
+
   WDL_PtrList<WDL_ConvolutionEngine> m_engines;
+  WDL_PtrList<WDL_ConvolutionEngine_Threaded> m_threaded;
+  WDL_ConvolutionThreadPool *m_pool, *m_threaded_pool; // m_threaded_pool has m_threaded
+  int m_pool_first;
 
-  WDL_Queue m_samplesout[WDL_CONVO_MAX_PROC_NCH];
-  WDL_FFT_REAL *m_get_tmpptrs[WDL_CONVO_MAX_PROC_NCH];
+  WDL_PtrList<WDL_Queue> m_samplesout;
+  WDL_TypedBuf<WDL_FFT_REAL *> m_get_tmpptrs;
 
   int m_proc_nch;
+  int m_matrix_out_nch; // 0 if not SetImpulseMatrix()
   bool m_need_feedsilence;
 
 } WDL_FIXALIGN;
 
 
+// WDL_ConvolutionEngine_Div with click free impulse changes: PrepareImpulse() does the FFTs/allocations for a new impulse
+// on a spare engine (call it from a non-audio thread), the next Add() swaps it in. The old engine keeps being fed and
+// stays at full gain until the new one has had an impulse length of input (before that its output lacks the tail of
+// what came before the swap), then is equal power crossfaded into the new one. Add/Avail/Get/Advance/Reset do not
+// allocate once an impulse is running, as long as blocks stay within the size PrepareImpulse() was told about.
+class WDL_ConvolutionEngine_Crossfade
+{
+public:
+  WDL_ConvolutionEngine_Crossfade();
+  ~WDL_ConvolutionEngine_Crossfade();
+
+  // call before the first PrepareImpulse()
+  void SetThreadPool(WDL_ConvolutionThreadPool *pool, int first_partition=2);
+  void SetCrossfade(int len) { m_fade_len=len>0 ? len : 0; } // samples after the new impulse's length, 0 switches then
+
+  // from one non-audio thread at a time. the engine is primed for blocks of up to max_blocksize (known_blocksize if 0,
+  // else 4096) samples of nch channels. replaces a previously prepared impulse that has not been picked up yet, so the
+  // audio thread always moves to the latest one. returns false if the impulse is empty
+  bool PrepareImpulse(WDL_ImpulseBuffer *impulse, int nch, int maxfft_size=0, int known_blocksize=0, int max_imp_size=0, int impulse_offset=0, int latency_allowed=0, int max_blocksize=0);
+  bool PrepareImpulseMatrix(WDL_ImpulseMatrix *impulses, int maxfft_size=0, int known_blocksize=0, int max_imp_size=0, int impulse_offset=0, int latency_allowed=0, int max_blocksize=0);
+  bool IsPending() { return wdl_atomic_get(&m_pending)>=0; }
+  bool IsFading() { return m_old>=0; } // audio thread only
+
+  // audio thread
+  int GetLatency() { return m_cur>=0 ? m_engs[m_cur].GetLatency() : 0; }
+  int GetNumOutputChannels() { return m_cur>=0 ? m_engs[m_cur].GetNumOutputChannels() : 0; }
+  void Reset(); // also completes any crossfade
+
+  void Add(WDL_FFT_REAL **bufs, int len, int nch); // with no impulse yet, input is discarded
+
+  int Avail(int wantSamples);
+  WDL_FFT_REAL **Get(); // returns length valid
+  void Advance(int len);
+
+private:
+  enum { NSLOTS=3 }; // running, fading out, prepared
+
+  bool PrepareInt(WDL_ImpulseBuffer *impulse, WDL_ImpulseMatrix *matrix, int nch, int maxfft_size, int known_blocksize, int max_imp_size, int impulse_offset, int latency_allowed, int max_blocksize);
+  void EndFade();
+
+  WDL_ConvolutionEngine_Div m_engs[NSLOTS];
+  int m_inuse[NSLOTS]; // set by the audio thread while m_cur or m_old
+  int m_len[NSLOTS]; // impulse length, set with the slot
+  int m_pending; // prepared slot, or -1
+  int m_prepared; // preparing thread: last slot handed to m_pending, or -1
+
+  int m_cur, m_old; // audio thread
+  int m_fade_hold, m_fade_len, m_fade_pos, m_fade_mixed; // m_fade_mixed: samples of m_cur's output already mixed with m_old's
+  double m_fade_c, m_fade_s, m_fade_rc, m_fade_rs; // gains of m_old/m_cur, rotated by (m_fade_rc,m_fade_rs) per sample
+
+} WDL_FIXALIGN;
+
+
 #endif
\ No newline at end of file
@@ -208,7 +208,7 @@ static void fft_reorder_buffer(int bitsz, WDL_FFT_COMPLEX *data, int fwd)
 
 // 0=fw, 1=iv, 2=fwreal, 3=ireal, 4=permutec, 6=permuter
 // low bit: is inverse
-// second bit: was isreal, but no longer used
+// second bit: is real (WDL_real_fft(), 1<<sizebits real items rather than complex)
 // third bit: is permute
 static void FFT(int sizebits, EEL_F *data, int dir)
 {
@@ -255,6 +255,12 @@ static void FFT(int sizebits, EEL_F *data, int dir)
 	{
     WDL_fft((WDL_FFT_COMPLEX*)data,1<<sizebits,dir&1);
 	}
+#ifndef WDL_FFT_NO_PERMUTE
+  else if (dir >= 2 && dir < 4)
+  {
+    WDL_real_fft(data,1<<sizebits,dir&1);
+  }
+#endif
 }
 
 
@@ -306,6 +312,18 @@ static EEL_F * NSEEL_CGEN_CALL  eel_ifft(EEL_F **blocks, EEL_F *start, EEL_F *le
   return fft_func(1,blocks,start,length);
 }
 
+#ifndef WDL_FFT_NO_PERMUTE
+static EEL_F * NSEEL_CGEN_CALL  eel_rfft(EEL_F **blocks, EEL_F *start, EEL_F *length)
+{
+  return fft_func(2,blocks,start,length);
+}
+
+static EEL_F * NSEEL_CGEN_CALL  eel_irfft(EEL_F **blocks, EEL_F *start, EEL_F *length)
+{
+  return fft_func(3,blocks,start,length);
+}
+#endif
+
 static EEL_F * NSEEL_CGEN_CALL  eel_fft_permute(EEL_F **blocks, EEL_F *start, EEL_F *length)
 {
   return fft_func(4,blocks,start,length);
@@ -335,9 +353,42 @@ static EEL_F * NSEEL_CGEN_CALL eel_convolve_c(EEL_F **blocks,EEL_F *dest, EEL_F
 
 
   WDL_fft_complexmul((WDL_FFT_COMPLEX*)destptr,(WDL_FFT_COMPLEX*)srcptr,(len/2)&~1);
+  if (len&2)
+  {
+    // WDL_fft_complexmul() works in pairs, do the odd item
+    EEL_F *d = destptr + len - 2;
+    const EEL_F *s = srcptr + len - 2;
+    const EEL_F re = d[0]*s[0] - d[1]*s[1];
+    d[1] = d[0]*s[1] + d[1]*s[0];
+    d[0] = re;
+  }
+
+  return dest;
+}
+
+#ifndef WDL_FFT_NO_PERMUTE
+static EEL_F * NSEEL_CGEN_CALL eel_convolve_r(EEL_F **blocks,EEL_F *dest, EEL_F *src, EEL_F *lenptr)
+{
+	const int dest_offs = (int)(*dest + 0.0001);
+	const int src_offs = (int)(*src + 0.0001);
+  const int len = (int)(*lenptr + 0.0001);
+  EEL_F *srcptr,*destptr;
+
+  if (len < 4 || (len&3) || len > NSEEL_RAM_ITEMSPERBLOCK || dest_offs < 0 || src_offs < 0 || 
+      dest_offs >= NSEEL_RAM_BLOCKS*NSEEL_RAM_ITEMSPERBLOCK || src_offs >= NSEEL_RAM_BLOCKS*NSEEL_RAM_ITEMSPERBLOCK) return dest;
+  if ((dest_offs&(NSEEL_RAM_ITEMSPERBLOCK-1)) + len > NSEEL_RAM_ITEMSPERBLOCK) return dest;
+  if ((src_offs&(NSEEL_RAM_ITEMSPERBLOCK-1)) + len > NSEEL_RAM_ITEMSPERBLOCK) return dest;
+
+  srcptr = __NSEEL_RAMAlloc(blocks,src_offs);
+  if (!srcptr || srcptr==&nseel_ramalloc_onfail) return dest;
+  destptr = __NSEEL_RAMAlloc(blocks,dest_offs);
+  if (!destptr || destptr==&nseel_ramalloc_onfail) return dest;
+
+  WDL_fft_realmul(destptr,srcptr,len);
 
   return dest;
 }
+#endif
 
 void EEL_fft_register()
 {
@@ -354,11 +405,16 @@ void EEL_fft_register()
   NSEEL_addfunc_retptr("ifft",2,NSEEL_PProc_RAM,&eel_ifft);
   NSEEL_addfunc_retptr("fft_permute",2,NSEEL_PProc_RAM,&eel_fft_permute);
   NSEEL_addfunc_retptr("fft_ipermute",2,NSEEL_PProc_RAM,&eel_ifft_permute);
+#ifndef WDL_FFT_NO_PERMUTE
+  NSEEL_addfunc_retptr("convolve_r",3,NSEEL_PProc_RAM,&eel_convolve_r);
+  NSEEL_addfunc_retptr("rfft",2,NSEEL_PProc_RAM,&eel_rfft);
+  NSEEL_addfunc_retptr("irfft",2,NSEEL_PProc_RAM,&eel_irfft);
+#endif
 }
 
 #ifdef EEL_WANT_DOCUMENTATION
 static const char *eel_fft_function_reference =
-"convolve_c\t\0"
+"convolve_c\tdest,src,size\tMultiplies each of size complex pairs in dest by those in src, for convolving fft() outputs.\0"
 "fft\tbuffer,size\tPerforms a FFT on the data in the local memory buffer at the offset specified by the first parameter. The size of the FFT is specified "
                   "by the second parameter, which must be 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, or 32768. The outputs are permuted, so if "
                   "you plan to use them in-order, call fft_permute(idx, size) before and fft_ipermute(idx,size) after your in-order use. Your inputs or "
@@ -368,6 +424,11 @@ static const char *eel_fft_function_reference =
 "ifft\tbuffer,size\tPerform an inverse FFT. For more information see fft().\0"
 "fft_permute\tbuffer,size\tPermute the output of fft() to have bands in-order. See fft() for more information.\0"
 "fft_ipermute\tbuffer,size\tPermute the input for ifft(), taking bands from in-order to the order ifft() requires. See fft() for more information.\0"
+"rfft\tbuffer,size\tPerforms a real FFT on size items at the offset specified by the first parameter, in place. size must be 16 to 32768. "
+                  "The output is size/2 complex pairs: the first pair holds the DC and nyquist (both real), the rest are bands 1..size/2-1, permuted "
+                  "like fft() outputs (for sizes of 32 or more, call fft_permute(buffer,size/2) to have them in-order). About twice as fast as fft() on real signals.\0"
+"irfft\tbuffer,size\tPerforms an inverse real FFT, taking the format rfft() outputs back to size items. Like fft(), rfft()+irfft() scales by size.\0"
+"convolve_r\tdest,src,size\tMultiplies the rfft() output of size items in dest by that in src (size must be a multiple of 4).\0"
 ;
 #endif
 
@@ -36,18 +36,21 @@ void *NSEEL_PProc_THIS(void *data, int data_size, struct _compileContext *ctx);
 
 #ifdef EEL_TARGET_PORTABLE
 
-extern EEL_BC_TYPE _asm_generic3parm[]; // 3 double * parms, returning double *
-extern EEL_BC_TYPE _asm_generic3parm_end[];
-extern EEL_BC_TYPE _asm_generic3parm_retd[]; // 3 double * parms, returning double
-extern EEL_BC_TYPE _asm_generic3parm_retd_end[];
-extern EEL_BC_TYPE _asm_generic2parm[]; // 2 double * parms, returning double *
-extern EEL_BC_TYPE _asm_generic2parm_end[];
-extern EEL_BC_TYPE _asm_generic2parm_retd[]; // 2 double * parms, returning double
-extern EEL_BC_TYPE _asm_generic2parm_retd_end[];
-extern EEL_BC_TYPE _asm_generic1parm[]; // 1 double * parms, returning double *
-extern EEL_BC_TYPE _asm_generic1parm_end[];
-extern EEL_BC_TYPE _asm_generic1parm_retd[]; // 1 double * parms, returning double 
-extern EEL_BC_TYPE _asm_generic1parm_retd_end[];
+// the stubs are sized here so their ends don't depend on how the linker lays out data
+#define EEL_BC_GENERIC_STUB_LEN (1 + (2*sizeof(INT_PTR))/sizeof(EEL_BC_TYPE))
+extern EEL_BC_TYPE _asm_generic3parm[EEL_BC_GENERIC_STUB_LEN]; // 3 double * parms, returning double *
+extern EEL_BC_TYPE _asm_generic3parm_retd[EEL_BC_GENERIC_STUB_LEN]; // 3 double * parms, returning double
+extern EEL_BC_TYPE _asm_generic2parm[EEL_BC_GENERIC_STUB_LEN]; // 2 double * parms, returning double *
+extern EEL_BC_TYPE _asm_generic2parm_retd[EEL_BC_GENERIC_STUB_LEN]; // 2 double * parms, returning double
+extern EEL_BC_TYPE _asm_generic1parm[EEL_BC_GENERIC_STUB_LEN]; // 1 double * parms, returning double *
+extern EEL_BC_TYPE _asm_generic1parm_retd[EEL_BC_GENERIC_STUB_LEN]; // 1 double * parms, returning double 
+
+#define _asm_generic3parm_end (_asm_generic3parm + EEL_BC_GENERIC_STUB_LEN)
+#define _asm_generic3parm_retd_end (_asm_generic3parm_retd + EEL_BC_GENERIC_STUB_LEN)
+#define _asm_generic2parm_end (_asm_generic2parm + EEL_BC_GENERIC_STUB_LEN)
+#define _asm_generic2parm_retd_end (_asm_generic2parm_retd + EEL_BC_GENERIC_STUB_LEN)
+#define _asm_generic1parm_end (_asm_generic1parm + EEL_BC_GENERIC_STUB_LEN)
+#define _asm_generic1parm_retd_end (_asm_generic1parm_retd + EEL_BC_GENERIC_STUB_LEN)
 
 #else
 
@@ -155,6 +155,13 @@ typedef struct {
   void *ramPtr;
 
   int workTable_size; // size (minus padding/extra space) of workTable -- only used if EEL_VALIDATE_WORKTABLE_USE set, but might be handy to have around too
+
+  // NSEEL_CODE_COMPILE_FLAG_BLOCK: the code loops block_count times, calling nseel_block_nextframe() first each time
+  int block_mode;
+  EEL_F block_count; // 1 outside of NSEEL_code_execute_block(), so NSEEL_code_execute() runs the code once
+  int block_pos, block_nin, block_nout;
+  EEL_F **block_ins, **block_outs;
+  EEL_F *block_vars[NSEEL_BLOCK_MAX_CHANNELS]; // splN, NULL if the code doesn't use it
 } codeHandleType;
 
 
@@ -183,11 +190,14 @@ typedef struct _compileContext
 
   int l_stats[4]; // source bytes, static code bytes, call code bytes, data bytes
   int has_used_global_vars;
+  int codegenFlags; // NSEEL_VM_FLAG_*, from NSEEL_VM_alloc_ex()
 
   _codeHandleFunctionRec *functions_local, *functions_common;
 
   // state used while generating functions
   int optimizeDisableFlags;
+  int ramReserveDirective; // largest //#eel-ram: of the current compile, recorded by the code cache
+  int zeroNewBlocks; // set while compiling code the code cache will snapshot, see __newBlock()
   struct opcodeRec *directValueCache; // linked list using fn as next
 
   int isSharedFunctions;
@@ -213,6 +223,9 @@ typedef struct _compileContext
     int __pad;
     double closefact;
     EEL_F *blocks[NSEEL_RAM_BLOCKS];
+    // set by NSEEL_VM_reserveRAM(). must immediately follow blocks: compiled code only passes the blocks pointer to
+    // __NSEEL_RAMAlloc(), which reads the arena from blocks[NSEEL_RAM_BLOCKS] (see NSEEL_RAM_ARENA in nseel-ram.c)
+    struct _eelRAMArena *arena;
   } ram_state
 #ifdef __GNUC__
     __attribute__ ((aligned (8)))
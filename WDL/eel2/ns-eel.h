@@ -119,6 +119,10 @@ typedef void *NSEEL_VMCTX;
 typedef void *NSEEL_CODEHANDLE;
 
 NSEEL_VMCTX NSEEL_VM_alloc(); // return a handle
+NSEEL_VMCTX NSEEL_VM_alloc_ex(int flags); // flags are NSEEL_VM_FLAG_*
+
+#define NSEEL_VM_FLAG_CODECACHE 1 // share compiled code between VMs that compile the same source, see NSEEL_code_cache_flush()
+
 void NSEEL_VM_free(NSEEL_VMCTX ctx); // free when done with a VM and ALL of its code have been freed, as well
 
 void NSEEL_VM_SetFunctionTable(NSEEL_VMCTX, eel_function_table *tab); // use NULL to use default (global) table
@@ -135,6 +139,14 @@ void NSEEL_VM_freeRAM(NSEEL_VMCTX ctx); // clears and frees all (VM) RAM used
 void NSEEL_VM_freeRAMIfCodeRequested(NSEEL_VMCTX); // call after code to free the script-requested memory
 int NSEEL_VM_wantfreeRAM(NSEEL_VMCTX ctx); // want NSEEL_VM_freeRAMIfCodeRequested?
 
+// preallocated RAM: once reserved, megabuf blocks are served from the VM's arena without allocating or locking,
+// so code can run on a real-time thread. when the arena is used up, accesses fail (as with NSEEL_RAM_limitmem) and are counted.
+// scripts compiled afterwards can grow the arena with a "//#eel-ram:<items>" line, and the shared gmem is allocated when
+// code using it is compiled. freeing RAM returns blocks to the arena.
+int NSEEL_VM_reserveRAM(NSEEL_VMCTX ctx, int nitems); // grows the arena to at least nitems (0 just enables it), returns items reserved or -1
+int NSEEL_VM_getRAMOverflows(NSEEL_VMCTX ctx); // number of accesses that found the arena empty
+void NSEEL_VM_freeRAMArena(NSEEL_VMCTX ctx); // frees VM RAM and the arena, back to allocating on demand
+
 // if you set this, it uses a local GMEM context. 
 // Must be set before compilation. 
 // void *p=NULL; 
@@ -163,12 +175,29 @@ int nseel_stringsegments_tobuf(char *bufOut, int bufout_sz, struct eelStringSegm
 NSEEL_CODEHANDLE NSEEL_code_compile(NSEEL_VMCTX ctx, const char *code, int lineoffs);
 #define NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS 1 // allows that code's functions to be used in other code (note you shouldn't destroy that codehandle without destroying others first if used)
 #define NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS_RESET 2 // resets common code functions
+#define NSEEL_CODE_COMPILE_FLAG_BLOCK 4 // compiles the code as the body of a loop over frames, for NSEEL_code_execute_block()
 
 NSEEL_CODEHANDLE NSEEL_code_compile_ex(NSEEL_VMCTX ctx, const char *code, int lineoffs, int flags);
 
+// VMs allocated with NSEEL_VM_FLAG_CODECACHE share a process-wide cache of compiled code, keyed by the source, flags
+// and function table. Once the same source has compiled in two VMs, further compiles copy the code and relocate it to
+// the VM's variables and memory rather than parsing/generating it again. Code using common functions, the stack, or
+// strings (if the VM has string callbacks) is never cached. Functions added with pprocs must only embed values that
+// are process-global or derived from the VM (its RAM, gmem or caller_this). The cache is in memory only.
+// NSEEL_code_cache_flush() frees the cache, and must not be called while compiling.
+void NSEEL_code_cache_flush();
+
 char *NSEEL_code_getcodeerror(NSEEL_VMCTX ctx);
 int NSEEL_code_geterror_flag(NSEEL_VMCTX ctx);
 void NSEEL_code_execute(NSEEL_CODEHANDLE code);
+
+// Runs code compiled with NSEEL_CODE_COMPILE_FLAG_BLOCK once per frame, entering the compiled code only once: before
+// each frame spl0..spl(nin-1) are set from ins[ch][frame], after it spl0..spl(nout-1) are written to outs[ch][frame]
+// (ins and outs may be the same buffers). Channels whose splN the code never mentions are passed through (or zeroed,
+// past nin). Up to NSEEL_BLOCK_MAX_CHANNELS channels. Code compiled without the flag has no channels bound, it just
+// runs nframes times. Returns the number of frames processed, less than nframes only if the frame loop could not run
+// them all, in which case the rest of the outputs are zeroed.
+int NSEEL_code_execute_block(NSEEL_CODEHANDLE code, int nframes, EEL_F **ins, int nin, EEL_F **outs, int nout);
 void NSEEL_code_free(NSEEL_CODEHANDLE code);
 int *NSEEL_code_getstats(NSEEL_CODEHANDLE code); // 4 ints...source bytes, static code bytes, call code bytes, data bytes
   
@@ -226,6 +255,8 @@ extern int NSEEL_RAM_memused_errors;
 
 #define NSEEL_STACK_SIZE 4096 // about 64k overhead if the stack functions are used in a given code handle
 
+#define NSEEL_BLOCK_MAX_CHANNELS 64 // spl0..spl63 for NSEEL_code_execute_block()
+
 // arch neutral mode, runs about 1/8th speed or so
 //#define EEL_TARGET_PORTABLE
 
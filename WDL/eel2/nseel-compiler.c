@@ -29,6 +29,7 @@
 
 #include "../denormal.h"
 #include "../wdlcstring.h"
+#include "../fnv64.h"
 
 #include <string.h>
 #include <math.h>
@@ -163,7 +164,7 @@ static int nseel_vms_referencing_globallist_cnt;
 nseel_globalVarItem *nseel_globalreg_list;
 static EEL_F *get_global_var(compileContext *ctx, const char *gv, int addIfNotPresent);
 
-static void *__newBlock(llBlock **start,int size, int wantMprotect);
+static void *__newBlock(llBlock **start,int size, int wantMprotect, int wantZero);
 
 #define OPCODE_IS_TRIVIAL(x) ((x)->opcodeType <= OPCODETYPE_VARPTRPTR)
 enum {
@@ -211,7 +212,7 @@ static void *newTmpBlock(compileContext *ctx, int size)
 {
   const int align = 8;
   const int a1=align-1;
-  char *p=(char*)__newBlock(&ctx->tmpblocks_head,size+a1, 0);
+  char *p=(char*)__newBlock(&ctx->tmpblocks_head,size+a1, 0, 0);
   return p+((align-(((INT_PTR)p)&a1))&a1);
 }
 
@@ -222,7 +223,7 @@ static void *__newBlock_align(compileContext *ctx, int size, int align, int isFo
                             (                            
                              isForCode < 0 ? (isForCode == -2 ? &ctx->pblocks : &ctx->tmpblocks_head) : 
                              isForCode > 0 ? &ctx->blocks_head : 
-                             &ctx->blocks_head_data) ,size+a1, isForCode>0);
+                             &ctx->blocks_head_data) ,size+a1, isForCode>0, isForCode>=0 && ctx->zeroNewBlocks);
   return p+((align-(((INT_PTR)p)&a1))&a1);
 }
 
@@ -355,6 +356,7 @@ void _asm_gmegabuf_end(void);
 
 static void *NSEEL_PProc_GRAM(void *data, int data_size, compileContext *ctx)
 {
+  if (ctx->ram_state.arena && !ctx->gram_blocks) __NSEEL_RAMAllocGMEM(NULL,0); // allocate the shared gmem now rather than when the code runs
   if (data_size>0) data=EEL_GLUE_set_immediate(data, (INT_PTR)ctx->gram_blocks);
   return data;
 }
@@ -622,7 +624,7 @@ void NSEEL_addfunc_ret_type(const char *name, int np, int ret_type,  NSEEL_PPPRO
   int stubsz=0;
 #define DOSTUB(np) { \
     stub = (char *)(ret_type == 1 ? &_asm_generic##np##parm_retd : &_asm_generic##np##parm); \
-    stubsz = (int) ((ret_type == 1 ? (char*)&_asm_generic##np##parm_retd_end : (char *)&_asm_generic##np##parm_end) - stub); \
+    stubsz = (int) ((ret_type == 1 ? (char*)_asm_generic##np##parm_retd_end : (char *)_asm_generic##np##parm_end) - stub); \
   }
 
   if (np == 1) DOSTUB(1)
@@ -707,23 +709,18 @@ static void freeBlocks(llBlock **start)
 }
 
 //---------------------------------------------------------------------------------------------------------------
-static void *__newBlock(llBlock **start, int size, int wantMprotect)
+// new blocks start allocating at a LLB_ALIGN boundary, and __newBlock() can zero what it hands out, so that identical
+// compiles produce identical block contents (the code cache depends on this)
+#define LLB_ALIGN 32
+static llBlock *__allocBlock(int size, int wantMprotect)
 {
 #if !defined(EEL_DOESNT_NEED_EXEC_PERMS) && defined(_WIN32)
   DWORD ov;
   UINT_PTR offs,eoffs;
 #endif
   llBlock *llb;
-  int alloc_size;
-  if (*start && (LLB_DSIZE - (*start)->sizeused) >= size)
-  {
-    void *t=(*start)->block+(*start)->sizeused;
-    (*start)->sizeused+=(size+7)&~7;
-    return t;
-  }
-
-  alloc_size=sizeof(llBlock);
-  if ((int)size > LLB_DSIZE) alloc_size += size - LLB_DSIZE;
+  int alloc_size=sizeof(llBlock);
+  if ((int)size > LLB_DSIZE - LLB_ALIGN) alloc_size += size - LLB_DSIZE + LLB_ALIGN;
   llb = (llBlock *)malloc(alloc_size); // grab bigger block if absolutely necessary (heh)
   if (!llb) return NULL;
   
@@ -751,10 +748,33 @@ static void *__newBlock(llBlock **start, int size, int wantMprotect)
   #endif
   }
 #endif
-  llb->sizeused=(size+7)&~7;
+  llb->next = NULL;
+  llb->sizeused = (int) ((LLB_ALIGN - (((INT_PTR)llb->block)&(LLB_ALIGN-1)))&(LLB_ALIGN-1));
+  return llb;
+}
+
+// wantZero clears the space handed out (including alignment padding), only needed when the block will be snapshotted
+static void *__newBlock(llBlock **start, int size, int wantMprotect, int wantZero)
+{
+  llBlock *llb;
+  void *t;
+  if (*start && (LLB_DSIZE - (*start)->sizeused) >= size)
+  {
+    t=(*start)->block+(*start)->sizeused;
+    (*start)->sizeused+=(size+7)&~7;
+    if (wantZero) memset(t,0,(size+7)&~7);
+    return t;
+  }
+
+  llb = __allocBlock(size,wantMprotect);
+  if (!llb) return NULL;
+
+  t=llb->block+llb->sizeused;
+  llb->sizeused+=(size+7)&~7;
+  if (wantZero) memset(t,0,(size+7)&~7);
   llb->next = *start;  
   *start = llb;
-  return llb->block;
+  return t;
 }
 
 
@@ -3925,9 +3945,48 @@ typedef struct topLevelCodeSegmentRec {
 } topLevelCodeSegmentRec;
 
 
-NSEEL_CODEHANDLE NSEEL_code_compile_ex(NSEEL_VMCTX _ctx, const char *_expression, int lineoffs, int compile_flags)
+// NSEEL_CODE_COMPILE_FLAG_BLOCK: the frame loop calls this before each frame, it stores the frame before's outputs 
+// and loads this frame's inputs
+static EEL_F * NSEEL_CGEN_CALL nseel_block_nextframe(void *opaque, EEL_F *parm)
+{
+  codeHandleType *h = (codeHandleType *)opaque;
+  const int pos = h->block_pos++;
+  int ch;
+  if (pos > 0)
+  {
+    for (ch = 0; ch < h->block_nout; ch ++)
+      if (h->block_vars[ch]) h->block_outs[ch][pos-1] = *h->block_vars[ch];
+  }
+  for (ch = 0; ch < h->block_nin; ch ++)
+    if (h->block_vars[ch]) *h->block_vars[ch] = h->block_ins[ch][pos];
+  return parm;
+}
+
+static void *NSEEL_PProc_Block(void *data, int data_size, compileContext *ctx)
+{
+  if (data_size>0) data=EEL_GLUE_set_immediate(data, (INT_PTR)ctx->tmpCodeHandle);
+  return data;
+}
+
+static functionType nseel_block_nextframe_func = 
+  { "__block_nextframe", _asm_generic1parm,_asm_generic1parm_end, 1, {&nseel_block_nextframe}, NSEEL_PProc_Block };
+
+static opcodeRec *nseel_createBlockJoin(compileContext *ctx, opcodeRec *code1, opcodeRec *code2)
+{
+  opcodeRec *r = code1 && code2 ? newOpCode(ctx,NULL,OPCODETYPE_FUNC2) : NULL;
+  if (r)
+  {
+    r->fntype = FN_JOIN_STATEMENTS;
+    r->fn = r;
+    r->parms.parms[0] = code1;
+    r->parms.parms[1] = code2;
+  }
+  return r;
+}
+
+
+static NSEEL_CODEHANDLE nseel_code_compile_int(compileContext *ctx, const char *_expression, int lineoffs, int compile_flags)
 {
-  compileContext *ctx = (compileContext *)_ctx;
   const char *endptr;
   const char *_expression_end;
   codeHandleType *handle;
@@ -3937,11 +3996,13 @@ NSEEL_CODEHANDLE NSEEL_code_compile_ex(NSEEL_VMCTX _ctx, const char *_expression
   int curtabptr_sz=0;
   void *curtabptr=NULL;
   int had_err=0;
+  opcodeRec *block_body=NULL, *block_tail=NULL;
 
   if (!ctx) return 0;
 
   ctx->directValueCache=0;
   ctx->optimizeDisableFlags=0;
+  ctx->ramReserveDirective=0;
   ctx->gotEndOfInput=0;
 
   if (compile_flags & NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS_RESET)
@@ -4049,6 +4110,12 @@ NSEEL_CODEHANDLE NSEEL_code_compile_ex(NSEEL_VMCTX _ctx, const char *_expression
         {
           if (l > 19 && !strnicmp(p,"//#eel-no-optimize:",19))
             ctx->optimizeDisableFlags = atoi(p+19);
+          else if (l > 11 && !strnicmp(p,"//#eel-ram:",11) && ctx->ram_state.arena)
+          {
+            const int n = atoi(p+11);
+            NSEEL_VM_reserveRAM(ctx,n);
+            if (n > ctx->ramReserveDirective) ctx->ramReserveDirective = n;
+          }
         }
         else
         {
@@ -4244,6 +4311,30 @@ NSEEL_CODEHANDLE NSEEL_code_compile_ex(NSEEL_VMCTX _ctx, const char *_expression
      ctx->rdbuf = NULL;
    }
            
+    if (start_opcode && !is_fname[0] && (compile_flags & NSEEL_CODE_COMPILE_FLAG_BLOCK))
+    {
+      // top level code is collected into the body of the frame loop, which is compiled once everything is parsed:
+      // __block_nextframe(); code; code; ...
+      if (!block_body)
+      {
+        opcodeRec *nf = newOpCode(ctx,NULL,OPCODETYPE_FUNC1);
+        if (nf)
+        {
+          nf->fntype = FUNCTYPE_FUNCTIONTYPEREC;
+          nf->fn = &nseel_block_nextframe_func;
+          nf->parms.parms[0] = nseel_createCompiledValuePtr(ctx,&handle->block_count,NULL);
+        }
+        block_body = block_tail = nseel_createBlockJoin(ctx,nf,start_opcode);
+      }
+      else
+      {
+        block_tail->parms.parms[1] = nseel_createBlockJoin(ctx,block_tail->parms.parms[1],start_opcode);
+        block_tail = block_tail->parms.parms[1];
+      }
+      if (block_tail) continue;
+      start_opcode = NULL; // out of memory, fail
+    }
+
     if (start_opcode)
     {
       int rvMode=0, fUse=0;
@@ -4461,6 +4552,42 @@ had_error:
   ctx->function_curName=NULL;
   ctx->function_globalFlag=0;
 
+  if (block_body && !had_err)
+  {
+    // loop(block_count, __block_nextframe(); code...) as the only top level segment
+    int computTableTop = 0, sz = -1;
+    void *startptr = NULL;
+    opcodeRec *op = newOpCode(ctx,NULL,OPCODETYPE_FUNC2);
+    if (op)
+    {
+      op->fntype = FN_LOOP;
+      op->parms.parms[0] = nseel_createCompiledValuePtr(ctx,&handle->block_count,NULL);
+      op->parms.parms[1] = block_body;
+
+      if (!(ctx->optimizeDisableFlags&OPTFLAG_NO_OPTIMIZE)) optimizeOpcodes(ctx,op,0);
+      sz = compileOpcodes(ctx,op,NULL,1024*1024*256,NULL,NULL,RETURNVALUE_IGNORE,NULL,NULL,NULL);
+      if (sz > 0 && (startptr = newTmpBlock(ctx,sz)) != NULL)
+        sz = compileOpcodes(ctx,op,(unsigned char*)startptr,sz,&computTableTop,NULL,RETURNVALUE_IGNORE,NULL,NULL,NULL);
+    }
+
+    if (!startptr || sz <= 0)
+    {
+      lstrcpyn_safe(ctx->last_error_string,"error compiling block loop",sizeof(ctx->last_error_string));
+      had_err=1;
+      startpts=startpts_tail=NULL;
+    }
+    else
+    {
+      topLevelCodeSegmentRec *p = newTmpBlock(ctx,sizeof(topLevelCodeSegmentRec));
+      p->_next=0;
+      p->code = startptr;
+      p->codesz = sz;
+      p->tmptable_use = computTableTop;
+      startpts=startpts_tail=p;
+      if (curtabptr_sz < computTableTop) curtabptr_sz=computTableTop;
+    }
+  }
+
   ctx->tmpCodeHandle = NULL;
     
   if (handle->want_stack)
@@ -4558,6 +4685,18 @@ had_error:
   if (handle)
   {
     handle->ramPtr = ctx->ram_state.blocks;
+    handle->block_count = 1.0;
+    if (block_body)
+    {
+      int ch;
+      handle->block_mode = 1;
+      for (ch = 0; ch < NSEEL_BLOCK_MAX_CHANNELS; ch ++)
+      {
+        char name[32];
+        snprintf(name,sizeof(name),"spl%d",ch);
+        if (NSEEL_VM_get_var_refcnt(ctx,name) >= 0) handle->block_vars[ch] = nseel_int_register_var(ctx,name,0,NULL);
+      }
+    }
     memcpy(handle->code_stats,ctx->l_stats,sizeof(ctx->l_stats));
     nseel_evallib_stats[0]+=ctx->l_stats[0];
     nseel_evallib_stats[1]+=ctx->l_stats[1];
@@ -4581,6 +4720,625 @@ had_error:
   return (NSEEL_CODEHANDLE)handle;
 }
 
+//------------------------------------------------------------------------------
+// compiled code cache (NSEEL_VM_FLAG_CODECACHE)
+//
+// the generated code and data embed absolute addresses (variables, the worktable, the VM's RAM, other blocks),
+// so an image can't be shared as-is. instead, the first compile of a source is snapshotted along with every
+// pointer-sized window that refers to something in that VM, and the second compile (in another VM) is compared
+// against it: if every byte that differs is explained by one of those windows referring to the same thing in
+// both VMs, the windows become relocations. later compiles copy the blocks and patch the relocations for
+// their VM, skipping the parser and code generator. if anything can't be explained, the source is not cached.
+
+enum {
+  CCREL_CODE=0, // idx/delta: offset into block image
+  CCREL_CTX, // delta: offset into compileContext
+  CCREL_THIS, // caller_this
+  CCREL_GRAM, // gram_blocks
+  CCREL_VAR, // name (idx: slot in vars, once ready)
+  CCREL_GLOBAL, // name (_global.*)
+};
+
+enum {
+  CCSTATE_PENDING=0, // have a snapshot and candidate relocations, waiting for a second compile
+  CCSTATE_BUSY, // another thread is comparing against the snapshot
+  CCSTATE_READY, // relocations verified, compiles are served from the images
+  CCSTATE_FAILED, // not cacheable
+};
+
+typedef struct
+{
+  int blk, offs; // location of the pointer in the images
+  int kind, idx;
+  INT_PTR delta;
+  char *name;
+} nseel_ccReloc;
+
+typedef struct
+{
+  int isCode, len;
+  INT_PTR addr; // address of the image in the snapshotted VM (only used while learning)
+  unsigned char *image;
+} nseel_ccBlock;
+
+typedef struct
+{
+  const void *functab;
+  int functab_size;
+  int lineoffs, compile_flags, codegenFlags;
+  int has_this, has_gram, has_arena;
+} nseel_ccKey;
+
+typedef struct nseel_ccEntry
+{
+  struct nseel_ccEntry *_next;
+  WDL_UINT64 hash;
+  nseel_ccKey key;
+  char *src;
+
+  int state;
+  int nblocks;
+  nseel_ccBlock *blocks;
+  int handle_blk, handle_offs;
+  int nrelocs;
+  nseel_ccReloc *relocs; // candidates while pending, relocations once ready
+  int nvars;
+  char **vars; // once ready, names of CCREL_VAR/CCREL_GLOBAL relocations (indexed by idx)
+  int l_stats[4];
+  int optimizeDisableFlags, ramReserveDirective; // left in ctx by //#eel-no-optimize: and //#eel-ram:
+} nseel_ccEntry;
+
+static nseel_ccEntry *nseel_cc_list;
+
+typedef struct
+{
+  INT_PTR addr;
+  const char *name;
+} nseel_ccGlobalRec;
+
+static void nseel_cc_setstate(nseel_ccEntry *ent, int state)
+{
+  NSEEL_HOSTSTUB_EnterMutex();
+  ent->state = state;
+  NSEEL_HOSTSTUB_LeaveMutex();
+}
+
+static char *nseel_cc_strdup(const char *s)
+{
+  const size_t l = strlen(s)+1;
+  char *r = (char *)malloc(l);
+  if (r) memcpy(r,s,l);
+  return r;
+}
+
+static void nseel_cc_freeentrydata(nseel_ccEntry *ent)
+{
+  int x;
+  for (x=0;x<ent->nblocks;x++) free(ent->blocks[x].image);
+  if (ent->vars) for (x=0;x<ent->nvars;x++) free(ent->vars[x]);
+  else for (x=0;x<ent->nrelocs;x++) free(ent->relocs[x].name);
+  free(ent->blocks);
+  free(ent->relocs);
+  free(ent->vars);
+  ent->blocks=NULL;
+  ent->relocs=NULL;
+  ent->vars=NULL;
+  ent->nblocks=ent->nrelocs=ent->nvars=0;
+}
+
+static int nseel_cc_eligible(compileContext *ctx, const char *expr, int compile_flags)
+{
+  if (!(ctx->codegenFlags & NSEEL_VM_FLAG_CODECACHE) || !expr || !*expr) return 0;
+
+  // common functions are shared with other code handles in the VM, so can't be relocated into a new handle
+  if (compile_flags & NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS) return 0;
+  if (ctx->functions_common && !(compile_flags & NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS_RESET)) return 0;
+
+  // string literals become VM-specific values via the string callbacks
+  if ((ctx->onString || ctx->onNamedString) && (strchr(expr,'"') || strchr(expr,'#'))) return 0;
+  return 1;
+}
+
+static WDL_UINT64 nseel_cc_makekey(compileContext *ctx, const char *expr, int lineoffs, int compile_flags, nseel_ccKey *key)
+{
+  eel_function_table *tab = ctx->registered_func_tab ? ctx->registered_func_tab : &default_user_funcs;
+  memset(key,0,sizeof(*key));
+  key->functab = tab;
+  key->functab_size = tab->list_size;
+  key->lineoffs = lineoffs;
+  key->compile_flags = compile_flags & ~NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS_RESET;
+  key->codegenFlags = ctx->codegenFlags;
+  key->has_this = !!ctx->caller_this;
+  key->has_gram = !!ctx->gram_blocks;
+  key->has_arena = !!ctx->ram_state.arena;
+  return WDL_FNV64(WDL_FNV64(WDL_FNV64_IV,(const unsigned char *)expr,(int)strlen(expr)),(const unsigned char *)key,sizeof(*key));
+}
+
+static nseel_ccEntry *nseel_cc_find(WDL_UINT64 hash, const nseel_ccKey *key, const char *expr)
+{
+  nseel_ccEntry *ent = nseel_cc_list;
+  while (ent)
+  {
+    if (ent->hash == hash && !memcmp(&ent->key,key,sizeof(*key)) && !strcmp(ent->src,expr)) return ent;
+    ent=ent->_next;
+  }
+  return NULL;
+}
+
+// returns the images of the handle's blocks (code blocks first), or NULL on failure
+static nseel_ccBlock *nseel_cc_snapshot(codeHandleType *h, int *nblocks_out, int *handle_blk, int *handle_offs)
+{
+  int n=0, x=0, pass;
+  llBlock *b;
+  nseel_ccBlock *list;
+
+  for (pass=0;pass<2;pass++)
+    for (b = pass ? h->blocks_data : h->blocks; b; b=b->next) n++;
+
+  list = (nseel_ccBlock *)calloc(n,sizeof(nseel_ccBlock));
+  if (!list) return NULL;
+
+  *handle_blk = -1;
+  for (pass=0;pass<2;pass++)
+  {
+    for (b = pass ? h->blocks_data : h->blocks; b; b=b->next, x++)
+    {
+      const int start = (int) ((LLB_ALIGN - (((INT_PTR)b->block)&(LLB_ALIGN-1)))&(LLB_ALIGN-1));
+      nseel_ccBlock *cb = list + x;
+      cb->isCode = !pass;
+      cb->len = b->sizeused - start;
+      cb->addr = (INT_PTR) (b->block + start);
+      cb->image = (unsigned char *)malloc(cb->len > 0 ? cb->len : 1);
+      if (!cb->image)
+      {
+        while (x >= 0) free(list[x--].image);
+        free(list);
+        return NULL;
+      }
+      memcpy(cb->image,b->block + start,cb->len);
+
+      if (pass && (INT_PTR)h >= cb->addr && (INT_PTR)h + (INT_PTR)sizeof(*h) <= cb->addr + cb->len)
+      {
+        // the block lists are set up per-handle
+        codeHandleType *ih = (codeHandleType *)(cb->image + ((INT_PTR)h - cb->addr));
+        *handle_blk = x;
+        *handle_offs = (int) ((INT_PTR)h - cb->addr);
+        ih->blocks = ih->blocks_data = NULL;
+      }
+    }
+  }
+  *nblocks_out = n;
+  if (*handle_blk < 0)
+  {
+    for (x=0;x<n;x++) free(list[x].image);
+    free(list);
+    return NULL;
+  }
+  return list;
+}
+
+// classifies v as something belonging to ctx/the code handle, returns 0 if it's not
+static int nseel_cc_classify(compileContext *ctx, const nseel_ccBlock *blocks, int nblocks,
+                             const nseel_ccGlobalRec *globals, int nglobals, INT_PTR v, nseel_ccReloc *out)
+{
+  int x;
+  for (x=0;x<nblocks;x++)
+  {
+    if (v >= blocks[x].addr && v <= blocks[x].addr + blocks[x].len)
+    {
+      out->kind=CCREL_CODE;
+      out->idx=x;
+      out->delta = v - blocks[x].addr;
+      out->name=NULL;
+      return 1;
+    }
+  }
+  out->idx=0;
+  out->delta=0;
+  out->name=NULL;
+  if (v >= (INT_PTR)ctx && v < (INT_PTR)(ctx+1))
+  {
+    out->kind=CCREL_CTX;
+    out->delta = v - (INT_PTR)ctx;
+    return 1;
+  }
+  if (ctx->caller_this && v == (INT_PTR)ctx->caller_this)
+  {
+    out->kind=CCREL_THIS;
+    return 1;
+  }
+  if (ctx->gram_blocks && v == (INT_PTR)ctx->gram_blocks)
+  {
+    out->kind=CCREL_GRAM;
+    return 1;
+  }
+  for (x=0;x<ctx->varTable_numBlocks;x++)
+  {
+    const INT_PTR base = (INT_PTR)ctx->varTable_Values[x];
+    if (base && v >= base && v < base + (INT_PTR) (NSEEL_VARS_PER_BLOCK*sizeof(EEL_F)) && !((v-base)%sizeof(EEL_F)))
+    {
+      const int ti = (int) ((v-base)/sizeof(EEL_F));
+      if (!ctx->varTable_Names[x] || !ctx->varTable_Names[x][ti]) return 0;
+      out->kind=CCREL_VAR;
+      out->name=ctx->varTable_Names[x][ti];
+      return 1;
+    }
+  }
+  for (x=0;x<nglobals;x++)
+  {
+    if (v == globals[x].addr)
+    {
+      out->kind=CCREL_GLOBAL;
+      out->name=(char *)globals[x].name;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static nseel_ccGlobalRec *nseel_cc_getglobals(int *nglobals)
+{
+  nseel_ccGlobalRec *list=NULL;
+  nseel_globalVarItem *p;
+  int n=0;
+  NSEEL_HOSTSTUB_EnterMutex();
+  for (p=nseel_globalreg_list;p;p=p->_next) n++;
+  if (n) list = (nseel_ccGlobalRec *)malloc(n*sizeof(nseel_ccGlobalRec));
+  if (!list) n=0;
+  for (p=nseel_globalreg_list, n=0; p && list; p=p->_next, n++)
+  {
+    list[n].addr = (INT_PTR)&p->data;
+    list[n].name = p->name;
+  }
+  NSEEL_HOSTSTUB_LeaveMutex();
+  *nglobals=n;
+  return list;
+}
+
+// first compile: record everything in the images that refers to ctx
+static int nseel_cc_findcandidates(compileContext *ctx, nseel_ccEntry *ent)
+{
+  int nglobals, x, alloc=0;
+  nseel_ccGlobalRec *globals = nseel_cc_getglobals(&nglobals);
+  for (x=0;x<ent->nblocks;x++)
+  {
+    const nseel_ccBlock *cb = ent->blocks + x;
+    int o;
+    for (o=0;o + (int)sizeof(INT_PTR) <= cb->len;o++)
+    {
+      INT_PTR v;
+      nseel_ccReloc r;
+      memcpy(&v,cb->image + o,sizeof(v));
+      if (!nseel_cc_classify(ctx,ent->blocks,ent->nblocks,globals,nglobals,v,&r)) continue;
+
+      if (ent->nrelocs >= alloc)
+      {
+        nseel_ccReloc *nr = (nseel_ccReloc *)realloc(ent->relocs,(alloc = alloc*2+64)*sizeof(nseel_ccReloc));
+        if (!nr) { free(globals); return 0; }
+        ent->relocs = nr;
+      }
+      r.blk=x;
+      r.offs=o;
+      if (r.name && !(r.name = nseel_cc_strdup(r.name))) { free(globals); return 0; }
+      ent->relocs[ent->nrelocs++] = r;
+      o += sizeof(INT_PTR)-1;
+    }
+  }
+  free(globals);
+  return 1;
+}
+
+// second compile: keep the candidates that refer to the same thing in ctx, and make sure they explain every difference
+static int nseel_cc_verify(compileContext *ctx, nseel_ccEntry *ent, const nseel_ccBlock *blocks, int nblocks)
+{
+  int nglobals, x, ci=0, nout=0, ok=1;
+  nseel_ccGlobalRec *globals;
+
+  if (nblocks != ent->nblocks) return 0;
+  for (x=0;x<nblocks;x++)
+    if (blocks[x].isCode != ent->blocks[x].isCode || blocks[x].len != ent->blocks[x].len) return 0;
+
+  globals = nseel_cc_getglobals(&nglobals);
+  for (x=0;x<nblocks && ok;x++)
+  {
+    const unsigned char *a = ent->blocks[x].image, *b = blocks[x].image;
+    int o;
+    for (o=0;o<blocks[x].len;o++)
+    {
+      while (ci < ent->nrelocs && (ent->relocs[ci].blk < x || (ent->relocs[ci].blk == x && ent->relocs[ci].offs < o)))
+      {
+        free(ent->relocs[ci].name);
+        ci++;
+      }
+      if (ci < ent->nrelocs && ent->relocs[ci].blk == x && ent->relocs[ci].offs == o)
+      {
+        nseel_ccReloc *cand = ent->relocs + ci, r;
+        INT_PTR v;
+        memcpy(&v,b + o,sizeof(v));
+        if (nseel_cc_classify(ctx,blocks,nblocks,globals,nglobals,v,&r) && r.kind == cand->kind &&
+            r.idx == cand->idx && r.delta == cand->delta &&
+            (!r.name || !strcmp(r.name,cand->name)))
+        {
+          ent->relocs[nout++] = *cand; // keeps the name
+          ci++;
+          o += sizeof(INT_PTR)-1;
+          continue;
+        }
+      }
+      if (a[o] != b[o]) { ok=0; break; }
+    }
+  }
+  while (ci < ent->nrelocs) free(ent->relocs[ci++].name);
+  ent->nrelocs = nout;
+  free(globals);
+  return ok;
+}
+
+// gives each distinct variable one slot, so instantiating looks each up once
+static int nseel_cc_internvars(nseel_ccEntry *ent)
+{
+  int x, y;
+  char **vars = (char **)malloc((ent->nrelocs+1) * sizeof(char *));
+  if (!vars) return 0;
+  ent->nvars=0;
+  for (x=0;x<ent->nrelocs;x++)
+  {
+    nseel_ccReloc *r = ent->relocs + x;
+    if (!r->name) continue;
+    for (y=0;y<ent->nvars;y++)
+    {
+      if (ent->relocs[(INT_PTR)vars[y]].kind == r->kind && !strcmp(ent->relocs[(INT_PTR)vars[y]].name,r->name)) break;
+    }
+    if (y == ent->nvars) vars[ent->nvars++] = (char *)(INT_PTR)x;
+    r->idx = y;
+  }
+  // take ownership of the first copy of each name
+  for (y=0;y<ent->nvars;y++) vars[y] = ent->relocs[(INT_PTR)vars[y]].name;
+  for (x=0;x<ent->nrelocs;x++)
+  {
+    nseel_ccReloc *r = ent->relocs + x;
+    if (!r->name) continue;
+    if (r->name != vars[r->idx]) free(r->name);
+    r->name = vars[r->idx];
+  }
+  ent->vars = vars;
+  return 1;
+}
+
+static llBlock *nseel_cc_clonelist(const nseel_ccEntry *ent, int isCode, INT_PTR *addrs)
+{
+  llBlock *head=NULL, **tail = &head;
+  int x;
+  for (x=0;x<ent->nblocks;x++)
+  {
+    llBlock *b;
+    if (ent->blocks[x].isCode != isCode) continue;
+
+    b = __allocBlock(ent->blocks[x].len,isCode);
+    if (!b)
+    {
+      freeBlocks(&head);
+      return NULL;
+    }
+    addrs[x] = (INT_PTR) (b->block + b->sizeused);
+    memcpy(b->block + b->sizeused,ent->blocks[x].image,ent->blocks[x].len);
+    b->sizeused += ent->blocks[x].len;
+    *tail = b;
+    tail = &b->next;
+  }
+  return head;
+}
+
+static codeHandleType *nseel_cc_instantiate(compileContext *ctx, const nseel_ccEntry *ent)
+{
+  INT_PTR *addrs = (INT_PTR *)calloc(ent->nblocks+ent->nvars,sizeof(INT_PTR)), *varaddrs;
+  llBlock *code=NULL, *data=NULL;
+  codeHandleType *h;
+  int x;
+
+  if (!addrs) return NULL;
+  code = nseel_cc_clonelist(ent,1,addrs);
+  data = code ? nseel_cc_clonelist(ent,0,addrs) : NULL;
+  if (!data)
+  {
+    freeBlocks(&code);
+    free(addrs);
+    return NULL;
+  }
+
+  varaddrs = addrs + ent->nblocks;
+  for (x=0;x<ent->nrelocs;x++)
+  {
+    const nseel_ccReloc *r = ent->relocs + x;
+    INT_PTR v=0;
+    switch (r->kind)
+    {
+      case CCREL_CODE: v = addrs[r->idx] + r->delta; break;
+      case CCREL_CTX: v = (INT_PTR)ctx + r->delta; break;
+      case CCREL_THIS: v = (INT_PTR)ctx->caller_this; break;
+      case CCREL_GRAM: v = (INT_PTR)ctx->gram_blocks; break;
+      case CCREL_VAR:
+        if (!varaddrs[r->idx]) varaddrs[r->idx] = (INT_PTR)nseel_int_register_var(ctx,r->name,0,NULL);
+        v = varaddrs[r->idx];
+      break;
+      case CCREL_GLOBAL:
+        if (!varaddrs[r->idx]) varaddrs[r->idx] = (INT_PTR)get_global_var(ctx,r->name,1);
+        v = varaddrs[r->idx];
+      break;
+    }
+    if (!v) break;
+    memcpy((char *)addrs[r->blk] + r->offs,&v,sizeof(v));
+  }
+
+  if (x < ent->nrelocs)
+  {
+    freeBlocks(&code);
+    freeBlocks(&data);
+    free(addrs);
+    return NULL;
+  }
+
+  h = (codeHandleType *) (addrs[ent->handle_blk] + ent->handle_offs);
+  h->blocks = code;
+  h->blocks_data = data;
+  free(addrs);
+  return h;
+}
+
+// applies the side effects of the compile's directives, which aren't captured in the images
+static void nseel_cc_applydirectives(compileContext *ctx, const nseel_ccEntry *ent)
+{
+  ctx->optimizeDisableFlags = ent->optimizeDisableFlags;
+  ctx->ramReserveDirective = ent->ramReserveDirective;
+  if (ent->ramReserveDirective && ctx->ram_state.arena) NSEEL_VM_reserveRAM(ctx,ent->ramReserveDirective);
+}
+
+static void nseel_cc_learn(compileContext *ctx, nseel_ccEntry *ent, const char *expr, WDL_UINT64 hash,
+                           const nseel_ccKey *key, codeHandleType *h)
+{
+  int nblocks=0, hblk=0, hoffs=0;
+  nseel_ccBlock *blocks;
+
+  if (h->want_stack) blocks = NULL; // the stack is aligned relative to its absolute address
+  else blocks = nseel_cc_snapshot(h,&nblocks,&hblk,&hoffs);
+
+  if (!ent)
+  {
+    ent = (nseel_ccEntry *)calloc(1,sizeof(nseel_ccEntry));
+    if (!ent)
+    {
+      if (blocks) { while (nblocks > 0) free(blocks[--nblocks].image); free(blocks); }
+      return;
+    }
+    ent->hash = hash;
+    ent->key = *key;
+    ent->src = nseel_cc_strdup(expr);
+    ent->blocks = blocks;
+    ent->nblocks = blocks ? nblocks : 0;
+    ent->handle_blk = hblk;
+    ent->handle_offs = hoffs;
+    memcpy(ent->l_stats,h->code_stats,sizeof(ent->l_stats));
+    ent->optimizeDisableFlags = ctx->optimizeDisableFlags;
+    ent->ramReserveDirective = ctx->ramReserveDirective;
+    ent->state = CCSTATE_BUSY;
+
+    NSEEL_HOSTSTUB_EnterMutex();
+    if (!ent->src || nseel_cc_find(hash,key,expr))
+    {
+      // lost a race with another thread compiling the same code
+      NSEEL_HOSTSTUB_LeaveMutex();
+      nseel_cc_freeentrydata(ent);
+      free(ent->src);
+      free(ent);
+      return;
+    }
+    ent->_next = nseel_cc_list;
+    nseel_cc_list = ent;
+    NSEEL_HOSTSTUB_LeaveMutex();
+
+    if (blocks && nseel_cc_findcandidates(ctx,ent))
+    {
+      nseel_cc_setstate(ent,CCSTATE_PENDING);
+    }
+    else
+    {
+      nseel_cc_freeentrydata(ent);
+      nseel_cc_setstate(ent,CCSTATE_FAILED);
+    }
+    return;
+  }
+
+  // ent->state is CCSTATE_BUSY and owned by us
+  if (blocks && nseel_cc_verify(ctx,ent,blocks,nblocks) && nseel_cc_internvars(ent))
+  {
+    int x;
+    for (x=0;x<nblocks;x++) free(blocks[x].image);
+    free(blocks);
+    nseel_cc_setstate(ent,CCSTATE_READY);
+  }
+  else
+  {
+    if (blocks) { while (nblocks > 0) free(blocks[--nblocks].image); free(blocks); }
+    nseel_cc_freeentrydata(ent);
+    nseel_cc_setstate(ent,CCSTATE_FAILED);
+  }
+}
+
+NSEEL_CODEHANDLE NSEEL_code_compile_ex(NSEEL_VMCTX _ctx, const char *_expression, int lineoffs, int compile_flags)
+{
+  compileContext *ctx = (compileContext *)_ctx;
+  nseel_ccEntry *ent=NULL;
+  nseel_ccKey key;
+  WDL_UINT64 hash=0;
+  codeHandleType *h;
+  int snapshot=0; // set if this compile will be snapshotted, or compared against a snapshot
+  const int use_cache = ctx && nseel_cc_eligible(ctx,_expression,compile_flags);
+
+  if (use_cache)
+  {
+    int st;
+    hash = nseel_cc_makekey(ctx,_expression,lineoffs,compile_flags,&key);
+
+    NSEEL_HOSTSTUB_EnterMutex();
+    ent = nseel_cc_find(hash,&key,_expression);
+    st = ent ? ent->state : -1;
+    if (st == CCSTATE_PENDING) ent->state = CCSTATE_BUSY;
+    NSEEL_HOSTSTUB_LeaveMutex();
+
+    if (st == CCSTATE_READY)
+    {
+      if (compile_flags & NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS_RESET) ctx->functions_common=NULL;
+      ctx->last_error_string[0]=0;
+      ctx->gotEndOfInput=0;
+      h = nseel_cc_instantiate(ctx,ent);
+      if (h)
+      {
+        nseel_cc_applydirectives(ctx,ent);
+        nseel_evallib_stats[0]+=ent->l_stats[0];
+        nseel_evallib_stats[1]+=ent->l_stats[1];
+        nseel_evallib_stats[2]+=ent->l_stats[2];
+        nseel_evallib_stats[3]+=ent->l_stats[3];
+        nseel_evallib_stats[4]++;
+        return (NSEEL_CODEHANDLE)h;
+      }
+    }
+    snapshot = st == CCSTATE_PENDING || st == -1;
+    if (!snapshot) ent=NULL;
+  }
+
+  if (ctx) ctx->zeroNewBlocks = snapshot;
+  h = (codeHandleType *)nseel_code_compile_int(ctx,_expression,lineoffs,compile_flags);
+  if (ctx) ctx->zeroNewBlocks = 0;
+
+  if (snapshot && (h || ent))
+  {
+    if (h && !ctx->functions_common) nseel_cc_learn(ctx,ent,_expression,hash,&key,h);
+    else if (ent)
+    {
+      nseel_cc_freeentrydata(ent);
+      nseel_cc_setstate(ent,CCSTATE_FAILED);
+    }
+  }
+  return (NSEEL_CODEHANDLE)h;
+}
+
+void NSEEL_code_cache_flush()
+{
+  nseel_ccEntry *ent;
+  NSEEL_HOSTSTUB_EnterMutex();
+  ent = nseel_cc_list;
+  nseel_cc_list = NULL;
+  NSEEL_HOSTSTUB_LeaveMutex();
+  while (ent)
+  {
+    nseel_ccEntry *next = ent->_next;
+    nseel_cc_freeentrydata(ent);
+    free(ent->src);
+    free(ent);
+    ent = next;
+  }
+}
+
 //------------------------------------------------------------------------------
 void NSEEL_code_execute(NSEEL_CODEHANDLE code)
 {
@@ -4607,6 +5365,71 @@ void NSEEL_code_execute(NSEEL_CODEHANDLE code)
 
 }
 
+int NSEEL_code_execute_block(NSEEL_CODEHANDLE code, int nframes, EEL_F **ins, int nin, EEL_F **outs, int nout)
+{
+  codeHandleType *h = (codeHandleType *)code;
+  int ch;
+  if (!h || !h->code || nframes < 1) return 0;
+
+  if (!h->block_mode)
+  {
+    for (ch = 0; ch < nframes; ch ++) NSEEL_code_execute(code);
+    return nframes;
+  }
+
+  if (nin < 0 || !ins) nin = 0;
+  if (nout < 0 || !outs) nout = 0;
+  if (nin > NSEEL_BLOCK_MAX_CHANNELS) nin = NSEEL_BLOCK_MAX_CHANNELS;
+  if (nout > NSEEL_BLOCK_MAX_CHANNELS) nout = NSEEL_BLOCK_MAX_CHANNELS;
+
+  // channels the code doesn't touch
+  for (ch = 0; ch < nout; ch ++)
+  {
+    if (h->block_vars[ch]) continue;
+    if (ch >= nin) memset(outs[ch],0,nframes*sizeof(EEL_F));
+    else if (outs[ch] != ins[ch]) memcpy(outs[ch],ins[ch],nframes*sizeof(EEL_F));
+  }
+
+  h->block_ins = ins;
+  h->block_outs = outs;
+  h->block_nin = nin;
+  h->block_nout = nout;
+
+  h->block_pos = 0;
+
+  while (h->block_pos < nframes)
+  {
+    const int start = h->block_pos;
+    int n = nframes - start;
+#if NSEEL_LOOPFUNC_SUPPORT_MAXLEN > 0
+    if (n > NSEEL_LOOPFUNC_SUPPORT_MAXLEN) n = NSEEL_LOOPFUNC_SUPPORT_MAXLEN;
+#endif
+    h->block_count = (EEL_F) n;
+    NSEEL_code_execute(code);
+    if (h->block_pos != start + n) break;
+  }
+
+  if (h->block_pos == nframes)
+  {
+    // the loop stores each frame's outputs when it starts the next one, so the last one is left
+    for (ch = 0; ch < nout; ch ++)
+      if (h->block_vars[ch]) outs[ch][nframes-1] = *h->block_vars[ch];
+  }
+  else
+  {
+    // the frame loop didn't run every frame (it can't be entered with the count it was given), so the frames
+    // it never got to are silenced rather than left holding their input
+    const int done = h->block_pos > 0 && h->block_pos < nframes ? h->block_pos - 1 : 0;
+    for (ch = 0; ch < nout; ch ++)
+      if (h->block_vars[ch]) memset(outs[ch]+done,0,(nframes-done)*sizeof(EEL_F));
+    nframes = done;
+  }
+
+  h->block_count = 1.0;
+  h->block_nin = h->block_nout = 0;
+  return nframes;
+}
+
 int NSEEL_code_geterror_flag(NSEEL_VMCTX ctx)
 {
   compileContext *c=(compileContext *)ctx;
@@ -4692,6 +5515,11 @@ static void NSEEL_VM_freevars(NSEEL_VMCTX _ctx)
 
 
 NSEEL_VMCTX NSEEL_VM_alloc() // return a handle
+{
+  return NSEEL_VM_alloc_ex(0);
+}
+
+NSEEL_VMCTX NSEEL_VM_alloc_ex(int flags)
 {
   compileContext *ctx=calloc(1,sizeof(compileContext));
 
@@ -4714,6 +5542,7 @@ NSEEL_VMCTX NSEEL_VM_alloc() // return a handle
   if (ctx) 
   {
     ctx->ram_state.closefact = NSEEL_CLOSEFACTOR;
+    ctx->codegenFlags = flags;
   }
   return ctx;
 }
@@ -4733,6 +5562,7 @@ void NSEEL_VM_free(NSEEL_VMCTX _ctx) // free when done with a VM and ALL of its
     compileContext *ctx=(compileContext *)_ctx;
     NSEEL_VM_freevars(_ctx);
     NSEEL_VM_freeRAM(_ctx);
+    NSEEL_VM_freeRAMArena(_ctx);
 
     freeBlocks(&ctx->pblocks);
 
@@ -37,6 +37,40 @@ unsigned int NSEEL_RAM_memused=0;
 int NSEEL_RAM_memused_errors=0;
 
 
+// preallocated RAM for a VM, see NSEEL_VM_reserveRAM(). megabuf faults take blocks from here rather than
+// calloc()ing them, and fail (counting an overflow) once it is used up.
+typedef struct _eelRAMArena
+{
+  EEL_F *chunks[NSEEL_RAM_BLOCKS]; // one allocation per reserve that grew the arena
+  EEL_F *freeblocks[NSEEL_RAM_BLOCKS];
+  char owned[NSEEL_RAM_BLOCKS]; // set if ram_state.blocks[x] came from the arena
+  int nchunks, nfree, nblocks;
+  int overflows;
+} eelRAMArena;
+
+// ram_state.arena follows ram_state.blocks
+#define NSEEL_RAM_ARENA(blocks) (*(eelRAMArena **)((blocks) + NSEEL_RAM_BLOCKS))
+
+static void nseel_ram_freeblock(EEL_F **blocks, int x)
+{
+  eelRAMArena *arena = NSEEL_RAM_ARENA(blocks);
+  if (arena && arena->owned[x])
+  {
+    // back to the arena, cleared as a new block would be
+    memset(blocks[x],0,sizeof(EEL_F)*NSEEL_RAM_ITEMSPERBLOCK);
+    arena->freeblocks[arena->nfree++] = blocks[x];
+    arena->owned[x] = 0;
+  }
+  else
+  {
+    if (NSEEL_RAM_memused >= sizeof(EEL_F) * NSEEL_RAM_ITEMSPERBLOCK) 
+      NSEEL_RAM_memused -= sizeof(EEL_F) * NSEEL_RAM_ITEMSPERBLOCK;
+    else NSEEL_RAM_memused_errors++;
+    free(blocks[x]);
+  }
+  blocks[x]=0;
+}
+
 
 int NSEEL_VM_wantfreeRAM(NSEEL_VMCTX ctx)
 {
@@ -66,14 +100,7 @@ void NSEEL_VM_freeRAMIfCodeRequested(NSEEL_VMCTX ctx) // check to see if our fre
   		  {
 				  if (pos >= startpos)
 				  {
-					  if (blocks[x])
-					  {
-						  if (NSEEL_RAM_memused >= sizeof(EEL_F) * NSEEL_RAM_ITEMSPERBLOCK) 
-							  NSEEL_RAM_memused -= sizeof(EEL_F) * NSEEL_RAM_ITEMSPERBLOCK;
-						  else NSEEL_RAM_memused_errors++;
-       	 	    free(blocks[x]);
-       	 	    blocks[x]=0;
-					  }
+					  if (blocks[x]) nseel_ram_freeblock(blocks,x);
 				  }
 				  pos+=NSEEL_RAM_ITEMSPERBLOCK;
  			  }
@@ -140,7 +167,18 @@ EEL_F * NSEEL_CGEN_CALL  __NSEEL_RAMAlloc(EEL_F **pblocks, unsigned int w)
   {
     unsigned int whichblock = w/NSEEL_RAM_ITEMSPERBLOCK;
     EEL_F *p=pblocks[whichblock];
-    if (!p)
+    if (!p && NSEEL_RAM_ARENA(pblocks))
+    {
+      // no locking or allocating: the arena belongs to this VM
+      eelRAMArena *arena = NSEEL_RAM_ARENA(pblocks);
+      if (arena->nfree > 0)
+      {
+        p=pblocks[whichblock]=arena->freeblocks[--arena->nfree];
+        arena->owned[whichblock]=1;
+      }
+      else arena->overflows++;
+    }
+    else if (!p)
     {
       NSEEL_HOSTSTUB_EnterMutex();
 
@@ -322,19 +360,81 @@ void NSEEL_VM_freeRAM(NSEEL_VMCTX ctx)
     EEL_F **blocks = c->ram_state.blocks;
     for (x = 0; x < NSEEL_RAM_BLOCKS; x ++)
     {
-	    if (blocks[x])
-	    {
-		    if (NSEEL_RAM_memused >= sizeof(EEL_F) * NSEEL_RAM_ITEMSPERBLOCK) 
-			    NSEEL_RAM_memused -= sizeof(EEL_F) * NSEEL_RAM_ITEMSPERBLOCK;
-		    else NSEEL_RAM_memused_errors++;
-        free(blocks[x]);
-        blocks[x]=0;
-	    }
+	    if (blocks[x]) nseel_ram_freeblock(blocks,x);
     }
     c->ram_state.needfree=0; // no need to free anymore
   }
 }
 
+int NSEEL_VM_reserveRAM(NSEEL_VMCTX ctx, int nitems)
+{
+  compileContext *c=(compileContext*)ctx;
+  eelRAMArena *arena;
+  int n;
+  if (!c) return -1;
+
+  if (!(arena = c->ram_state.arena))
+  {
+    arena = (eelRAMArena *)calloc(1,sizeof(eelRAMArena));
+    if (!arena) return -1;
+    c->ram_state.arena = arena; // blocks that were allocated on demand before this are kept
+  }
+
+  if (nitems < 0) nitems=0;
+  n = nitems/NSEEL_RAM_ITEMSPERBLOCK + ((nitems&(NSEEL_RAM_ITEMSPERBLOCK-1)) ? 1 : 0);
+  if (n > NSEEL_RAM_BLOCKS) n = NSEEL_RAM_BLOCKS;
+  n -= arena->nblocks;
+
+  if (n > 0)
+  {
+    const unsigned int msize=sizeof(EEL_F) * NSEEL_RAM_ITEMSPERBLOCK;
+    EEL_F *mem=NULL;
+    NSEEL_HOSTSTUB_EnterMutex();
+    if (NSEEL_RAM_limitmem)
+    {
+      const unsigned int avail = NSEEL_RAM_limitmem > NSEEL_RAM_memused ? (NSEEL_RAM_limitmem - NSEEL_RAM_memused - 1) / msize : 0;
+      if ((unsigned int)n > avail) n = (int)avail;
+    }
+    if (n > 0) mem = (EEL_F *)calloc(sizeof(EEL_F),n*NSEEL_RAM_ITEMSPERBLOCK);
+    if (mem)
+    {
+      // handed out from the front of the chunk first
+      int x;
+      for (x = n-1; x >= 0; x --) arena->freeblocks[arena->nfree++] = mem + x*NSEEL_RAM_ITEMSPERBLOCK;
+      arena->chunks[arena->nchunks++] = mem;
+      arena->nblocks += n;
+      NSEEL_RAM_memused += n*msize;
+    }
+    NSEEL_HOSTSTUB_LeaveMutex();
+  }
+  return arena->nblocks * NSEEL_RAM_ITEMSPERBLOCK;
+}
+
+int NSEEL_VM_getRAMOverflows(NSEEL_VMCTX ctx)
+{
+  compileContext *c=(compileContext*)ctx;
+  return c && c->ram_state.arena ? c->ram_state.arena->overflows : 0;
+}
+
+void NSEEL_VM_freeRAMArena(NSEEL_VMCTX ctx)
+{
+  compileContext *c=(compileContext*)ctx;
+  eelRAMArena *arena = c ? c->ram_state.arena : NULL;
+  if (arena)
+  {
+    const unsigned int asize=arena->nblocks * sizeof(EEL_F) * NSEEL_RAM_ITEMSPERBLOCK;
+    int x;
+    NSEEL_VM_freeRAM(ctx);
+
+    for (x = 0; x < arena->nchunks; x ++) free(arena->chunks[x]);
+    if (NSEEL_RAM_memused >= asize) NSEEL_RAM_memused -= asize;
+    else NSEEL_RAM_memused_errors++;
+
+    free(arena);
+    c->ram_state.arena = NULL;
+  }
+}
+
 void NSEEL_VM_FreeGRAM(void **ufd)
 {
   if (ufd[0])
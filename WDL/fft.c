@@ -59,6 +59,199 @@ static WDL_FFT_COMPLEX d32768[4095];
 
 #define sqrthalf (d16[1].re)
 
+#ifndef WDL_FFT_NO_SIMD
+
+/*
+  SIMD versions of the radix-4 passes and complex multiplies (see fft_simd.h), chosen by WDL_fft_init():
+    float:  AVX if the CPU/OS supports it, else SSE. NEON on ARM64.
+    double: AVX if supported, else SSE2.
+  They only replace the work done inside cpass/cpassbig/upass/upassbig and WDL_fft_complexmul*, so the output
+  order (and WDL_fft_permute()) is unchanged. Define WDL_FFT_NO_SIMD to build without them.
+*/
+
+typedef struct
+{
+  int (*fwd)(WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, int);
+  int (*fwdrev)(WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, int);
+  int (*inv)(WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, int);
+  int (*invrev)(WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, int);
+  int (*cplxmul)(WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, int);
+  int (*cplxmul2)(WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, int);
+  int (*cplxmul3)(WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, const WDL_FFT_COMPLEX *, int);
+  int (*splitmul)(WDL_FFT_REAL *, WDL_FFT_REAL *, const WDL_FFT_REAL *, const WDL_FFT_REAL *, const WDL_FFT_REAL *, const WDL_FFT_REAL *, int, int);
+} fft_simd_funcs;
+
+static const fft_simd_funcs *fft_simd;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define FFT_SIMD_SSE
+  #if defined(_MSC_VER) || (defined(__clang__) || __GNUC__ >= 5)
+    #define FFT_SIMD_AVX
+  #endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && WDL_FFT_REALSIZE == 4
+  #define FFT_SIMD_NEON
+#endif
+
+#ifdef FFT_SIMD_SSE
+
+#ifdef FFT_SIMD_AVX
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#include <emmintrin.h>
+#endif
+
+#if WDL_FFT_REALSIZE == 4
+
+#define FFTV_T __m128
+#define FFTV_K 2
+#define FFTV_LOAD(p) _mm_loadu_ps((const float *)(p))
+#define FFTV_STORE(p,v) _mm_storeu_ps((float *)(p),v)
+#define FFTV_LOADWREV(p) _mm_shuffle_ps(FFTV_LOAD((p)-1),FFTV_LOAD((p)-1),_MM_SHUFFLE(0,1,2,3))
+#define FFTV_ADD _mm_add_ps
+#define FFTV_SUB _mm_sub_ps
+#define FFTV_MUL _mm_mul_ps
+#define FFTV_SWAP(v) _mm_shuffle_ps(v,v,_MM_SHUFFLE(2,3,0,1))
+#define FFTV_DUPRE(v) _mm_shuffle_ps(v,v,_MM_SHUFFLE(2,2,0,0))
+#define FFTV_DUPIM(v) _mm_shuffle_ps(v,v,_MM_SHUFFLE(3,3,1,1))
+#define FFTV_NEGRE(v) _mm_xor_ps(v,_mm_set_ps(0.0f,-0.0f,0.0f,-0.0f))
+
+#else
+
+#define FFTV_T __m128d
+#define FFTV_K 1
+#define FFTV_LOAD(p) _mm_loadu_pd((const double *)(p))
+#define FFTV_STORE(p,v) _mm_storeu_pd((double *)(p),v)
+#define FFTV_LOADWREV(p) FFTV_SWAP(FFTV_LOAD(p))
+#define FFTV_ADD _mm_add_pd
+#define FFTV_SUB _mm_sub_pd
+#define FFTV_MUL _mm_mul_pd
+#define FFTV_SWAP(v) _mm_shuffle_pd(v,v,1)
+#define FFTV_DUPRE(v) _mm_unpacklo_pd(v,v)
+#define FFTV_DUPIM(v) _mm_unpackhi_pd(v,v)
+#define FFTV_NEGRE(v) _mm_xor_pd(v,_mm_set_pd(0.0,-0.0))
+
+#endif
+
+#define FFT_SIMD_FUNC(x) fft_sse_##x
+#define FFT_SIMD_ATTR
+#include "fft_simd.h"
+#undef FFT_SIMD_FUNC
+#undef FFT_SIMD_ATTR
+#undef FFTV_T
+#undef FFTV_K
+#undef FFTV_LOAD
+#undef FFTV_STORE
+#undef FFTV_LOADWREV
+#undef FFTV_ADD
+#undef FFTV_SUB
+#undef FFTV_MUL
+#undef FFTV_SWAP
+#undef FFTV_DUPRE
+#undef FFTV_DUPIM
+#undef FFTV_NEGRE
+
+#ifdef FFT_SIMD_AVX
+
+#if WDL_FFT_REALSIZE == 4
+
+#define FFTV_T __m256
+#define FFTV_K 4
+#define FFTV_LOAD(p) _mm256_loadu_ps((const float *)(p))
+#define FFTV_STORE(p,v) _mm256_storeu_ps((float *)(p),v)
+#define FFTV_LOADWREV(p) _mm256_permute_ps(_mm256_permute2f128_ps(FFTV_LOAD((p)-3),FFTV_LOAD((p)-3),1),_MM_SHUFFLE(0,1,2,3))
+#define FFTV_ADD _mm256_add_ps
+#define FFTV_SUB _mm256_sub_ps
+#define FFTV_MUL _mm256_mul_ps
+#define FFTV_SWAP(v) _mm256_permute_ps(v,_MM_SHUFFLE(2,3,0,1))
+#define FFTV_DUPRE(v) _mm256_moveldup_ps(v)
+#define FFTV_DUPIM(v) _mm256_movehdup_ps(v)
+#define FFTV_NEGRE(v) _mm256_xor_ps(v,_mm256_set_ps(0.0f,-0.0f,0.0f,-0.0f,0.0f,-0.0f,0.0f,-0.0f))
+
+#else
+
+#define FFTV_T __m256d
+#define FFTV_K 2
+#define FFTV_LOAD(p) _mm256_loadu_pd((const double *)(p))
+#define FFTV_STORE(p,v) _mm256_storeu_pd((double *)(p),v)
+#define FFTV_LOADWREV(p) _mm256_permute_pd(_mm256_permute2f128_pd(FFTV_LOAD((p)-1),FFTV_LOAD((p)-1),1),5)
+#define FFTV_ADD _mm256_add_pd
+#define FFTV_SUB _mm256_sub_pd
+#define FFTV_MUL _mm256_mul_pd
+#define FFTV_SWAP(v) _mm256_permute_pd(v,5)
+#define FFTV_DUPRE(v) _mm256_movedup_pd(v)
+#define FFTV_DUPIM(v) _mm256_permute_pd(v,15)
+#define FFTV_NEGRE(v) _mm256_xor_pd(v,_mm256_set_pd(0.0,-0.0,0.0,-0.0))
+
+#endif
+
+#define FFT_SIMD_FUNC(x) fft_avx_##x
+#ifdef _MSC_VER
+#define FFT_SIMD_ATTR
+#else
+#define FFT_SIMD_ATTR __attribute__((target("avx")))
+#endif
+#include "fft_simd.h"
+#undef FFT_SIMD_FUNC
+#undef FFT_SIMD_ATTR
+
+static int fft_cpu_has_avx(void)
+{
+#ifdef _MSC_VER
+  int r[4];
+  __cpuid(r,1);
+  if ((r[2] & ((1<<27)|(1<<28))) != ((1<<27)|(1<<28))) return 0; // OSXSAVE, AVX
+  return (_xgetbv(0) & 6) == 6; // OS saves xmm/ymm
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx");
+#endif
+}
+
+#endif // FFT_SIMD_AVX
+
+#elif defined(FFT_SIMD_NEON)
+
+#include <arm_neon.h>
+
+static const float fft_neon_negre[4] = { -1.0f, 1.0f, -1.0f, 1.0f };
+
+#define FFTV_T float32x4_t
+#define FFTV_K 2
+#define FFTV_LOAD(p) vld1q_f32((const float *)(p))
+#define FFTV_STORE(p,v) vst1q_f32((float *)(p),v)
+#define FFTV_LOADWREV(p) vextq_f32(vrev64q_f32(FFTV_LOAD((p)-1)),vrev64q_f32(FFTV_LOAD((p)-1)),2)
+#define FFTV_ADD vaddq_f32
+#define FFTV_SUB vsubq_f32
+#define FFTV_MUL vmulq_f32
+#define FFTV_SWAP(v) vrev64q_f32(v)
+#define FFTV_DUPRE(v) vtrn1q_f32(v,v)
+#define FFTV_DUPIM(v) vtrn2q_f32(v,v)
+#define FFTV_NEGRE(v) vmulq_f32(v,vld1q_f32(fft_neon_negre))
+
+#define FFT_SIMD_FUNC(x) fft_neon_##x
+#define FFT_SIMD_ATTR
+#include "fft_simd.h"
+#undef FFT_SIMD_FUNC
+#undef FFT_SIMD_ATTR
+
+#endif
+
+static void fft_simd_init(void)
+{
+#if defined(FFT_SIMD_AVX)
+  fft_simd = fft_cpu_has_avx() ? &fft_avx_funcs : &fft_sse_funcs;
+#elif defined(FFT_SIMD_SSE)
+  fft_simd = &fft_sse_funcs;
+#elif defined(FFT_SIMD_NEON)
+  fft_simd = &fft_neon_funcs;
+#endif
+}
+
+#endif // WDL_FFT_NO_SIMD
+
 #define VOL *(volatile WDL_FFT_REAL *)&
 
 #define TRANSFORM(a0,a1,a2,a3,wre,wim) { \
@@ -514,6 +707,16 @@ static void cpass(register WDL_FFT_COMPLEX *a,register const WDL_FFT_COMPLEX *w,
   TRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
   TRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
 
+#ifndef WDL_FFT_NO_SIMD
+  if (fft_simd)
+  {
+    const int cnt = 2 * n;
+    int i = fft_simd->fwd(a + 2,a1 + 2,a2 + 2,a3 + 2,w + 1,cnt);
+    for (; i < cnt; i ++) TRANSFORM(a[2+i],a1[2+i],a2[2+i],a3[2+i],w[1+i].re,w[1+i].im);
+    return;
+  }
+#endif
+
   for (;;) {
     TRANSFORM(a[2],a1[2],a2[2],a3[2],w[1].re,w[1].im);
     TRANSFORM(a[3],a1[3],a2[3],a3[3],w[2].re,w[2].im);
@@ -582,6 +785,23 @@ static void cpassbig(register WDL_FFT_COMPLEX *a,register const WDL_FFT_COMPLEX
 
   TRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
   TRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+#ifndef WDL_FFT_NO_SIMD
+  if (fft_simd)
+  {
+    const int cnt = n - 2;
+    int i = fft_simd->fwd(a + 2,a1 + 2,a2 + 2,a3 + 2,w + 1,cnt);
+    for (; i < cnt; i ++) TRANSFORM(a[2+i],a1[2+i],a2[2+i],a3[2+i],w[1+i].re,w[1+i].im);
+
+    TRANSFORMHALF(a[n],a1[n],a2[n],a3[n]);
+    TRANSFORM(a[n+1],a1[n+1],a2[n+1],a3[n+1],w[n-2].im,w[n-2].re);
+
+    i = fft_simd->fwdrev(a + n + 2,a1 + n + 2,a2 + n + 2,a3 + n + 2,w + n - 3,cnt);
+    for (; i < cnt; i ++) TRANSFORM(a[n+2+i],a1[n+2+i],a2[n+2+i],a3[n+2+i],w[n-3-i].im,w[n-3-i].re);
+    return;
+  }
+#endif
+
   a += 2;
   a1 += 2;
   a2 += 2;
@@ -665,32 +885,22 @@ static void c32768(register WDL_FFT_COMPLEX *a)
   c16384(a);
 }
 
-#if 0
-static void mulr4(WDL_FFT_REAL *a,WDL_FFT_REAL *b)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6;
-
-  t1 = a[2] * b[2];
-  t2 = a[3] * b[3];
-  t3 = a[3] * b[2];
-  t4 = a[2] * b[3];
-  t5 = a[0] * b[0];
-  t6 = a[1] * b[1];
-  t1 -= t2;
-  t3 += t4;
-  a[0] = t5;
-  a[1] = t6;
-  a[2] = t1;
-  a[3] = t3;
-}
-
-#endif
 /* n even, n > 0 */
 void WDL_fft_complexmul(WDL_FFT_COMPLEX *a,WDL_FFT_COMPLEX *b,int n)
 {
   register WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
   if (n<2 || (n&1)) return;
 
+#ifndef WDL_FFT_NO_SIMD
+  if (fft_simd)
+  {
+    int i = fft_simd->cplxmul(a,b,n);
+    if (!(n -= i)) return;
+    a += i;
+    b += i;
+  }
+#endif
+
   do {
     t1 = a[0].re * b[0].re;
     t2 = a[0].im * b[0].im;
@@ -718,6 +928,17 @@ void WDL_fft_complexmul2(WDL_FFT_COMPLEX *c, WDL_FFT_COMPLEX *a, WDL_FFT_COMPLEX
   register WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
   if (n<2 || (n&1)) return;
 
+#ifndef WDL_FFT_NO_SIMD
+  if (fft_simd)
+  {
+    int i = fft_simd->cplxmul2(c,a,b,n);
+    if (!(n -= i)) return;
+    a += i;
+    b += i;
+    c += i;
+  }
+#endif
+
   do {
     t1 = a[0].re * b[0].re;
     t2 = a[0].im * b[0].im;
@@ -745,6 +966,17 @@ void WDL_fft_complexmul3(WDL_FFT_COMPLEX *c, WDL_FFT_COMPLEX *a, WDL_FFT_COMPLEX
   register WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
   if (n<2 || (n&1)) return;
 
+#ifndef WDL_FFT_NO_SIMD
+  if (fft_simd)
+  {
+    int i = fft_simd->cplxmul3(c,a,b,n);
+    if (!(n -= i)) return;
+    a += i;
+    b += i;
+    c += i;
+  }
+#endif
+
   do {
     t1 = a[0].re * b[0].re;
     t2 = a[0].im * b[0].im;
@@ -768,6 +1000,37 @@ void WDL_fft_complexmul3(WDL_FFT_COMPLEX *c, WDL_FFT_COMPLEX *a, WDL_FFT_COMPLEX
   } while (n -= 2);
 }
 
+/* split complex, len values in each of re/im */
+static void fft_splitmul(WDL_FFT_REAL *cre, WDL_FFT_REAL *cim, const WDL_FFT_REAL *are, const WDL_FFT_REAL *aim,
+                         const WDL_FFT_REAL *bre, const WDL_FFT_REAL *bim, int n, int add)
+{
+  int i = 0;
+#ifndef WDL_FFT_NO_SIMD
+  if (fft_simd) i = fft_simd->splitmul(cre,cim,are,aim,bre,bim,n,add);
+#endif
+  for (; i < n; i ++)
+  {
+    WDL_FFT_REAL r = are[i] * bre[i] - aim[i] * bim[i], im = are[i] * bim[i] + aim[i] * bre[i];
+    if (add)
+    {
+      r += cre[i];
+      im += cim[i];
+    }
+    cre[i] = r;
+    cim[i] = im;
+  }
+}
+
+void WDL_fft_splitmul2(WDL_FFT_REAL *cre, WDL_FFT_REAL *cim, const WDL_FFT_REAL *are, const WDL_FFT_REAL *aim, const WDL_FFT_REAL *bre, const WDL_FFT_REAL *bim, int len)
+{
+  fft_splitmul(cre,cim,are,aim,bre,bim,len,0);
+}
+
+void WDL_fft_splitmul3(WDL_FFT_REAL *cre, WDL_FFT_REAL *cim, const WDL_FFT_REAL *are, const WDL_FFT_REAL *aim, const WDL_FFT_REAL *bre, const WDL_FFT_REAL *bim, int len)
+{
+  fft_splitmul(cre,cim,are,aim,bre,bim,len,1);
+}
+
 
 static inline void u4(register WDL_FFT_COMPLEX *a)
 {
@@ -917,6 +1180,16 @@ static void upass(register WDL_FFT_COMPLEX *a,register const WDL_FFT_COMPLEX *w,
   UNTRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
   UNTRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
 
+#ifndef WDL_FFT_NO_SIMD
+  if (fft_simd)
+  {
+    const int cnt = 2 * n;
+    int i = fft_simd->inv(a + 2,a1 + 2,a2 + 2,a3 + 2,w + 1,cnt);
+    for (; i < cnt; i ++) UNTRANSFORM(a[2+i],a1[2+i],a2[2+i],a3[2+i],w[1+i].re,w[1+i].im);
+    return;
+  }
+#endif
+
   for (;;) {
     UNTRANSFORM(a[2],a1[2],a2[2],a3[2],w[1].re,w[1].im);
     UNTRANSFORM(a[3],a1[3],a2[3],a3[3],w[2].re,w[2].im);
@@ -986,6 +1259,23 @@ static void upassbig(register WDL_FFT_COMPLEX *a,register const WDL_FFT_COMPLEX
 
   UNTRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
   UNTRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+#ifndef WDL_FFT_NO_SIMD
+  if (fft_simd)
+  {
+    const int cnt = n - 2;
+    int i = fft_simd->inv(a + 2,a1 + 2,a2 + 2,a3 + 2,w + 1,cnt);
+    for (; i < cnt; i ++) UNTRANSFORM(a[2+i],a1[2+i],a2[2+i],a3[2+i],w[1+i].re,w[1+i].im);
+
+    UNTRANSFORMHALF(a[n],a1[n],a2[n],a3[n]);
+    UNTRANSFORM(a[n+1],a1[n+1],a2[n+1],a3[n+1],w[n-2].im,w[n-2].re);
+
+    i = fft_simd->invrev(a + n + 2,a1 + n + 2,a2 + n + 2,a3 + n + 2,w + n - 3,cnt);
+    for (; i < cnt; i ++) UNTRANSFORM(a[n+2+i],a1[n+2+i],a2[n+2+i],a3[n+2+i],w[n-3-i].im,w[n-3-i].re);
+    return;
+  }
+#endif
+
   a += 2;
   a1 += 2;
   a2 += 2;
@@ -1125,6 +1415,10 @@ int *WDL_fft_permute_tab(int fftsize)
   return _idxperm + fftsize - 2;
 }
 
+// cos/sin(2*pi*k/N) for k <= N/4, N being the largest real FFT size. smaller sizes step through it.
+static WDL_FFT_COMPLEX _realtw[(2<<FFT_MAXBITLEN)/4+1];
+
+
 
 #endif
 
@@ -1136,6 +1430,10 @@ void WDL_fft_init()
     int i, offs;
   	ffttabinit=1;
 
+#ifndef WDL_FFT_NO_SIMD
+    fft_simd_init();
+#endif
+
 #define fft_gen(x,y) __fft_gen(x,sizeof(x)/sizeof(x[0]),y)
     fft_gen(d16,1);
     fft_gen(d32,1);
@@ -1158,6 +1456,12 @@ void WDL_fft_init()
 		  idx_perm_calc(offs, i);
 		  offs += i;
 	  }
+
+    for (i = 0; i < (int) (sizeof(_realtw)/sizeof(_realtw[0])); i ++)
+    {
+      _realtw[i].re = (WDL_FFT_REAL) cos(i*PI*2.0/(2<<FFT_MAXBITLEN));
+      _realtw[i].im = (WDL_FFT_REAL) sin(i*PI*2.0/(2<<FFT_MAXBITLEN));
+    }
 #endif
 
   }
@@ -1188,465 +1492,97 @@ void WDL_fft(WDL_FFT_COMPLEX *buf, int len, int isInverse)
 }
 
 
-#if 0
-/* n multiple of 4, n >= 8 */
-void WDL_fft_realmul(WDL_FFT_REAL *a,WDL_FFT_REAL *b,int n)
-{
-  if (n<8 || (n&3)) return;
-  mulr4(a,b);
-  WDL_fft_complexmul((WDL_FFT_COMPLEX *)(a + 4),(WDL_FFT_COMPLEX *)(b + 4),(n - 4) / 2);
-}
-
-
-
-
-//////////// begin WDL_FFT_REAL modes
-static void r2(register WDL_FFT_REAL *a)
-{
-  register WDL_FFT_REAL t1, t2;
-
-  t1 = a[0] + a[1];
-  t2 = a[0] - a[1];
-  a[0] = t1;
-  a[1] = t2;
-}
-
-static void r4(register WDL_FFT_REAL *a)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t6;
-
-  t3 = a[0] + a[1];
-  t4 = a[2] + a[3];
-  t1 = a[0] - a[1];
-  t2 = a[2] - a[3];
-  t6 = t3 - t4;
-  t3 += t4;
-  a[2] = t1;
-  a[3] = t2;
-  a[0] = t3;
-  a[1] = t6;
-}
-
-static void r8(register WDL_FFT_REAL *a)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
-
-  t2 = a[0] + a[1];
-  t8 = a[4] + a[5];
-  t3 = a[2] - a[3];
-  t6 = t2 - t8;
-  t2 += t8;
-  t1 = a[2] + a[3];
-  t7 = a[6] + a[7];
-  a[2] = t6;
-  t5 = t1 - t7;
-  t1 += t7;
-  t4 = a[0] - a[1];
-  a[3] = t5;
-  t8 = t2 - t1;
-  t2 += t1;
-  t7 = a[6] - a[7];
-  a[1] = t8;
-  t6 = t3 - t7;
-  t3 += t7;
-  a[0] = t2;
-  t6 *= sqrthalf;
-  t8 = a[4] - a[5];
-  t3 *= sqrthalf;
-  t1 = t4 - t6;
-  t4 += t6;
-  t2 = t8 - t3;
-  t8 += t3;
-  a[6] = t1;
-  a[4] = t4;
-  a[7] = t2;
-  a[5] = t8;
-}
+#ifndef WDL_FFT_NO_PERMUTE
 
-/* a[0...8n-1], w[0...2n-1]; n even, n >= 4 */
-static void rpass(register WDL_FFT_REAL *a,register const WDL_FFT_COMPLEX *w,register unsigned int n)
+/*
+  len/2 point complex FFT of the even/odd samples, then split into the len/2+1 bins of the real FFT:
+    X[k] = E[k] + W^k O[k], X[len/2-k] = conj(E[k] - W^k O[k]), W = exp(-2*pi*i/len)
+  where E[k] = (Z[k] + conj(Z[len/2-k]))/2 and O[k] = (Z[k] - conj(Z[len/2-k]))/2i.
+  Z[k] and Z[len/2-k] sit at their permuted positions and both results are written back there.
+*/
+static void real_split(WDL_FFT_COMPLEX *buf, int n, int isInverse)
 {
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6;
-  register WDL_FFT_REAL *b;
-  register unsigned int k;
-
-  b = a + 4 * n;
-  k = n - 2;
-
-  RZERO(a[0],a[1],b[0],b[1]);
-  R(a[2],a[3],b[2],b[3],w[0].re,w[0].im);
-  R(a[4],a[5],b[4],b[5],w[1].re,w[1].im);
-  R(a[6],a[7],b[6],b[7],w[2].re,w[2].im);
+  const int *tab = WDL_fft_permute_tab(n);
+  const WDL_FFT_COMPLEX *tw = _realtw;
+  const int twstep = (1<<FFT_MAXBITLEN) / n;
+  const WDL_FFT_REAL sc = isInverse ? (WDL_FFT_REAL)1.0 : (WDL_FFT_REAL)0.5;
+  int k;
 
-  for (;;) {
-    R(a[8],a[9],b[8],b[9],w[3].re,w[3].im);
-    R(a[10],a[11],b[10],b[11],w[4].re,w[4].im);
-    R(a[12],a[13],b[12],b[13],w[5].re,w[5].im);
-    R(a[14],a[15],b[14],b[15],w[6].re,w[6].im);
-    if (!(k -= 2)) break;
-    a += 8;
-    b += 8;
-    w += 4;
+  {
+    // forward: DC, nyquist from Z[0]. inverse: the same butterfly gives back 2*Z[0]
+    WDL_FFT_REAL a = buf[0].re, b = buf[0].im;
+    buf[0].re = a + b;
+    buf[0].im = a - b;
   }
-}
-
-static void r16(register WDL_FFT_REAL *a)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6;
-
-  RZERO(a[0],a[1],a[8],a[9]);
-  R(a[2],a[3],a[10],a[11],d16[0].re,d16[0].im);
-  R(a[4],a[5],a[12],a[13],d16[1].re,d16[1].im);
-  R(a[6],a[7],a[14],a[15],d16[2].re,d16[2].im);
-  r8(a);
-  c4((WDL_FFT_COMPLEX *)(a + 8));
-}
-
-static void r32(register WDL_FFT_REAL *a)
-{
-  rpass(a,d32,4);
-  r16(a);
-  c8((WDL_FFT_COMPLEX *)(a + 16));
-}
-
-static void r64(register WDL_FFT_REAL *a)
-{
-  rpass(a,d64,8);
-  r32(a);
-  c16((WDL_FFT_COMPLEX *)(a + 32));
-}
-
-static void r128(register WDL_FFT_REAL *a)
-{
-  rpass(a,d128,16);
-  r64(a);
-  c32((WDL_FFT_COMPLEX *)(a + 64));
-}
-
-static void r256(register WDL_FFT_REAL *a)
-{
-  rpass(a,d256,32);
-  r128(a);
-  c64((WDL_FFT_COMPLEX *)(a + 128));
-}
-
-static void r512(register WDL_FFT_REAL *a)
-{
-  rpass(a,d512,64);
-  r256(a);
-  c128((WDL_FFT_COMPLEX *)(a + 256));
-}
 
-
-/* a[0...8n-1], w[0...n-1]; n even, n >= 8 */
-static void rpassbig(register WDL_FFT_REAL *a,register const WDL_FFT_COMPLEX *w,register unsigned int n)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6;
-  register WDL_FFT_REAL *b;
-  register unsigned int k;
-
-  b = a + 4 * n;
-
-  RZERO(a[0],a[1],b[0],b[1]);
-  R(a[2],a[3],b[2],b[3],w[0].re,w[0].im);
-
-  k = n - 2;
-  do {
-    R(a[4],a[5],b[4],b[5],w[1].re,w[1].im);
-    R(a[6],a[7],b[6],b[7],w[2].re,w[2].im);
-    a += 4;
-    b += 4;
-    w += 2;
-  } while (k -= 2);
-
-  RHALF(a[4],a[5],b[4],b[5]);
-  R(a[6],a[7],b[6],b[7],w[0].im,w[0].re);
-
-  k = n - 2;
-  do {
-    R(a[8],a[9],b[8],b[9],w[-1].im,w[-1].re);
-    R(a[10],a[11],b[10],b[11],w[-2].im,w[-2].re);
-    a += 4;
-    b += 4;
-    w -= 2;
-  } while (k -= 2);
-}
-
-
-static void r1024(register WDL_FFT_REAL *a)
-{
-  rpassbig(a,d1024,128);
-  r512(a);
-  c256((WDL_FFT_COMPLEX *)(a + 512));
-}
-
-static void r2048(register WDL_FFT_REAL *a)
-{
-  rpassbig(a,d2048,256);
-  r1024(a);
-  c512((WDL_FFT_COMPLEX *)(a + 1024));
-}
- 
-
-static void r4096(register WDL_FFT_REAL *a)
-{
-  rpassbig(a,d4096,512);
-  r2048(a);
-  c1024((WDL_FFT_COMPLEX *)(a + 2048));
-}
-
-static void r8192(register WDL_FFT_REAL *a)
-{
-  rpassbig(a,d8192,1024);
-  r4096(a);
-  c2048((WDL_FFT_COMPLEX *)(a + 4096));
-}
-
-static void r16384(register WDL_FFT_REAL *a)
-{
-  rpassbig(a,d16384,2048);
-  r8192(a);
-  c4096((WDL_FFT_COMPLEX *)(a + 8192));
-}
-
-static void r32768(register WDL_FFT_REAL *a)
-{
-  rpassbig(a,d32768,4096);
-  r16384(a);
-  c8192((WDL_FFT_COMPLEX *)(a + 16384));
-}
-
-
-
-static void v4(register WDL_FFT_REAL *a)
-{
-  register WDL_FFT_REAL t1, t3, t5, t6;
-
-  t5 = a[0] + a[1];
-  t6 = a[0] - a[1];
-  t1 = t5 + a[2];
-  t5 -= a[2];
-  t3 = t6 + a[3];
-  t6 -= a[3];
-  a[0] = t1;
-  a[1] = t5;
-  a[2] = t3;
-  a[3] = t6;
-}
-
-static void v8(register WDL_FFT_REAL *a)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
-
-  t5 = a[0] + a[1];
-  t2 = a[4] + a[6];
-  t8 = t5 + a[2];
-  t5 -= a[2];
-  t1 = a[0] - a[1];
-  t7 = t8 + t2;
-  t8 -= t2;
-  t3 = a[4] - a[6];
-  a[0] = t7;
-  t6 = a[5] + a[7];
-  a[1] = t8;
-  t7 = t5 + t6;
-  t5 -= t6;
-  t4 = a[5] - a[7];
-  a[4] = t7;
-  t6 = t4 - t3;
-  t3 += t4;
-  a[5] = t5;
-  t3 *= sqrthalf;
-  t2 = t1 + a[3];
-  t1 -= a[3];
-  t6 *= sqrthalf;
-  t7 = t2 - t3;
-  t3 += t2;
-  t8 = t1 - t6;
-  t6 += t1;
-  a[3] = t7;
-  a[7] = t8;
-  a[2] = t3;
-  a[6] = t6;
-}
-
-/* a[0...8n-1], w[0...2n-1]; n even, n >= 4 */
-static void vpass(register WDL_FFT_REAL *a,register const WDL_FFT_COMPLEX *w,register unsigned int n)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6;
-  register WDL_FFT_REAL *b;
-  register unsigned int k;
-
-  b = a + 4 * n;
-  k = n - 2;
-
-  VZERO(a[0],a[1],b[0],b[1]);
-  V(a[2],a[3],b[2],b[3],w[0].re,w[0].im);
-  V(a[4],a[5],b[4],b[5],w[1].re,w[1].im);
-  V(a[6],a[7],b[6],b[7],w[2].re,w[2].im);
-
-  for (;;) {
-    V(a[8],a[9],b[8],b[9],w[3].re,w[3].im);
-    V(a[10],a[11],b[10],b[11],w[4].re,w[4].im);
-    V(a[12],a[13],b[12],b[13],w[5].re,w[5].im);
-    V(a[14],a[15],b[14],b[15],w[6].re,w[6].im);
-    if (!(k -= 2)) break;
-    a += 8;
-    b += 8;
-    w += 4;
+  for (k = 1; k <= n/2; k ++)
+  {
+    WDL_FFT_COMPLEX *p1 = buf + tab[k], *p2 = buf + tab[n-k];
+    WDL_FFT_REAL c, s, er, ei, dr, di, or_, oi;
+    tw += twstep;
+    c = tw->re;
+    s = tw->im;
+
+    er = (p1->re + p2->re) * sc;
+    ei = (p1->im - p2->im) * sc;
+    dr = (p1->re - p2->re) * sc;
+    di = (p1->im + p2->im) * sc;
+
+    if (!isInverse)
+    {
+      // W^k * (d / i)
+      or_ = c*di - s*dr;
+      oi = -c*dr - s*di;
+      p1->re = er + or_;
+      p1->im = ei + oi;
+      p2->re = er - or_;
+      p2->im = oi - ei;
+    }
+    else
+    {
+      // conj(W^k) * d, then E + iO
+      or_ = c*dr - s*di;
+      oi = s*dr + c*di;
+      p1->re = er - oi;
+      p1->im = ei + or_;
+      p2->re = er + oi;
+      p2->im = or_ - ei;
+    }
   }
 }
 
-static void v16(register WDL_FFT_REAL *a)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6;
-
-  u4((WDL_FFT_COMPLEX *)(a + 8));
-  v8(a);
-  VZERO(a[0],a[1],a[8],a[9]);
-  V(a[2],a[3],a[10],a[11],d16[0].re,d16[0].im);
-  V(a[4],a[5],a[12],a[13],d16[1].re,d16[1].im);
-  V(a[6],a[7],a[14],a[15],d16[2].re,d16[2].im);
-}
-
-static void v32(register WDL_FFT_REAL *a)
-{
-  u8((WDL_FFT_COMPLEX *)(a + 16));
-  v16(a);
-  vpass(a,d32,4);
-}
-
-static void v64(register WDL_FFT_REAL *a)
-{
-  u16((WDL_FFT_COMPLEX *)(a + 32));
-  v32(a);
-  vpass(a,d64,8);
-}
-
-static void v128(register WDL_FFT_REAL *a)
-{
-  u32((WDL_FFT_COMPLEX *)(a + 64));
-  v64(a);
-  vpass(a,d128,16);
-}
-
-static void v256(register WDL_FFT_REAL *a)
-{
-  u64((WDL_FFT_COMPLEX *)(a + 128));
-  v128(a);
-  vpass(a,d256,32);
-}
-
-static void v512(register WDL_FFT_REAL *a)
-{
-  u128((WDL_FFT_COMPLEX *)(a + 256));
-  v256(a);
-  vpass(a,d512,64);
-}
-
-
-
-/* a[0...8n-1], w[0...n-1]; n even, n >= 8 */
-static void vpassbig(register WDL_FFT_REAL *a,register const WDL_FFT_COMPLEX *w,register unsigned int n)
-{
-  register WDL_FFT_REAL t1, t2, t3, t4, t5, t6;
-  register WDL_FFT_REAL *b;
-  register unsigned int k;
-
-  b = a + 4 * n;
-
-  VZERO(a[0],a[1],b[0],b[1]);
-  V(a[2],a[3],b[2],b[3],w[0].re,w[0].im);
-
-  k = n - 2;
-  do {
-    V(a[4],a[5],b[4],b[5],w[1].re,w[1].im);
-    V(a[6],a[7],b[6],b[7],w[2].re,w[2].im);
-    a += 4;
-    b += 4;
-    w += 2;
-  } while (k -= 2);
-
-  VHALF(a[4],a[5],b[4],b[5]);
-  V(a[6],a[7],b[6],b[7],w[0].im,w[0].re);
-
-  k = n - 2;
-  do {
-    V(a[8],a[9],b[8],b[9],w[-1].im,w[-1].re);
-    V(a[10],a[11],b[10],b[11],w[-2].im,w[-2].re);
-    a += 4;
-    b += 4;
-    w -= 2;
-  } while (k -= 2);
-}
-
-
-static void v1024(register WDL_FFT_REAL *a)
-{
-  u256((WDL_FFT_COMPLEX *)(a + 512));
-  v512(a);
-  vpassbig(a,d1024,128);
-}
-
-static void v2048(register WDL_FFT_REAL *a)
-{
-  u512((WDL_FFT_COMPLEX *)(a + 1024));
-  v1024(a);
-  vpassbig(a,d2048,256);
-}
-
-
-static void v4096(register WDL_FFT_REAL *a)
-{
-  u1024((WDL_FFT_COMPLEX *)(a + 2048));
-  v2048(a);
-  vpassbig(a,d4096,512);
-}
-
-static void v8192(register WDL_FFT_REAL *a)
-{
-  u2048((WDL_FFT_COMPLEX *)(a + 4096));
-  v4096(a);
-  vpassbig(a,d8192,1024);
-}
-
-static void v16384(register WDL_FFT_REAL *a)
-{
-  u4096((WDL_FFT_COMPLEX *)(a + 8192));
-  v8192(a);
-  vpassbig(a,d16384,2048);
-}
-
-static void v32768(register WDL_FFT_REAL *a)
-{
-  u8192((WDL_FFT_COMPLEX *)(a + 16384));
-  v16384(a);
-  vpassbig(a,d32768,4096);
-}
-
-
+/*
+  len a power of two, 4 <= len <= 65536. buf is len reals in, len reals out (packed), the same format
+  WDL_fft_realmul() expects:
+    buf[0] = DC, buf[1] = nyquist (both real),
+    bins 1..len/2-1 are complex, bin k at ((WDL_FFT_COMPLEX*)buf)[WDL_fft_permute(len/2,k)].
+  the inverse takes that format back to len real samples. unscaled like WDL_fft(), a forward+inverse scales by len.
+*/
 void WDL_real_fft(WDL_FFT_REAL *buf, int len, int isInverse)
 {
-  switch (len)
+  const int n = len/2;
+  if (n < 2 || n > (1<<FFT_MAXBITLEN) || (n&(n-1))) return;
+
+  if (!isInverse)
   {
-    case 2: r2(buf); break;
-#define TMP(x) case x: if (!isInverse) r##x(buf); else v##x(buf); break;
-    TMP(4)
-    TMP(8)
-    TMP(16)
-    TMP(32)
-    TMP(64)
-    TMP(128)
-    TMP(256)
-    TMP(512)
-    TMP(1024)
-    TMP(2048)
-    TMP(4096)
-    TMP(8192)
-    TMP(16384)
-    TMP(32768)
-#undef TMP
+    WDL_fft((WDL_FFT_COMPLEX*)buf, n, 0);
+    real_split((WDL_FFT_COMPLEX*)buf, n, 0);
+  }
+  else
+  {
+    real_split((WDL_FFT_COMPLEX*)buf, n, 1);
+    WDL_fft((WDL_FFT_COMPLEX*)buf, n, 1);
   }
 }
 
 #endif
+
+/* multiplies two WDL_real_fft() spectra, len reals (len/2 complex, >= 4) */
+void WDL_fft_realmul(WDL_FFT_REAL *a, WDL_FFT_REAL *b, int len)
+{
+  const WDL_FFT_REAL dc = a[0]*b[0], ny = a[1]*b[1];
+  if (len<4 || (len&3)) return;
+  WDL_fft_complexmul((WDL_FFT_COMPLEX *)a, (WDL_FFT_COMPLEX *)b, len/2);
+  a[0] = dc;
+  a[1] = ny;
+}
@@ -57,12 +57,17 @@ extern void WDL_fft_complexmul(WDL_FFT_COMPLEX *dest, WDL_FFT_COMPLEX *src, int
 extern void WDL_fft_complexmul2(WDL_FFT_COMPLEX *dest, WDL_FFT_COMPLEX *src, WDL_FFT_COMPLEX *src2, int len);
 extern void WDL_fft_complexmul3(WDL_FFT_COMPLEX *destAdd, WDL_FFT_COMPLEX *src, WDL_FFT_COMPLEX *src2, int len);
 
+// split complex versions of complexmul2/3: len real parts in *re, len imaginary parts in *im
+extern void WDL_fft_splitmul2(WDL_FFT_REAL *destre, WDL_FFT_REAL *destim, const WDL_FFT_REAL *srcre, const WDL_FFT_REAL *srcim, const WDL_FFT_REAL *src2re, const WDL_FFT_REAL *src2im, int len);
+extern void WDL_fft_splitmul3(WDL_FFT_REAL *destAddre, WDL_FFT_REAL *destAddim, const WDL_FFT_REAL *srcre, const WDL_FFT_REAL *srcim, const WDL_FFT_REAL *src2re, const WDL_FFT_REAL *src2im, int len);
+
 extern void WDL_fft(WDL_FFT_COMPLEX *, int len, int isInverse);
 
-#if 0 // these dont work right!
-extern void WDL_fft_realmul(WDL_FFT_REAL *dest, WDL_FFT_REAL *src, int len);
+// real input FFT, len = 4..65536. output is packed into the len reals: buf[0]=DC, buf[1]=nyquist, and bin k (0<k<len/2)
+// is the complex value at ((WDL_FFT_COMPLEX*)buf)[WDL_fft_permute(len/2,k)]. inverse takes the same format back to samples.
+// not available with WDL_FFT_NO_PERMUTE.
 extern void WDL_real_fft(WDL_FFT_REAL *, int len, int isInverse);
-#endif
+extern void WDL_fft_realmul(WDL_FFT_REAL *dest, WDL_FFT_REAL *src, int len); // dest *= src, both WDL_real_fft() spectra
 
 int WDL_fft_permute(int fftsize, int idx);
 int *WDL_fft_permute_tab(int fftsize);
@@ -0,0 +1,167 @@
+/*
+  WDL - fft_simd.h
+  Copyright (C) 2006 and later Cockos Incorporated
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+
+  Vector versions of the fft.c radix-4 butterflies and complex multiplies. This is not a public header,
+  fft.c includes it once per instruction set after defining:
+
+    FFT_SIMD_FUNC(x)     name of the instantiated function x
+    FFT_SIMD_ATTR        function attributes (target() for runtime dispatched sets), may be empty
+    FFTV_T               vector type, holding FFTV_K interleaved WDL_FFT_COMPLEX values
+    FFTV_LOAD(p), FFTV_STORE(p,v)    unaligned
+    FFTV_LOADWREV(p)     element j = p[-j] with re/im swapped (the mirrored twiddles of cpassbig/upassbig)
+    FFTV_ADD, FFTV_SUB, FFTV_MUL
+    FFTV_SWAP(v)         swaps re/im of each element
+    FFTV_DUPRE(v), FFTV_DUPIM(v)     re or im copied to both halves of each element
+    FFTV_NEGRE(v)        negates re of each element
+
+  Every function handles the largest multiple of FFTV_K of its n and returns that count, the caller does the rest.
+
+*/
+
+// v*w
+FFT_SIMD_ATTR static inline FFTV_T FFT_SIMD_FUNC(cmul)(FFTV_T v, FFTV_T w)
+{
+  return FFTV_ADD(FFTV_MUL(v,FFTV_DUPRE(w)),FFTV_MUL(FFTV_NEGRE(FFTV_SWAP(v)),FFTV_DUPIM(w)));
+}
+
+// v*conj(w)
+FFT_SIMD_ATTR static inline FFTV_T FFT_SIMD_FUNC(cmulconj)(FFTV_T v, FFTV_T w)
+{
+  return FFTV_SUB(FFTV_MUL(v,FFTV_DUPRE(w)),FFTV_MUL(FFTV_NEGRE(FFTV_SWAP(v)),FFTV_DUPIM(w)));
+}
+
+/*
+  TRANSFORM():
+    A = a0-a2, B = i*(a1-a3)
+    a0 += a2, a1 += a3, a2 = (A+B)*w, a3 = (A-B)*conj(w)
+*/
+#define FFT_SIMD_TRANSFORM(i, wv) { \
+  const FFTV_T x0 = FFTV_LOAD(a0+(i)), x1 = FFTV_LOAD(a1+(i)), x2 = FFTV_LOAD(a2+(i)), x3 = FFTV_LOAD(a3+(i)); \
+  const FFTV_T A = FFTV_SUB(x0,x2), B = FFTV_NEGRE(FFTV_SWAP(FFTV_SUB(x1,x3))); \
+  FFTV_STORE(a0+(i),FFTV_ADD(x0,x2)); \
+  FFTV_STORE(a1+(i),FFTV_ADD(x1,x3)); \
+  FFTV_STORE(a2+(i),FFT_SIMD_FUNC(cmul)(FFTV_ADD(A,B),(wv))); \
+  FFTV_STORE(a3+(i),FFT_SIMD_FUNC(cmulconj)(FFTV_SUB(A,B),(wv))); \
+}
+
+/*
+  UNTRANSFORM():
+    P = a2*conj(w), Q = a3*w, S = P+Q, D = i*(P-Q)
+    a0 += S, a2 = a0-S, a1 -= D, a3 = a1+D
+*/
+#define FFT_SIMD_UNTRANSFORM(i, wv) { \
+  const FFTV_T x0 = FFTV_LOAD(a0+(i)), x1 = FFTV_LOAD(a1+(i)); \
+  const FFTV_T P = FFT_SIMD_FUNC(cmulconj)(FFTV_LOAD(a2+(i)),(wv)), Q = FFT_SIMD_FUNC(cmul)(FFTV_LOAD(a3+(i)),(wv)); \
+  const FFTV_T S = FFTV_ADD(P,Q), D = FFTV_NEGRE(FFTV_SWAP(FFTV_SUB(P,Q))); \
+  FFTV_STORE(a0+(i),FFTV_ADD(x0,S)); \
+  FFTV_STORE(a2+(i),FFTV_SUB(x0,S)); \
+  FFTV_STORE(a1+(i),FFTV_SUB(x1,D)); \
+  FFTV_STORE(a3+(i),FFTV_ADD(x1,D)); \
+}
+
+FFT_SIMD_ATTR static int FFT_SIMD_FUNC(fwd)(WDL_FFT_COMPLEX *a0, WDL_FFT_COMPLEX *a1, WDL_FFT_COMPLEX *a2, WDL_FFT_COMPLEX *a3, const WDL_FFT_COMPLEX *w, int n)
+{
+  int i;
+  n &= ~(FFTV_K-1);
+  for (i = 0; i < n; i += FFTV_K) FFT_SIMD_TRANSFORM(i, FFTV_LOAD(w+i))
+  return n;
+}
+
+FFT_SIMD_ATTR static int FFT_SIMD_FUNC(fwdrev)(WDL_FFT_COMPLEX *a0, WDL_FFT_COMPLEX *a1, WDL_FFT_COMPLEX *a2, WDL_FFT_COMPLEX *a3, const WDL_FFT_COMPLEX *w, int n)
+{
+  int i;
+  n &= ~(FFTV_K-1);
+  for (i = 0; i < n; i += FFTV_K) FFT_SIMD_TRANSFORM(i, FFTV_LOADWREV(w-i))
+  return n;
+}
+
+FFT_SIMD_ATTR static int FFT_SIMD_FUNC(inv)(WDL_FFT_COMPLEX *a0, WDL_FFT_COMPLEX *a1, WDL_FFT_COMPLEX *a2, WDL_FFT_COMPLEX *a3, const WDL_FFT_COMPLEX *w, int n)
+{
+  int i;
+  n &= ~(FFTV_K-1);
+  for (i = 0; i < n; i += FFTV_K) FFT_SIMD_UNTRANSFORM(i, FFTV_LOAD(w+i))
+  return n;
+}
+
+FFT_SIMD_ATTR static int FFT_SIMD_FUNC(invrev)(WDL_FFT_COMPLEX *a0, WDL_FFT_COMPLEX *a1, WDL_FFT_COMPLEX *a2, WDL_FFT_COMPLEX *a3, const WDL_FFT_COMPLEX *w, int n)
+{
+  int i;
+  n &= ~(FFTV_K-1);
+  for (i = 0; i < n; i += FFTV_K) FFT_SIMD_UNTRANSFORM(i, FFTV_LOADWREV(w-i))
+  return n;
+}
+
+#undef FFT_SIMD_TRANSFORM
+#undef FFT_SIMD_UNTRANSFORM
+
+// a *= b
+FFT_SIMD_ATTR static int FFT_SIMD_FUNC(cplxmul)(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *b, int n)
+{
+  int i;
+  n &= ~(FFTV_K-1);
+  for (i = 0; i < n; i += FFTV_K) FFTV_STORE(a+i,FFT_SIMD_FUNC(cmul)(FFTV_LOAD(a+i),FFTV_LOAD(b+i)));
+  return n;
+}
+
+// c = a*b
+FFT_SIMD_ATTR static int FFT_SIMD_FUNC(cplxmul2)(WDL_FFT_COMPLEX *c, const WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *b, int n)
+{
+  int i;
+  n &= ~(FFTV_K-1);
+  for (i = 0; i < n; i += FFTV_K) FFTV_STORE(c+i,FFT_SIMD_FUNC(cmul)(FFTV_LOAD(a+i),FFTV_LOAD(b+i)));
+  return n;
+}
+
+// c += a*b
+FFT_SIMD_ATTR static int FFT_SIMD_FUNC(cplxmul3)(WDL_FFT_COMPLEX *c, const WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *b, int n)
+{
+  int i;
+  n &= ~(FFTV_K-1);
+  for (i = 0; i < n; i += FFTV_K) FFTV_STORE(c+i,FFTV_ADD(FFTV_LOAD(c+i),FFT_SIMD_FUNC(cmul)(FFTV_LOAD(a+i),FFTV_LOAD(b+i))));
+  return n;
+}
+
+// split complex, c = a*b (add=0) or c += a*b (add=1). n counts reals per array, 2*FFTV_K per vector
+FFT_SIMD_ATTR static int FFT_SIMD_FUNC(splitmul)(WDL_FFT_REAL *cre, WDL_FFT_REAL *cim, const WDL_FFT_REAL *are, const WDL_FFT_REAL *aim,
+                                                 const WDL_FFT_REAL *bre, const WDL_FFT_REAL *bim, int n, int add)
+{
+  int i;
+  n &= ~(FFTV_K*2-1);
+  for (i = 0; i < n; i += FFTV_K*2)
+  {
+    const FFTV_T ar = FFTV_LOAD(are+i), ai = FFTV_LOAD(aim+i), br = FFTV_LOAD(bre+i), bi = FFTV_LOAD(bim+i);
+    FFTV_T r = FFTV_SUB(FFTV_MUL(ar,br),FFTV_MUL(ai,bi)), im = FFTV_ADD(FFTV_MUL(ar,bi),FFTV_MUL(ai,br));
+    if (add)
+    {
+      r = FFTV_ADD(FFTV_LOAD(cre+i),r);
+      im = FFTV_ADD(FFTV_LOAD(cim+i),im);
+    }
+    FFTV_STORE(cre+i,r);
+    FFTV_STORE(cim+i,im);
+  }
+  return n;
+}
+
+static const fft_simd_funcs FFT_SIMD_FUNC(funcs) =
+{
+  FFT_SIMD_FUNC(fwd), FFT_SIMD_FUNC(fwdrev), FFT_SIMD_FUNC(inv), FFT_SIMD_FUNC(invrev),
+  FFT_SIMD_FUNC(cplxmul), FFT_SIMD_FUNC(cplxmul2), FFT_SIMD_FUNC(cplxmul3), FFT_SIMD_FUNC(splitmul),
+};
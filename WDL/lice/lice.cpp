@@ -52,6 +52,266 @@ void LICE_CombinePixels2Clamp(LICE_pixel *destptr, int r, int g, int b, int a, i
 }
 
 
+#ifndef LICE_NO_SIMD
+
+/*
+  Vector blend kernels for LICE_Blit()/LICE_ScaledBlit() (see lice_simd.h): AVX2 if the CPU/OS supports it, else
+  SSE2. NEON on ARM64. Selected on first use or by LICE_SetBlitSIMD().
+*/
+
+typedef void (*lice_simd_rowfunc)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia);
+
+typedef struct
+{
+  lice_simd_rowfunc copy, copy_srcalpha, copy_srcalpha_full;
+  lice_simd_rowfunc add, add_srcalpha;
+  lice_simd_rowfunc mul, mul_srcalpha;
+  lice_simd_rowfunc halfmix;
+} lice_simd_funcs;
+
+static const lice_simd_funcs *lice_simd;
+static int lice_simd_level=-1;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define LS_SIMD_SSE
+  #if defined(_MSC_VER) || (defined(__clang__) || __GNUC__ >= 5)
+    #define LS_SIMD_AVX2
+  #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #define LS_SIMD_NEON
+#endif
+
+#define LS_AMASK_CHAN(c) ((LICE_PIXEL_A)==(c)?-1:0)
+
+#ifdef LS_SIMD_SSE
+
+#ifdef LS_SIMD_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#include <emmintrin.h>
+#endif
+
+#define LSV_P __m128i
+#define LSV_W __m128i
+#define LSV_K 4
+#define LSV_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define LSV_STORE(p,v) _mm_storeu_si128((__m128i *)(p),v)
+#define LSV_LO(v) _mm_unpacklo_epi8(v,_mm_setzero_si128())
+#define LSV_HI(v) _mm_unpackhi_epi8(v,_mm_setzero_si128())
+#define LSV_PACK _mm_packus_epi16
+#define LSV_SET1(x) _mm_set1_epi16((short)(x))
+#define LSV_ADD _mm_add_epi16
+#define LSV_SUB _mm_sub_epi16
+#define LSV_MUL _mm_mullo_epi16
+#define LSV_MULHI _mm_mulhi_epu16
+#define LSV_SRL8(v) _mm_srli_epi16(v,8)
+#define LSV_SLL8(v) _mm_slli_epi16(v,8)
+#define LSV_SIGN(v) _mm_srai_epi16(v,15)
+#define LSV_XOR _mm_xor_si128
+#define LSV_AND _mm_and_si128
+#define LSV_OR _mm_or_si128
+#define LSV_ANDNOT _mm_andnot_si128
+#define LSV_EQ _mm_cmpeq_epi16
+#define LSV_ALPHA(w) _mm_shufflehi_epi16(_mm_shufflelo_epi16(w,_MM_SHUFFLE(LICE_PIXEL_A,LICE_PIXEL_A,LICE_PIXEL_A,LICE_PIXEL_A)),_MM_SHUFFLE(LICE_PIXEL_A,LICE_PIXEL_A,LICE_PIXEL_A,LICE_PIXEL_A))
+#define LSV_AMASK _mm_set_epi16(LS_AMASK_CHAN(3),LS_AMASK_CHAN(2),LS_AMASK_CHAN(1),LS_AMASK_CHAN(0),LS_AMASK_CHAN(3),LS_AMASK_CHAN(2),LS_AMASK_CHAN(1),LS_AMASK_CHAN(0))
+#define LSV_HALFMIX(d,s) _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(d,1),_mm_set1_epi32(0x7f7f7f7f)),_mm_and_si128(_mm_srli_epi32(s,1),_mm_set1_epi32(0x7f7f7f7f)))
+
+#define LS_SIMD_FUNC(x) ls_sse2_##x
+#define LS_SIMD_ATTR
+#include "lice_simd.h"
+#undef LS_SIMD_FUNC
+#undef LS_SIMD_ATTR
+
+#ifdef LS_SIMD_AVX2
+
+#undef LSV_P
+#undef LSV_W
+#undef LSV_K
+#undef LSV_LOAD
+#undef LSV_STORE
+#undef LSV_LO
+#undef LSV_HI
+#undef LSV_PACK
+#undef LSV_SET1
+#undef LSV_ADD
+#undef LSV_SUB
+#undef LSV_MUL
+#undef LSV_MULHI
+#undef LSV_SRL8
+#undef LSV_SLL8
+#undef LSV_SIGN
+#undef LSV_XOR
+#undef LSV_AND
+#undef LSV_OR
+#undef LSV_ANDNOT
+#undef LSV_EQ
+#undef LSV_ALPHA
+#undef LSV_AMASK
+#undef LSV_HALFMIX
+
+// unpack/pack work within each 128 bit half, so the pixel order survives the round trip
+#define LSV_P __m256i
+#define LSV_W __m256i
+#define LSV_K 8
+#define LSV_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define LSV_STORE(p,v) _mm256_storeu_si256((__m256i *)(p),v)
+#define LSV_LO(v) _mm256_unpacklo_epi8(v,_mm256_setzero_si256())
+#define LSV_HI(v) _mm256_unpackhi_epi8(v,_mm256_setzero_si256())
+#define LSV_PACK _mm256_packus_epi16
+#define LSV_SET1(x) _mm256_set1_epi16((short)(x))
+#define LSV_ADD _mm256_add_epi16
+#define LSV_SUB _mm256_sub_epi16
+#define LSV_MUL _mm256_mullo_epi16
+#define LSV_MULHI _mm256_mulhi_epu16
+#define LSV_SRL8(v) _mm256_srli_epi16(v,8)
+#define LSV_SLL8(v) _mm256_slli_epi16(v,8)
+#define LSV_SIGN(v) _mm256_srai_epi16(v,15)
+#define LSV_XOR _mm256_xor_si256
+#define LSV_AND _mm256_and_si256
+#define LSV_OR _mm256_or_si256
+#define LSV_ANDNOT _mm256_andnot_si256
+#define LSV_EQ _mm256_cmpeq_epi16
+#define LSV_ALPHA(w) _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(w,_MM_SHUFFLE(LICE_PIXEL_A,LICE_PIXEL_A,LICE_PIXEL_A,LICE_PIXEL_A)),_MM_SHUFFLE(LICE_PIXEL_A,LICE_PIXEL_A,LICE_PIXEL_A,LICE_PIXEL_A))
+#define LSV_AMASK _mm256_set_epi16(LS_AMASK_CHAN(3),LS_AMASK_CHAN(2),LS_AMASK_CHAN(1),LS_AMASK_CHAN(0),LS_AMASK_CHAN(3),LS_AMASK_CHAN(2),LS_AMASK_CHAN(1),LS_AMASK_CHAN(0), \
+                                   LS_AMASK_CHAN(3),LS_AMASK_CHAN(2),LS_AMASK_CHAN(1),LS_AMASK_CHAN(0),LS_AMASK_CHAN(3),LS_AMASK_CHAN(2),LS_AMASK_CHAN(1),LS_AMASK_CHAN(0))
+#define LSV_HALFMIX(d,s) _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(d,1),_mm256_set1_epi32(0x7f7f7f7f)),_mm256_and_si256(_mm256_srli_epi32(s,1),_mm256_set1_epi32(0x7f7f7f7f)))
+
+#ifdef _MSC_VER
+#define LS_SIMD_ATTR
+#else
+#define LS_SIMD_ATTR __attribute__((target("avx2")))
+#endif
+
+#define LS_SIMD_FUNC(x) ls_avx2_##x
+#include "lice_simd.h"
+#undef LS_SIMD_FUNC
+#undef LS_SIMD_ATTR
+
+static int ls_cpu_has_avx2()
+{
+#ifdef _MSC_VER
+  int r[4];
+  __cpuid(r,1);
+  if ((r[2] & ((1<<27)|(1<<28))) != ((1<<27)|(1<<28))) return 0; // OSXSAVE, AVX
+  if ((_xgetbv(0) & 6) != 6) return 0; // OS saves xmm/ymm
+  __cpuidex(r,7,0);
+  return (r[1] & (1<<5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // LS_SIMD_AVX2
+
+#elif defined(LS_SIMD_NEON)
+
+#include <arm_neon.h>
+
+static inline uint16x8_t ls_neon_mulhi(uint16x8_t a, uint16x8_t b)
+{
+  return vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(a),vget_low_u16(b)),16),
+                      vshrn_n_u32(vmull_u16(vget_high_u16(a),vget_high_u16(b)),16));
+}
+static inline uint16x8_t ls_neon_alpha(uint16x8_t w)
+{
+  uint64x2_t a=vandq_u64(vshrq_n_u64(vreinterpretq_u64_u16(w),16*LICE_PIXEL_A),vdupq_n_u64(0xffff));
+  a=vorrq_u64(a,vshlq_n_u64(a,16));
+  return vreinterpretq_u16_u64(vorrq_u64(a,vshlq_n_u64(a,32)));
+}
+static inline uint16x8_t ls_neon_amask()
+{
+  static const unsigned short m[8]={ LS_AMASK_CHAN(0),LS_AMASK_CHAN(1),LS_AMASK_CHAN(2),LS_AMASK_CHAN(3),
+                                     LS_AMASK_CHAN(0),LS_AMASK_CHAN(1),LS_AMASK_CHAN(2),LS_AMASK_CHAN(3) };
+  return vld1q_u16(m);
+}
+
+#define LSV_P uint8x16_t
+#define LSV_W uint16x8_t
+#define LSV_K 4
+#define LSV_LOAD(p) vld1q_u8((const uint8_t *)(p))
+#define LSV_STORE(p,v) vst1q_u8((uint8_t *)(p),v)
+#define LSV_LO(v) vmovl_u8(vget_low_u8(v))
+#define LSV_HI(v) vmovl_u8(vget_high_u8(v))
+#define LSV_PACK(lo,hi) vcombine_u8(vqmovn_u16(lo),vqmovn_u16(hi))
+#define LSV_SET1(x) vdupq_n_u16((unsigned short)(x))
+#define LSV_ADD vaddq_u16
+#define LSV_SUB vsubq_u16
+#define LSV_MUL vmulq_u16
+#define LSV_MULHI ls_neon_mulhi
+#define LSV_SRL8(v) vshrq_n_u16(v,8)
+#define LSV_SLL8(v) vshlq_n_u16(v,8)
+#define LSV_SIGN(v) vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(v),15))
+#define LSV_XOR veorq_u16
+#define LSV_AND vandq_u16
+#define LSV_OR vorrq_u16
+#define LSV_ANDNOT(m,a) vbicq_u16(a,m)
+#define LSV_EQ vceqq_u16
+#define LSV_ALPHA ls_neon_alpha
+#define LSV_AMASK ls_neon_amask()
+#define LSV_HALFMIX(d,s) vreinterpretq_u8_u32(vaddq_u32( \
+    vandq_u32(vshrq_n_u32(vreinterpretq_u32_u8(d),1),vdupq_n_u32(0x7f7f7f7f)), \
+    vandq_u32(vshrq_n_u32(vreinterpretq_u32_u8(s),1),vdupq_n_u32(0x7f7f7f7f))))
+
+#define LS_SIMD_FUNC(x) ls_neon_##x
+#define LS_SIMD_ATTR
+#include "lice_simd.h"
+#undef LS_SIMD_FUNC
+#undef LS_SIMD_ATTR
+
+#endif
+
+// The kernel for mode/ia, or NULL if the scalar templates have to do it. With zeroIsNoop only kernels that leave
+// dest alone for a 0 source pixel are returned (LICE_ScaledBlit() leaves unsampled pixels 0).
+static lice_simd_rowfunc lice_simd_getrowfunc(int mode, int ia, bool zeroIsNoop)
+{
+  if (lice_simd_level<0) LICE_SetBlitSIMD(-1);
+  if (!lice_simd || ia<1 || ia>256) return NULL;
+
+  switch (mode&(LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA))
+  {
+    case LICE_BLIT_MODE_COPY: return ia<256 && !zeroIsNoop ? lice_simd->copy : NULL;
+    case LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA: return ia<256 ? lice_simd->copy_srcalpha : lice_simd->copy_srcalpha_full;
+#ifndef LICE_DISABLE_BLEND_ADD
+    case LICE_BLIT_MODE_ADD: return lice_simd->add;
+    case LICE_BLIT_MODE_ADD|LICE_BLIT_USE_ALPHA: return lice_simd->add_srcalpha;
+#endif
+#ifndef LICE_DISABLE_BLEND_MUL
+    case LICE_BLIT_MODE_MUL: return zeroIsNoop ? NULL : lice_simd->mul;
+    case LICE_BLIT_MODE_MUL|LICE_BLIT_USE_ALPHA: return lice_simd->mul_srcalpha;
+#endif
+  }
+  return NULL;
+}
+
+#endif // LICE_NO_SIMD
+
+int LICE_SetBlitSIMD(int level)
+{
+#ifndef LICE_NO_SIMD
+  const lice_simd_funcs *funcs[3]={ NULL, NULL, NULL };
+#if defined(LS_SIMD_SSE)
+  funcs[1]=&ls_sse2_funcs;
+  #ifdef LS_SIMD_AVX2
+    if (ls_cpu_has_avx2()) funcs[2]=&ls_avx2_funcs;
+  #endif
+#elif defined(LS_SIMD_NEON)
+  funcs[1]=&ls_neon_funcs;
+#endif
+  if (level<0 || level>2) level=2;
+  while (level>0 && !funcs[level]) level--;
+  lice_simd=funcs[level];
+  lice_simd_level=level;
+  return level;
+#else
+  return 0;
+#endif
+}
+
+
 LICE_MemBitmap::LICE_MemBitmap(int w, int h, unsigned int linealign)
 {
   m_allocsize=0;
@@ -982,6 +1242,19 @@ void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, const
   {
     if (alpha==0.5)
     {
+#ifndef LICE_NO_SIMD
+      if (lice_simd_level<0) LICE_SetBlitSIMD(-1);
+      if (lice_simd && src != dest)
+      {
+        while (i-->0)
+        {
+          lice_simd->halfmix((LICE_pixel *)pdest,(const LICE_pixel *)psrc,cpsize,128);
+          pdest+=dest_span;
+          psrc += src_span;
+        }
+        return;
+      }
+#endif
       while (i-->0)
       {
         int a=cpsize;
@@ -1010,6 +1283,22 @@ void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, const
   else 
   {
     int ia=(int)(alpha*256.0);
+
+#ifndef LICE_NO_SIMD
+    // the kernels load several pixels before storing, which a blit within one bitmap could see
+    lice_simd_rowfunc rowfunc = src != dest ? lice_simd_getrowfunc(mode,ia,false) : NULL;
+    if (rowfunc)
+    {
+      while (i-->0)
+      {
+        rowfunc((LICE_pixel *)pdest,(const LICE_pixel *)psrc,cpsize,ia);
+        pdest+=dest_span;
+        psrc += src_span;
+      }
+      return;
+    }
+#endif
+
     #ifdef LICE_FAVOR_SIZE
         LICE_COMBINEFUNC blitfunc=NULL;      
         #define __LICE__ACTION(comb) blitfunc=comb::doPix;
@@ -1359,6 +1648,35 @@ void LICE_ScaledBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
     }
     else
     {
+#ifndef LICE_NO_SIMD
+      // Sample a strip of the row into a buffer with the plain copy, then combine it with the kernel. Pixels the
+      // sampling skips stay 0, which the kernels that are allowed here leave alone.
+      lice_simd_rowfunc rowfunc = src != dest ? lice_simd_getrowfunc(mode,ia,true) : NULL;
+      if (rowfunc)
+      {
+        LICE_pixel tmp[512];
+        const int filtermode=mode&LICE_BLIT_FILTER_MASK;
+        int y, x;
+        for (y = 0; y < dsth; y ++)
+        {
+          for (x = 0; x < dstw; x += 512)
+          {
+            const int n=lice_min(512,dstw-x);
+            memset(tmp,0,n*sizeof(LICE_pixel));
+          #ifdef LICE_FAVOR_SIZE
+            _LICE_Template_Blit2::scaleBlit((LICE_pixel_chan *)tmp,psrc,n,1,icurx+x*idx,icury,idx,idy,clip_r,clip_b,src_span,0,256,filtermode,_LICE_CombinePixelsClobberNoClamp::doPix);
+          #else
+            _LICE_Template_Blit2<_LICE_CombinePixelsClobberNoClamp>::scaleBlit((LICE_pixel_chan *)tmp,psrc,n,1,icurx+x*idx,icury,idx,idy,clip_r,clip_b,src_span,0,256,filtermode);
+          #endif
+            rowfunc((LICE_pixel *)pdest+x,tmp,n,ia);
+          }
+          pdest+=dest_span;
+          icury+=idy;
+        }
+        return;
+      }
+#endif
+
       #ifdef LICE_FAVOR_SIZE
         LICE_COMBINEFUNC blitfunc=NULL;      
         #define __LICE__ACTION(comb) blitfunc=comb::doPix;
@@ -2593,4 +2911,108 @@ unsigned short _LICE_RGB2HSV_invtab[256]={ // 65536/idx - 1
 };
 
 
+#ifdef LICE_BENCH_BLIT
+
+// c++ -O2 -DLICE_BENCH_BLIT lice.cpp
+// (off Windows add -I../swell -D_LICE_NO_SYSBITMAPS_ -DWDL_NO_DEFINE_MINMAX)
+// Exits with 1 if the SIMD output differs from the scalar output anywhere.
+
+#include <stdio.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LICE_BENCH_CLOCK() ((double)__rdtsc())
+#define LICE_BENCH_UNIT "cycles"
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define LICE_BENCH_CLOCK() ((double)__rdtsc())
+#define LICE_BENCH_UNIT "cycles"
+#else
+#include <time.h>
+#define LICE_BENCH_CLOCK() ((double)clock()*(1.0e9/CLOCKS_PER_SEC))
+#define LICE_BENCH_UNIT "ns"
+#endif
+
+static void bench_fill(LICE_IBitmap *bm, unsigned int seed)
+{
+  LICE_pixel *p=bm->getBits();
+  int i, n=bm->getRowSpan()*bm->getHeight();
+  for (i = 0; i < n; i ++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    p[i]=seed;
+    if ((seed>>8)&1) p[i] |= 0xff<<(LICE_PIXEL_A*8); // plenty of opaque and transparent pixels too
+    else if ((seed>>9)&1) p[i] &= ~(0xff<<(LICE_PIXEL_A*8));
+  }
+}
+
+// time per destination pixel of blitting src onto dest (scaled to dest's size if scaled), and the result
+static double bench_run(LICE_IBitmap *dest, LICE_IBitmap *src, bool scaled, float alpha, int mode, int reps)
+{
+  const int w=dest->getWidth(), h=dest->getHeight();
+  double best=0.0;
+  int r;
+  for (r = 0; r < reps; r ++)
+  {
+    bench_fill(dest,1234);
+    const double t0=LICE_BENCH_CLOCK();
+    if (scaled) LICE_ScaledBlit(dest,src,0,0,w,h,0.0f,0.0f,(float)src->getWidth(),(float)src->getHeight(),alpha,mode);
+    else LICE_Blit(dest,src,0,0,0,0,w,h,alpha,mode);
+    const double t=LICE_BENCH_CLOCK()-t0;
+    if (!r || t<best) best=t;
+  }
+  return best/(w*h);
+}
+
+int main(int argc, char **argv)
+{
+  static const struct { const char *name; float alpha; int mode; } modes[]=
+  {
+    { "copy 0.7", 0.7f, LICE_BLIT_MODE_COPY },
+    { "copy 0.5", 0.5f, LICE_BLIT_MODE_COPY },
+    { "srcalpha 1.0", 1.0f, LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA },
+    { "srcalpha 0.7", 0.7f, LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA },
+    { "add 0.7", 0.7f, LICE_BLIT_MODE_ADD },
+    { "add srcalpha", 1.0f, LICE_BLIT_MODE_ADD|LICE_BLIT_USE_ALPHA },
+    { "mul 0.7", 0.7f, LICE_BLIT_MODE_MUL },
+    { "mul srcalpha", 1.0f, LICE_BLIT_MODE_MUL|LICE_BLIT_USE_ALPHA },
+    { "scaled srcalpha", 1.0f, LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA|LICE_BLIT_FILTER_BILINEAR },
+  };
+  static const struct { const char *name; int w, h; } sizes[]=
+  {
+    { "knob 1x", 48, 48 }, { "knob 2x", 96, 96 },
+    { "background 1x", 600, 400 }, { "background 2x", 1200, 800 },
+  };
+  const int best=LICE_SetBlitSIMD(-1);
+  int sz, m, errors=0;
+
+  printf("LICE_Blit/LICE_ScaledBlit, %s per pixel, scalar vs SIMD level %d:\n",LICE_BENCH_UNIT,best);
+  for (sz = 0; sz < (int)(sizeof(sizes)/sizeof(sizes[0])); sz ++)
+  {
+    const int w=sizes[sz].w, h=sizes[sz].h, reps=lice_max(5,2000000/(w*h));
+    LICE_MemBitmap src(w,h), srchalf(w/2+1,h/2+1), ref(w,h), dest(w,h);
+    bench_fill(&src,1);
+    bench_fill(&srchalf,2);
+
+    printf("\n%s (%dx%d)\n%-16s %10s %10s %8s\n",sizes[sz].name,w,h,"mode","scalar","simd","speedup");
+    for (m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); m ++)
+    {
+      const bool scaled=(modes[m].mode&LICE_BLIT_FILTER_MASK)!=0;
+      LICE_IBitmap *s=scaled ? (LICE_IBitmap *)&srchalf : (LICE_IBitmap *)&src;
+
+      LICE_SetBlitSIMD(0);
+      const double ts=bench_run(&ref,s,scaled,modes[m].alpha,modes[m].mode,reps);
+      LICE_SetBlitSIMD(best);
+      const double tv=bench_run(&dest,s,scaled,modes[m].alpha,modes[m].mode,reps);
+
+      const bool same=!memcmp(ref.getBits(),dest.getBits(),ref.getRowSpan()*h*sizeof(LICE_pixel));
+      if (!same) errors++;
+      printf("%-16s %10.2f %10.2f %7.2fx%s\n",modes[m].name,ts,tv,ts/tv,same ? "" : "  MISMATCH");
+    }
+  }
+  return errors ? 1 : 0;
+}
+
+#endif // LICE_BENCH_BLIT
+
 #endif//__LICE_CPP_IMPLEMENTED__
@@ -927,6 +927,10 @@ SOURCE=.\lice_extended.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\lice_simd.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\lice_gl_ctx.h
 # End Source File
 # Begin Source File
@@ -399,6 +399,12 @@ void LICE_Copy(LICE_IBitmap *dest, LICE_IBitmap *src); // resizes dest to fit
 void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, const RECT *srcrect, float alpha, int mode);
 void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch, float alpha, int mode);
 
+// LICE_Blit()/LICE_ScaledBlit() use vector kernels for the copy, add and multiply modes (with or without
+// LICE_BLIT_USE_ALPHA) where the CPU has them, with identical results. level: 0=scalar only, 1=SSE2/NEON, 2=AVX2,
+// -1=the best available (the default). Returns the level now in use, which may be lower than requested.
+// Not thread safe, call before blitting from other threads. Define LICE_NO_SIMD to build without the kernels.
+int LICE_SetBlitSIMD(int level);
+
 void LICE_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch);
 
 // dstw/dsty can be negative, srcw/srch can be as well (for flipping)
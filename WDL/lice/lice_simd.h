@@ -0,0 +1,203 @@
+/*
+  Cockos WDL - LICE - Lightweight Image Compositing Engine
+  Copyright (C) 2007 and later, Cockos Incorporated
+  File: lice_simd.h (vector blend kernels)
+  See lice.h for license and other information
+
+
+  Vector versions of the common _LICE_CombinePixels* modes, one row at a time. This is not a public header,
+  lice.cpp includes it once per instruction set after defining:
+
+    LS_SIMD_FUNC(x)      name of the instantiated function x
+    LS_SIMD_ATTR         function attributes (target() for runtime dispatched sets), may be empty
+    LSV_P                vector of LSV_K pixels
+    LSV_W                the same pixels widened to 16 bit channels (half of them)
+    LSV_LOAD(p), LSV_STORE(p,v)    LSV_K pixels, unaligned
+    LSV_LO(v), LSV_HI(v)           first/second half of a pixel vector, widened
+    LSV_PACK(lo,hi)                narrow back to pixels, saturating to 0..255
+    LSV_SET1(x), LSV_ADD, LSV_SUB, LSV_MUL (low 16 bits), LSV_MULHI (unsigned, high 16 bits),
+    LSV_SRL8, LSV_SLL8, LSV_SIGN (0 or -1 per channel), LSV_XOR, LSV_AND, LSV_OR, LSV_ANDNOT(m,a) (a&~m),
+    LSV_EQ (all ones where equal)
+    LSV_ALPHA(w)         each pixel's alpha channel copied to all four of its channels
+    LSV_AMASK            all ones in the alpha channels
+    LSV_HALFMIX(d,s)     ((d>>1)&0x7f7f7f7f) + ((s>>1)&0x7f7f7f7f) per pixel
+
+  All kernels take 0 < ia <= 256 and give exactly what the scalar classes give, including the rounding of the
+  divides by 256, so the two can be mixed freely. The pixels past the last whole vector go through the scalar
+  classes.
+
+*/
+
+#define LS_SIMD_TAIL(comb) \
+  for (; i < n; i ++) \
+  { \
+    const LICE_pixel_chan *ps_=(const LICE_pixel_chan *)(src+i); \
+    comb::doPix((LICE_pixel_chan *)(dest+i),ps_[LICE_PIXEL_R],ps_[LICE_PIXEL_G],ps_[LICE_PIXEL_B],ps_[LICE_PIXEL_A],ia); \
+  }
+
+// s + ((d-s)*sc)/256, truncating towards zero like the scalar divide. |d-s|*sc fits 16 bits for sc <= 256.
+LS_SIMD_ATTR static inline LSV_W LS_SIMD_FUNC(lerp)(LSV_W s, LSV_W d, LSV_W sc)
+{
+  const LSV_W diff=LSV_SUB(d,s), sign=LSV_SIGN(diff);
+  const LSV_W q=LSV_SRL8(LSV_MUL(LSV_SUB(LSV_XOR(diff,sign),sign),sc));
+  return LSV_ADD(s,LSV_SUB(LSV_XOR(q,sign),sign));
+}
+
+// (ia*(a+1))/256 per pixel, the alpha the source alpha modes combine with. The product only reaches 65536 for
+// ia=256 and a=255, which the high half catches.
+LS_SIMD_ATTR static inline LSV_W LS_SIMD_FUNC(ualpha)(LSV_W s, LSV_W iav)
+{
+  const LSV_W a1=LSV_ADD(LSV_ALPHA(s),LSV_SET1(1));
+  return LSV_ADD(LSV_SRL8(LSV_MUL(a1,iav)),LSV_SLL8(LSV_MULHI(a1,iav)));
+}
+
+// _LICE_CombinePixelsCopyNoClamp, 0 < ia < 256
+LS_SIMD_ATTR static void LS_SIMD_FUNC(copy)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const LSV_W sc=LSV_SET1(256-ia);
+  int i;
+  for (i = 0; i + LSV_K <= n; i += LSV_K)
+  {
+    const LSV_P d=LSV_LOAD(dest+i), s=LSV_LOAD(src+i);
+    LSV_STORE(dest+i,LSV_PACK(LS_SIMD_FUNC(lerp)(LSV_LO(s),LSV_LO(d),sc),LS_SIMD_FUNC(lerp)(LSV_HI(s),LSV_HI(d),sc)));
+  }
+  LS_SIMD_TAIL(_LICE_CombinePixelsCopyNoClamp)
+}
+
+// _LICE_CombinePixelsCopySourceAlphaNoClamp, 0 < ia < 256. a=0 gives sc2=0, which leaves dest as it was.
+LS_SIMD_ATTR static inline LSV_W LS_SIMD_FUNC(copy_srcalpha_w)(LSV_W s, LSV_W d, LSV_W iav, LSV_W amask)
+{
+  const LSV_W sc2=LS_SIMD_FUNC(ualpha)(s,iav);
+  const LSV_W o=LS_SIMD_FUNC(lerp)(s,d,LSV_SUB(LSV_SET1(256),sc2));
+  return LSV_OR(LSV_AND(amask,LSV_ADD(sc2,d)),LSV_ANDNOT(amask,o)); // alpha = min(255,sc2+dest alpha), by the pack
+}
+
+LS_SIMD_ATTR static void LS_SIMD_FUNC(copy_srcalpha)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const LSV_W iav=LSV_SET1(ia), amask=LSV_AMASK;
+  int i;
+  for (i = 0; i + LSV_K <= n; i += LSV_K)
+  {
+    const LSV_P d=LSV_LOAD(dest+i), s=LSV_LOAD(src+i);
+    LSV_STORE(dest+i,LSV_PACK(LS_SIMD_FUNC(copy_srcalpha_w)(LSV_LO(s),LSV_LO(d),iav,amask),
+                              LS_SIMD_FUNC(copy_srcalpha_w)(LSV_HI(s),LSV_HI(d),iav,amask)));
+  }
+  LS_SIMD_TAIL(_LICE_CombinePixelsCopySourceAlphaNoClamp)
+}
+
+// _LICE_CombinePixelsCopySourceAlphaIgnoreAlphaParmNoClamp (ia == 256). a=255 falls out of the blend as a copy.
+LS_SIMD_ATTR static inline LSV_W LS_SIMD_FUNC(copy_srcalpha_full_w)(LSV_W s, LSV_W d, LSV_W amask)
+{
+  const LSV_W a=LSV_ALPHA(s);
+  LSV_W o=LS_SIMD_FUNC(lerp)(s,d,LSV_SUB(LSV_SET1(255),a));
+  o=LSV_OR(LSV_AND(amask,LSV_ADD(a,d)),LSV_ANDNOT(amask,o));
+  const LSV_W skip=LSV_EQ(a,LSV_SET1(0));
+  return LSV_OR(LSV_AND(skip,d),LSV_ANDNOT(skip,o));
+}
+
+LS_SIMD_ATTR static void LS_SIMD_FUNC(copy_srcalpha_full)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const LSV_W amask=LSV_AMASK;
+  int i;
+  for (i = 0; i + LSV_K <= n; i += LSV_K)
+  {
+    const LSV_P d=LSV_LOAD(dest+i), s=LSV_LOAD(src+i);
+    LSV_STORE(dest+i,LSV_PACK(LS_SIMD_FUNC(copy_srcalpha_full_w)(LSV_LO(s),LSV_LO(d),amask),
+                              LS_SIMD_FUNC(copy_srcalpha_full_w)(LSV_HI(s),LSV_HI(d),amask)));
+  }
+  LS_SIMD_TAIL(_LICE_CombinePixelsCopySourceAlphaIgnoreAlphaParmNoClamp)
+}
+
+// _LICE_CombinePixelsAdd: dest + (src*ia)/256, saturated by the pack
+LS_SIMD_ATTR static void LS_SIMD_FUNC(add)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const LSV_W iav=LSV_SET1(ia);
+  int i;
+  for (i = 0; i + LSV_K <= n; i += LSV_K)
+  {
+    const LSV_P d=LSV_LOAD(dest+i), s=LSV_LOAD(src+i);
+    LSV_STORE(dest+i,LSV_PACK(LSV_ADD(LSV_LO(d),LSV_SRL8(LSV_MUL(LSV_LO(s),iav))),
+                              LSV_ADD(LSV_HI(d),LSV_SRL8(LSV_MUL(LSV_HI(s),iav)))));
+  }
+  LS_SIMD_TAIL(_LICE_CombinePixelsAdd)
+}
+
+// _LICE_CombinePixelsAddSourceAlpha. a=0 gives a per pixel alpha of at most 1, which adds nothing.
+LS_SIMD_ATTR static inline LSV_W LS_SIMD_FUNC(add_srcalpha_w)(LSV_W s, LSV_W d, LSV_W iav)
+{
+  const LSV_W ua=LS_SIMD_FUNC(ualpha)(s,iav);
+  return LSV_ADD(d,LSV_SRL8(LSV_MUL(s,ua)));
+}
+
+LS_SIMD_ATTR static void LS_SIMD_FUNC(add_srcalpha)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const LSV_W iav=LSV_SET1(ia);
+  int i;
+  for (i = 0; i + LSV_K <= n; i += LSV_K)
+  {
+    const LSV_P d=LSV_LOAD(dest+i), s=LSV_LOAD(src+i);
+    LSV_STORE(dest+i,LSV_PACK(LS_SIMD_FUNC(add_srcalpha_w)(LSV_LO(s),LSV_LO(d),iav),
+                              LS_SIMD_FUNC(add_srcalpha_w)(LSV_HI(s),LSV_HI(d),iav)));
+  }
+  LS_SIMD_TAIL(_LICE_CombinePixelsAddSourceAlpha)
+}
+
+// _LICE_CombinePixelsMulNoClamp: (dest*((256-ia)*256 + src*ia))>>16. The factor is 65536-ia*(256-src), which fits
+// 16 bits for ia >= 1.
+LS_SIMD_ATTR static void LS_SIMD_FUNC(mul)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const LSV_W iav=LSV_SET1(ia), da=LSV_SET1((256-ia)*256);
+  int i;
+  for (i = 0; i + LSV_K <= n; i += LSV_K)
+  {
+    const LSV_P d=LSV_LOAD(dest+i), s=LSV_LOAD(src+i);
+    LSV_STORE(dest+i,LSV_PACK(LSV_MULHI(LSV_LO(d),LSV_ADD(da,LSV_MUL(LSV_LO(s),iav))),
+                              LSV_MULHI(LSV_HI(d),LSV_ADD(da,LSV_MUL(LSV_HI(s),iav)))));
+  }
+  LS_SIMD_TAIL(_LICE_CombinePixelsMulNoClamp)
+}
+
+// _LICE_CombinePixelsMulSourceAlphaNoClamp. Pixels with a=0 are skipped, as are those whose per pixel alpha
+// rounds to 0 (the factor would be 65536, i.e. dest unchanged).
+LS_SIMD_ATTR static inline LSV_W LS_SIMD_FUNC(mul_srcalpha_w)(LSV_W s, LSV_W d, LSV_W iav)
+{
+  const LSV_W a=LSV_ALPHA(s), zero=LSV_SET1(0);
+  const LSV_W ua=LS_SIMD_FUNC(ualpha)(s,iav);
+  const LSV_W o=LSV_MULHI(d,LSV_ADD(LSV_SLL8(LSV_SUB(LSV_SET1(256),ua)),LSV_MUL(s,ua)));
+  const LSV_W skip=LSV_OR(LSV_EQ(a,zero),LSV_EQ(ua,zero));
+  return LSV_OR(LSV_AND(skip,d),LSV_ANDNOT(skip,o));
+}
+
+LS_SIMD_ATTR static void LS_SIMD_FUNC(mul_srcalpha)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const LSV_W iav=LSV_SET1(ia);
+  int i;
+  for (i = 0; i + LSV_K <= n; i += LSV_K)
+  {
+    const LSV_P d=LSV_LOAD(dest+i), s=LSV_LOAD(src+i);
+    LSV_STORE(dest+i,LSV_PACK(LS_SIMD_FUNC(mul_srcalpha_w)(LSV_LO(s),LSV_LO(d),iav),
+                              LS_SIMD_FUNC(mul_srcalpha_w)(LSV_HI(s),LSV_HI(d),iav)));
+  }
+  LS_SIMD_TAIL(_LICE_CombinePixelsMulSourceAlphaNoClamp)
+}
+
+// _LICE_CombinePixelsHalfMixFAST, what LICE_Blit() does for a copy at alpha 0.5. ia is ignored.
+LS_SIMD_ATTR static void LS_SIMD_FUNC(halfmix)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  int i;
+  for (i = 0; i + LSV_K <= n; i += LSV_K)
+  {
+    LSV_STORE(dest+i,LSV_HALFMIX(LSV_LOAD(dest+i),LSV_LOAD(src+i)));
+  }
+  for (; i < n; i ++) _LICE_CombinePixelsHalfMixFAST::doPixFAST(dest+i,src[i]);
+}
+
+#undef LS_SIMD_TAIL
+
+static const lice_simd_funcs LS_SIMD_FUNC(funcs) =
+{
+  LS_SIMD_FUNC(copy), LS_SIMD_FUNC(copy_srcalpha), LS_SIMD_FUNC(copy_srcalpha_full),
+  LS_SIMD_FUNC(add), LS_SIMD_FUNC(add_srcalpha),
+  LS_SIMD_FUNC(mul), LS_SIMD_FUNC(mul_srcalpha),
+  LS_SIMD_FUNC(halfmix),
+};
@@ -91,13 +91,171 @@ private:
 };
 
 
+#ifndef WDL_RESAMPLE_NO_SIMD
+
+/*
+  SIMD versions of the sinc dot products (see resample_simd.h): AVX if the CPU/OS supports it, else SSE2. NEON on
+  ARM64. They work in double whatever WDL_ResampleSample/WDL_SincFilterSample are, like the scalar code.
+*/
+
+typedef struct
+{
+  int (*dot1)(const WDL_SincFilterSample *, const WDL_SincFilterSample *, const WDL_ResampleSample *, int, double *, double *);
+  int (*dot1p)(const WDL_SincFilterSample *, const WDL_ResampleSample *, int, double *);
+  int (*dot2)(const WDL_SincFilterSample *, const WDL_SincFilterSample *, const WDL_ResampleSample *, int, double *, double *);
+  int (*dot2p)(const WDL_SincFilterSample *, const WDL_ResampleSample *, int, double *);
+} resample_simd_funcs;
+
+static const resample_simd_funcs *resample_simd;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define RS_SIMD_SSE
+  #if defined(_MSC_VER) || (defined(__clang__) || __GNUC__ >= 5)
+    #define RS_SIMD_AVX
+  #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #define RS_SIMD_NEON
+#endif
+
+#ifdef RS_SIMD_SSE
+
+#ifdef RS_SIMD_AVX
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#include <emmintrin.h>
+#endif
+
+static inline __m128d rs_sse_load(const double *p) { return _mm_loadu_pd(p); }
+static inline __m128d rs_sse_load(const float *p) { return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double *)p))); }
+static inline __m128d rs_sse_load_dup(const double *p) { return _mm_set1_pd(*p); }
+static inline __m128d rs_sse_load_dup(const float *p) { return _mm_set1_pd((double)*p); }
+
+#define RSV_T __m128d
+#define RSV_K 2
+#define RSV_LOADF(p) rs_sse_load(p)
+#define RSV_LOADF2(p) rs_sse_load_dup(p)
+#define RSV_LOADS(p) rs_sse_load(p)
+#define RSV_ZERO _mm_setzero_pd()
+#define RSV_ADD _mm_add_pd
+#define RSV_MUL _mm_mul_pd
+#define RSV_STORE(p,v) _mm_storeu_pd(p,v)
+
+#define RS_SIMD_FUNC(x) rs_sse_##x
+#define RS_SIMD_ATTR
+#include "resample_simd.h"
+#undef RS_SIMD_FUNC
+#undef RS_SIMD_ATTR
+#undef RSV_T
+#undef RSV_K
+#undef RSV_LOADF
+#undef RSV_LOADF2
+#undef RSV_LOADS
+#undef RSV_ZERO
+#undef RSV_ADD
+#undef RSV_MUL
+#undef RSV_STORE
+
+#ifdef RS_SIMD_AVX
+
+#ifdef _MSC_VER
+#define RS_SIMD_ATTR
+#else
+#define RS_SIMD_ATTR __attribute__((target("avx")))
+#endif
+
+RS_SIMD_ATTR static inline __m256d rs_avx_load(const double *p) { return _mm256_loadu_pd(p); }
+RS_SIMD_ATTR static inline __m256d rs_avx_load(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+RS_SIMD_ATTR static inline __m256d rs_avx_load_dup(const double *p)
+{
+  const __m128d v=_mm_loadu_pd(p);
+  return _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_unpacklo_pd(v,v)),_mm_unpackhi_pd(v,v),1);
+}
+RS_SIMD_ATTR static inline __m256d rs_avx_load_dup(const float *p)
+{
+  const __m128 v=_mm_castpd_ps(_mm_load_sd((const double *)p));
+  return _mm256_cvtps_pd(_mm_unpacklo_ps(v,v));
+}
+
+#define RSV_T __m256d
+#define RSV_K 4
+#define RSV_LOADF(p) rs_avx_load(p)
+#define RSV_LOADF2(p) rs_avx_load_dup(p)
+#define RSV_LOADS(p) rs_avx_load(p)
+#define RSV_ZERO _mm256_setzero_pd()
+#define RSV_ADD _mm256_add_pd
+#define RSV_MUL _mm256_mul_pd
+#define RSV_STORE(p,v) _mm256_storeu_pd(p,v)
+
+#define RS_SIMD_FUNC(x) rs_avx_##x
+#include "resample_simd.h"
+#undef RS_SIMD_FUNC
+#undef RS_SIMD_ATTR
+
+static int rs_cpu_has_avx()
+{
+#ifdef _MSC_VER
+  int r[4];
+  __cpuid(r,1);
+  if ((r[2] & ((1<<27)|(1<<28))) != ((1<<27)|(1<<28))) return 0; // OSXSAVE, AVX
+  return (_xgetbv(0) & 6) == 6; // OS saves xmm/ymm
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx");
+#endif
+}
+
+#endif // RS_SIMD_AVX
+
+#elif defined(RS_SIMD_NEON)
+
+#include <arm_neon.h>
+
+static inline float64x2_t rs_neon_load(const double *p) { return vld1q_f64(p); }
+static inline float64x2_t rs_neon_load(const float *p) { return vcvt_f64_f32(vld1_f32(p)); }
+
+#define RSV_T float64x2_t
+#define RSV_K 2
+#define RSV_LOADF(p) rs_neon_load(p)
+#define RSV_LOADF2(p) vdupq_n_f64((double)*(p))
+#define RSV_LOADS(p) rs_neon_load(p)
+#define RSV_ZERO vdupq_n_f64(0.0)
+#define RSV_ADD vaddq_f64
+#define RSV_MUL vmulq_f64
+#define RSV_STORE(p,v) vst1q_f64(p,v)
+
+#define RS_SIMD_FUNC(x) rs_neon_##x
+#define RS_SIMD_ATTR
+#include "resample_simd.h"
+#undef RS_SIMD_FUNC
+#undef RS_SIMD_ATTR
+
+#endif
+
+static void resample_simd_init()
+{
+#if defined(RS_SIMD_AVX)
+  resample_simd = rs_cpu_has_avx() ? &rs_avx_funcs : &rs_sse_funcs;
+#elif defined(RS_SIMD_SSE)
+  resample_simd = &rs_sse_funcs;
+#elif defined(RS_SIMD_NEON)
+  resample_simd = &rs_neon_funcs;
+#endif
+}
+
+#endif // WDL_RESAMPLE_NO_SIMD
+
+
+// the phases are rows of m_filter_coeffs (see BuildLowPass()), fracpos interpolates between rows oversize-1-ifpos and the next
 void inline WDL_Resampler::SincSample(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, double fracpos, int nch, WDL_SincFilterSample *filter, int filtsz)
 {
   int oversize=m_lp_oversize;
   int x;
   fracpos *= oversize;
   int ifpos=(int)fracpos;
-  filter += oversize-1-ifpos;
+  filter += (oversize-1-ifpos)*filtsz;
   fracpos -= ifpos;
 
   for (x = 0; x < nch; x ++)
@@ -109,9 +267,9 @@ void inline WDL_Resampler::SincSample(WDL_ResampleSample *outptr, WDL_ResampleSa
     while (i--)
     {
       sum += fptr[0]*iptr[0]; 
-      sum2 += fptr[1]*iptr[0]; 
+      sum2 += fptr[filtsz]*iptr[0]; 
       iptr+=nch;
-      fptr += oversize;
+      fptr ++;
     }
     outptr[x]=sum*fracpos + sum2*(1.0-fracpos);
   }
@@ -123,19 +281,18 @@ void inline WDL_Resampler::SincSample1(WDL_ResampleSample *outptr, WDL_ResampleS
   int oversize=m_lp_oversize;
   fracpos *= oversize;
   int ifpos=(int)fracpos;
-  filter += oversize-1-ifpos;
+  filter += (oversize-1-ifpos)*filtsz;
   fracpos -= ifpos;
 
   double sum=0.0,sum2=0.0;
-  WDL_SincFilterSample *fptr=filter;
-  WDL_ResampleSample *iptr=inptr;
-  int i=filtsz;
-  while (i--)
+  int i=0;
+#ifndef WDL_RESAMPLE_NO_SIMD
+  if (resample_simd) i=resample_simd->dot1(filter,filter+filtsz,inptr,filtsz,&sum,&sum2);
+#endif
+  for (; i < filtsz; i ++)
   {
-    sum += fptr[0]*iptr[0]; 
-    sum2 += fptr[1]*iptr[0];
-    iptr++;
-    fptr += oversize;
+    sum += filter[i]*inptr[i]; 
+    sum2 += filter[filtsz+i]*inptr[i];
   }
   outptr[0]=sum*fracpos+sum2*(1.0-fracpos);
 
@@ -146,32 +303,70 @@ void inline WDL_Resampler::SincSample2(WDL_ResampleSample *outptr, WDL_ResampleS
   int oversize=m_lp_oversize;
   fracpos *= oversize;
   int ifpos=(int)fracpos;
-  filter += oversize-1-ifpos;
+  filter += (oversize-1-ifpos)*filtsz;
   fracpos -= ifpos;
 
-  double sum=0.0;
-  double sum2=0.0;
-  double sumb=0.0;
-  double sum2b=0.0;
-  WDL_SincFilterSample *fptr=filter;
-  WDL_ResampleSample *iptr=inptr;
-  int i=filtsz/2;
-  while (i--)
+  double sum[2]={0.0,0.0};
+  double sumb[2]={0.0,0.0};
+  int i=0;
+#ifndef WDL_RESAMPLE_NO_SIMD
+  if (resample_simd) i=resample_simd->dot2(filter,filter+filtsz,inptr,filtsz,sum,sumb);
+#endif
+  for (; i < filtsz; i ++)
+  {
+    sum[0] += filter[i]*inptr[i*2];
+    sum[1] += filter[i]*inptr[i*2+1];
+    sumb[0] += filter[filtsz+i]*inptr[i*2];
+    sumb[1] += filter[filtsz+i]*inptr[i*2+1];
+  }
+  outptr[0]=sum[0]*fracpos + sumb[0]*(1.0-fracpos);
+  outptr[1]=sum[1]*fracpos + sumb[1]*(1.0-fracpos);
+
+}
+
+// filter is the m_poly_coeffs row of the output phase
+void inline WDL_Resampler::PolySample(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, int nch, WDL_SincFilterSample *filter, int filtsz)
+{
+  int x;
+  for (x = 0; x < nch; x ++)
   {
-    sum += fptr[0]*iptr[0];
-    sum2 += fptr[0]*iptr[1];
-    sumb += fptr[1]*iptr[0];
-    sum2b += fptr[1]*iptr[1];
-    sum += fptr[oversize]*iptr[2];
-    sum2 += fptr[oversize]*iptr[3];
-    sumb += fptr[oversize+1]*iptr[2];
-    sum2b += fptr[oversize+1]*iptr[3];
-    iptr+=4;
-    fptr += oversize*2;
+    double sum=0.0;
+    WDL_ResampleSample *iptr=inptr+x;
+    int i;
+    for (i = 0; i < filtsz; i ++)
+    {
+      sum += filter[i]*iptr[0];
+      iptr+=nch;
+    }
+    outptr[x]=sum;
   }
-  outptr[0]=sum*fracpos + sumb*(1.0-fracpos);
-  outptr[1]=sum2*fracpos + sum2b*(1.0-fracpos);
+}
 
+void inline WDL_Resampler::PolySample1(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, WDL_SincFilterSample *filter, int filtsz)
+{
+  double sum=0.0;
+  int i=0;
+#ifndef WDL_RESAMPLE_NO_SIMD
+  if (resample_simd) i=resample_simd->dot1p(filter,inptr,filtsz,&sum);
+#endif
+  for (; i < filtsz; i ++) sum += filter[i]*inptr[i];
+  outptr[0]=sum;
+}
+
+void inline WDL_Resampler::PolySample2(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, WDL_SincFilterSample *filter, int filtsz)
+{
+  double sum[2]={0.0,0.0};
+  int i=0;
+#ifndef WDL_RESAMPLE_NO_SIMD
+  if (resample_simd) i=resample_simd->dot2p(filter,inptr,filtsz,sum);
+#endif
+  for (; i < filtsz; i ++)
+  {
+    sum[0] += filter[i]*inptr[i*2];
+    sum[1] += filter[i]*inptr[i*2+1];
+  }
+  outptr[0]=sum[0];
+  outptr[1]=sum[1];
 }
 
 
@@ -187,6 +382,7 @@ WDL_Resampler::WDL_Resampler()
   m_filtercnt=1;
   m_interp=true;
   m_feedmode=false;
+  m_polyphase=false;
 
   m_filter_coeffs_size=0; 
   m_sratein=44100.0; 
@@ -195,6 +391,14 @@ WDL_Resampler::WDL_Resampler()
   m_filter_ratio=-1.0; 
   m_iirfilter=0;
 
+  m_poly_in=m_poly_out=1;
+  m_poly_size=m_poly_phases=0;
+  m_poly_filtpos=-1.0;
+
+#ifndef WDL_RESAMPLE_NO_SIMD
+  if (!resample_simd) resample_simd_init();
+#endif
+
   Reset(); 
 }
 
@@ -227,12 +431,15 @@ void WDL_Resampler::SetMode(bool interp, int filtercnt, bool sinc, int sinc_size
   {
     m_filter_coeffs.Resize(0);
     m_filter_coeffs_size=0;
+    m_poly_coeffs.Resize(0);
+    m_poly_size=0;
   }
   if (!m_filtercnt) 
   {
     delete m_iirfilter;
     m_iirfilter=0;
   }
+  else if (!m_iirfilter) m_iirfilter = new WDL_Resampler_IIRFilter; // here rather than in ResampleOut(), which runs on the audio thread
 }
 
 void WDL_Resampler::SetRates(double rate_in, double rate_out) 
@@ -244,6 +451,18 @@ void WDL_Resampler::SetRates(double rate_in, double rate_out)
     m_sratein=rate_in; 
     m_srateout=rate_out;  
     m_ratio=m_sratein / m_srateout;
+
+    m_poly_in=m_poly_out=0;
+    if (rate_in == floor(rate_in) && rate_out == floor(rate_out) && rate_in < 2147483647.0 && rate_out < 2147483647.0)
+    {
+      int a=(int)rate_in, b=(int)rate_out;
+      while (b) { const int t=a%b; a=b; b=t; }
+      if ((int)rate_out/a <= WDL_RESAMPLE_MAX_POLYPHASE)
+      {
+        m_poly_in=(int)rate_in/a;
+        m_poly_out=(int)rate_out/a;
+      }
+    }
   }
 }
 
@@ -260,8 +479,10 @@ void WDL_Resampler::BuildLowPass(double filtpos) // only called in sinc modes
     m_lp_oversize = wantinterp;
     m_filter_ratio=filtpos;
 
-    // build lowpass filter
-    int allocsize = (wantsize+1)*m_lp_oversize;
+    // build lowpass filter. stored as m_lp_oversize+1 rows (phases) of wantsize taps: oversampled position
+    // k*m_lp_oversize+ph goes to row ph, tap k. row m_lp_oversize is row 0 shifted by one tap, so that the two
+    // phases SincSample() interpolates between are always adjacent rows
+    int allocsize = wantsize*(m_lp_oversize+1);
     WDL_SincFilterSample *cfout=m_filter_coeffs.Resize(allocsize);
     if (m_filter_coeffs.GetSize()==allocsize)
     {
@@ -284,11 +505,13 @@ void WDL_Resampler::BuildLowPass(double filtpos) // only called in sinc modes
         windowpos+=dwindowpos;
         sincpos += dsincpos;
 
-        cfout[hsz+x] = (WDL_SincFilterSample)val;
+        const int k=(hsz+x)/m_lp_oversize, ph=(hsz+x)%m_lp_oversize;
+        if (k < wantsize) cfout[ph*wantsize+k] = (WDL_SincFilterSample)val;
+        if (!ph && k>0) cfout[m_lp_oversize*wantsize+k-1] = (WDL_SincFilterSample)val;
         if (x < hsz) filtpower += val;
       }
       filtpower = m_lp_oversize/filtpower;
-      for (x = 0; x < sz+m_lp_oversize; x ++) 
+      for (x = 0; x < allocsize; x ++) 
       {
         cfout[x] = (WDL_SincFilterSample) (cfout[x]*filtpower);
       }
@@ -298,6 +521,48 @@ void WDL_Resampler::BuildLowPass(double filtpos) // only called in sinc modes
   }
 }
 
+bool WDL_Resampler::BuildPolyphase(double filtpos) // only called in sinc modes, m_poly_out>0
+{
+  const int wantsize=m_sincsize, nph=m_poly_out;
+  if (nph*wantsize > WDL_RESAMPLE_MAX_POLYPHASE_SIZE) return false;
+
+  if (m_poly_filtpos!=filtpos || m_poly_size != wantsize || m_poly_phases != nph)
+  {
+    WDL_SincFilterSample *cfout=m_poly_coeffs.ResizeOK(nph*wantsize);
+    if (!cfout)
+    {
+      m_poly_size=0;
+      return false;
+    }
+    m_poly_filtpos=filtpos;
+    m_poly_size=wantsize;
+    m_poly_phases=nph;
+
+    // the window and sinc of BuildLowPass(), evaluated exactly at each tap of each output phase (fracpos=ph/nph)
+    // rather than at the nearest oversampled positions. each phase is normalized to unity gain at DC
+    int ph, k;
+    for (ph = 0; ph < nph; ph ++)
+    {
+      WDL_SincFilterSample *row=cfout+ph*wantsize;
+      double filtpower=0.0;
+      for (k = 0; k < wantsize; k ++)
+      {
+        const double pos = k + 1 - ph/(double)nph;
+        const double windowpos = 2.0 * PI * pos / wantsize;
+        const double sincpos = PI * (pos - wantsize/2) * filtpos;
+        double val = 0.35875 - 0.48829 * cos(windowpos) + 0.14128 * cos(2*windowpos) - 0.01168 * cos(3*windowpos); // blackman-harris
+        if (fabs(sincpos) > 1.0e-12) val *= sin(sincpos) / sincpos;
+
+        row[k] = (WDL_SincFilterSample)val;
+        filtpower += val;
+      }
+      filtpower = 1.0/filtpower;
+      for (k = 0; k < wantsize; k ++) row[k] = (WDL_SincFilterSample) (row[k]*filtpower);
+    }
+  }
+  return true;
+}
+
 double WDL_Resampler::GetCurrentLatency() 
 { 
   double v=((double)m_samples_in_rsinbuf-m_filtlatency)/m_sratein;
@@ -408,7 +673,61 @@ int WDL_Resampler::ResampleOut(WDL_ResampleSample *out, int nsamples_in, int nsa
 
   int outlatadj=0;
 
-  if (m_sincsize) // sinc interpolating
+  if (m_sincsize && m_polyphase && m_poly_out>0 && BuildPolyphase(m_ratio > 1.0 ? 1.0 / (m_ratio*1.03) : 1.0)) // exact ratio sinc
+  {
+    int filtsz=m_poly_size;
+    int filtlen = rsinbuf_availtemp - filtsz;
+    outlatadj=filtsz/2-1;
+    WDL_SincFilterSample *filter=m_poly_coeffs.Get();
+
+    // srcpos is tracked as ipos + ph/nph, so it does not drift
+    const int nph=m_poly_out, dipos=m_poly_in/nph, dph=m_poly_in%nph;
+    int ipos=(int)srcpos;
+    int ph=(int) ((srcpos-ipos)*nph + 0.5);
+    if (ph>=nph) { ph-=nph; ipos++; }
+
+    if (nch == 1)
+    {
+      while (ns--)
+      {
+        if (ipos >= filtlen-1)  break; // quit decoding, not enough input samples
+
+        PolySample1(outptr,localin + ipos,filter + ph*filtsz,filtsz);
+        outptr ++;
+        ipos+=dipos;
+        if ((ph+=dph) >= nph) { ph-=nph; ipos++; }
+        ret++;
+      }
+    }
+    else if (nch==2)
+    {
+      while (ns--)
+      {
+        if (ipos >= filtlen-1)  break; // quit decoding, not enough input samples
+
+        PolySample2(outptr,localin + ipos*2,filter + ph*filtsz,filtsz);
+        outptr+=2;
+        ipos+=dipos;
+        if ((ph+=dph) >= nph) { ph-=nph; ipos++; }
+        ret++;
+      }
+    }
+    else
+    {
+      while (ns--)
+      {
+        if (ipos >= filtlen-1)  break; // quit decoding, not enough input samples
+
+        PolySample(outptr,localin + ipos*nch,nch,filter + ph*filtsz,filtsz);
+        outptr += nch;
+        ipos+=dipos;
+        if ((ph+=dph) >= nph) { ph-=nph; ipos++; }
+        ret++;
+      }
+    }
+    srcpos = ipos + ph/(double)nph;
+  }
+  else if (m_sincsize) // sinc interpolating
   {
     if (m_ratio > 1.0) BuildLowPass(1.0 / (m_ratio*1.03));
     else BuildLowPass(1.0);
@@ -53,6 +53,19 @@ typedef double WDL_ResampleSample;
 #define WDL_RESAMPLE_MAX_NCH 64
 #endif
 
+// sinc mode: when the rates are integers whose ratio reduces to in/out with out <= WDL_RESAMPLE_MAX_POLYPHASE (and the
+// table of out*sinc_size coefficients fits in WDL_RESAMPLE_MAX_POLYPHASE_SIZE), a filter is built for each of the out
+// output phases, so that each output sample is a single dot product with no interpolation between filter phases
+#ifndef WDL_RESAMPLE_MAX_POLYPHASE
+#define WDL_RESAMPLE_MAX_POLYPHASE 1024
+#endif
+
+#ifndef WDL_RESAMPLE_MAX_POLYPHASE_SIZE
+#define WDL_RESAMPLE_MAX_POLYPHASE_SIZE (1<<20)
+#endif
+
+//#define WDL_RESAMPLE_NO_SIMD // define to build the sinc dot products without SSE/AVX/NEON
+
 
 class WDL_Resampler
 {
@@ -64,6 +77,7 @@ public:
 
   void SetFilterParms(float filterpos=0.693, float filterq=0.707) { m_filterpos=filterpos; m_filterq=filterq; } // used for filtercnt>0 but not sinc
   void SetFeedMode(bool wantInputDriven) { m_feedmode=wantInputDriven; } // if true, that means the first parameter to ResamplePrepare will specify however much input you have, not how much you want
+  void SetPolyphase(bool allow) { m_polyphase=allow; } // default false, see WDL_RESAMPLE_MAX_POLYPHASE. output differs slightly from the interpolated sinc
 
   void Reset(double fracpos=0.0);
   void SetRates(double rate_in, double rate_out);
@@ -85,9 +99,13 @@ public:
 
 private:
   void BuildLowPass(double filtpos);
+  bool BuildPolyphase(double filtpos);
   void inline SincSample(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, double fracpos, int nch, WDL_SincFilterSample *filter, int filtsz);
   void inline SincSample1(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, double fracpos, WDL_SincFilterSample *filter, int filtsz);
   void inline SincSample2(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, double fracpos, WDL_SincFilterSample *filter, int filtsz);
+  void inline PolySample(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, int nch, WDL_SincFilterSample *filter, int filtsz);
+  void inline PolySample1(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, WDL_SincFilterSample *filter, int filtsz);
+  void inline PolySample2(WDL_ResampleSample *outptr, WDL_ResampleSample *inptr, WDL_SincFilterSample *filter, int filtsz);
 
   double m_sratein WDL_FIXALIGN;
   double m_srateout;
@@ -96,7 +114,9 @@ private:
   double m_filter_ratio;
   float m_filterq, m_filterpos;
   WDL_TypedBuf<WDL_ResampleSample> m_rsinbuf;
-  WDL_TypedBuf<WDL_SincFilterSample> m_filter_coeffs;
+  WDL_TypedBuf<WDL_SincFilterSample> m_filter_coeffs; // m_lp_oversize+1 phases of m_filter_coeffs_size taps
+  WDL_TypedBuf<WDL_SincFilterSample> m_poly_coeffs; // m_poly_out phases of m_poly_size taps
+  double m_poly_filtpos;
 
   class WDL_Resampler_IIRFilter;
   WDL_Resampler_IIRFilter *m_iirfilter;
@@ -110,8 +130,11 @@ private:
   int m_sincsize;
   int m_filtercnt;
   int m_sincoversize;
+  int m_poly_in, m_poly_out; // m_ratio == m_poly_in/m_poly_out, 0 if not usable
+  int m_poly_size, m_poly_phases; // of m_poly_coeffs
   bool m_interp;
   bool m_feedmode;
+  bool m_polyphase;
 
 };
 
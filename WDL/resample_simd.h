@@ -0,0 +1,116 @@
+/*
+    WDL - resample_simd.h
+    Copyright (C) 2010 and later Cockos Incorporated
+
+    This software is provided 'as-is', without any express or implied
+    warranty.  In no event will the authors be held liable for any damages
+    arising from the use of this software.
+
+    Permission is granted to anyone to use this software for any purpose,
+    including commercial applications, and to alter it and redistribute it
+    freely, subject to the following restrictions:
+
+    1. The origin of this software must not be misrepresented; you must not
+       claim that you wrote the original software. If you use this software
+       in a product, an acknowledgment in the product documentation would be
+       appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be
+       misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+
+    You may also distribute this software under the LGPL v2 or later.
+
+
+    Vector versions of the WDL_Resampler sinc dot products. This is not a public header, resample.cpp includes it
+    once per instruction set after defining:
+
+      RS_SIMD_FUNC(x)      name of the instantiated function x
+      RS_SIMD_ATTR         function attributes (target() for runtime dispatched sets), may be empty
+      RSV_T                vector of RSV_K doubles (sums are kept in double, as in the scalar code)
+      RSV_LOADF(p)         RSV_K filter coefficients, unaligned
+      RSV_LOADF2(p)        RSV_K/2 filter coefficients, each repeated twice (for interleaved stereo)
+      RSV_LOADS(p)         RSV_K samples, unaligned
+      RSV_ZERO, RSV_ADD, RSV_MUL, RSV_STORE(p,v)
+
+    Each function handles as many taps of its n as it can (returned), the caller does the rest. The phases are
+    rows of the filter table, so both the coefficients and (mono) samples are contiguous.
+
+*/
+
+// sum of all lanes
+#define RS_SIMD_HSUM(v, sum) { double t_[RSV_K]; int i_; RSV_STORE(t_,(v)); for (i_ = 0; i_ < RSV_K; i_ ++) (sum) += t_[i_]; }
+
+// sum of even and odd lanes (left and right)
+#define RS_SIMD_HSUM2(v, sums) { double t_[RSV_K]; int i_; RSV_STORE(t_,(v)); for (i_ = 0; i_ < RSV_K; i_ += 2) { (sums)[0] += t_[i_]; (sums)[1] += t_[i_+1]; } }
+
+// mono, two phases: *sa += fa.in, *sb += fb.in
+RS_SIMD_ATTR static int RS_SIMD_FUNC(dot1)(const WDL_SincFilterSample *fa, const WDL_SincFilterSample *fb, const WDL_ResampleSample *in, int n, double *sa, double *sb)
+{
+  RSV_T a=RSV_ZERO, b=RSV_ZERO;
+  int i;
+  n &= ~(RSV_K-1);
+  for (i = 0; i < n; i += RSV_K)
+  {
+    const RSV_T s=RSV_LOADS(in+i);
+    a=RSV_ADD(a,RSV_MUL(RSV_LOADF(fa+i),s));
+    b=RSV_ADD(b,RSV_MUL(RSV_LOADF(fb+i),s));
+  }
+  RS_SIMD_HSUM(a,*sa)
+  RS_SIMD_HSUM(b,*sb)
+  return n;
+}
+
+// mono, one phase: *sa += fa.in
+RS_SIMD_ATTR static int RS_SIMD_FUNC(dot1p)(const WDL_SincFilterSample *fa, const WDL_ResampleSample *in, int n, double *sa)
+{
+  RSV_T a=RSV_ZERO, a2=RSV_ZERO;
+  int i;
+  n &= ~(RSV_K*2-1);
+  for (i = 0; i < n; i += RSV_K*2)
+  {
+    a=RSV_ADD(a,RSV_MUL(RSV_LOADF(fa+i),RSV_LOADS(in+i)));
+    a2=RSV_ADD(a2,RSV_MUL(RSV_LOADF(fa+i+RSV_K),RSV_LOADS(in+i+RSV_K)));
+  }
+  RS_SIMD_HSUM(RSV_ADD(a,a2),*sa)
+  return n;
+}
+
+// interleaved stereo, two phases: sa[0..1] += fa.in, sb[0..1] += fb.in
+RS_SIMD_ATTR static int RS_SIMD_FUNC(dot2)(const WDL_SincFilterSample *fa, const WDL_SincFilterSample *fb, const WDL_ResampleSample *in, int n, double *sa, double *sb)
+{
+  RSV_T a=RSV_ZERO, b=RSV_ZERO;
+  int i;
+  n &= ~(RSV_K/2-1);
+  for (i = 0; i < n; i += RSV_K/2)
+  {
+    const RSV_T s=RSV_LOADS(in+i*2);
+    a=RSV_ADD(a,RSV_MUL(RSV_LOADF2(fa+i),s));
+    b=RSV_ADD(b,RSV_MUL(RSV_LOADF2(fb+i),s));
+  }
+  RS_SIMD_HSUM2(a,sa)
+  RS_SIMD_HSUM2(b,sb)
+  return n;
+}
+
+// interleaved stereo, one phase: sa[0..1] += fa.in
+RS_SIMD_ATTR static int RS_SIMD_FUNC(dot2p)(const WDL_SincFilterSample *fa, const WDL_ResampleSample *in, int n, double *sa)
+{
+  RSV_T a=RSV_ZERO, a2=RSV_ZERO;
+  int i;
+  n &= ~(RSV_K-1);
+  for (i = 0; i < n; i += RSV_K)
+  {
+    a=RSV_ADD(a,RSV_MUL(RSV_LOADF2(fa+i),RSV_LOADS(in+i*2)));
+    a2=RSV_ADD(a2,RSV_MUL(RSV_LOADF2(fa+i+RSV_K/2),RSV_LOADS(in+i*2+RSV_K)));
+  }
+  RS_SIMD_HSUM2(RSV_ADD(a,a2),sa)
+  return n;
+}
+
+#undef RS_SIMD_HSUM
+#undef RS_SIMD_HSUM2
+
+static const resample_simd_funcs RS_SIMD_FUNC(funcs) =
+{
+  RS_SIMD_FUNC(dot1), RS_SIMD_FUNC(dot1p), RS_SIMD_FUNC(dot2), RS_SIMD_FUNC(dot2p),
+};
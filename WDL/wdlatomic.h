@@ -3,20 +3,51 @@
 
 #ifdef _WIN32
 
-static int wdl_atomic_incr(int *v) { return (int) InterlockedIncrement((LONG *)v); }
-static int wdl_atomic_decr(int *v) { return (int) InterlockedDecrement((LONG *)v); }
+static inline int wdl_atomic_incr(int *v) { return (int) InterlockedIncrement((LONG *)v); }
+static inline int wdl_atomic_decr(int *v) { return (int) InterlockedDecrement((LONG *)v); }
+static inline int wdl_atomic_exchange(int *v, int nv) { return (int) InterlockedExchange((LONG *)v, (LONG)nv); }
+static inline int wdl_atomic_get(const int *v) { int r = *(const volatile int *)v; MemoryBarrier(); return r; }
+static inline void wdl_atomic_set(int *v, int nv) { MemoryBarrier(); *(volatile int *)v = nv; }
+// doubles must be 8 byte aligned (the MSVC default), so that they're read and written as a whole
+static inline double wdl_atomic_get_double(const double *v) { double r = *(const volatile double *)v; MemoryBarrier(); return r; }
+static inline void wdl_atomic_set_double(double *v, double nv) { MemoryBarrier(); *(volatile double *)v = nv; }
 
 #elif !defined(__ppc__) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 2))))
 
-static int wdl_atomic_incr(int *v) { return __sync_add_and_fetch(v,1); }
-static int wdl_atomic_decr(int *v) { return __sync_add_and_fetch(v,~0); }
+static inline int wdl_atomic_incr(int *v) { return __sync_add_and_fetch(v,1); }
+static inline int wdl_atomic_decr(int *v) { return __sync_add_and_fetch(v,~0); }
+static inline int wdl_atomic_exchange(int *v, int nv) { __sync_synchronize(); return __sync_lock_test_and_set(v,nv); }
+static inline int wdl_atomic_get(const int *v) { int r = *(const volatile int *)v; __sync_synchronize(); return r; }
+static inline void wdl_atomic_set(int *v, int nv) { __sync_synchronize(); *(volatile int *)v = nv; }
+#ifdef __ATOMIC_SEQ_CST
+// loaded and stored as the 64 bit integer with the same bits, which the _n builtins accept
+typedef union { unsigned long long i; double d; } wdl_atomic_double_bits;
+#if !defined(__clang__) && __GNUC__ >= 11
+// GCC 11+ reports loads through a pointer it can't rule out being NULL+offset (e.g. ptrlist Get()->member) as overflows
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstringop-overflow"
+#endif
+static inline double wdl_atomic_get_double(const double *v) { wdl_atomic_double_bits r; r.i = __atomic_load_n((const unsigned long long *)v,__ATOMIC_SEQ_CST); return r.d; }
+#if !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+static inline void wdl_atomic_set_double(double *v, double nv) { wdl_atomic_double_bits r; r.d = nv; __atomic_store_n((unsigned long long *)v,r.i,__ATOMIC_SEQ_CST); }
+#else
+static inline double wdl_atomic_get_double(const double *v) { double r = *(const volatile double *)v; __sync_synchronize(); return r; }
+static inline void wdl_atomic_set_double(double *v, double nv) { __sync_synchronize(); *(volatile double *)v = nv; }
+#endif
 
 #elif defined(__APPLE__)
 // used by GCC < 4.2 on OSX
 #include <libkern/OSAtomic.h>
 
-static int wdl_atomic_incr(int *v) { return (int) OSAtomicIncrement32Barrier((int32_t*)v); }
-static int wdl_atomic_decr(int *v) { return (int) OSAtomicDecrement32Barrier((int32_t*)v); }
+static inline int wdl_atomic_incr(int *v) { return (int) OSAtomicIncrement32Barrier((int32_t*)v); }
+static inline int wdl_atomic_decr(int *v) { return (int) OSAtomicDecrement32Barrier((int32_t*)v); }
+static inline int wdl_atomic_exchange(int *v, int nv) { int ov; do { ov = *(volatile int *)v; } while (!OSAtomicCompareAndSwap32Barrier(ov,nv,(int32_t*)v)); return ov; }
+static inline int wdl_atomic_get(const int *v) { int r = *(const volatile int *)v; OSMemoryBarrier(); return r; }
+static inline void wdl_atomic_set(int *v, int nv) { OSMemoryBarrier(); *(volatile int *)v = nv; }
+static inline double wdl_atomic_get_double(const double *v) { double r = *(const volatile double *)v; OSMemoryBarrier(); return r; }
+static inline void wdl_atomic_set_double(double *v, double nv) { OSMemoryBarrier(); *(volatile double *)v = nv; }
 #else
 
 // unsupported! 